@@ -0,0 +1,199 @@
+//+------------------------------------------------------------------+
+//|                         Asynchronous Request Workers and Replies |
+//+------------------------------------------------------------------+
+#ifndef MT4ASYNC_H
+#define MT4ASYNC_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MT4Metrics.h"
+
+//+------------------------------------------------------------------+
+//| MT4AsyncReply - Outcome of one asynchronous request              |
+//| code is the Manager API return code (RET_OK on success) and      |
+//| error its description, filled on the worker that ran the call.   |
+//+------------------------------------------------------------------+
+template <class T>
+struct MT4AsyncReply {
+    int code;
+    std::string error;
+    T value;
+    
+    MT4AsyncReply() : code(0), value() {}
+    
+    bool ok() const { return code == 0; }
+};
+
+// Completion callback of an asynchronous request, run on a worker
+template <class T>
+using MT4AsyncCallback = std::function<void(const MT4AsyncReply<T>&)>;
+
+//+------------------------------------------------------------------+
+//| MT4AsyncPromise - Adapts a completion callback to a std::future  |
+//+------------------------------------------------------------------+
+template <class T>
+class MT4AsyncPromise {
+private:
+    std::shared_ptr<std::promise<MT4AsyncReply<T> > > m_promise;
+
+public:
+    MT4AsyncPromise() : m_promise(std::make_shared<std::promise<MT4AsyncReply<T> > >()) {}
+    
+    std::future<MT4AsyncReply<T> > getFuture() {
+        return m_promise->get_future();
+    }
+    
+    MT4AsyncCallback<T> getCallback() const {
+        std::shared_ptr<std::promise<MT4AsyncReply<T> > > promise = m_promise;
+        return [promise](const MT4AsyncReply<T>& reply) { promise->set_value(reply); };
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4AsyncWorkers - Fixed set of threads draining one FIFO         |
+//| Jobs start in submission order; with several workers they run    |
+//| concurrently. stop() lets queued jobs finish; called from a job  |
+//| it would wait for itself, so it refuses and returns false.       |
+//+------------------------------------------------------------------+
+class MT4AsyncWorkers {
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::pair<std::function<void()>, uint64_t> > m_jobs;   // job, MT4MetricsNow() at post
+    std::mutex m_lock;
+    std::condition_variable m_ready;
+    bool m_running;
+    std::atomic<unsigned long long> m_completed;
+    MT4LatencyHistogram m_wait;             // post() to job start
+    
+    MT4AsyncWorkers(const MT4AsyncWorkers&);
+    MT4AsyncWorkers& operator=(const MT4AsyncWorkers&);
+    
+    // Worker set the calling thread belongs to, NULL outside any worker
+    static const MT4AsyncWorkers*& current() {
+        thread_local const MT4AsyncWorkers* workers = NULL;
+        return workers;
+    }
+    
+    void run() {
+        current() = this;
+        
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_ready.wait(lock, [this]() { return !m_jobs.empty() || !m_running; });
+                
+                if (m_jobs.empty()) {
+                    return;
+                }
+                
+                job.swap(m_jobs.front().first);
+                m_wait.recordSince(m_jobs.front().second);
+                m_jobs.pop_front();
+            }
+            
+            job();
+            m_completed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    MT4AsyncWorkers() : m_running(false), m_completed(0) {}
+    
+    ~MT4AsyncWorkers() {
+        stop();
+    }
+    
+    // Start count worker threads
+    bool start(int count) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        if (m_running) {
+            return true;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        
+        m_running = true;
+        for (int i = 0; i < count; i++) {
+            m_threads.push_back(std::thread(&MT4AsyncWorkers::run, this));
+        }
+        return true;
+    }
+    
+    // Finish queued jobs and join the workers; false (and nothing
+    // stopped) when called from one of the workers
+    bool stop() {
+        if (isCurrentThread()) {
+            return false;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_running = false;
+        }
+        m_ready.notify_all();
+        
+        for (size_t i = 0; i < m_threads.size(); i++) {
+            m_threads[i].join();
+        }
+        m_threads.clear();
+        return true;
+    }
+    
+    // Check if the calling thread is one of these workers
+    bool isCurrentThread() const {
+        return current() == this;
+    }
+    
+    // Queue a job; false if the workers are not running
+    bool post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_running) {
+                return false;
+            }
+            m_jobs.push_back(std::make_pair(std::move(job), MT4MetricsNow()));
+        }
+        m_ready.notify_one();
+        return true;
+    }
+    
+    bool isRunning() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_running;
+    }
+    
+    // Number of worker threads
+    int size() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return (int)m_threads.size();
+    }
+    
+    // Jobs waiting for a worker
+    int pending() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return (int)m_jobs.size();
+    }
+    
+    // Jobs finished since construction
+    unsigned long long getCompletedCount() const {
+        return m_completed.load(std::memory_order_relaxed);
+    }
+    
+    // Time jobs spent queued before a worker picked them up
+    const MT4LatencyHistogram& getWaitLatency() const {
+        return m_wait;
+    }
+};
+
+#endif // MT4ASYNC_H
@@ -0,0 +1,355 @@
+//+------------------------------------------------------------------+
+//|                         Incremental OHLC Bars from Pumped Quotes |
+//+------------------------------------------------------------------+
+#ifndef MT4BARS_H
+#define MT4BARS_H
+
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+
+// Default closed bars kept per symbol and period
+#define MT4_BAR_HISTORY 1024
+
+// Most closed bars init() accepts; each symbol allocates the history
+// for every period when its first quote arrives
+#define MT4_BAR_MAX_HISTORY 65536
+
+enum MT4BarPeriod {
+    MT4_BAR_M1,
+    MT4_BAR_M5,
+    MT4_BAR_H1,
+    MT4_BAR_PERIOD_COUNT
+};
+
+constexpr int MT4_BAR_SECONDS[] = { 60, 300, 3600 };
+
+constexpr const char* MT4_BAR_NAMES[] = { "M1", "M5", "H1" };
+
+static_assert(sizeof(MT4_BAR_SECONDS) / sizeof(MT4_BAR_SECONDS[0]) == MT4_BAR_PERIOD_COUNT, "Every period needs a length");
+static_assert(sizeof(MT4_BAR_NAMES) / sizeof(MT4_BAR_NAMES[0]) == MT4_BAR_PERIOD_COUNT, "Every period needs a name");
+
+//+------------------------------------------------------------------+
+//| MT4Bar - One bid OHLC bar, 48 bytes without padding              |
+//+------------------------------------------------------------------+
+struct MT4Bar {
+    int time;                   // bar open, server time
+    int symbol_id;
+    int period;                 // MT4BarPeriod
+    int ticks;
+    double open;
+    double high;
+    double low;
+    double close;
+};
+
+// Closed bars, called on the pumping thread in close order
+typedef std::function<void(const MT4Bar* bars, int count)> MT4BarCallback;
+
+//+------------------------------------------------------------------+
+//| MT4BarBuilder - Rolling M1/M5/H1 bars per symbol id              |
+//| Registered as a listener it folds every pumped bid into the      |
+//| forming bar of each period. A bar closes when a tick of a later  |
+//| bar arrives or, for quiet symbols, once the server clock (the    |
+//| newest lasttime seen, advanced on PUMP_PING) passes its end.     |
+//| Closed bars go to a ring of fixed length per symbol and period,  |
+//| allocated when the symbol first shows up and never resized, and  |
+//| to the subscribers. Readers copy bars out under a per-symbol     |
+//| lock held only for a few stores by the pumping thread.           |
+//+------------------------------------------------------------------+
+class MT4BarBuilder : public MT4PumpListener {
+private:
+    struct Series {
+        MT4Bar* ring;
+        int head;                   // next slot to write
+        int count;                  // closed bars held, up to the history
+        bool forming;
+        MT4Bar current;
+    };
+    
+    struct SymbolBars {
+        std::mutex lock;
+        MT4Bar* storage;
+        Series series[MT4_BAR_PERIOD_COUNT];
+    };
+    
+    const MT4QuoteTable& m_quotes;
+    int m_history;
+    std::atomic<SymbolBars*> m_symbols[MT4_MAX_SYMBOLS];
+    std::atomic<int> m_symbol_count;        // highest allocated id + 1
+    
+    // Pumping thread only
+    long long m_clock;                      // newest server time seen
+    long long m_clock_local;                // local time when m_clock was set
+    long long m_swept;                      // server time of the last sweep
+    std::vector<MT4Bar> m_closed;
+    
+    std::vector<std::pair<int, MT4BarCallback> > m_subscribers;
+    std::mutex m_subscribers_lock;
+    int m_next_subscriber;
+    
+    std::atomic<unsigned long long> m_closed_count;
+    std::atomic<unsigned long long> m_late_count;
+    
+    MT4BarBuilder(const MT4BarBuilder&);
+    MT4BarBuilder& operator=(const MT4BarBuilder&);
+    
+    SymbolBars* allocate(int id) {
+        SymbolBars* bars = m_symbols[id].load(std::memory_order_acquire);
+        if (bars != NULL) {
+            return bars;
+        }
+        
+        bars = new SymbolBars();
+        bars->storage = new MT4Bar[(size_t)m_history * MT4_BAR_PERIOD_COUNT];
+        for (int p = 0; p < MT4_BAR_PERIOD_COUNT; p++) {
+            bars->series[p].ring = bars->storage + (size_t)m_history * p;
+            bars->series[p].head = 0;
+            bars->series[p].count = 0;
+            bars->series[p].forming = false;
+        }
+        
+        m_symbols[id].store(bars, std::memory_order_release);
+        if (id >= m_symbol_count.load(std::memory_order_relaxed)) {
+            m_symbol_count.store(id + 1, std::memory_order_release);
+        }
+        return bars;
+    }
+    
+    void closeLocked(Series& series) {
+        series.ring[series.head] = series.current;
+        series.head = (series.head + 1) % m_history;
+        if (series.count < m_history) {
+            series.count++;
+        }
+        series.forming = false;
+        m_closed.push_back(series.current);
+    }
+    
+    void update(int id, double price, long long time) {
+        SymbolBars* bars = allocate(id);
+        std::lock_guard<std::mutex> lock(bars->lock);
+        
+        for (int p = 0; p < MT4_BAR_PERIOD_COUNT; p++) {
+            Series& series = bars->series[p];
+            int start = (int)(time - time % MT4_BAR_SECONDS[p]);
+            
+            if (series.forming && start > series.current.time) {
+                closeLocked(series);
+            }
+            
+            if (!series.forming) {
+                if (series.count > 0 && start <= series.ring[(series.head + m_history - 1) % m_history].time) {
+                    m_late_count++;
+                    continue;
+                }
+                
+                MT4Bar& bar = series.current;
+                bar.time = start;
+                bar.symbol_id = id;
+                bar.period = p;
+                bar.ticks = 1;
+                bar.open = bar.high = bar.low = bar.close = price;
+                series.forming = true;
+            } else if (start == series.current.time) {
+                MT4Bar& bar = series.current;
+                if (price > bar.high) {
+                    bar.high = price;
+                }
+                if (price < bar.low) {
+                    bar.low = price;
+                }
+                bar.close = price;
+                bar.ticks++;
+            } else {
+                // Older than the forming bar
+                m_late_count++;
+            }
+        }
+    }
+    
+    // Close every forming bar that ended by now (server time)
+    void sweep(long long now) {
+        int count = m_symbol_count.load(std::memory_order_acquire);
+        
+        for (int id = 0; id < count; id++) {
+            SymbolBars* bars = m_symbols[id].load(std::memory_order_acquire);
+            if (bars == NULL) {
+                continue;
+            }
+            
+            std::lock_guard<std::mutex> lock(bars->lock);
+            for (int p = 0; p < MT4_BAR_PERIOD_COUNT; p++) {
+                Series& series = bars->series[p];
+                if (series.forming && series.current.time + MT4_BAR_SECONDS[p] <= now) {
+                    closeLocked(series);
+                }
+            }
+        }
+        m_swept = now;
+    }
+    
+    void publish() {
+        if (m_closed.empty()) {
+            return;
+        }
+        
+        m_closed_count += m_closed.size();
+        {
+            std::lock_guard<std::mutex> lock(m_subscribers_lock);
+            for (size_t i = 0; i < m_subscribers.size(); i++) {
+                m_subscribers[i].second(m_closed.data(), (int)m_closed.size());
+            }
+        }
+        m_closed.clear();
+    }
+
+public:
+    MT4BarBuilder(const MT4QuoteTable& quotes)
+        : m_quotes(quotes), m_history(MT4_BAR_HISTORY), m_symbol_count(0),
+          m_clock(0), m_clock_local(0), m_swept(0), m_next_subscriber(1),
+          m_closed_count(0), m_late_count(0) {
+        for (int i = 0; i < MT4_MAX_SYMBOLS; i++) {
+            m_symbols[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+    
+    ~MT4BarBuilder() {
+        for (int i = 0; i < MT4_MAX_SYMBOLS; i++) {
+            SymbolBars* bars = m_symbols[i].load();
+            if (bars != NULL) {
+                delete[] bars->storage;
+                delete bars;
+            }
+        }
+    }
+    
+    // Set the closed bars kept per symbol and period, 1 to
+    // MT4_BAR_MAX_HISTORY; only before the builder is registered
+    bool init(int history = MT4_BAR_HISTORY) {
+        if (history <= 0 || history > MT4_BAR_MAX_HISTORY || m_symbol_count.load() > 0) {
+            return false;
+        }
+        m_history = history;
+        return true;
+    }
+    
+    int getHistory() const {
+        return m_history;
+    }
+    
+    // Copy up to max_bars of the newest bars of a symbol id, oldest
+    // first. With forming, the last one is the still open bar.
+    int getBars(int symbol_id, MT4BarPeriod period, MT4Bar* bars, int max_bars, bool forming = true) const {
+        if (symbol_id < 0 || symbol_id >= MT4_MAX_SYMBOLS || period < 0 || period >= MT4_BAR_PERIOD_COUNT ||
+            max_bars <= 0) {
+            return 0;
+        }
+        
+        SymbolBars* symbol = m_symbols[symbol_id].load(std::memory_order_acquire);
+        if (symbol == NULL) {
+            return 0;
+        }
+        
+        std::lock_guard<std::mutex> lock(symbol->lock);
+        const Series& series = symbol->series[period];
+        
+        int open = forming && series.forming ? 1 : 0;
+        int closed = series.count < max_bars - open ? series.count : max_bars - open;
+        int first = (series.head + m_history - closed) % m_history;
+        
+        for (int i = 0; i < closed; i++) {
+            bars[i] = series.ring[(first + i) % m_history];
+        }
+        if (open) {
+            bars[closed] = series.current;
+        }
+        return closed + open;
+    }
+    
+    int getBars(const char* symbol, MT4BarPeriod period, MT4Bar* bars, int max_bars, bool forming = true) const {
+        return getBars(m_quotes.findSymbol(symbol), period, bars, max_bars, forming);
+    }
+    
+    // Register a callback for closed bars; returns an id for
+    // unsubscribe(). Callbacks must not subscribe or unsubscribe.
+    int subscribe(MT4BarCallback callback) {
+        std::lock_guard<std::mutex> lock(m_subscribers_lock);
+        int id = m_next_subscriber++;
+        m_subscribers.push_back(std::make_pair(id, callback));
+        return id;
+    }
+    
+    void unsubscribe(int id) {
+        std::lock_guard<std::mutex> lock(m_subscribers_lock);
+        for (size_t i = 0; i < m_subscribers.size(); i++) {
+            if (m_subscribers[i].first == id) {
+                m_subscribers.erase(m_subscribers.begin() + i);
+                return;
+            }
+        }
+    }
+    
+    // Statistics
+    unsigned long long getClosedCount() const { return m_closed_count; }
+    unsigned long long getLateCount() const { return m_late_count; }
+    
+    int getSymbolCount() const {
+        int count = 0;
+        for (int i = 0; i < m_symbol_count.load(std::memory_order_acquire); i++) {
+            if (m_symbols[i].load(std::memory_order_acquire) != NULL) {
+                count++;
+            }
+        }
+        return count;
+    }
+    
+    // Allocate the rings of every known symbol up front
+    void onPumpingStarted(CManagerInterface* pump) {
+        for (int id = 0; id < m_quotes.getSymbolCount(); id++) {
+            allocate(id);
+        }
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        for (int i = 0; i < count; i++) {
+            int id = m_quotes.findSymbol(quotes[i].symbol);
+            if (id < 0) {
+                continue;
+            }
+            
+            long long time = (long long)quotes[i].lasttime;
+            update(id, quotes[i].bid, time);
+            if (time > m_clock) {
+                m_clock = time;
+                m_clock_local = (long long)::time(NULL);
+            }
+        }
+        
+        // Quiet symbols close at most once per second of server time
+        if (m_clock > m_swept) {
+            sweep(m_clock);
+        }
+        publish();
+    }
+    
+    // The server clock keeps running between ticks
+    void onPing() {
+        if (m_clock == 0) {
+            return;
+        }
+        
+        long long now = m_clock + ((long long)time(NULL) - m_clock_local);
+        if (now > m_swept) {
+            sweep(now);
+        }
+        publish();
+    }
+};
+
+#endif // MT4BARS_H
@@ -0,0 +1,701 @@
+//+------------------------------------------------------------------+
+//|                      MT4Manager Wrapper Benchmarks (Fake Server) |
+//+------------------------------------------------------------------+
+// Measures the C++ wrapper against MT4FakeManager, so results show the
+// cost of the connector itself rather than of a real server. Build with
+// build_benchmark.bat and run from a console:
+//
+//   MT4Benchmark.exe [--users N] [--trades N] [--symbols N]
+//                    [--latency-us N] [--iterations N] [--ticks N] [--tick-rate N]
+//                    [--replay FILE] [--replay-speed X]
+//                    [--save-baseline FILE] [--baseline FILE] [--threshold PCT]
+//
+// --latency-us adds a busy-wait round trip to every request call;
+// --tick-rate 0 publishes ticks back to back.
+//
+// --replay feeds a recorded MT4JournalWriter day file through the
+// pumping engine instead of running the synthetic suite; --replay-speed
+// 0 (the default) replays as fast as the listeners allow.
+//
+// --save-baseline writes every reported figure to FILE. --baseline
+// compares the run against such a file and exits with status 2 when a
+// figure is worse by more than --threshold percent (default 10).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MT4Manager.h"
+#include "MT4FakeManager.h"
+
+struct BenchOptions {
+    MT4FakeConfig fake;
+    int iterations;
+    int ticks;
+    int tick_rate;              // ticks per second, 0 for unpaced
+    const char* replay;         // journal day file, NULL for the synthetic suite
+    double replay_speed;
+    const char* baseline;
+    const char* save_baseline;
+    double threshold;           // allowed regression, percent
+    
+    BenchOptions()
+        : iterations(200), ticks(1000000), tick_rate(0), replay(NULL), replay_speed(0),
+          baseline(NULL), save_baseline(NULL), threshold(10) {}
+};
+
+// One reported figure, kept for --save-baseline and --baseline
+struct BenchResult {
+    std::string name;
+    double value;
+    bool higher_is_better;
+};
+
+static std::vector<BenchResult> g_results;
+
+static void record(const std::string& name, double value, bool higher_is_better) {
+    BenchResult result;
+    result.name = name;
+    result.value = value;
+    result.higher_is_better = higher_is_better;
+    g_results.push_back(result);
+}
+
+static double secondsSince(uint64_t start) {
+    return (MT4MetricsNow() - start) / 1e9;
+}
+
+// Rates ("/s") are better high; times and counts are better low
+static void report(const char* name, double value, const char* unit) {
+    printf("  %-40s %14.1f %s\n", name, value, unit);
+    record(name, value, strstr(unit, "/s") != NULL);
+}
+
+static void reportLatency(const char* name, const MT4LatencyHistogram& h) {
+    MT4LatencySummary s = h.summarize();
+    printf("  %-40s n=%-9llu p50=%9.1f  p99=%9.1f  p99.9=%9.1f  max=%9.1f us\n", name,
+           (unsigned long long)s.count, s.p50_us, s.p99_us, s.p999_us, s.max_us);
+    if (s.count > 0) {
+        record(std::string(name) + " p50", s.p50_us, false);
+        record(std::string(name) + " p99", s.p99_us, false);
+    }
+}
+
+// Connect and log in a manager wrapping fake
+static bool logIn(MT4Manager& manager) {
+    return manager.connect("fake") && manager.login(1, "fake");
+}
+
+//+------------------------------------------------------------------+
+//| Bulk request copies: views keep the API buffer, the vector forms |
+//| copy every record into a wrapper object                          |
+//+------------------------------------------------------------------+
+static void benchBulk(const BenchOptions& options) {
+    printf("Bulk requests (%d trades, %d users)\n", options.fake.trades, options.fake.users);
+    
+    MT4FakeManager fake(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return;
+    }
+    
+    uint64_t start = MT4MetricsNow();
+    long long records = 0;
+    for (int i = 0; i < options.iterations; i++) {
+        TradeRecordView view = manager.getTradesView();
+        records += view.size();
+    }
+    double elapsed = secondsSince(start);
+    report("getTradesView", records / elapsed / 1e6, "M records/s");
+    report("getTradesView bandwidth", records * sizeof(TradeRecord) / elapsed / 1e6, "MB/s");
+    
+    start = MT4MetricsNow();
+    records = 0;
+    for (int i = 0; i < options.iterations; i++) {
+        records += (long long)manager.getTrades().size();
+    }
+    elapsed = secondsSince(start);
+    report("getTrades (vector<MT4Trade>)", records / elapsed / 1e6, "M records/s");
+    
+    start = MT4MetricsNow();
+    records = 0;
+    for (int i = 0; i < options.iterations; i++) {
+        UserRecordView view = manager.getAccountsView();
+        records += view.size();
+    }
+    elapsed = secondsSince(start);
+    report("getAccountsView", records / elapsed / 1e6, "M records/s");
+    
+    start = MT4MetricsNow();
+    records = 0;
+    for (int i = 0; i < options.iterations; i++) {
+        records += (long long)manager.getAccounts().size();
+    }
+    elapsed = secondsSince(start);
+    report("getAccounts (vector<MT4Account>)", records / elapsed / 1e6, "M records/s");
+    
+    reportLatency("TradesRequest", manager.getCallLatency(MT4_CALL_TRADES_REQUEST));
+    reportLatency("UsersRequest", manager.getCallLatency(MT4_CALL_USERS_REQUEST));
+}
+
+//+------------------------------------------------------------------+
+//| openTrade ticket resolution: reported by the server, or found by |
+//| scanning the login's trades when the server leaves order at 0    |
+//+------------------------------------------------------------------+
+static void benchOpenTrade(const BenchOptions& options, bool report_tickets) {
+    MT4FakeConfig config = options.fake;
+    config.report_tickets = report_tickets;
+    
+    MT4FakeManager fake(config);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return;
+    }
+    
+    MT4LatencyHistogram latency;
+    int resolved = 0;
+    
+    for (int i = 0; i < options.iterations; i++) {
+        uint64_t start = MT4MetricsNow();
+        int login = MT4_FAKE_FIRST_LOGIN + i % config.users;
+        if (manager.openTrade(login, "FAKE000", OP_BUY, 1.0, 1.1) != 0) {
+            resolved++;
+        }
+        latency.recordSince(start);
+    }
+    
+    reportLatency(report_tickets ? "openTrade (ticket reported)" : "openTrade (TradesGetByLogin scan)", latency);
+    if (resolved != options.iterations) {
+        printf("  %d of %d tickets not resolved\n", options.iterations - resolved, options.iterations);
+    }
+}
+
+// Drive an attached engine to PUMP_START_PUMPING, so every listener
+// loads its snapshot from the fake
+static void startFakePumping(MT4Manager& manager, MT4FakeManager& pump) {
+    manager.getPumpingEngine().attach(&pump);
+    manager.getPumpingEngine().dispatch(PUMP_START_PUMPING, 0, NULL);
+}
+
+//+------------------------------------------------------------------+
+//| Pump decode: quotes and trade updates through every built-in     |
+//| listener (quote table, trade book, margin engine, stores, ...)   |
+//+------------------------------------------------------------------+
+static void benchPumpDecode(const BenchOptions& options) {
+    printf("Pump decode (%d symbols, %d open trades)\n", options.fake.symbols, options.fake.trades);
+    
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return;
+    }
+    
+    uint64_t start = MT4MetricsNow();
+    startFakePumping(manager, pump);
+    report("PUMP_START_PUMPING snapshot load", secondsSince(start) * 1000, "ms");
+    
+    MT4PumpingEngine& engine = manager.getPumpingEngine();
+    std::vector<SymbolInfo> batch(MT4_PUMP_QUOTE_BATCH);
+    
+    start = MT4MetricsNow();
+    long long quotes = 0;
+    for (int i = 0; quotes < options.ticks; i++) {
+        for (int j = 0; j < MT4_PUMP_QUOTE_BATCH; j++) {
+            batch[j] = pump.makeQuote(i * MT4_PUMP_QUOTE_BATCH + j, 1.1 + (j % 100) * 0.00001);
+        }
+        pump.pushQuotes(&batch[0], MT4_PUMP_QUOTE_BATCH);
+        engine.dispatch(PUMP_UPDATE_BIDASK, 0, NULL);
+        quotes += MT4_PUMP_QUOTE_BATCH;
+    }
+    report("quotes", quotes / secondsSince(start) / 1e6, "M quotes/s");
+    
+    int events = options.ticks / 10;
+    start = MT4MetricsNow();
+    for (int i = 0; i < events; i++) {
+        TradeRecord trade = pump.makeTrade(i);
+        engine.dispatch(PUMP_UPDATE_TRADES, TRANS_UPDATE, &trade);
+    }
+    report("trade updates", events / secondsSince(start) / 1e6, "M events/s");
+    
+    reportLatency("dispatch per notification", engine.getDispatchLatency());
+}
+
+//+------------------------------------------------------------------+
+//| Pre-trade checks: cost of MT4RiskChecker::check() on an order    |
+//| that passes every rule, with limits loaded by pumping            |
+//+------------------------------------------------------------------+
+static void benchRiskCheck(const BenchOptions& options) {
+    printf("Pre-trade checks (%d symbols, %d users)\n", options.fake.symbols, options.fake.users);
+    
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return;
+    }
+    startFakePumping(manager, pump);
+    manager.enableRiskChecks(true);
+    
+    TradeTransInfo trade = MT4Manager::makeOpenTrade(MT4_FAKE_FIRST_LOGIN, "FAKE000", OP_BUY, 0.1, 1.1);
+    MT4RiskChecker& risk = manager.getRiskChecker();
+    int checks = options.iterations * 1000;
+    int passed = 0;
+    
+    uint64_t start = MT4MetricsNow();
+    for (int i = 0; i < checks; i++) {
+        passed += risk.check(trade) == RET_OK;
+    }
+    double elapsed = secondsSince(start);
+    
+    report("check()", elapsed * 1e9 / checks, "ns per order");
+    if (passed != checks) {
+        printf("  %d of %d checks rejected\n", checks - passed, checks);
+    }
+}
+
+//+------------------------------------------------------------------+
+//| Startup: caches filled by request calls against a snapshot load  |
+//+------------------------------------------------------------------+
+static void benchSnapshot(const BenchOptions& options) {
+    printf("Snapshot startup (%d trades, %d users)\n", options.fake.trades, options.fake.users);
+    
+    const char* path = "MT4Benchmark.snapshot";
+    MT4FakeManager fake(options.fake);
+    {
+        MT4Manager manager(&fake);
+        if (!logIn(manager)) {
+            printf("  login failed: %s\n", manager.getLastError());
+            return;
+        }
+        
+        uint64_t start = MT4MetricsNow();
+        manager.reconcileSnapshot();
+        report("request calls", secondsSince(start) * 1e3, "ms");
+        
+        start = MT4MetricsNow();
+        if (!manager.saveSnapshot(path)) {
+            printf("  save failed: %s\n", manager.getLastError());
+            return;
+        }
+        report("saveSnapshot()", secondsSince(start) * 1e3, "ms");
+    }
+    
+    MT4Manager manager(&fake);
+    uint64_t start = MT4MetricsNow();
+    if (!manager.loadSnapshot(path)) {
+        printf("  load failed: %s\n", manager.getLastError());
+        return;
+    }
+    report("loadSnapshot()", secondsSince(start) * 1e3, "ms");
+    DeleteFileA(path);
+}
+
+static void benchQuery(const BenchOptions& options) {
+    printf("Trade book queries (%d trades, %d users)\n", options.fake.trades, options.fake.users);
+    
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return;
+    }
+    startFakePumping(manager, pump);
+    
+    // FAKE000 lot-or-larger buys opened in the last day, any demo group
+    MT4TradeQuery query;
+    query.group = "demo*";
+    query.symbol = "FAKE000";
+    query.cmd = OP_BUY;
+    query.open_from = time(NULL) - 86400;
+    query.volume_min = 100;
+    
+    std::vector<TradeRecord> trades;
+    uint64_t start = MT4MetricsNow();
+    for (int i = 0; i < options.iterations; i++) {
+        trades.clear();
+        manager.queryTrades(query, trades);
+    }
+    report("queryTrades()", secondsSince(start) * 1e6 / options.iterations, "us per query");
+    printf("  %d trades matched\n", (int)trades.size());
+}
+
+// Single-object lookups served by the pumped stores: the pointer
+// getters draw from the wrapper pools, find* return by value
+static void benchLookups(const BenchOptions& options) {
+    printf("Single-object lookups (%d users)\n", options.fake.users);
+    
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return;
+    }
+    startFakePumping(manager, pump);
+    
+    int lookups = options.iterations * 1000;
+    long long found = 0;
+    uint64_t start = MT4MetricsNow();
+    for (int i = 0; i < lookups; i++) {
+        MT4Account* account = manager.getAccount(MT4_FAKE_FIRST_LOGIN + i % options.fake.users);
+        found += account != NULL;
+        delete account;
+    }
+    report("getAccount() + delete", secondsSince(start) * 1e9 / lookups, "ns per lookup");
+    
+    start = MT4MetricsNow();
+    for (int i = 0; i < lookups; i++) {
+        found += manager.findAccount(MT4_FAKE_FIRST_LOGIN + i % options.fake.users).has_value();
+    }
+    report("findAccount()", secondsSince(start) * 1e9 / lookups, "ns per lookup");
+    printf("  %lld found, %llu pool fallbacks\n", found, MT4Account::objectPool().fallbacks());
+}
+
+//+------------------------------------------------------------------+
+//| Tick to consumer: ticks published on a producer thread, drained  |
+//| from the pump queue on a consumer thread                         |
+//+------------------------------------------------------------------+
+class TickConsumer : public MT4PumpListener {
+public:
+    const std::vector<uint64_t>& stamps;
+    MT4LatencyHistogram latency;
+    std::atomic<long long> received;
+    
+    explicit TickConsumer(const std::vector<uint64_t>& published) : stamps(published), received(0) {}
+    
+    // bid carries the tick's sequence number
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        uint64_t now = MT4MetricsNow();
+        for (int i = 0; i < count; i++) {
+            size_t seq = (size_t)quotes[i].bid;
+            if (seq < stamps.size()) {
+                latency.record(now - stamps[seq]);
+            }
+        }
+        received.fetch_add(count, std::memory_order_relaxed);
+    }
+};
+
+static void benchTickToConsumer(const BenchOptions& options) {
+    printf("Tick to consumer (%d ticks, %s)\n", options.ticks, options.tick_rate > 0 ? "paced" : "unpaced");
+    
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager) || !manager.enablePumpQueue()) {
+        printf("  setup failed: %s\n", manager.getLastError());
+        return;
+    }
+    startFakePumping(manager, pump);
+    
+    std::vector<uint64_t> stamps(options.ticks);
+    TickConsumer consumer(stamps);
+    std::atomic<bool> producing(true);
+    
+    std::thread drain([&]() {
+        while (producing.load(std::memory_order_acquire) || manager.getPumpQueue().depth() > 0) {
+            if (manager.drainPumpQueue(&consumer) == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    
+    MT4PumpingEngine& engine = manager.getPumpingEngine();
+    uint64_t interval = options.tick_rate > 0 ? 1000000000ULL / options.tick_rate : 0;
+    uint64_t start = MT4MetricsNow();
+    
+    for (int i = 0; i < options.ticks; i++) {
+        if (interval > 0) {
+            uint64_t due = start + interval * i;
+            while (MT4MetricsNow() < due) {
+            }
+        }
+        
+        SymbolInfo tick = pump.makeQuote(i, (double)i);
+        stamps[i] = MT4MetricsNow();
+        pump.pushQuotes(&tick, 1);
+        engine.dispatch(PUMP_UPDATE_BIDASK, 0, NULL);
+    }
+    
+    producing.store(false, std::memory_order_release);
+    drain.join();
+    
+    report("published", options.ticks / secondsSince(start) / 1e6, "M ticks/s");
+    report("dropped by pump queue", (double)manager.getPumpQueue().dropped(), "ticks");
+    reportLatency("tick to consumer", consumer.latency);
+}
+
+//+------------------------------------------------------------------+
+//| Sharded dispatch: a handler costing about one microsecond per    |
+//| quote, run on one shard and then on one shard per core           |
+//+------------------------------------------------------------------+
+class SlowHandler : public MT4PumpListener {
+public:
+    std::atomic<long long> received;
+    
+    SlowHandler() : received(0) {}
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        for (int i = 0; i < count; i++) {
+            uint64_t until = MT4MetricsNow() + 1000;
+            while (MT4MetricsNow() < until) {
+            }
+        }
+        received.fetch_add(count, std::memory_order_relaxed);
+    }
+};
+
+static void benchShardedRun(const BenchOptions& options, int shards, long long quotes) {
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    SlowHandler handler;
+    
+    if (!logIn(manager) || !manager.addShardedHandler(&handler) || !manager.enableShardedDispatch(shards)) {
+        printf("  setup failed: %s\n", manager.getLastError());
+        return;
+    }
+    startFakePumping(manager, pump);
+    
+    const MT4ShardedDispatcher& dispatcher = manager.getDispatcher();
+    MT4PumpingEngine& engine = manager.getPumpingEngine();
+    std::vector<SymbolInfo> batch(MT4_PUMP_QUOTE_BATCH);
+    uint64_t start = MT4MetricsNow();
+    
+    for (long long sent = 0; sent < quotes; sent += MT4_PUMP_QUOTE_BATCH) {
+        // Stay below the ring capacity so the run measures handler throughput
+        while (dispatcher.depth() > MT4_PUMP_QUEUE_QUOTES / 2) {
+            std::this_thread::yield();
+        }
+        for (int j = 0; j < MT4_PUMP_QUOTE_BATCH; j++) {
+            batch[j] = pump.makeQuote((int)sent + j, 1.1);
+        }
+        pump.pushQuotes(&batch[0], MT4_PUMP_QUOTE_BATCH);
+        engine.dispatch(PUMP_UPDATE_BIDASK, 0, NULL);
+    }
+    while (handler.received.load() + (long long)dispatcher.dropped() < quotes) {
+        std::this_thread::yield();
+    }
+    
+    char name[64];
+    snprintf(name, sizeof(name), "%d shard(s)%s", dispatcher.getShardCount(), shards == 0 ? ", one per core" : "");
+    report(name, handler.received.load() / secondsSince(start) / 1e6, "M quotes/s");
+}
+
+static void benchShardedDispatch(const BenchOptions& options) {
+    long long quotes = options.ticks / 10;
+    printf("Sharded dispatch (%lld quotes, 1 us handler)\n", quotes);
+    
+    benchShardedRun(options, 1, quotes);
+    benchShardedRun(options, 0, quotes);
+}
+
+//+------------------------------------------------------------------+
+//| Journal replay: recorded quotes and trade events pushed through  |
+//| the pumping engine and every built-in listener                   |
+//+------------------------------------------------------------------+
+class ReplayFeed : public MT4PumpListener {
+public:
+    MT4FakeManager& pump;
+    MT4PumpingEngine& engine;
+    long long quotes;
+    long long trades;
+    
+    ReplayFeed(MT4FakeManager& fake, MT4PumpingEngine& target) : pump(fake), engine(target), quotes(0), trades(0) {}
+    
+    void onQuotes(const SymbolInfo* batch, int count) {
+        pump.pushQuotes(batch, count);
+        engine.dispatch(PUMP_UPDATE_BIDASK, 0, NULL);
+        quotes += count;
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        engine.deliverTrades(events, count);
+        trades += count;
+    }
+};
+
+static bool benchReplay(const BenchOptions& options) {
+    printf("Journal replay (%s, speed %.1f)\n", options.replay, options.replay_speed);
+    
+    MT4JournalReader reader;
+    if (!reader.open(options.replay)) {
+        printf("  cannot open journal %s\n", options.replay);
+        return false;
+    }
+    
+    MT4FakeManager fake(options.fake);
+    MT4FakeManager pump(options.fake);
+    MT4Manager manager(&fake);
+    if (!logIn(manager)) {
+        printf("  login failed: %s\n", manager.getLastError());
+        return false;
+    }
+    startFakePumping(manager, pump);
+    
+    MT4PumpingEngine& engine = manager.getPumpingEngine();
+    ReplayFeed feed(pump, engine);
+    MT4JournalReplay replay(reader);
+    replay.addListener(&feed);
+    
+    uint64_t start = MT4MetricsNow();
+    unsigned long long batches = replay.run(options.replay_speed);
+    double elapsed = secondsSince(start);
+    
+    printf("  %llu batches, %lld quotes, %lld trade events\n", batches, feed.quotes, feed.trades);
+    if (elapsed > 0 && batches > 0) {
+        report("replayed quotes", feed.quotes / elapsed / 1e6, "M quotes/s");
+        report("replayed trade events", feed.trades / elapsed / 1e6, "M events/s");
+    }
+    reportLatency("dispatch per notification", engine.getDispatchLatency());
+    return true;
+}
+
+//+------------------------------------------------------------------+
+//| Baselines: one "value<TAB>name" line per reported figure         |
+//+------------------------------------------------------------------+
+static bool saveBaseline(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        printf("Cannot write baseline %s\n", path);
+        return false;
+    }
+    for (size_t i = 0; i < g_results.size(); i++) {
+        fprintf(f, "%.6g\t%s\n", g_results[i].value, g_results[i].name.c_str());
+    }
+    bool ok = fclose(f) == 0;
+    if (!ok) {
+        printf("Cannot write baseline %s\n", path);
+    }
+    return ok;
+}
+
+// Compare this run with a saved baseline; returns the number of figures
+// worse by more than threshold percent, or -1 if the file is unreadable
+static int compareBaseline(const char* path, double threshold) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        printf("Cannot read baseline %s\n", path);
+        return -1;
+    }
+    
+    std::map<std::string, double> baseline;
+    char line[512];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char* name = strchr(line, '\t');
+        if (name == NULL) {
+            continue;
+        }
+        *name++ = '\0';
+        name[strcspn(name, "\r\n")] = '\0';
+        baseline[name] = atof(line);
+    }
+    fclose(f);
+    
+    printf("Baseline comparison (%s, threshold %.1f%%)\n", path, threshold);
+    int regressions = 0;
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const BenchResult& r = g_results[i];
+        std::map<std::string, double>::const_iterator it = baseline.find(r.name);
+        if (it == baseline.end() || it->second == 0) {
+            printf("  %-40s %14.1f (no baseline)\n", r.name.c_str(), r.value);
+            continue;
+        }
+        
+        double change = (r.value - it->second) / it->second * 100;
+        bool regressed = r.higher_is_better ? change < -threshold : change > threshold;
+        regressions += regressed;
+        printf("  %-40s %14.1f -> %14.1f %+7.1f%%%s\n", r.name.c_str(), it->second, r.value, change,
+               regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* text = argv[i + 1];
+        int value = atoi(text);
+        if (strcmp(argv[i], "--users") == 0) {
+            options.fake.users = value;
+        } else if (strcmp(argv[i], "--trades") == 0) {
+            options.fake.trades = value;
+        } else if (strcmp(argv[i], "--symbols") == 0) {
+            options.fake.symbols = value;
+        } else if (strcmp(argv[i], "--latency-us") == 0) {
+            options.fake.latency_us = value;
+        } else if (strcmp(argv[i], "--iterations") == 0) {
+            options.iterations = value;
+        } else if (strcmp(argv[i], "--ticks") == 0) {
+            options.ticks = value;
+        } else if (strcmp(argv[i], "--tick-rate") == 0) {
+            options.tick_rate = value;
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            options.replay = text;
+        } else if (strcmp(argv[i], "--replay-speed") == 0) {
+            options.replay_speed = atof(text);
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            options.baseline = text;
+        } else if (strcmp(argv[i], "--save-baseline") == 0) {
+            options.save_baseline = text;
+        } else if (strcmp(argv[i], "--threshold") == 0) {
+            options.threshold = atof(text);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    if (options.iterations < 1 || options.ticks < 1 || options.fake.users < 1) {
+        printf("--iterations, --ticks and --users must be positive\n");
+        return 1;
+    }
+    if (options.threshold < 0 || options.replay_speed < 0) {
+        printf("--threshold and --replay-speed must not be negative\n");
+        return 1;
+    }
+    
+    if (options.replay != NULL) {
+        if (!benchReplay(options)) {
+            return 1;
+        }
+    } else {
+        benchBulk(options);
+        printf("openTrade (%d calls, %d us server latency)\n", options.iterations, options.fake.latency_us);
+        benchOpenTrade(options, true);
+        benchOpenTrade(options, false);
+        benchPumpDecode(options);
+        benchRiskCheck(options);
+        benchSnapshot(options);
+        benchQuery(options);
+        benchLookups(options);
+        benchTickToConsumer(options);
+        benchShardedDispatch(options);
+    }
+    
+    if (options.save_baseline != NULL && !saveBaseline(options.save_baseline)) {
+        return 1;
+    }
+    if (options.baseline != NULL) {
+        int regressions = compareBaseline(options.baseline, options.threshold);
+        if (regressions < 0) {
+            return 1;
+        }
+        if (regressions > 0) {
+            printf("%d figure(s) regressed beyond %.1f%%\n", regressions, options.threshold);
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,580 @@
+//+------------------------------------------------------------------+
+//|                     Structure-of-arrays Account and Symbol Stores |
+//+------------------------------------------------------------------+
+#ifndef MT4COLUMNSTORE_H
+#define MT4COLUMNSTORE_H
+
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+#include "MT4Dictionary.h"
+#include "MT4Metrics.h"
+
+// Deleted logins remembered for deltas; older deltas become full
+#define MT4_ACCOUNT_TOMBSTONES 65536
+
+//+------------------------------------------------------------------+
+//| MT4AccountDelta - Accounts changed since a version               |
+//+------------------------------------------------------------------+
+struct MT4AccountDelta {
+    uint64_t version;                   // pass as since on the next call
+    bool full;                          // changed holds every account, removed is empty
+    std::vector<UserRecord> changed;    // added or updated since
+    std::vector<int> removed;           // logins deleted since
+};
+
+//+------------------------------------------------------------------+
+//| MT4AccountChange - One account change passed to subscribers      |
+//+------------------------------------------------------------------+
+struct MT4AccountChange {
+    int type;                   // TRANS_ADD, TRANS_UPDATE or TRANS_DELETE
+    uint64_t version;
+    const UserRecord* user;     // valid during the callback only
+};
+
+// Called after each batch of account changes, outside the store lock
+typedef std::function<void(const MT4AccountChange* changes, int count)> MT4AccountCallback;
+
+//+------------------------------------------------------------------+
+//| MT4AccountStore - Hot account columns with a cold record table   |
+//| Scans (balance filters, group sweeps) read only the dense hot    |
+//| columns; the full UserRecord of a row lives in a parallel cold   |
+//| table and is only touched on lookup. Rows are swap-removed, so   |
+//| row numbers are stable only under the read lock.                 |
+//| Every change stamps its row with the next store version, which   |
+//| makes the version column the dirty set of getChangedSince().     |
+//| Versions start at the MT4MetricsNow() of construction, so one    |
+//| from an earlier process or lost deletions yield a full delta.    |
+//| load() diffs against the current rows and only stamps records    |
+//| that differ.                                                     |
+//+------------------------------------------------------------------+
+class MT4AccountStore : public MT4PumpListener {
+public:
+    // Read-only view of the hot columns, valid inside read()
+    struct Columns {
+        int count;
+        const int* login;
+        const double* balance;
+        const double* credit;
+        const int* leverage;
+        const int* group_id;
+        const uint64_t* version;
+        const UserRecord* record;
+    };
+
+private:
+    std::vector<int> m_login;
+    std::vector<double> m_balance;
+    std::vector<double> m_credit;
+    std::vector<int> m_leverage;
+    std::vector<int> m_group_id;
+    std::vector<uint64_t> m_version;
+    std::vector<UserRecord> m_cold;
+    std::unordered_map<int, int> m_rows;                // login -> row
+    std::deque<std::pair<uint64_t, int> > m_removed;    // version, login of deletions
+    uint64_t m_floor;                                   // deltas from before this are full
+    std::atomic<uint64_t> m_current;
+    MT4Dictionary& m_dictionary;
+    mutable std::shared_mutex m_lock;
+    std::atomic<bool> m_ready;
+    
+    std::vector<std::pair<int, MT4AccountCallback> > m_subscribers;
+    std::mutex m_subscribers_lock;
+    int m_next_subscriber;
+    
+    MT4AccountStore(const MT4AccountStore&);
+    MT4AccountStore& operator=(const MT4AccountStore&);
+    
+    uint64_t stampLocked() {
+        uint64_t version = m_current.load(std::memory_order_relaxed) + 1;
+        m_current.store(version, std::memory_order_release);
+        return version;
+    }
+    
+    // A new group takes the dictionary lock, so it is never interned
+    // under m_lock; rows resolve the id with findGroup()
+    void internGroup(const char* group) {
+        m_dictionary.addGroup(group);
+    }
+    
+    void setRowLocked(int row, const UserRecord& user, uint64_t version) {
+        m_login[row] = user.login;
+        m_balance[row] = user.balance;
+        m_credit[row] = user.credit;
+        m_leverage[row] = user.leverage;
+        m_group_id[row] = m_dictionary.findGroup(user.group);
+        m_version[row] = version;
+        m_cold[row] = user;
+    }
+    
+    // Insert or update user; returns the change type
+    int upsertLocked(const UserRecord& user, uint64_t version) {
+        std::unordered_map<int, int>::iterator it = m_rows.find(user.login);
+        if (it != m_rows.end()) {
+            setRowLocked(it->second, user, version);
+            return TRANS_UPDATE;
+        }
+        
+        int row = (int)m_login.size();
+        m_login.push_back(0);
+        m_balance.push_back(0);
+        m_credit.push_back(0);
+        m_leverage.push_back(0);
+        m_group_id.push_back(0);
+        m_version.push_back(0);
+        m_cold.push_back(user);
+        setRowLocked(row, user, version);
+        m_rows[user.login] = row;
+        return TRANS_ADD;
+    }
+    
+    // Remember a deleted login; dropping the oldest raises the floor
+    void tombstoneLocked(int login, uint64_t version) {
+        m_removed.push_back(std::make_pair(version, login));
+        if (m_removed.size() > MT4_ACCOUNT_TOMBSTONES) {
+            m_floor = m_removed.front().first;
+            m_removed.pop_front();
+        }
+    }
+    
+    void removeLocked(int login, uint64_t version) {
+        std::unordered_map<int, int>::iterator it = m_rows.find(login);
+        if (it == m_rows.end()) {
+            return;
+        }
+        
+        int row = it->second;
+        int last = (int)m_login.size() - 1;
+        m_rows.erase(it);
+        
+        if (row != last) {
+            m_login[row] = m_login[last];
+            m_balance[row] = m_balance[last];
+            m_credit[row] = m_credit[last];
+            m_leverage[row] = m_leverage[last];
+            m_group_id[row] = m_group_id[last];
+            m_version[row] = m_version[last];
+            m_cold[row] = m_cold[last];
+            m_rows[m_login[row]] = row;
+        }
+        
+        m_login.pop_back();
+        m_balance.pop_back();
+        m_credit.pop_back();
+        m_leverage.pop_back();
+        m_group_id.pop_back();
+        m_version.pop_back();
+        m_cold.pop_back();
+        
+        tombstoneLocked(login, version);
+    }
+    
+    void notify(const std::vector<MT4AccountChange>& changes) {
+        if (changes.empty()) {
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(m_subscribers_lock);
+        for (size_t i = 0; i < m_subscribers.size(); i++) {
+            m_subscribers[i].second(changes.data(), (int)changes.size());
+        }
+    }
+
+public:
+    explicit MT4AccountStore(MT4Dictionary& dictionary)
+        : m_floor(MT4MetricsNow()), m_current(m_floor), m_dictionary(dictionary), m_ready(false),
+          m_next_subscriber(1) {}
+    
+    // Replace the store contents with a full user list; only records
+    // that differ from the current ones get a new version
+    void load(const UserRecord* users, int total) {
+        std::vector<MT4AccountChange> changes;
+        std::vector<UserRecord> previous;
+        std::vector<uint64_t> versions;
+        std::unordered_map<int, int> rows;
+        for (int i = 0; i < total; i++) {
+            internGroup(users[i].group);
+        }
+        {
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            
+            previous.swap(m_cold);
+            versions.swap(m_version);
+            rows.swap(m_rows);
+            
+            m_login.clear();
+            m_balance.clear();
+            m_credit.clear();
+            m_leverage.clear();
+            m_group_id.clear();
+            
+            m_login.reserve(total);
+            m_balance.reserve(total);
+            m_credit.reserve(total);
+            m_leverage.reserve(total);
+            m_group_id.reserve(total);
+            m_version.reserve(total);
+            m_cold.reserve(total);
+            m_rows.reserve(total);
+            
+            for (int i = 0; i < total; i++) {
+                std::unordered_map<int, int>::iterator it = rows.find(users[i].login);
+                if (it == rows.end()) {
+                    MT4AccountChange change = { TRANS_ADD, stampLocked(), &users[i] };
+                    upsertLocked(users[i], change.version);
+                    changes.push_back(change);
+                    continue;
+                }
+                
+                int row = it->second;
+                rows.erase(it);
+                if (memcmp(&previous[row], &users[i], sizeof(UserRecord)) == 0) {
+                    upsertLocked(users[i], versions[row]);
+                    continue;
+                }
+                
+                MT4AccountChange change = { TRANS_UPDATE, stampLocked(), &users[i] };
+                upsertLocked(users[i], change.version);
+                changes.push_back(change);
+            }
+            
+            // Whatever is left in rows was not in the new list
+            for (std::unordered_map<int, int>::iterator it = rows.begin(); it != rows.end(); ++it) {
+                MT4AccountChange change = { TRANS_DELETE, stampLocked(), &previous[it->second] };
+                tombstoneLocked(it->first, change.version);
+                changes.push_back(change);
+            }
+            
+            m_ready = true;
+        }
+        
+        notify(changes);
+    }
+    
+    // Apply one user record change
+    void apply(int type, const UserRecord& user) {
+        MT4UserEvent event;
+        event.type = type;
+        event.user = user;
+        onUsers(&event, 1);
+    }
+    
+    // Check whether the store has been loaded and can be trusted
+    bool isReady() const {
+        return m_ready;
+    }
+    
+    // Number of accounts in the store
+    int size() const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        return (int)m_login.size();
+    }
+    
+    // Version of the latest change
+    uint64_t getVersion() const {
+        return m_current.load(std::memory_order_acquire);
+    }
+    
+    // Run fn(const Columns&) with the hot columns under the read lock
+    template <class Fn>
+    void read(Fn fn) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        Columns cols;
+        cols.count = (int)m_login.size();
+        cols.login = m_login.data();
+        cols.balance = m_balance.data();
+        cols.credit = m_credit.data();
+        cols.leverage = m_leverage.data();
+        cols.group_id = m_group_id.data();
+        cols.version = m_version.data();
+        cols.record = m_cold.data();
+        fn(cols);
+    }
+    
+    // Fill delta with the accounts changed and the logins removed after
+    // since. since 0, a version from another process, or one older than
+    // the remembered deletions give a full delta.
+    void getChangedSince(uint64_t since, MT4AccountDelta& delta) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        delta.version = m_current.load(std::memory_order_relaxed);
+        delta.full = since < m_floor || since > delta.version;
+        delta.changed.clear();
+        delta.removed.clear();
+        
+        if (delta.full) {
+            delta.changed = m_cold;
+            return;
+        }
+        
+        const uint64_t* version = m_version.data();
+        int count = (int)m_version.size();
+        for (int i = 0; i < count; i++) {
+            if (version[i] > since) {
+                delta.changed.push_back(m_cold[i]);
+            }
+        }
+        
+        for (std::deque<std::pair<uint64_t, int> >::const_reverse_iterator it = m_removed.rbegin();
+             it != m_removed.rend() && it->first > since; ++it) {
+            delta.removed.push_back(it->second);
+        }
+    }
+    
+    // Call callback after every batch of changes; returns the id for
+    // unsubscribe(). Callbacks run on the thread applying the change
+    // and must not subscribe or unsubscribe.
+    int subscribe(MT4AccountCallback callback) {
+        std::lock_guard<std::mutex> lock(m_subscribers_lock);
+        int id = m_next_subscriber++;
+        m_subscribers.push_back(std::make_pair(id, callback));
+        return id;
+    }
+    
+    // Remove a subscription; no call to it is running once this returns
+    void unsubscribe(int id) {
+        std::lock_guard<std::mutex> lock(m_subscribers_lock);
+        for (size_t i = 0; i < m_subscribers.size(); i++) {
+            if (m_subscribers[i].first == id) {
+                m_subscribers.erase(m_subscribers.begin() + i);
+                return;
+            }
+        }
+    }
+    
+    // Append the logins whose balance lies in [min_balance, max_balance]
+    void selectByBalance(double min_balance, double max_balance, std::vector<int>& logins) const {
+        read([&](const Columns& cols) {
+            for (int i = 0; i < cols.count; i++) {
+                if (cols.balance[i] >= min_balance && cols.balance[i] <= max_balance) {
+                    logins.push_back(cols.login[i]);
+                }
+            }
+        });
+    }
+    
+    // Copy the full record of a login; false if unknown
+    bool getRecord(int login, UserRecord& user) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        std::unordered_map<int, int>::const_iterator it = m_rows.find(login);
+        if (it == m_rows.end()) {
+            return false;
+        }
+        
+        user = m_cold[it->second];
+        return true;
+    }
+    
+    // Append the full record of every account
+    void getRecords(std::vector<UserRecord>& users) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        users.insert(users.end(), m_cold.begin(), m_cold.end());
+    }
+    
+    // Append the logins of a group id
+    void selectByGroup(int group_id, std::vector<int>& logins) const {
+        read([&](const Columns& cols) {
+            for (int i = 0; i < cols.count; i++) {
+                if (cols.group_id[i] == group_id) {
+                    logins.push_back(cols.login[i]);
+                }
+            }
+        });
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        UserRecord* users = pump->UsersGet(&total);
+        load(users, users != NULL ? total : 0);
+        
+        if (users) {
+            pump->MemFree(users);
+        }
+    }
+    
+    // The session supervisor delivered the gap's changes as onUsers
+    void onPumpingResumed(CManagerInterface* pump) {
+        m_ready = true;
+    }
+    
+    void onPumpingStopped() {
+        m_ready = false;
+    }
+    
+    void onUsers(const MT4UserEvent* events, int count) {
+        std::vector<MT4AccountChange> changes;
+        changes.reserve(count);
+        for (int i = 0; i < count; i++) {
+            if (events[i].type != TRANS_DELETE) {
+                internGroup(events[i].user.group);
+            }
+        }
+        {
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            
+            for (int i = 0; i < count; i++) {
+                MT4AccountChange change = { events[i].type, 0, &events[i].user };
+                if (events[i].type == TRANS_DELETE) {
+                    if (m_rows.find(events[i].user.login) == m_rows.end()) {
+                        continue;
+                    }
+                    change.version = stampLocked();
+                    removeLocked(events[i].user.login, change.version);
+                } else {
+                    change.version = stampLocked();
+                    change.type = upsertLocked(events[i].user, change.version);
+                }
+                changes.push_back(change);
+            }
+        }
+        
+        notify(changes);
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4SymbolStore - Hot symbol columns with a cold ConSymbol table  |
+//| Rows are indexed by the quote table symbol id, so a tick's id    |
+//| addresses its contract parameters directly.                      |
+//+------------------------------------------------------------------+
+class MT4SymbolStore : public MT4PumpListener {
+public:
+    // Read-only view of the hot columns, valid inside read()
+    struct Columns {
+        int count;
+        const unsigned char* valid;
+        const int* digits;
+        const double* point;
+        const double* contract_size;
+        const double* tick_value;
+    };
+
+private:
+    MT4QuoteTable& m_quotes;
+    unsigned char m_valid[MT4_MAX_SYMBOLS];
+    int m_digits[MT4_MAX_SYMBOLS];
+    double m_point[MT4_MAX_SYMBOLS];
+    double m_contract_size[MT4_MAX_SYMBOLS];
+    double m_tick_value[MT4_MAX_SYMBOLS];
+    std::vector<ConSymbol> m_cold;
+    int m_count;                                        // highest id + 1
+    mutable std::shared_mutex m_lock;
+    std::atomic<bool> m_ready;
+    
+    MT4SymbolStore(const MT4SymbolStore&);
+    MT4SymbolStore& operator=(const MT4SymbolStore&);
+
+public:
+    explicit MT4SymbolStore(MT4QuoteTable& quotes)
+        : m_quotes(quotes), m_cold(MT4_MAX_SYMBOLS), m_count(0), m_ready(false) {
+        memset(m_valid, 0, sizeof(m_valid));
+    }
+    
+    // Replace the store contents with a full symbol list
+    void load(const ConSymbol* symbols, int total) {
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        memset(m_valid, 0, sizeof(m_valid));
+        m_count = 0;
+        
+        for (int i = 0; i < total; i++) {
+            int id = m_quotes.registerSymbol(symbols[i].symbol);
+            if (id < 0) {
+                continue;
+            }
+            
+            m_valid[id] = 1;
+            m_digits[id] = symbols[i].digits;
+            m_point[id] = symbols[i].point;
+            m_contract_size[id] = symbols[i].contract_size;
+            m_tick_value[id] = symbols[i].tick_value;
+            m_cold[id] = symbols[i];
+            if (id >= m_count) {
+                m_count = id + 1;
+            }
+        }
+        
+        m_ready = true;
+    }
+    
+    // Check whether the store has been loaded and can be trusted
+    bool isReady() const {
+        return m_ready;
+    }
+    
+    // Run fn(const Columns&) with the hot columns under the read lock
+    template <class Fn>
+    void read(Fn fn) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        Columns cols;
+        cols.count = m_count;
+        cols.valid = m_valid;
+        cols.digits = m_digits;
+        cols.point = m_point;
+        cols.contract_size = m_contract_size;
+        cols.tick_value = m_tick_value;
+        fn(cols);
+    }
+    
+    // Copy the full specification of a symbol id; false if unknown
+    bool getRecord(int symbol_id, ConSymbol& symbol) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        if (symbol_id < 0 || symbol_id >= m_count || !m_valid[symbol_id]) {
+            return false;
+        }
+        
+        symbol = m_cold[symbol_id];
+        return true;
+    }
+    
+    // Copy the full specification of a symbol by name
+    bool getRecord(const char* name, ConSymbol& symbol) const {
+        return getRecord(m_quotes.findSymbol(name), symbol);
+    }
+    
+    // Append the specification of every known symbol, in id order
+    void getRecords(std::vector<ConSymbol>& symbols) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        for (int id = 0; id < m_count; id++) {
+            if (m_valid[id]) {
+                symbols.push_back(m_cold[id]);
+            }
+        }
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        ConSymbol* symbols = pump->SymbolsGetAll(&total);
+        load(symbols, symbols != NULL ? total : 0);
+        
+        if (symbols) {
+            pump->MemFree(symbols);
+        }
+    }
+    
+    void onPumpingStopped() {
+        m_ready = false;
+    }
+};
+
+#endif // MT4COLUMNSTORE_H
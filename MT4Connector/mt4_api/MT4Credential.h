@@ -0,0 +1,91 @@
+//+------------------------------------------------------------------+
+//|                                  Masked Manager Password Storage |
+//+------------------------------------------------------------------+
+#ifndef MT4CREDENTIAL_H
+#define MT4CREDENTIAL_H
+
+#include <string.h>
+#include <random>
+#include <windows.h>
+
+// Bytes kept per password, terminator included; Manager API passwords
+// are at most 15 characters
+#define MT4_CREDENTIAL_SIZE 64
+
+//+------------------------------------------------------------------+
+//| MT4Credential - Password kept for reconnects, never in clear     |
+//| Reconnects and extra connections log in again, so the password   |
+//| has to outlive login(). It is kept XOR-masked with a random pad  |
+//| drawn on every set() and unmasked only into a Plain on the stack |
+//| for the duration of one API call; clear() and the destructors    |
+//| wipe the bytes so they do not linger in dumps or swapped pages.  |
+//+------------------------------------------------------------------+
+class MT4Credential {
+private:
+    unsigned char m_masked[MT4_CREDENTIAL_SIZE];
+    unsigned char m_pad[MT4_CREDENTIAL_SIZE];
+    bool m_set;
+    
+    MT4Credential(const MT4Credential&);
+    MT4Credential& operator=(const MT4Credential&);
+
+public:
+    // Unmasked copy for the duration of one call, wiped on destruction
+    class Plain {
+    private:
+        char m_text[MT4_CREDENTIAL_SIZE];
+        
+        Plain(const Plain&);
+        Plain& operator=(const Plain&);
+    
+    public:
+        explicit Plain(const MT4Credential& credential) {
+            for (int i = 0; i < MT4_CREDENTIAL_SIZE; i++) {
+                m_text[i] = (char)(credential.m_masked[i] ^ credential.m_pad[i]);
+            }
+            m_text[MT4_CREDENTIAL_SIZE - 1] = '\0';
+        }
+        
+        ~Plain() {
+            SecureZeroMemory(m_text, sizeof(m_text));
+        }
+        
+        const char* c_str() const {
+            return m_text;
+        }
+    };
+    
+    MT4Credential() : m_set(false) {
+        memset(m_masked, 0, sizeof(m_masked));
+        memset(m_pad, 0, sizeof(m_pad));
+    }
+    
+    ~MT4Credential() {
+        clear();
+    }
+    
+    // Keep password, truncated to MT4_CREDENTIAL_SIZE - 1 characters
+    void set(const char* password) {
+        std::random_device random;
+        size_t length = password != NULL ? strlen(password) : 0;
+        
+        for (int i = 0; i < MT4_CREDENTIAL_SIZE; i++) {
+            m_pad[i] = (unsigned char)random();
+            unsigned char c = (size_t)i < length ? (unsigned char)password[i] : 0;
+            m_masked[i] = c ^ m_pad[i];
+        }
+        m_set = true;
+    }
+    
+    void clear() {
+        SecureZeroMemory(m_masked, sizeof(m_masked));
+        SecureZeroMemory(m_pad, sizeof(m_pad));
+        m_set = false;
+    }
+    
+    bool isSet() const {
+        return m_set;
+    }
+};
+
+#endif // MT4CREDENTIAL_H
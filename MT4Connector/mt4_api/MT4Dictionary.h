@@ -0,0 +1,402 @@
+//+------------------------------------------------------------------+
+//|                       Interned Symbol and Group Name Dictionary   |
+//+------------------------------------------------------------------+
+#ifndef MT4DICTIONARY_H
+#define MT4DICTIONARY_H
+
+#include <string.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+
+// Group capacity of the dictionary
+#define MT4_MAX_GROUPS 1024
+
+// Highest per-bucket seed tried before falling back to probing
+#define MT4_DICT_MAX_SEED 65535
+
+//+------------------------------------------------------------------+
+//| MT4NameTable - Append-only names with a perfect hash index       |
+//| Names get dense ids in arrival order and never change id. The    |
+//| index is built by hash-and-displace: names are grouped into      |
+//| buckets and each bucket has the seed that places all its names   |
+//| in free slots, so a lookup is one hash and one compare. A new    |
+//| name only re-seeds its own bucket, and the whole index is only   |
+//| rebuilt when no seed fits. Updates happen in place behind a      |
+//| sequence counter: hits are checked against the name itself, and  |
+//| a miss during an update is retried, so lookups never lock.       |
+//+------------------------------------------------------------------+
+template <int NameLen, int MaxNames, int TableSize>
+class MT4NameTable {
+private:
+    static const int BucketCount = MaxNames / 2;
+    
+    char m_names[MaxNames][NameLen];
+    std::atomic<int> m_count;
+    std::atomic<bool> m_perfect;                        // false: linear probing fallback
+    std::atomic<unsigned short> m_seeds[BucketCount];   // 0 = bucket empty
+    std::atomic<short> m_slots[TableSize];
+    std::atomic<unsigned int> m_sequence;               // odd while the index changes
+    std::vector<int> m_buckets[BucketCount];            // ids per bucket, under m_lock
+    std::mutex m_lock;
+    
+    MT4NameTable(const MT4NameTable&);
+    MT4NameTable& operator=(const MT4NameTable&);
+    
+    static unsigned int hash(const char* name, unsigned int seed) {
+        unsigned int h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (int i = 0; i < NameLen && name[i]; i++) {
+            h ^= (unsigned char)name[i];
+            h *= 16777619u;
+        }
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 13;
+        return h;
+    }
+    
+    static int bucketOf(const char* name) {
+        return hash(name, 0) % BucketCount;
+    }
+    
+    int slotOf(int id, unsigned int seed) const {
+        return hash(m_names[id], seed) & (TableSize - 1);
+    }
+    
+    // One probe of the current index; -1 if not found
+    int lookup(const char* name) const {
+        if (m_perfect.load(std::memory_order_acquire)) {
+            unsigned int seed = m_seeds[bucketOf(name)].load(std::memory_order_acquire);
+            int id = m_slots[hash(name, seed) & (TableSize - 1)].load(std::memory_order_acquire);
+            return (id >= 0 && strncmp(m_names[id], name, NameLen) == 0) ? id : -1;
+        }
+        
+        for (int slot = hash(name, 0) & (TableSize - 1);; slot = (slot + 1) & (TableSize - 1)) {
+            int id = m_slots[slot].load(std::memory_order_acquire);
+            if (id < 0) {
+                return -1;
+            }
+            if (strncmp(m_names[id], name, NameLen) == 0) {
+                return id;
+            }
+        }
+    }
+    
+    void beginUpdate() {
+        m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    void endUpdate() {
+        m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Seed that places every name of bucket in a slot that is free or
+    // held by the bucket itself, 0 if none does
+    unsigned int findSeed(const std::vector<int>& bucket) const {
+        std::vector<int> taken(bucket.size());
+        
+        for (unsigned int seed = 1; seed <= MT4_DICT_MAX_SEED; seed++) {
+            bool fits = true;
+            
+            for (size_t i = 0; i < bucket.size() && fits; i++) {
+                int slot = slotOf(bucket[i], seed);
+                int owner = m_slots[slot].load(std::memory_order_relaxed);
+                fits = owner < 0 || bucketOf(m_names[owner]) == bucketOf(m_names[bucket[i]]);
+                
+                for (size_t j = 0; j < i && fits; j++) {
+                    fits = taken[j] != slot;
+                }
+                taken[i] = slot;
+            }
+            
+            if (fits) {
+                return seed;
+            }
+        }
+        return 0;
+    }
+    
+    // Move bucket b to seed (caller is inside an update)
+    void reseed(int b, unsigned int seed) {
+        const std::vector<int>& bucket = m_buckets[b];
+        unsigned int old_seed = m_seeds[b].load(std::memory_order_relaxed);
+        
+        for (size_t i = 0; old_seed != 0 && i < bucket.size(); i++) {
+            int slot = slotOf(bucket[i], old_seed);
+            if (m_slots[slot].load(std::memory_order_relaxed) == bucket[i]) {
+                m_slots[slot].store(-1, std::memory_order_relaxed);
+            }
+        }
+        for (size_t i = 0; i < bucket.size(); i++) {
+            m_slots[slotOf(bucket[i], seed)].store((short)bucket[i], std::memory_order_release);
+        }
+        m_seeds[b].store((unsigned short)seed, std::memory_order_release);
+    }
+    
+    void clearIndex() {
+        for (int i = 0; i < TableSize; i++) {
+            m_slots[i].store(-1, std::memory_order_relaxed);
+        }
+        for (int b = 0; b < BucketCount; b++) {
+            m_seeds[b].store(0, std::memory_order_relaxed);
+        }
+    }
+    
+    // Rebuild the whole index, largest buckets first while the table is
+    // still empty (caller is inside an update)
+    void rebuild(int count) {
+        clearIndex();
+        bool perfect = true;
+        
+        std::vector<int> order;
+        for (int b = 0; b < BucketCount; b++) {
+            if (!m_buckets[b].empty()) {
+                order.push_back(b);
+            }
+        }
+        for (size_t i = 1; i < order.size(); i++) {
+            for (size_t j = i; j > 0 && m_buckets[order[j]].size() > m_buckets[order[j - 1]].size(); j--) {
+                int tmp = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = tmp;
+            }
+        }
+        
+        for (size_t i = 0; i < order.size() && perfect; i++) {
+            unsigned int seed = findSeed(m_buckets[order[i]]);
+            if (seed == 0) {
+                perfect = false;
+            } else {
+                reseed(order[i], seed);
+            }
+        }
+        
+        if (!perfect) {
+            clearIndex();
+            for (int i = 0; i < count; i++) {
+                probeInsert(i);
+            }
+        }
+        m_perfect.store(perfect, std::memory_order_release);
+    }
+    
+    void probeInsert(int id) {
+        int slot = slotOf(id, 0);
+        while (m_slots[slot].load(std::memory_order_relaxed) >= 0) {
+            slot = (slot + 1) & (TableSize - 1);
+        }
+        m_slots[slot].store((short)id, std::memory_order_release);
+    }
+    
+    // Index a name whose id has just been assigned (caller holds m_lock)
+    void insert(int id) {
+        int b = bucketOf(m_names[id]);
+        m_buckets[b].push_back(id);
+        
+        // Probing only ever fills a free slot, which no lookup depends on
+        if (!m_perfect.load(std::memory_order_relaxed)) {
+            probeInsert(id);
+            return;
+        }
+        
+        unsigned int seed = findSeed(m_buckets[b]);
+        beginUpdate();
+        if (seed != 0) {
+            reseed(b, seed);
+        } else {
+            rebuild(id + 1);
+        }
+        endUpdate();
+    }
+
+public:
+    MT4NameTable() : m_count(0), m_perfect(true), m_sequence(0) {
+        static_assert((TableSize & (TableSize - 1)) == 0, "TableSize must be a power of two");
+        static_assert(TableSize >= 2 * MaxNames, "TableSize must be at least twice MaxNames");
+        memset(m_names, 0, sizeof(m_names));
+        clearIndex();
+    }
+    
+    // Id of a name, -1 if unknown (lock-free)
+    int find(const char* name) const {
+        if (name == NULL) {
+            return -1;
+        }
+        
+        for (;;) {
+            unsigned int sequence = m_sequence.load(std::memory_order_acquire);
+            int id = lookup(name);
+            if (id >= 0) {
+                return id;
+            }
+            
+            // A miss only counts if no update ran meanwhile
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((sequence & 1) == 0 && m_sequence.load(std::memory_order_relaxed) == sequence) {
+                return -1;
+            }
+        }
+    }
+    
+    // Intern a name; returns its id, -1 if the dictionary is full
+    int add(const char* name) {
+        return addAll(&name, 1);
+    }
+    
+    // Intern several names; returns the id of the last name, -1 if the
+    // dictionary filled up
+    int addAll(const char* const* names, int total) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        int count = m_count.load(std::memory_order_relaxed);
+        int id = -1;
+        
+        for (int i = 0; i < total; i++) {
+            if (names[i] == NULL || *names[i] == 0) {
+                continue;
+            }
+            
+            id = lookup(names[i]);
+            if (id >= 0) {
+                continue;
+            }
+            
+            if (count >= MaxNames) {
+                id = -1;
+                break;
+            }
+            
+            // Names are written before the count and index that expose them
+            strncpy(m_names[count], names[i], NameLen - 1);
+            id = count++;
+            m_count.store(count, std::memory_order_release);
+            insert(id);
+        }
+        
+        return id;
+    }
+    
+    // Name of an id, NULL if out of range
+    const char* name(int id) const {
+        if (id < 0 || id >= m_count.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        return m_names[id];
+    }
+    
+    // Number of interned names
+    int size() const {
+        return m_count.load(std::memory_order_acquire);
+    }
+    
+    // Check whether the index is collision-free
+    bool isPerfect() const {
+        return m_perfect.load(std::memory_order_acquire);
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4Dictionary - Dense integer ids for symbol and group names     |
+//| Symbol ids are the quote table ids, so every per-symbol array in |
+//| the connector shares one numbering. Group ids are assigned here. |
+//| Filled from the symbol and group lists when pumping starts (or   |
+//| via load()); unseen names can be interned later with addGroup(). |
+//+------------------------------------------------------------------+
+class MT4Dictionary : public MT4PumpListener {
+private:
+    typedef MT4NameTable<12, MT4_MAX_SYMBOLS, 2 * MT4_MAX_SYMBOLS> SymbolNames;
+    typedef MT4NameTable<16, MT4_MAX_GROUPS, 2 * MT4_MAX_GROUPS> GroupNames;
+    
+    MT4QuoteTable& m_quotes;
+    SymbolNames m_symbols;
+    GroupNames m_groups;
+    
+    MT4Dictionary(const MT4Dictionary&);
+    MT4Dictionary& operator=(const MT4Dictionary&);
+    
+    // Mirror the quote table ids that are not in the dictionary yet
+    void syncSymbols() {
+        std::vector<const char*> names;
+        for (int id = m_symbols.size(); id < m_quotes.getSymbolCount(); id++) {
+            names.push_back(m_quotes.getSymbolName(id));
+        }
+        if (!names.empty()) {
+            m_symbols.addAll(names.data(), (int)names.size());
+        }
+    }
+
+public:
+    explicit MT4Dictionary(MT4QuoteTable& quotes) : m_quotes(quotes) {}
+    
+    // Intern a symbol and group list in one pass
+    void load(const ConSymbol* symbols, int symbol_total, const ConGroup* groups, int group_total) {
+        for (int i = 0; i < symbol_total; i++) {
+            m_quotes.registerSymbol(symbols[i].symbol);
+        }
+        syncSymbols();
+        
+        std::vector<const char*> names;
+        for (int i = 0; i < group_total; i++) {
+            names.push_back(groups[i].group);
+        }
+        if (!names.empty()) {
+            m_groups.addAll(names.data(), (int)names.size());
+        }
+    }
+    
+    // Id of a symbol name, -1 if unknown
+    int findSymbol(const char* symbol) const {
+        return m_symbols.find(symbol);
+    }
+    
+    // Id of a group name, -1 if unknown
+    int findGroup(const char* group) const {
+        return m_groups.find(group);
+    }
+    
+    // Intern a symbol; the id matches the quote table
+    int addSymbol(const char* symbol) {
+        int id = m_symbols.find(symbol);
+        if (id < 0 && m_quotes.registerSymbol(symbol) >= 0) {
+            syncSymbols();
+            id = m_symbols.find(symbol);
+        }
+        return id;
+    }
+    
+    // Intern a group
+    int addGroup(const char* group) {
+        int id = m_groups.find(group);
+        return id >= 0 ? id : m_groups.add(group);
+    }
+    
+    const char* getSymbolName(int id) const { return m_symbols.name(id); }
+    const char* getGroupName(int id) const { return m_groups.name(id); }
+    int getSymbolCount() const { return m_symbols.size(); }
+    int getGroupCount() const { return m_groups.size(); }
+    
+    // Check whether both indexes resolve names in a single probe
+    bool isPerfect() const {
+        return m_symbols.isPerfect() && m_groups.isPerfect();
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        syncSymbols();
+        
+        int total = 0;
+        ConGroup* groups = pump->GroupsGet(&total);
+        if (groups) {
+            load(NULL, 0, groups, total);
+            pump->MemFree(groups);
+        }
+    }
+};
+
+#endif // MT4DICTIONARY_H
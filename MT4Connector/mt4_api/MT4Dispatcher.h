@@ -0,0 +1,493 @@
+//+------------------------------------------------------------------+
+//|                           Sharded Event Dispatch on Pinned Workers |
+//+------------------------------------------------------------------+
+#ifndef MT4DISPATCHER_H
+#define MT4DISPATCHER_H
+
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <windows.h>
+#include "MT4Pumping.h"
+#include "MT4Dictionary.h"
+
+// Upper bound of shards (and worker threads) of one dispatcher
+#define MT4_DISPATCH_MAX_SHARDS 64
+
+// Longest a worker sleeps before checking its queue again
+#define MT4_DISPATCH_WAIT_MS 100
+
+// Most events one drain of a shard queue delivers
+#define MT4_DISPATCH_BUDGET 4096
+
+//+------------------------------------------------------------------+
+//| MT4ShardedDispatcher - Runs handlers on one thread per shard     |
+//| Registered as a listener it routes quotes by symbol id and       |
+//| trades, users and online events by login into per-shard SPSC     |
+//| queues (MT4PumpQueue); each shard's worker, optionally pinned to |
+//| a core, delivers its queue to every handler. One key always maps |
+//| to one shard, so a handler sees each symbol's and login's events |
+//| in order, while keys in different shards run in parallel. A slow |
+//| handler only fills its own shard's queue, which then drops new   |
+//| events instead of stalling the pumping thread or other shards.   |
+//| Handlers are called from every worker and must be thread-safe    |
+//| across keys. The pump goes to shard 0 only: its worker runs the  |
+//| handlers' onPumpingStarted/Resumed once, while the other shards  |
+//| hold their events until that load is done. onPumpingStopped      |
+//| reaches handlers once per shard, onPumpDetached once.            |
+//+------------------------------------------------------------------+
+class MT4ShardedDispatcher : public MT4PumpListener {
+private:
+    // Forwards one shard's drained batches to every handler
+    class Fanout : public MT4PumpListener {
+    private:
+        MT4ShardedDispatcher& m_owner;
+        const std::vector<MT4PumpListener*>& m_handlers;
+        bool m_primary;                         // shard 0, which loads the handlers
+    
+    public:
+        Fanout(MT4ShardedDispatcher& owner, bool primary)
+            : m_owner(owner), m_handlers(owner.m_handlers), m_primary(primary) {}
+        
+        void onPumpingStarted(CManagerInterface* pump) {
+            if (!m_primary) {
+                m_owner.waitLoaded();
+                return;
+            }
+            
+            unsigned int session = m_owner.m_sessions.load(std::memory_order_acquire);
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onPumpingStarted(pump);
+            }
+            m_owner.m_loaded.store(session, std::memory_order_release);
+        }
+        
+        void onPumpingResumed(CManagerInterface* pump) {
+            if (!m_primary) {
+                m_owner.waitLoaded();
+                return;
+            }
+            
+            unsigned int session = m_owner.m_sessions.load(std::memory_order_acquire);
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onPumpingResumed(pump);
+            }
+            m_owner.m_loaded.store(session, std::memory_order_release);
+        }
+        
+        void onPumpDetached() {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onPumpDetached();
+            }
+        }
+        
+        void onPumpingStopped() {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onPumpingStopped();
+            }
+        }
+        
+        void onQuotes(const SymbolInfo* quotes, int count) {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onQuotes(quotes, count);
+            }
+        }
+        
+        void onTrades(const MT4TradeEvent* events, int count) {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onTrades(events, count);
+            }
+        }
+        
+        void onUsers(const MT4UserEvent* events, int count) {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onUsers(events, count);
+            }
+        }
+        
+        void onOnline(const MT4OnlineEvent* events, int count) {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onOnline(events, count);
+            }
+        }
+        
+        void onPing() {
+            for (size_t i = 0; i < m_handlers.size(); i++) {
+                m_handlers[i]->onPing();
+            }
+        }
+    };
+    
+    struct Shard {
+        MT4PumpQueue queue;
+        HANDLE wake;                            // auto-reset, set by the producer
+        std::thread thread;
+        std::atomic<int> core;                  // pinned core, -1 if not pinned
+        alignas(MT4_CACHE_LINE) std::atomic<bool> sleeping;
+        std::atomic<unsigned long long> delivered;
+        
+        Shard() : wake(NULL), core(-1), sleeping(false), delivered(0) {}
+    };
+    
+    const MT4Dictionary& m_dictionary;
+    std::vector<MT4PumpListener*> m_handlers;
+    std::vector<Shard*> m_shards;
+    std::atomic<bool> m_running;
+    
+    // Pumping sessions announced, and the last one shard 0 has loaded
+    std::atomic<unsigned int> m_sessions;
+    std::atomic<unsigned int> m_loaded;
+    
+    // Producer-side scratch, one vector per shard (pumping thread only)
+    std::vector<std::vector<SymbolInfo> > m_quote_scratch;
+    std::vector<std::vector<MT4TradeEvent> > m_trade_scratch;
+    std::vector<std::vector<MT4UserEvent> > m_user_scratch;
+    std::vector<std::vector<MT4OnlineEvent> > m_online_scratch;
+    std::vector<int> m_touched;
+    
+    MT4ShardedDispatcher(const MT4ShardedDispatcher&);
+    MT4ShardedDispatcher& operator=(const MT4ShardedDispatcher&);
+    
+    static int& currentShardSlot() {
+        static thread_local int shard = -1;
+        return shard;
+    }
+    
+    // Quotes of symbols the dictionary does not know yet hash by name
+    unsigned int quoteKey(const SymbolInfo& quote) const {
+        int id = m_dictionary.findSymbol(quote.symbol);
+        if (id >= 0) {
+            return (unsigned int)id;
+        }
+        
+        unsigned int h = 2166136261u;
+        for (int i = 0; i < (int)sizeof(quote.symbol) && quote.symbol[i]; i++) {
+            h ^= (unsigned char)quote.symbol[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+    
+    // Wake the shard's worker if it has gone to sleep. The fence orders
+    // the ring push before the sleeping check, pairing with the worker's
+    // store of sleeping before it re-checks its queue.
+    void wake(Shard* shard) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard->sleeping.load(std::memory_order_relaxed) && shard->sleeping.exchange(false)) {
+            SetEvent(shard->wake);
+        }
+    }
+    
+    // Split a batch by key into the per-shard scratch vectors and push
+    // each part as one run, keeping the batch order within a shard
+    template <class T, class Key, class Push>
+    void route(const T* items, int count, std::vector<std::vector<T> >& scratch, Key key, Push push) {
+        unsigned int shards = (unsigned int)m_shards.size();
+        if (shards == 0 || count <= 0) {
+            return;
+        }
+        
+        if (count == 1) {
+            Shard* shard = m_shards[key(items[0]) % shards];
+            push(shard->queue, items, 1);
+            wake(shard);
+            return;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            unsigned int s = key(items[i]) % shards;
+            if (scratch[s].empty()) {
+                m_touched.push_back((int)s);
+            }
+            scratch[s].push_back(items[i]);
+        }
+        
+        for (size_t i = 0; i < m_touched.size(); i++) {
+            std::vector<T>& part = scratch[m_touched[i]];
+            push(m_shards[m_touched[i]]->queue, part.data(), (int)part.size());
+            part.clear();
+        }
+        for (size_t i = 0; i < m_touched.size(); i++) {
+            wake(m_shards[m_touched[i]]);
+        }
+        m_touched.clear();
+    }
+    
+    // Hold a shard other than 0 until the handlers loaded the latest
+    // session, or the dispatcher stops
+    void waitLoaded() {
+        unsigned int session = m_sessions.load(std::memory_order_acquire);
+        while ((int)(session - m_loaded.load(std::memory_order_acquire)) > 0 &&
+               m_running.load(std::memory_order_acquire)) {
+            Sleep(1);
+        }
+    }
+    
+    void wakeAll() {
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            wake(m_shards[i]);
+        }
+    }
+    
+    void run(Shard* shard, int index) {
+        currentShardSlot() = index;
+        if (shard->core >= 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << shard->core) == 0) {
+            shard->core = -1;
+        }
+        
+        Fanout fanout(*this, index == 0);
+        for (;;) {
+            int drained;
+            while ((drained = shard->queue.drain(&fanout, MT4_DISPATCH_BUDGET)) > 0) {
+                shard->delivered.fetch_add(drained, std::memory_order_relaxed);
+            }
+            
+            if (!m_running.load(std::memory_order_acquire)) {
+                break;
+            }
+            
+            shard->sleeping.store(true);
+            if (shard->queue.depth() == 0 && m_running.load()) {
+                WaitForSingleObject(shard->wake, MT4_DISPATCH_WAIT_MS);
+            }
+            shard->sleeping.store(false);
+        }
+        
+        // Hand over what was queued before stop()
+        shard->delivered.fetch_add(shard->queue.drain(&fanout), std::memory_order_relaxed);
+        currentShardSlot() = -1;
+    }
+    
+    void release() {
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            if (m_shards[i]->wake != NULL) {
+                CloseHandle(m_shards[i]->wake);
+            }
+            delete m_shards[i];
+        }
+        m_shards.clear();
+    }
+
+public:
+    MT4ShardedDispatcher(const MT4Dictionary& dictionary)
+        : m_dictionary(dictionary), m_running(false), m_sessions(0), m_loaded(0) {}
+    
+    ~MT4ShardedDispatcher() {
+        stop();
+    }
+    
+    // Register a handler; only while stopped
+    bool addHandler(MT4PumpListener* handler) {
+        if (handler == NULL || !m_shards.empty()) {
+            return false;
+        }
+        
+        m_handlers.push_back(handler);
+        return true;
+    }
+    
+    // Allocate shards queues and start their workers; shards == 0 uses
+    // one per core. With pin, shard i runs on core (first_core + i)
+    // modulo the core count. The capacities are per shard.
+    bool start(int shards = 0, bool pin = true, int first_core = 0,
+               int quote_capacity = MT4_PUMP_QUEUE_QUOTES, int trade_capacity = MT4_PUMP_QUEUE_TRADES,
+               int user_capacity = MT4_PUMP_QUEUE_USERS, int online_capacity = MT4_PUMP_QUEUE_ONLINE) {
+        if (!m_shards.empty()) {
+            return false;
+        }
+        
+        int cores = (int)std::thread::hardware_concurrency();
+        if (cores <= 0) {
+            cores = 1;
+        }
+        if (shards <= 0) {
+            shards = cores;
+        }
+        if (shards > MT4_DISPATCH_MAX_SHARDS || first_core < 0) {
+            return false;
+        }
+        
+        for (int i = 0; i < shards; i++) {
+            Shard* shard = new Shard();
+            m_shards.push_back(shard);
+            
+            shard->wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+            if (shard->wake == NULL ||
+                !shard->queue.init(quote_capacity, trade_capacity, user_capacity, online_capacity)) {
+                release();
+                return false;
+            }
+            
+            int core = (first_core + i) % cores;
+            shard->core = pin && core < (int)(sizeof(DWORD_PTR) * 8) ? core : -1;
+        }
+        
+        m_quote_scratch.assign(shards, std::vector<SymbolInfo>());
+        m_trade_scratch.assign(shards, std::vector<MT4TradeEvent>());
+        m_user_scratch.assign(shards, std::vector<MT4UserEvent>());
+        m_online_scratch.assign(shards, std::vector<MT4OnlineEvent>());
+        for (int i = 0; i < shards; i++) {
+            m_quote_scratch[i].reserve(MT4_PUMP_QUOTE_BATCH);
+        }
+        m_touched.reserve(shards);
+        
+        m_running = true;
+        for (int i = 0; i < shards; i++) {
+            m_shards[i]->thread = std::thread(&MT4ShardedDispatcher::run, this, m_shards[i], i);
+        }
+        return true;
+    }
+    
+    // Stop the workers once they delivered what is queued; the pumping
+    // engine must no longer call this listener
+    void stop() {
+        if (m_shards.empty()) {
+            return;
+        }
+        
+        m_running = false;
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            SetEvent(m_shards[i]->wake);
+        }
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            if (m_shards[i]->thread.joinable()) {
+                m_shards[i]->thread.join();
+            }
+        }
+        release();
+    }
+    
+    bool isRunning() const {
+        return m_running;
+    }
+    
+    // Shard of the calling worker thread, -1 elsewhere; lets handlers
+    // keep per-shard state without locking
+    static int currentShard() {
+        return currentShardSlot();
+    }
+    
+    // Shard a symbol's quotes or a login's events are routed to
+    int shardOfSymbol(const char* symbol) const {
+        SymbolInfo quote;
+        memset(&quote, 0, sizeof(quote));
+        strncpy(quote.symbol, symbol, sizeof(quote.symbol) - 1);
+        return m_shards.empty() ? -1 : (int)(quoteKey(quote) % m_shards.size());
+    }
+    
+    int shardOfLogin(int login) const {
+        return m_shards.empty() ? -1 : (int)((unsigned int)login % m_shards.size());
+    }
+    
+    // Producer side (pumping thread). Only shard 0 gets the pump; the
+    // others get a start without one and wait for shard 0's load.
+    void onPumpingStarted(CManagerInterface* pump) {
+        m_sessions.fetch_add(1, std::memory_order_acq_rel);
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            m_shards[i]->queue.onPumpingStarted(i == 0 ? pump : NULL);
+        }
+        wakeAll();
+    }
+    
+    void onPumpingResumed(CManagerInterface* pump) {
+        m_sessions.fetch_add(1, std::memory_order_acq_rel);
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            m_shards[i]->queue.onPumpingResumed(i == 0 ? pump : NULL);
+        }
+        wakeAll();
+    }
+    
+    void onPumpingStopped() {
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            m_shards[i]->queue.onPumpingStopped();
+        }
+        wakeAll();
+    }
+    
+    // Once shard 0 no longer uses the pump, release the shards waiting
+    // for a load that will not come and detach the handlers here
+    void onPumpDetached() {
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            m_shards[i]->queue.onPumpDetached();
+        }
+        m_loaded.store(m_sessions.load(std::memory_order_acquire), std::memory_order_release);
+        
+        Fanout fanout(*this, false);
+        fanout.onPumpDetached();
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        route(quotes, count, m_quote_scratch,
+              [this](const SymbolInfo& q) { return quoteKey(q); },
+              [](MT4PumpQueue& queue, const SymbolInfo* q, int n) { queue.onQuotes(q, n); });
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        route(events, count, m_trade_scratch,
+              [](const MT4TradeEvent& e) { return (unsigned int)e.trade.login; },
+              [](MT4PumpQueue& queue, const MT4TradeEvent* e, int n) { queue.onTrades(e, n); });
+    }
+    
+    void onUsers(const MT4UserEvent* events, int count) {
+        route(events, count, m_user_scratch,
+              [](const MT4UserEvent& e) { return (unsigned int)e.user.login; },
+              [](MT4PumpQueue& queue, const MT4UserEvent* e, int n) { queue.onUsers(e, n); });
+    }
+    
+    void onOnline(const MT4OnlineEvent* events, int count) {
+        route(events, count, m_online_scratch,
+              [](const MT4OnlineEvent& e) { return (unsigned int)e.login; },
+              [](MT4PumpQueue& queue, const MT4OnlineEvent* e, int n) { queue.onOnline(e, n); });
+    }
+    
+    void onPing() {
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            m_shards[i]->queue.onPing();
+        }
+    }
+    
+    // Statistics
+    int getShardCount() const {
+        return (int)m_shards.size();
+    }
+    
+    // Core shard i is pinned to, -1 if unpinned or pinning failed
+    int getShardCore(int shard) const {
+        return m_shards[shard]->core.load();
+    }
+    
+    unsigned long long getShardDelivered(int shard) const {
+        return m_shards[shard]->delivered.load(std::memory_order_relaxed);
+    }
+    
+    const MT4PumpQueue& getShardQueue(int shard) const {
+        return m_shards[shard]->queue;
+    }
+    
+    unsigned long long depth() const {
+        unsigned long long total = 0;
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            total += m_shards[i]->queue.depth();
+        }
+        return total;
+    }
+    
+    unsigned long long dropped() const {
+        unsigned long long total = 0;
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            total += m_shards[i]->queue.dropped();
+        }
+        return total;
+    }
+    
+    unsigned long long delivered() const {
+        unsigned long long total = 0;
+        for (size_t i = 0; i < m_shards.size(); i++) {
+            total += m_shards[i]->delivered.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+#endif // MT4DISPATCHER_H
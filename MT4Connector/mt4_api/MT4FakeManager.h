@@ -0,0 +1,548 @@
+//+------------------------------------------------------------------+
+//|                      In-process Fake Manager Server (Benchmarks) |
+//+------------------------------------------------------------------+
+#ifndef MT4FAKEMANAGER_H
+#define MT4FAKEMANAGER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4Metrics.h"
+
+// First login and ticket handed out by the fake server
+#define MT4_FAKE_FIRST_LOGIN  1000
+#define MT4_FAKE_FIRST_TICKET 1
+
+//+------------------------------------------------------------------+
+//| MT4FakeConfig - Shape of the simulated server                    |
+//+------------------------------------------------------------------+
+struct MT4FakeConfig {
+    int latency_us;             // busy-wait added to every request call
+    int users;
+    int trades;                 // open trades, spread round-robin over users
+    int symbols;
+    bool report_tickets;        // TradeTransaction returns new tickets in info.order
+    
+    MT4FakeConfig() : latency_us(0), users(1000), trades(10000), symbols(32), report_tickets(true) {}
+};
+
+//+------------------------------------------------------------------+
+//| MT4FakeManager - CManagerInterface served from generated data    |
+//| Implements the calls MT4Manager and its listeners make; request  |
+//| arrays are copied into malloc'd buffers and released by MemFree  |
+//| like the DLL's. Every other interface call is declared so the    |
+//| class is concrete, and fails with RET_ERROR or an empty array.   |
+//| Quotes queued with pushQuotes() are returned by                  |
+//| SymbolInfoUpdated(), so an MT4PumpingEngine attached to the fake |
+//| can be driven with dispatch(PUMP_UPDATE_BIDASK, 0, NULL). The    |
+//| request side is thread-safe; the quote side belongs to the       |
+//| dispatching thread. Release() does not delete: caller owns it.   |
+//+------------------------------------------------------------------+
+class MT4FakeManager : public CManagerInterface {
+private:
+    MT4FakeConfig m_config;
+    std::vector<UserRecord> m_users;
+    std::vector<ConSymbol> m_symbols;
+    std::vector<TradeRecord> m_trades;
+    ConGroup m_group;
+    std::mutex m_lock;                      // guards m_trades
+    std::atomic<int> m_next_ticket;
+    std::atomic<bool> m_connected;
+    
+    std::vector<SymbolInfo> m_pending;      // quotes not yet read by SymbolInfoUpdated
+    size_t m_pending_read;
+    
+    MT4FakeManager(const MT4FakeManager&);
+    MT4FakeManager& operator=(const MT4FakeManager&);
+    
+    // Simulated network round trip
+    void delay() const {
+        if (m_config.latency_us <= 0) {
+            return;
+        }
+        uint64_t until = MT4MetricsNow() + (uint64_t)m_config.latency_us * 1000;
+        while (MT4MetricsNow() < until) {
+        }
+    }
+    
+    template <class T>
+    static T* copyOut(const T* records, size_t count, int* total) {
+        *total = (int)count;
+        if (count == 0) {
+            return NULL;
+        }
+        T* out = (T*)malloc(count * sizeof(T));
+        if (out != NULL) {
+            memcpy(out, records, count * sizeof(T));
+        }
+        return out;
+    }
+    
+    void generate() {
+        if (m_config.users < 1) {
+            m_config.users = 1;
+        }
+        if (m_config.symbols < 1) {
+            m_config.symbols = 1;
+        }
+        
+        memset(&m_group, 0, sizeof(m_group));
+        strcpy(m_group.group, "demo");
+        strcpy(m_group.currency, "USD");
+        m_group.default_leverage = 100;
+        m_group.margin_call = 50;
+        m_group.margin_stopout = 20;
+        for (int i = 0; i < 32; i++) {
+            m_group.secgroups[i].show = 1;
+            m_group.secgroups[i].trade = 1;
+            m_group.secgroups[i].lot_min = 1;
+            m_group.secgroups[i].lot_max = 100000;
+            m_group.secgroups[i].lot_step = 1;
+        }
+        
+        m_symbols.resize(m_config.symbols);
+        for (int i = 0; i < m_config.symbols; i++) {
+            ConSymbol& s = m_symbols[i];
+            memset(&s, 0, sizeof(s));
+            snprintf(s.symbol, sizeof(s.symbol), "FAKE%03d", i);
+            strcpy(s.currency, "USD");
+            strcpy(s.margin_currency, "USD");
+            s.trade = TRADE_FULL;
+            s.digits = 5;
+            s.point = 0.00001;
+            s.stops_level = 10;
+            s.contract_size = 100000;
+            s.tick_size = 0.00001;
+            s.tick_value = 1;
+            s.margin_divider = 1;
+        }
+        
+        m_users.resize(m_config.users);
+        for (int i = 0; i < m_config.users; i++) {
+            UserRecord& u = m_users[i];
+            memset(&u, 0, sizeof(u));
+            u.login = MT4_FAKE_FIRST_LOGIN + i;
+            strcpy(u.group, "demo");
+            snprintf(u.name, sizeof(u.name), "Fake User %d", u.login);
+            u.enable = 1;
+            u.leverage = 100;
+            u.balance = 10000;
+            u.regdate = time(NULL) - 86400;
+        }
+        
+        m_trades.resize(m_config.trades > 0 ? m_config.trades : 0);
+        for (size_t i = 0; i < m_trades.size(); i++) {
+            TradeRecord& t = m_trades[i];
+            memset(&t, 0, sizeof(t));
+            t.order = m_next_ticket++;
+            t.login = MT4_FAKE_FIRST_LOGIN + (int)(i % m_users.size());
+            memcpy(t.symbol, m_symbols[i % m_symbols.size()].symbol, sizeof(t.symbol));
+            t.digits = 5;
+            t.cmd = (int)(i % 2);
+            t.volume = 100;
+            t.open_price = 1.1;
+            t.open_time = time(NULL) - 3600;
+            t.margin_rate = 1;
+        }
+    }
+    
+    const UserRecord* findUser(int login) const {
+        int index = login - MT4_FAKE_FIRST_LOGIN;
+        return index >= 0 && index < (int)m_users.size() ? &m_users[index] : NULL;
+    }
+    
+    const ConSymbol* findSymbol(LPCSTR symbol) const {
+        for (size_t i = 0; i < m_symbols.size(); i++) {
+            if (strncmp(m_symbols[i].symbol, symbol, sizeof(m_symbols[i].symbol)) == 0) {
+                return &m_symbols[i];
+            }
+        }
+        return NULL;
+    }
+
+public:
+    explicit MT4FakeManager(const MT4FakeConfig& config = MT4FakeConfig())
+        : m_config(config), m_next_ticket(MT4_FAKE_FIRST_TICKET), m_connected(false), m_pending_read(0) {
+        generate();
+    }
+    
+    const MT4FakeConfig& getConfig() const {
+        return m_config;
+    }
+    
+    // Queue quotes for the next SymbolInfoUpdated() calls (dispatching thread)
+    void pushQuotes(const SymbolInfo* quotes, int count) {
+        if (m_pending_read == m_pending.size()) {
+            m_pending.clear();
+            m_pending_read = 0;
+        }
+        m_pending.insert(m_pending.end(), quotes, quotes + count);
+    }
+    
+    // A quote of symbol index at price bid, stamped with the current time
+    SymbolInfo makeQuote(int symbol, double bid) const {
+        SymbolInfo si;
+        memset(&si, 0, sizeof(si));
+        memcpy(si.symbol, m_symbols[symbol % m_symbols.size()].symbol, sizeof(si.symbol));
+        si.digits = 5;
+        si.point = 0.00001;
+        si.bid = bid;
+        si.ask = bid + 0.0001;
+        si.lasttime = time(NULL);
+        return si;
+    }
+    
+    // A pumped trade update as the server would send it
+    TradeRecord makeTrade(int index) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        TradeRecord t = m_trades.empty() ? TradeRecord() : m_trades[index % m_trades.size()];
+        t.profit = (double)(index % 200) - 100;
+        return t;
+    }
+    
+    //--- Connection
+    int __stdcall Release() { return 0; }
+    void __stdcall MemFree(void* ptr) { free(ptr); }
+    LPCSTR __stdcall ErrorDescription(const int code) { return code == RET_OK ? "OK" : "Fake server error"; }
+    int __stdcall Connect(LPCSTR) { delay(); m_connected = true; return RET_OK; }
+    int __stdcall Disconnect() { m_connected = false; return RET_OK; }
+    int __stdcall IsConnected() { return m_connected ? 1 : 0; }
+    int __stdcall Login(const int, LPCSTR) { delay(); return m_connected ? RET_OK : RET_NO_CONNECT; }
+    int __stdcall Ping() { delay(); return RET_OK; }
+    time_t __stdcall ServerTime() { delay(); return time(NULL); }
+    
+    //--- Users and groups
+    UserRecord* __stdcall UsersRequest(int* total) {
+        delay();
+        return copyOut(m_users.data(), m_users.size(), total);
+    }
+    
+    UserRecord* __stdcall UsersGet(int* total) {
+        return copyOut(m_users.data(), m_users.size(), total);
+    }
+    
+    int __stdcall UserRecordGet(const int login, UserRecord* user) {
+        delay();
+        const UserRecord* found = findUser(login);
+        if (found == NULL) {
+            return RET_INVALID_DATA;
+        }
+        *user = *found;
+        return RET_OK;
+    }
+    
+    ConGroup* __stdcall CfgRequestGroup(int* total) { delay(); return copyOut(&m_group, 1, total); }
+    ConGroup* __stdcall GroupsRequest(int* total) { delay(); return copyOut(&m_group, 1, total); }
+    ConGroup* __stdcall GroupsGet(int* total) { return copyOut(&m_group, 1, total); }
+    
+    int __stdcall GroupRecordGet(LPCSTR name, ConGroup* group) {
+        if (strcmp(name, m_group.group) != 0) {
+            return RET_INVALID_DATA;
+        }
+        *group = m_group;
+        return RET_OK;
+    }
+    
+    OnlineRecord* __stdcall OnlineRequest(int* total) { delay(); *total = 0; return NULL; }
+    OnlineRecord* __stdcall OnlineGet(int* total) { *total = 0; return NULL; }
+    
+    //--- Symbols and quotes
+    ConSymbol* __stdcall SymbolsGetAll(int* total) {
+        return copyOut(m_symbols.data(), m_symbols.size(), total);
+    }
+    
+    int __stdcall SymbolsRefresh() { delay(); return RET_OK; }
+    int __stdcall SymbolAdd(LPCSTR) { return RET_OK; }
+    
+    int __stdcall SymbolGet(LPCSTR symbol, ConSymbol* cs) {
+        const ConSymbol* found = findSymbol(symbol);
+        if (found == NULL) {
+            return RET_INVALID_DATA;
+        }
+        *cs = *found;
+        return RET_OK;
+    }
+    
+    int __stdcall SymbolInfoGet(LPCSTR symbol, SymbolInfo* si) {
+        const ConSymbol* found = findSymbol(symbol);
+        if (found == NULL) {
+            return RET_INVALID_DATA;
+        }
+        *si = makeQuote((int)(found - &m_symbols[0]), 1.1);
+        return RET_OK;
+    }
+    
+    int __stdcall SymbolInfoUpdated(SymbolInfo* si, const int max_info) {
+        int count = 0;
+        while (count < max_info && m_pending_read < m_pending.size()) {
+            si[count++] = m_pending[m_pending_read++];
+        }
+        return count;
+    }
+    
+    //--- Trades
+    TradeRecord* __stdcall TradesRequest(int* total) {
+        delay();
+        std::lock_guard<std::mutex> lock(m_lock);
+        return copyOut(m_trades.data(), m_trades.size(), total);
+    }
+    
+    TradeRecord* __stdcall TradesGet(int* total) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return copyOut(m_trades.data(), m_trades.size(), total);
+    }
+    
+    TradeRecord* __stdcall TradesGetByLogin(const int login, LPCSTR, int* total) {
+        delay();
+        std::lock_guard<std::mutex> lock(m_lock);
+        std::vector<TradeRecord> found;
+        for (size_t i = 0; i < m_trades.size(); i++) {
+            if (m_trades[i].login == login) {
+                found.push_back(m_trades[i]);
+            }
+        }
+        return copyOut(found.data(), found.size(), total);
+    }
+    
+    TradeRecord* __stdcall TradesGetBySymbol(LPCSTR symbol, int* total) {
+        delay();
+        std::lock_guard<std::mutex> lock(m_lock);
+        std::vector<TradeRecord> found;
+        for (size_t i = 0; i < m_trades.size(); i++) {
+            if (strncmp(m_trades[i].symbol, symbol, sizeof(m_trades[i].symbol)) == 0) {
+                found.push_back(m_trades[i]);
+            }
+        }
+        return copyOut(found.data(), found.size(), total);
+    }
+    
+    int __stdcall TradeRecordGet(const int order, TradeRecord* trade) {
+        delay();
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (size_t i = 0; i < m_trades.size(); i++) {
+            if (m_trades[i].order == order) {
+                *trade = m_trades[i];
+                return RET_OK;
+            }
+        }
+        return RET_INVALID_DATA;
+    }
+    
+    // Opens are appended to the trade list; everything else is accepted
+    int __stdcall TradeTransaction(TradeTransInfo* info) {
+        delay();
+        if (info->type != TT_BR_ORDER_OPEN) {
+            return RET_OK;
+        }
+        
+        TradeRecord t;
+        memset(&t, 0, sizeof(t));
+        t.order = m_next_ticket++;
+        t.login = info->orderby;
+        memcpy(t.symbol, info->symbol, sizeof(t.symbol));
+        t.cmd = info->cmd;
+        t.volume = info->volume;
+        t.open_price = info->price;
+        t.sl = info->sl;
+        t.tp = info->tp;
+        t.open_time = time(NULL);
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_trades.push_back(t);
+        }
+        
+        info->order = m_config.report_tickets ? t.order : 0;
+        return RET_OK;
+    }
+    
+    //--- Margin
+    int __stdcall MarginLevelRequest(const int login, MarginLevel* level) {
+        delay();
+        return MarginLevelGet(login, NULL, level);
+    }
+    
+    int __stdcall MarginLevelGet(const int login, LPCSTR, MarginLevel* level) {
+        const UserRecord* user = findUser(login);
+        if (user == NULL) {
+            return RET_INVALID_DATA;
+        }
+        memset(level, 0, sizeof(*level));
+        level->login = login;
+        memcpy(level->group, user->group, sizeof(level->group));
+        level->leverage = user->leverage;
+        level->balance = user->balance;
+        level->equity = user->balance;
+        level->margin_free = user->balance;
+        return RET_OK;
+    }
+    
+    //--- Pumping and synchronization; the engine is driven via dispatch()
+    int __stdcall PumpingSwitchEx(MTAPI_NOTIFY_FUNC_EX, const int, void*) { return RET_OK; }
+    int __stdcall UsersSyncStart(const time_t) { return RET_ERROR; }
+    UserRecord* __stdcall UsersSyncRead(int* total) { *total = 0; return NULL; }
+    int __stdcall TradesSyncStart(const time_t) { return RET_ERROR; }
+    TradeRecord* __stdcall TradesSyncRead(int* total) { *total = 0; return NULL; }
+    
+    //--- Not simulated: the rest of the interface fails like an offline server
+    int __stdcall QueryInterface(REFIID, LPVOID*) { return RET_ERROR; }
+    int __stdcall AddRef() { return 1; }
+    void __stdcall WorkingDirectory(LPCSTR) {}
+    int __stdcall LoginSecured(LPCSTR) { return RET_ERROR; }
+    int __stdcall KeysSend(LPCSTR) { return RET_ERROR; }
+    int __stdcall PasswordChange(LPCSTR, const int) { return RET_ERROR; }
+    int __stdcall ManagerRights(ConManager*) { return RET_ERROR; }
+    
+    int __stdcall SrvRestart() { return RET_ERROR; }
+    int __stdcall SrvChartsSync() { return RET_ERROR; }
+    int __stdcall SrvLiveUpdateStart() { return RET_ERROR; }
+    int __stdcall SrvFeedsRestart() { return RET_ERROR; }
+    ServerFeed* __stdcall SrvFeeders(int* total) { *total = 0; return NULL; }
+    LPSTR __stdcall SrvFeederLog(LPCSTR, int* len) { *len = 0; return NULL; }
+    
+    int __stdcall CfgRequestCommon(ConCommon*) { return RET_ERROR; }
+    int __stdcall CfgRequestTime(ConTime*) { return RET_ERROR; }
+    int __stdcall CfgRequestBackup(ConBackup*) { return RET_ERROR; }
+    int __stdcall CfgRequestSymbolGroup(ConSymbolGroup*) { return RET_ERROR; }
+    ConAccess* __stdcall CfgRequestAccess(int* total) { *total = 0; return NULL; }
+    ConDataServer* __stdcall CfgRequestDataServer(int* total) { *total = 0; return NULL; }
+    ConHoliday* __stdcall CfgRequestHoliday(int* total) { *total = 0; return NULL; }
+    ConSymbol* __stdcall CfgRequestSymbol(int* total) { *total = 0; return NULL; }
+    ConManager* __stdcall CfgRequestManager(int* total) { *total = 0; return NULL; }
+    ConFeeder* __stdcall CfgRequestFeeder(int* total) { *total = 0; return NULL; }
+    ConLiveUpdate* __stdcall CfgRequestLiveUpdate(int* total) { *total = 0; return NULL; }
+    ConSync* __stdcall CfgRequestSync(int* total) { *total = 0; return NULL; }
+    ConPluginParam* __stdcall CfgRequestPlugin(int* total) { *total = 0; return NULL; }
+    ConGatewayAccount* __stdcall CfgRequestGatewayAccount(int* total) { *total = 0; return NULL; }
+    ConGatewayMarkup* __stdcall CfgRequestGatewayMarkup(int* total) { *total = 0; return NULL; }
+    ConGatewayRule* __stdcall CfgRequestGatewayRule(int* total) { *total = 0; return NULL; }
+    
+    int __stdcall CfgUpdateCommon(const ConCommon*) { return RET_ERROR; }
+    int __stdcall CfgUpdateAccess(const ConAccess*, const int) { return RET_ERROR; }
+    int __stdcall CfgUpdateDataServer(const ConDataServer*, const int) { return RET_ERROR; }
+    int __stdcall CfgUpdateTime(const ConTime*) { return RET_ERROR; }
+    int __stdcall CfgUpdateHoliday(const ConHoliday*, const int) { return RET_ERROR; }
+    int __stdcall CfgUpdateSymbol(const ConSymbol*) { return RET_ERROR; }
+    int __stdcall CfgUpdateSymbolGroup(const ConSymbolGroup*, const int) { return RET_ERROR; }
+    int __stdcall CfgUpdateGroup(const ConGroup*) { return RET_ERROR; }
+    int __stdcall CfgUpdateManager(const ConManager*) { return RET_ERROR; }
+    int __stdcall CfgUpdateFeeder(const ConFeeder*) { return RET_ERROR; }
+    int __stdcall CfgUpdateBackup(const ConBackup*) { return RET_ERROR; }
+    int __stdcall CfgUpdateLiveUpdate(const ConLiveUpdate*) { return RET_ERROR; }
+    int __stdcall CfgUpdateSync(const ConSync*) { return RET_ERROR; }
+    int __stdcall CfgUpdatePlugin(const ConPlugin*, const PluginCfg*, const int) { return RET_ERROR; }
+    int __stdcall CfgUpdateGatewayAccount(const ConGatewayAccount*) { return RET_ERROR; }
+    int __stdcall CfgUpdateGatewayMarkup(const ConGatewayMarkup*) { return RET_ERROR; }
+    int __stdcall CfgUpdateGatewayRule(const ConGatewayRule*) { return RET_ERROR; }
+    
+    int __stdcall CfgDeleteAccess(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteDataServer(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteHoliday(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteSymbol(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteGroup(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteManager(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteFeeder(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteLiveUpdate(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteSync(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteGatewayAccount(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteGatewayMarkup(const int) { return RET_ERROR; }
+    int __stdcall CfgDeleteGatewayRule(const int) { return RET_ERROR; }
+    
+    int __stdcall CfgShiftAccess(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftDataServer(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftHoliday(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftSymbol(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftGroup(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftManager(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftFeeder(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftLiveUpdate(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftSync(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftPlugin(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftGatewayAccount(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftGatewayMarkup(const int, const int) { return RET_ERROR; }
+    int __stdcall CfgShiftGatewayRule(const int, const int) { return RET_ERROR; }
+    
+    RateInfo* __stdcall ChartRequest(const ChartInfo*, time_t*, int* total) { *total = 0; return NULL; }
+    int __stdcall ChartAdd(LPCSTR, const int, const RateInfo*, int*) { return RET_ERROR; }
+    int __stdcall ChartUpdate(LPCSTR, const int, const RateInfo*, int*) { return RET_ERROR; }
+    int __stdcall ChartDelete(LPCSTR, const int, const RateInfo*, int*) { return RET_ERROR; }
+    int __stdcall HistoryCorrect(LPCSTR, int*) { return RET_ERROR; }
+    TickRecord* __stdcall TickInfoRequest(const TickRequest*, int* total) { *total = 0; return NULL; }
+    LPSTR __stdcall LogsRequest(const LogRequest*, int* len) { *len = 0; return NULL; }
+    void __stdcall LogsOut(const int, LPCSTR, LPCSTR) {}
+    
+    UserRecord* __stdcall UserRecordsRequest(const int*, int* total) { *total = 0; return NULL; }
+    int __stdcall UserRecordNew(UserRecord*) { return RET_ERROR; }
+    int __stdcall UserRecordUpdate(const UserRecord*) { return RET_ERROR; }
+    int __stdcall UsersGroupOp(const GroupCommandInfo*, const int*) { return RET_ERROR; }
+    int __stdcall UserPasswordCheck(const int, LPCSTR) { return RET_ERROR; }
+    int __stdcall UserPasswordSet(const int, LPCSTR, const int, const int) { return RET_ERROR; }
+    int __stdcall OnlineRecordGet(const int, OnlineRecord*) { return RET_ERROR; }
+    int* __stdcall UsersSnapshot(int* total) { *total = 0; return NULL; }
+    
+    TradeRecord* __stdcall TradeRecordsRequest(const int*, int* total) { *total = 0; return NULL; }
+    TradeRecord* __stdcall TradesUserHistory(const int, const time_t, const time_t, int* total) { *total = 0; return NULL; }
+    TradeRecord* __stdcall TradesGetByMarket(int* total) { *total = 0; return NULL; }
+    int __stdcall TradeCheckStops(const TradeTransInfo*, const double) { return RET_ERROR; }
+    int __stdcall TradeClearRollback(const int) { return RET_ERROR; }
+    int __stdcall TradeCalcProfit(TradeRecord*) { return RET_ERROR; }
+    int* __stdcall TradesSnapshot(int* total) { *total = 0; return NULL; }
+    TradeRecord* __stdcall ReportsRequest(const ReportGroupRequest*, const int*, int* total) { *total = 0; return NULL; }
+    DailyReport* __stdcall DailyReportsRequest(const DailyGroupRequest*, const int*, int* total) { *total = 0; return NULL; }
+    int __stdcall DailySyncStart(const time_t) { return RET_ERROR; }
+    DailyReport* __stdcall DailySyncRead(int* total) { *total = 0; return NULL; }
+    
+    int __stdcall ExternalCommand(LPCSTR, const int, LPSTR*, int*) { return RET_ERROR; }
+    int __stdcall PluginUpdate(const ConPluginParam*) { return RET_ERROR; }
+    int __stdcall PumpingSwitch(MTAPI_NOTIFY_FUNC, const HWND, const UINT, const int) { return RET_ERROR; }
+    
+    int __stdcall SymbolHide(LPCSTR) { return RET_ERROR; }
+    int __stdcall SymbolChange(const SymbolProperties*) { return RET_ERROR; }
+    int __stdcall SymbolSendTick(LPCSTR, const double, const double) { return RET_ERROR; }
+    int __stdcall SymbolsGroupsGet(ConSymbolGroup*) { return RET_ERROR; }
+    TickInfo* __stdcall TickInfoLast(LPCSTR, int* total) { *total = 0; return NULL; }
+    RequestInfo* __stdcall RequestsGet(int* total) { *total = 0; return NULL; }
+    int __stdcall RequestInfoGet(const int, RequestInfo*) { return RET_ERROR; }
+    SymbolSummary* __stdcall SummaryGetAll(int* total) { *total = 0; return NULL; }
+    int __stdcall SummaryGet(LPCSTR, SymbolSummary*) { return RET_ERROR; }
+    int __stdcall SummaryGetByCount(const int, SymbolSummary*) { return RET_ERROR; }
+    int __stdcall SummaryGetByType(const int, SymbolSummary*) { return RET_ERROR; }
+    int __stdcall SummaryCurrency(LPSTR, const int) { return RET_ERROR; }
+    ExposureValue* __stdcall ExposureGet(int* total) { *total = 0; return NULL; }
+    int __stdcall ExposureValueGet(LPCSTR, ExposureValue*) { return RET_ERROR; }
+    int __stdcall ManagerCommon(ConCommon*) { return RET_ERROR; }
+    
+    int __stdcall NewsTotal() { return 0; }
+    int __stdcall NewsTopicGet(const int, NewsTopic*) { return RET_ERROR; }
+    void __stdcall NewsBodyRequest(const int) {}
+    LPCSTR __stdcall NewsBodyGet(const int) { return NULL; }
+    int __stdcall NewsSend(const NewsTopic*) { return RET_ERROR; }
+    int __stdcall MailLast(LPSTR, int*) { return RET_ERROR; }
+    int __stdcall MailSend(const MailBox*, const int*) { return RET_ERROR; }
+    int __stdcall NotificationsSend(LPWSTR, LPCWSTR) { return RET_ERROR; }
+    int __stdcall NotificationsSend(const int*, const UINT, LPCWSTR) { return RET_ERROR; }
+    
+    int __stdcall DealerSwitch(MTAPI_NOTIFY_FUNC, const HWND, const UINT) { return RET_ERROR; }
+    int __stdcall DealerRequestGet(RequestInfo*) { return RET_ERROR; }
+    int __stdcall DealerSend(const RequestInfo*, const int, const int) { return RET_ERROR; }
+    int __stdcall DealerReject(const int) { return RET_ERROR; }
+    int __stdcall DealerReset(const int) { return RET_ERROR; }
+    
+    BackupInfo* __stdcall BackupInfoUsers(const int, int* total) { *total = 0; return NULL; }
+    BackupInfo* __stdcall BackupInfoOrders(const int, int* total) { *total = 0; return NULL; }
+    UserRecord* __stdcall BackupRequestUsers(LPCSTR, LPCSTR, int* total) { *total = 0; return NULL; }
+    TradeRecord* __stdcall BackupRequestOrders(LPCSTR, LPCSTR, int* total) { *total = 0; return NULL; }
+    int __stdcall BackupRestoreUsers(const UserRecord*, const int) { return RET_ERROR; }
+    TradeRestoreResult* __stdcall BackupRestoreOrders(const TradeRecord*, int* total) { *total = 0; return NULL; }
+    
+    int __stdcall BytesSent() { return 0; }
+    int __stdcall BytesReceived() { return 0; }
+    int __stdcall LicenseCheck(LPCSTR) { return RET_ERROR; }
+};
+
+#endif // MT4FAKEMANAGER_H
@@ -0,0 +1,504 @@
+//+------------------------------------------------------------------+
+//|                        Allocation-free JSON/CSV Record Formatting |
+//+------------------------------------------------------------------+
+#ifndef MT4FORMAT_H
+#define MT4FORMAT_H
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <cmath>
+#include <charconv>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4QuoteTable.h"
+#include "MT4WireFormat.h"
+#include "MT4Metrics.h"
+
+//+------------------------------------------------------------------+
+//| Command names, indexed by TradeRecord::cmd                       |
+//+------------------------------------------------------------------+
+constexpr const char* MT4_CMD_NAMES[] = {
+    "Buy", "Sell", "Buy Limit", "Sell Limit", "Buy Stop", "Sell Stop", "Balance", "Credit"
+};
+
+constexpr int MT4_CMD_NAME_COUNT = sizeof(MT4_CMD_NAMES) / sizeof(MT4_CMD_NAMES[0]);
+
+// Display name of a trade command
+constexpr const char* MT4CmdName(int cmd) {
+    return (cmd >= 0 && cmd < MT4_CMD_NAME_COUNT) ? MT4_CMD_NAMES[cmd] : "Unknown";
+}
+
+//+------------------------------------------------------------------+
+//| MT4Writer - Appends text to a caller-provided buffer             |
+//| Never allocates; output is truncated once the buffer is full and |
+//| overflowed() reports it. The buffer is always NUL-terminated.    |
+//+------------------------------------------------------------------+
+class MT4Writer {
+private:
+    char* m_buf;
+    size_t m_cap;
+    size_t m_len;
+    bool m_overflow;
+
+public:
+    MT4Writer(char* buffer, size_t capacity)
+        : m_buf(buffer), m_cap(capacity), m_len(0), m_overflow(capacity == 0) {
+        if (capacity > 0) {
+            buffer[0] = 0;
+        }
+    }
+    
+    const char* data() const { return m_buf; }
+    size_t size() const { return m_len; }
+    bool overflowed() const { return m_overflow; }
+    
+    // Discard the contents, keeping the buffer
+    void clear() {
+        m_len = 0;
+        m_overflow = m_cap == 0;
+        if (m_cap > 0) {
+            m_buf[0] = 0;
+        }
+    }
+    
+    MT4Writer& append(const char* text, size_t n) {
+        if (m_cap == 0) {
+            return *this;               // no buffer to copy into, m_overflow is set
+        }
+        if (m_len + n >= m_cap) {
+            n = m_cap > m_len + 1 ? m_cap - m_len - 1 : 0;
+            m_overflow = true;
+        }
+        memcpy(m_buf + m_len, text, n);
+        m_len += n;
+        m_buf[m_len] = 0;
+        return *this;
+    }
+    
+    MT4Writer& append(const char* text) {
+        return append(text, strlen(text));
+    }
+    
+    MT4Writer& append(char c) {
+        return append(&c, 1);
+    }
+    
+    // Append a fixed char[] field that may lack a terminator
+    MT4Writer& appendField(const char* text, size_t max_len) {
+        return append(text, strnlen(text, max_len));
+    }
+    
+    MT4Writer& appendInt(long long value) {
+        char tmp[24];
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), value);
+        return append(tmp, r.ptr - tmp);
+    }
+    
+    // Append value with digits decimals; NaN, infinities (which JSON
+    // cannot represent) and values too long for the buffer are null
+    MT4Writer& appendDouble(double value, int digits) {
+        if (!std::isfinite(value)) {
+            return append("null", 4);
+        }
+        
+        char tmp[64];
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), value, std::chars_format::fixed, digits);
+        if (r.ec != std::errc()) {
+            // Too long in fixed notation
+            r = std::to_chars(tmp, tmp + sizeof(tmp), value, std::chars_format::scientific, digits);
+            if (r.ec != std::errc()) {
+                return append("null", 4);
+            }
+        }
+        return append(tmp, r.ptr - tmp);
+    }
+    
+    // Append a JSON string literal, escaping quotes, backslashes and
+    // control characters
+    MT4Writer& appendJsonString(const char* text, size_t max_len) {
+        static const char hex[] = "0123456789abcdef";
+        
+        append('"');
+        for (size_t i = 0; i < max_len && text[i]; i++) {
+            unsigned char c = (unsigned char)text[i];
+            if (c == '"' || c == '\\') {
+                char esc[2] = { '\\', (char)c };
+                append(esc, 2);
+            } else if (c < 0x20) {
+                char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+                append(esc, 6);
+            } else {
+                append((char)c);
+            }
+        }
+        return append('"');
+    }
+    
+    // Append a CSV field, quoting it when it contains separators
+    MT4Writer& appendCsvString(const char* text, size_t max_len) {
+        size_t n = strnlen(text, max_len);
+        bool plain = true;
+        for (size_t i = 0; i < n && plain; i++) {
+            plain = text[i] != ',' && text[i] != '"' && text[i] != '\r' && text[i] != '\n';
+        }
+        if (plain) {
+            return append(text, n);
+        }
+        
+        append('"');
+        for (size_t i = 0; i < n; i++) {
+            if (text[i] == '"') {
+                append('"');
+            }
+            append(text[i]);
+        }
+        return append('"');
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4TimeFormatter - Local "YYYY-MM-DD HH:MM:SS", hour cached      |
+//| localtime() runs once per local hour touched; minutes and        |
+//| seconds are split arithmetically. An hour in which the zone      |
+//| shifts (half-hour zones can move their clocks at :30) is cached  |
+//| a minute at a time instead.                                      |
+//| Not thread-safe; instance() gives each thread its own formatter. |
+//+------------------------------------------------------------------+
+class MT4TimeFormatter {
+private:
+    time_t m_start;             // cached range, a local hour or minute
+    time_t m_end;
+    int m_start_secs;           // seconds into the local hour at m_start
+    char m_prefix[14];          // "YYYY-MM-DD HH"
+    
+    static void twoDigits(char* out, int value) {
+        out[0] = (char)('0' + value / 10);
+        out[1] = (char)('0' + value % 10);
+    }
+    
+    static void localTime(time_t t, struct tm& tm_local) {
+#ifdef _WIN32
+        localtime_s(&tm_local, &t);
+#else
+        localtime_r(&t, &tm_local);
+#endif
+    }
+    
+    // Check that t is secs into the local hour of tm_local
+    static bool inHour(time_t t, const struct tm& tm_local, int secs) {
+        struct tm other;
+        localTime(t, other);
+        return other.tm_hour == tm_local.tm_hour && other.tm_mday == tm_local.tm_mday &&
+               other.tm_min * 60 + other.tm_sec == secs;
+    }
+    
+    void cacheHour(time_t t) {
+        struct tm tm_local;
+        localTime(t, tm_local);
+        
+        m_start_secs = 0;
+        m_start = t - (tm_local.tm_min * 60 + tm_local.tm_sec);
+        m_end = m_start + 3600;
+        
+        // The zone shifts within this hour; split only the seconds
+        if (!inHour(m_start, tm_local, 0) || !inHour(m_end - 1, tm_local, 3599)) {
+            m_start_secs = tm_local.tm_min * 60;
+            m_start = t - tm_local.tm_sec;
+            m_end = m_start + 60;
+        }
+        
+        int year = tm_local.tm_year + 1900;
+        twoDigits(m_prefix, year / 100 % 100);
+        twoDigits(m_prefix + 2, year % 100);
+        m_prefix[4] = '-';
+        twoDigits(m_prefix + 5, tm_local.tm_mon + 1);
+        m_prefix[7] = '-';
+        twoDigits(m_prefix + 8, tm_local.tm_mday);
+        m_prefix[10] = ' ';
+        twoDigits(m_prefix + 11, tm_local.tm_hour);
+        m_prefix[13] = 0;
+    }
+
+public:
+    MT4TimeFormatter() : m_start(0), m_end(0), m_start_secs(0) {
+        m_prefix[0] = 0;
+    }
+    
+    // Write the local time of t as 19 characters plus a terminator
+    // into out (at least 20 bytes)
+    void format(time_t t, char* out) {
+        if (t < m_start || t >= m_end) {
+            cacheHour(t);
+        }
+        
+        int secs = m_start_secs + (int)(t - m_start);
+        memcpy(out, m_prefix, 13);
+        out[13] = ':';
+        twoDigits(out + 14, secs / 60);
+        out[16] = ':';
+        twoDigits(out + 17, secs % 60);
+        out[19] = 0;
+    }
+    
+    MT4Writer& append(MT4Writer& w, time_t t) {
+        char buf[20];
+        format(t, buf);
+        return w.append(buf, 19);
+    }
+    
+    // Formatter of the calling thread
+    static MT4TimeFormatter& instance() {
+        static thread_local MT4TimeFormatter formatter;
+        return formatter;
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4Format - JSON objects and CSV rows of Manager API records     |
+//| Every function appends to a writer and returns it, so a batch of |
+//| records can be streamed into one buffer.                         |
+//+------------------------------------------------------------------+
+namespace MT4Format {
+
+inline MT4Writer& tradeJson(MT4Writer& w, const TradeRecord& t) {
+    MT4TimeFormatter& tf = MT4TimeFormatter::instance();
+    
+    w.append("{\"ticket\":").appendInt(t.order);
+    w.append(",\"login\":").appendInt(t.login);
+    w.append(",\"symbol\":").appendJsonString(t.symbol, sizeof(t.symbol));
+    w.append(",\"cmd\":").appendInt(t.cmd);
+    w.append(",\"type\":\"").append(MT4CmdName(t.cmd)).append('"');
+    w.append(",\"volume\":").appendDouble(t.volume / 100.0, 2);
+    w.append(",\"open_price\":").appendDouble(t.open_price, t.digits);
+    w.append(",\"open_time\":\"");
+    tf.append(w, t.open_time).append('"');
+    w.append(",\"sl\":").appendDouble(t.sl, t.digits);
+    w.append(",\"tp\":").appendDouble(t.tp, t.digits);
+    if (t.close_time != 0) {
+        w.append(",\"close_price\":").appendDouble(t.close_price, t.digits);
+        w.append(",\"close_time\":\"");
+        tf.append(w, t.close_time).append('"');
+    }
+    w.append(",\"profit\":").appendDouble(t.profit, 2);
+    w.append(",\"commission\":").appendDouble(t.commission, 2);
+    w.append(",\"swap\":").appendDouble(t.storage, 2);
+    w.append(",\"comment\":").appendJsonString(t.comment, sizeof(t.comment));
+    return w.append('}');
+}
+
+// Columns: ticket,login,symbol,type,volume,open_price,open_time,sl,tp,
+// close_price,close_time,profit,commission,swap,comment
+inline MT4Writer& tradeCsv(MT4Writer& w, const TradeRecord& t) {
+    MT4TimeFormatter& tf = MT4TimeFormatter::instance();
+    
+    w.appendInt(t.order).append(',').appendInt(t.login).append(',');
+    w.appendCsvString(t.symbol, sizeof(t.symbol)).append(',');
+    w.append(MT4CmdName(t.cmd)).append(',');
+    w.appendDouble(t.volume / 100.0, 2).append(',');
+    w.appendDouble(t.open_price, t.digits).append(',');
+    tf.append(w, t.open_time).append(',');
+    w.appendDouble(t.sl, t.digits).append(',');
+    w.appendDouble(t.tp, t.digits).append(',');
+    if (t.close_time != 0) {
+        w.appendDouble(t.close_price, t.digits).append(',');
+        tf.append(w, t.close_time).append(',');
+    } else {
+        w.append(",,");
+    }
+    w.appendDouble(t.profit, 2).append(',');
+    w.appendDouble(t.commission, 2).append(',');
+    w.appendDouble(t.storage, 2).append(',');
+    w.appendCsvString(t.comment, sizeof(t.comment));
+    return w.append('\n');
+}
+
+inline MT4Writer& accountJson(MT4Writer& w, const UserRecord& u) {
+    MT4TimeFormatter& tf = MT4TimeFormatter::instance();
+    
+    w.append("{\"login\":").appendInt(u.login);
+    w.append(",\"group\":").appendJsonString(u.group, sizeof(u.group));
+    w.append(",\"name\":").appendJsonString(u.name, sizeof(u.name));
+    w.append(",\"email\":").appendJsonString(u.email, sizeof(u.email));
+    w.append(",\"leverage\":").appendInt(u.leverage);
+    w.append(",\"balance\":").appendDouble(u.balance, 2);
+    w.append(",\"credit\":").appendDouble(u.credit, 2);
+    w.append(",\"registered\":\"");
+    tf.append(w, u.regdate).append('"');
+    w.append(",\"last_login\":\"");
+    tf.append(w, u.lastdate).append('"');
+    return w.append('}');
+}
+
+// Columns: login,group,name,email,leverage,balance,credit
+inline MT4Writer& accountCsv(MT4Writer& w, const UserRecord& u) {
+    w.appendInt(u.login).append(',');
+    w.appendCsvString(u.group, sizeof(u.group)).append(',');
+    w.appendCsvString(u.name, sizeof(u.name)).append(',');
+    w.appendCsvString(u.email, sizeof(u.email)).append(',');
+    w.appendInt(u.leverage).append(',');
+    w.appendDouble(u.balance, 2).append(',');
+    w.appendDouble(u.credit, 2);
+    return w.append('\n');
+}
+
+inline MT4Writer& quoteJson(MT4Writer& w, const char* symbol, const MT4Quote& q, int digits = 5) {
+    w.append("{\"symbol\":").appendJsonString(symbol, 12);
+    w.append(",\"bid\":").appendDouble(q.bid, digits);
+    w.append(",\"ask\":").appendDouble(q.ask, digits);
+    w.append(",\"time\":").appendInt((long long)q.time);
+    return w.append('}');
+}
+
+// Columns: symbol,bid,ask,time
+inline MT4Writer& quoteCsv(MT4Writer& w, const char* symbol, const MT4Quote& q, int digits = 5) {
+    w.appendCsvString(symbol, 12).append(',');
+    w.appendDouble(q.bid, digits).append(',');
+    w.appendDouble(q.ask, digits).append(',');
+    w.appendInt((long long)q.time);
+    return w.append('\n');
+}
+
+inline MT4Writer& latencyJson(MT4Writer& w, const MT4LatencyHistogram& h) {
+    MT4LatencySummary s = h.summarize();
+    
+    w.append("{\"count\":").appendInt((long long)s.count);
+    w.append(",\"mean_us\":").appendDouble(s.mean_us, 1);
+    w.append(",\"p50_us\":").appendDouble(s.p50_us, 1);
+    w.append(",\"p90_us\":").appendDouble(s.p90_us, 1);
+    w.append(",\"p99_us\":").appendDouble(s.p99_us, 1);
+    w.append(",\"p999_us\":").appendDouble(s.p999_us, 1);
+    w.append(",\"max_us\":").appendDouble(s.max_us, 1);
+    return w.append('}');
+}
+
+//+------------------------------------------------------------------+
+//| Binary frames (see MT4WireFormat.h)                              |
+//| Each encoder writes a complete frame into out and returns its    |
+//| size in bytes, or 0 when cap is too small. Symbol ids are looked |
+//| up in the quote table; unknown symbols are sent as -1.           |
+//+------------------------------------------------------------------+
+
+// Bytes needed for a frame of count records of record_size
+inline size_t wireFrameSize(size_t record_size, int count) {
+    return sizeof(MT4WireHeader) + record_size * (size_t)count;
+}
+
+inline void wireHeader(void* out, uint16_t type, int count, size_t record_size) {
+    MT4WireHeader h;
+    h.magic = MT4_WIRE_MAGIC;
+    h.version = MT4_WIRE_VERSION;
+    h.type = type;
+    h.count = (uint32_t)count;
+    h.record_size = (uint32_t)record_size;
+    memcpy(out, &h, sizeof(h));
+}
+
+inline size_t wireQuotes(const MT4Quote* quotes, int count, void* out, size_t cap) {
+    size_t size = wireFrameSize(sizeof(MT4WireQuote), count);
+    if (size > cap) {
+        return 0;
+    }
+    
+    wireHeader(out, MT4_WIRE_QUOTES, count, sizeof(MT4WireQuote));
+    MT4WireQuote* rec = (MT4WireQuote*)((char*)out + sizeof(MT4WireHeader));
+    
+    for (int i = 0; i < count; i++) {
+        MT4WireQuote q;
+        q.symbol_id = quotes[i].symbol_id;
+        q.sequence = quotes[i].sequence;
+        q.bid = quotes[i].bid;
+        q.ask = quotes[i].ask;
+        q.time = (int64_t)quotes[i].time;
+        memcpy(&rec[i], &q, sizeof(q));
+    }
+    return size;
+}
+
+// One trade in wire layout
+inline MT4WireTrade wireTrade(const TradeRecord& t, const MT4QuoteTable& ids) {
+    MT4WireTrade w;
+    w.order = t.order;
+    w.login = t.login;
+    w.symbol_id = ids.findSymbol(t.symbol);
+    w.cmd = t.cmd;
+    w.volume = t.volume;
+    w.state = t.state;
+    w.digits = t.digits;
+    w.reserved = 0;
+    w.open_price = t.open_price;
+    w.close_price = t.close_price;
+    w.sl = t.sl;
+    w.tp = t.tp;
+    w.profit = t.profit;
+    w.commission = t.commission;
+    w.storage = t.storage;
+    w.open_time = (int64_t)t.open_time;
+    w.close_time = (int64_t)t.close_time;
+    return w;
+}
+
+inline size_t wireTrades(const TradeRecord* trades, int count, const MT4QuoteTable& ids,
+                         void* out, size_t cap) {
+    size_t size = wireFrameSize(sizeof(MT4WireTrade), count);
+    if (size > cap) {
+        return 0;
+    }
+    
+    wireHeader(out, MT4_WIRE_TRADES, count, sizeof(MT4WireTrade));
+    MT4WireTrade* rec = (MT4WireTrade*)((char*)out + sizeof(MT4WireHeader));
+    
+    for (int i = 0; i < count; i++) {
+        MT4WireTrade w = wireTrade(trades[i], ids);
+        memcpy(&rec[i], &w, sizeof(w));
+    }
+    return size;
+}
+
+inline size_t wireTradeEvents(const MT4TradeEvent* events, int count, const MT4QuoteTable& ids,
+                              void* out, size_t cap) {
+    size_t size = wireFrameSize(sizeof(MT4WireTradeEvent), count);
+    if (size > cap) {
+        return 0;
+    }
+    
+    wireHeader(out, MT4_WIRE_TRADE_EVENTS, count, sizeof(MT4WireTradeEvent));
+    MT4WireTradeEvent* rec = (MT4WireTradeEvent*)((char*)out + sizeof(MT4WireHeader));
+    
+    for (int i = 0; i < count; i++) {
+        MT4WireTradeEvent w;
+        w.type = events[i].type;
+        w.reserved = 0;
+        w.trade = wireTrade(events[i].trade, ids);
+        memcpy(&rec[i], &w, sizeof(w));
+    }
+    return size;
+}
+
+inline size_t wireSymbols(const ConSymbol* symbols, int count, const MT4QuoteTable& ids,
+                          void* out, size_t cap) {
+    size_t size = wireFrameSize(sizeof(MT4WireSymbol), count);
+    if (size > cap) {
+        return 0;
+    }
+    
+    wireHeader(out, MT4_WIRE_SYMBOLS, count, sizeof(MT4WireSymbol));
+    MT4WireSymbol* rec = (MT4WireSymbol*)((char*)out + sizeof(MT4WireHeader));
+    
+    for (int i = 0; i < count; i++) {
+        MT4WireSymbol w;
+        memset(&w, 0, sizeof(w));
+        w.symbol_id = ids.findSymbol(symbols[i].symbol);
+        w.digits = symbols[i].digits;
+        w.point = symbols[i].point;
+        w.contract_size = symbols[i].contract_size;
+        memcpy(w.name, symbols[i].symbol, sizeof(w.name) - 1);
+        memcpy(&rec[i], &w, sizeof(w));
+    }
+    return size;
+}
+
+} // namespace MT4Format
+
+#endif // MT4FORMAT_H
@@ -0,0 +1,810 @@
+//+------------------------------------------------------------------+
+//|                 Memory-Mapped Tick/Trade Journal and Replay        |
+//+------------------------------------------------------------------+
+#ifndef MT4JOURNAL_H
+#define MT4JOURNAL_H
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+#include "MT4Format.h"
+#include "MT4MappedFile.h"
+#include "MT4WireFormat.h"
+
+//+------------------------------------------------------------------+
+//| Journal files                                                    |
+//| One pair of files per UTC day in the journal directory:          |
+//|   journal_YYYYMMDD.mt4j  header, then records appended in order  |
+//|   journal_YYYYMMDD.idx   MT4JournalIndexEntry every second       |
+//| A record is the receive time in microseconds followed by one     |
+//| wire frame (MT4WireFormat.h): quotes, trade events, or the full  |
+//| symbol id -> name table whenever it changes. data_end in the     |
+//| header is advanced after every record, so a crash loses at most  |
+//| the record being written.                                        |
+//+------------------------------------------------------------------+
+#define MT4_JOURNAL_MAGIC          0x4A34544D       // "MT4J"
+#define MT4_JOURNAL_VERSION        1
+#define MT4_JOURNAL_CHUNK          (64ull << 20)    // file growth step
+#define MT4_JOURNAL_INDEX_INTERVAL 1000000          // microseconds between index entries
+
+#pragma pack(push, 1)
+
+struct MT4JournalFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int32_t day;                    // YYYYMMDD (UTC)
+    int32_t reserved2;
+    int64_t created_us;
+    uint64_t data_end;              // offset just past the last complete record
+};
+
+struct MT4JournalIndexEntry {
+    int64_t timestamp_us;
+    uint64_t offset;                // first record at or after timestamp_us
+    uint64_t symbols_offset;        // latest symbols record before offset
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(MT4JournalFileHeader) == 32, "MT4JournalFileHeader layout changed");
+static_assert(sizeof(MT4JournalIndexEntry) == 24, "MT4JournalIndexEntry layout changed");
+
+// Wall clock in microseconds since the Unix epoch
+inline int64_t MT4JournalNow() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// UTC calendar day of a timestamp as YYYYMMDD
+inline int MT4JournalDay(int64_t timestamp_us) {
+    int64_t days = timestamp_us / 86400000000LL;
+    if (timestamp_us < 0 && days * 86400000000LL != timestamp_us) {
+        days--;
+    }
+    
+    // Civil date from days since 1970-01-01 (proleptic Gregorian)
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t doe = days - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t day = doy - (153 * mp + 2) / 5 + 1;
+    int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+    
+    return (int)(year * 10000 + month * 100 + day);
+}
+
+// Path of a day's journal (extension "mt4j") or index ("idx")
+inline std::string MT4JournalPath(const std::string& directory, int day, const char* extension) {
+    char name[32];
+    snprintf(name, sizeof(name), "journal_%08d.%s", day, extension);
+    return directory.empty() ? std::string(name) : directory + "\\" + name;
+}
+
+//+------------------------------------------------------------------+
+//| MT4JournalWriter - Appends the pumped stream to the journal      |
+//| Registered after the quote table so symbol ids are assigned.     |
+//| Appends are memcpy into the mapping on the pumping thread; the   |
+//| file grows in MT4_JOURNAL_CHUNK steps and is cut to its data on  |
+//| close and at each daily roll. If the disk fills up, records are  |
+//| counted as dropped and pumping is not affected. A file a reader  |
+//| still maps cannot be cut; it keeps its zeroed tail (data_end     |
+//| marks the end) and the cut is retried at the next open or roll.  |
+//+------------------------------------------------------------------+
+class MT4JournalWriter : public MT4PumpListener {
+private:
+    MT4QuoteTable& m_quotes;
+    std::string m_directory;
+    std::string m_last_error;
+    
+    MT4MappedFile m_file;
+    HANDLE m_index;
+    int m_day;
+    int64_t m_day_end_us;
+    uint64_t m_end;
+    int64_t m_next_index_us;
+    uint64_t m_symbols_offset;
+    int m_symbols_written;
+    std::string m_trim_path;            // journal left uncut by closeDay
+    uint64_t m_trim_length;
+    
+    std::atomic<bool> m_open;
+    std::atomic<unsigned long long> m_records;
+    std::atomic<unsigned long long> m_bytes;
+    std::atomic<unsigned long long> m_dropped;
+    
+    MT4JournalWriter(const MT4JournalWriter&);
+    MT4JournalWriter& operator=(const MT4JournalWriter&);
+    
+    MT4JournalFileHeader* header() {
+        return (MT4JournalFileHeader*)m_file.data();
+    }
+    
+    // Bytes of leading index entries that point at records still in the
+    // journal; entries past data_end were written for records lost in a crash
+    uint64_t validIndexBytes() {
+        LARGE_INTEGER zero;
+        zero.QuadPart = 0;
+        SetFilePointerEx(m_index, zero, NULL, FILE_BEGIN);
+        
+        MT4JournalIndexEntry entry;
+        DWORD read = 0;
+        uint64_t valid = 0;
+        
+        while (ReadFile(m_index, &entry, sizeof(entry), &read, NULL) && read == sizeof(entry) &&
+               entry.offset < m_end) {
+            valid += sizeof(entry);
+        }
+        return valid;
+    }
+    
+    // Retry cutting a journal that a reader still mapped when its day closed
+    void retryTrim(const std::string& opening) {
+        if (m_trim_path.empty()) {
+            return;
+        }
+        if (m_trim_path == opening || MT4MappedFile::truncate(m_trim_path.c_str(), m_trim_length)) {
+            m_trim_path.clear();
+        }
+    }
+    
+    bool openDay(int64_t now) {
+        m_day = MT4JournalDay(now);
+        m_day_end_us = (now / 86400000000LL + 1) * 86400000000LL;
+        
+        std::string path = MT4JournalPath(m_directory, m_day, "mt4j");
+        retryTrim(path);
+        
+        if (!m_file.openWrite(path.c_str(), sizeof(MT4JournalFileHeader) + MT4_JOURNAL_CHUNK)) {
+            m_last_error = "Failed to open journal " + path;
+            return false;
+        }
+        
+        MT4JournalFileHeader* h = header();
+        bool resumed = h->magic == MT4_JOURNAL_MAGIC && h->version == MT4_JOURNAL_VERSION && h->day == m_day &&
+                       h->data_end >= sizeof(MT4JournalFileHeader) && h->data_end <= m_file.size();
+        if (resumed) {
+            m_end = h->data_end;                // resume today's journal
+        } else {
+            memset(h, 0, sizeof(*h));
+            h->magic = MT4_JOURNAL_MAGIC;
+            h->version = MT4_JOURNAL_VERSION;
+            h->day = m_day;
+            h->created_us = now;
+            m_end = sizeof(MT4JournalFileHeader);
+            h->data_end = m_end;
+        }
+        
+        path = MT4JournalPath(m_directory, m_day, "idx");
+        m_index = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_index == INVALID_HANDLE_VALUE) {
+            m_last_error = "Failed to open journal index " + path;
+            m_file.closeAt(m_end);
+            return false;
+        }
+        
+        // A reinitialised journal invalidates the whole index; a resumed
+        // one keeps only the entries for records that survived, so entries
+        // appended from here on never follow stale offsets
+        LARGE_INTEGER keep;
+        keep.QuadPart = (LONGLONG)(resumed ? validIndexBytes() : 0);
+        if (!SetFilePointerEx(m_index, keep, NULL, FILE_BEGIN) || !SetEndOfFile(m_index)) {
+            m_last_error = "Failed to reset journal index " + path;
+            CloseHandle(m_index);
+            m_index = INVALID_HANDLE_VALUE;
+            m_file.closeAt(m_end);
+            return false;
+        }
+        
+        m_next_index_us = 0;
+        m_symbols_written = 0;
+        m_symbols_offset = 0;
+        return true;
+    }
+    
+    void closeDay() {
+        if (m_file.data() != NULL) {
+            header()->data_end = m_end;
+            m_file.flush(0, m_end);
+        }
+        if (m_file.isOpen() && !m_file.closeAt(m_end)) {
+            m_trim_path = MT4JournalPath(m_directory, m_day, "mt4j");
+            m_trim_length = m_end;
+            m_last_error = "Journal " + m_trim_path + " is mapped by a reader; cut deferred";
+        }
+        
+        if (m_index != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_index);
+            m_index = INVALID_HANDLE_VALUE;
+        }
+    }
+    
+    // Room for size bytes at the end of the data; NULL when the disk is full
+    char* reserve(size_t size) {
+        if (m_end + size > m_file.size()) {
+            uint64_t grow = size > MT4_JOURNAL_CHUNK ? size : MT4_JOURNAL_CHUNK;
+            if (!m_file.resize(m_file.size() + grow)) {
+                return NULL;
+            }
+        }
+        return m_file.data() + m_end;
+    }
+    
+    void commit(size_t size, int64_t now) {
+        uint64_t offset = m_end;
+        m_end += size;
+        header()->data_end = m_end;
+        
+        if (now >= m_next_index_us) {
+            MT4JournalIndexEntry entry;
+            entry.timestamp_us = now;
+            entry.offset = offset;
+            entry.symbols_offset = m_symbols_offset;
+            
+            DWORD written = 0;
+            WriteFile(m_index, &entry, sizeof(entry), &written, NULL);
+            m_next_index_us = now + MT4_JOURNAL_INDEX_INTERVAL;
+        }
+        
+        m_records.fetch_add(1, std::memory_order_relaxed);
+        m_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    
+    // Roll at midnight UTC; false if the journal cannot take records
+    bool prepare(int64_t now) {
+        if (m_file.data() == NULL) {
+            return false;
+        }
+        
+        if (now >= m_day_end_us) {
+            closeDay();
+            if (!openDay(now)) {
+                return false;
+            }
+        }
+        
+        return syncSymbols(now);
+    }
+    
+    // Write the full id -> name table whenever the quote table grew
+    bool syncSymbols(int64_t now) {
+        int count = m_quotes.getSymbolCount();
+        if (count == m_symbols_written) {
+            return true;
+        }
+        
+        size_t size = sizeof(int64_t) + MT4Format::wireFrameSize(sizeof(MT4WireSymbol), count);
+        char* rec = reserve(size);
+        if (rec == NULL) {
+            return false;
+        }
+        
+        memcpy(rec, &now, sizeof(now));
+        char* frame = rec + sizeof(int64_t);
+        MT4Format::wireHeader(frame, MT4_WIRE_SYMBOLS, count, sizeof(MT4WireSymbol));
+        
+        char* out = frame + sizeof(MT4WireHeader);
+        for (int id = 0; id < count; id++) {
+            MT4WireSymbol w;
+            memset(&w, 0, sizeof(w));
+            w.symbol_id = id;
+            strncpy(w.name, m_quotes.getSymbolName(id), sizeof(w.name) - 1);
+            memcpy(out + id * sizeof(w), &w, sizeof(w));
+        }
+        
+        m_symbols_offset = m_end;
+        m_symbols_written = count;
+        commit(size, now);
+        return true;
+    }
+
+public:
+    explicit MT4JournalWriter(MT4QuoteTable& quotes)
+        : m_quotes(quotes), m_index(INVALID_HANDLE_VALUE), m_day(0), m_day_end_us(0), m_end(0),
+          m_next_index_us(0), m_symbols_offset(0), m_symbols_written(0), m_trim_length(0),
+          m_open(false), m_records(0), m_bytes(0), m_dropped(0) {}
+    
+    ~MT4JournalWriter() {
+        close();
+    }
+    
+    // Open today's journal in directory (created if missing); call before pumping starts
+    bool open(const char* directory) {
+        if (m_open.load()) {
+            return true;
+        }
+        
+        m_directory = directory != NULL ? directory : "";
+        if (!m_directory.empty()) {
+            CreateDirectoryA(m_directory.c_str(), NULL);
+        }
+        
+        if (!openDay(MT4JournalNow())) {
+            return false;
+        }
+        
+        m_open.store(true);
+        return true;
+    }
+    
+    // Cut the journal to its data and close it; only safe while pumping is stopped
+    void close() {
+        m_open.store(false);
+        closeDay();
+    }
+    
+    bool isOpen() const {
+        return m_open.load();
+    }
+    
+    // Day being written (YYYYMMDD)
+    int getDay() const {
+        return m_day;
+    }
+    
+    unsigned long long getRecordCount() const {
+        return m_records.load(std::memory_order_relaxed);
+    }
+    
+    unsigned long long getBytesWritten() const {
+        return m_bytes.load(std::memory_order_relaxed);
+    }
+    
+    // Pumped batches that could not be journaled (disk full, roll failure)
+    unsigned long long getDroppedCount() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+    
+    const char* getLastError() const {
+        return m_last_error.c_str();
+    }
+    
+    void onPumpingStopped() {
+        if (m_file.data() != NULL) {
+            m_file.flush(0, m_end);
+        }
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        if (!m_open.load(std::memory_order_relaxed)) {
+            return;
+        }
+        
+        int64_t now = MT4JournalNow();
+        size_t size = sizeof(int64_t) + MT4Format::wireFrameSize(sizeof(MT4WireQuote), count);
+        char* rec;
+        
+        if (!prepare(now) || (rec = reserve(size)) == NULL) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        
+        memcpy(rec, &now, sizeof(now));
+        char* frame = rec + sizeof(int64_t);
+        MT4Format::wireHeader(frame, MT4_WIRE_QUOTES, count, sizeof(MT4WireQuote));
+        
+        char* out = frame + sizeof(MT4WireHeader);
+        for (int i = 0; i < count; i++) {
+            MT4WireQuote q;
+            q.symbol_id = m_quotes.findSymbol(quotes[i].symbol);
+            q.sequence = m_quotes.getSequence(q.symbol_id);
+            q.bid = quotes[i].bid;
+            q.ask = quotes[i].ask;
+            q.time = (int64_t)quotes[i].lasttime;
+            memcpy(out + i * sizeof(q), &q, sizeof(q));
+        }
+        
+        commit(size, now);
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        if (!m_open.load(std::memory_order_relaxed)) {
+            return;
+        }
+        
+        int64_t now = MT4JournalNow();
+        size_t frame_size = MT4Format::wireFrameSize(sizeof(MT4WireTradeEvent), count);
+        char* rec;
+        
+        if (!prepare(now) || (rec = reserve(sizeof(int64_t) + frame_size)) == NULL) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        
+        memcpy(rec, &now, sizeof(now));
+        MT4Format::wireTradeEvents(events, count, m_quotes, rec + sizeof(int64_t), frame_size);
+        commit(sizeof(int64_t) + frame_size, now);
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4JournalRecord - One decoded journal record                    |
+//| records points into the mapping and is not aligned; copy each    |
+//| record out with memcpy.                                          |
+//+------------------------------------------------------------------+
+struct MT4JournalRecord {
+    int64_t timestamp_us;
+    MT4WireHeader frame;
+    const char* records;
+};
+
+//+------------------------------------------------------------------+
+//| MT4JournalReader - Sequential reader over one day's journal      |
+//| Symbol frames are applied as they are read, so getSymbolName()   |
+//| always reflects the ids of the current record. The index is      |
+//| rebuilt by scanning when the .idx file is missing.               |
+//+------------------------------------------------------------------+
+class MT4JournalReader {
+private:
+    MT4MappedFile m_file;
+    std::vector<MT4JournalIndexEntry> m_index;
+    std::vector<std::string> m_names;
+    uint64_t m_end;
+    uint64_t m_pos;
+    int m_day;
+    
+    MT4JournalReader(const MT4JournalReader&);
+    MT4JournalReader& operator=(const MT4JournalReader&);
+    
+    // Decode the record at offset; false at the end or on a damaged record
+    bool parse(uint64_t offset, MT4JournalRecord& rec, uint64_t& next) const {
+        if (offset + sizeof(int64_t) + sizeof(MT4WireHeader) > m_end) {
+            return false;
+        }
+        
+        const char* p = m_file.data() + offset;
+        memcpy(&rec.timestamp_us, p, sizeof(int64_t));
+        memcpy(&rec.frame, p + sizeof(int64_t), sizeof(MT4WireHeader));
+        
+        if (rec.frame.magic != MT4_WIRE_MAGIC) {
+            return false;
+        }
+        
+        uint64_t size = sizeof(int64_t) + sizeof(MT4WireHeader) + (uint64_t)rec.frame.count * rec.frame.record_size;
+        if (offset + size > m_end) {
+            return false;
+        }
+        
+        rec.records = p + sizeof(int64_t) + sizeof(MT4WireHeader);
+        next = offset + size;
+        return true;
+    }
+    
+    void applySymbols(const MT4JournalRecord& rec) {
+        if (rec.frame.record_size < sizeof(MT4WireSymbol)) {
+            return;
+        }
+        
+        for (uint32_t i = 0; i < rec.frame.count; i++) {
+            MT4WireSymbol w;
+            memcpy(&w, rec.records + (size_t)i * rec.frame.record_size, sizeof(w));
+            if (w.symbol_id < 0 || w.symbol_id >= MT4_MAX_SYMBOLS) {
+                continue;
+            }
+            if ((size_t)w.symbol_id >= m_names.size()) {
+                m_names.resize(w.symbol_id + 1);
+            }
+            w.name[sizeof(w.name) - 1] = 0;
+            m_names[w.symbol_id] = w.name;
+        }
+    }
+    
+    bool loadIndex(const std::string& path) {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        MT4JournalIndexEntry entry;
+        DWORD read = 0;
+        
+        while (ReadFile(file, &entry, sizeof(entry), &read, NULL) && read == sizeof(entry)) {
+            // Entries past data_end belong to records lost in a crash
+            if (entry.offset < m_end && (m_index.empty() || entry.timestamp_us >= m_index.back().timestamp_us)) {
+                m_index.push_back(entry);
+            }
+        }
+        
+        CloseHandle(file);
+        return !m_index.empty();
+    }
+    
+    void buildIndex() {
+        MT4JournalRecord rec;
+        uint64_t offset = sizeof(MT4JournalFileHeader), next;
+        uint64_t symbols_offset = 0;
+        int64_t next_us = 0;
+        
+        while (parse(offset, rec, next)) {
+            if (rec.frame.type == MT4_WIRE_SYMBOLS) {
+                symbols_offset = offset;
+            }
+            if (rec.timestamp_us >= next_us) {
+                MT4JournalIndexEntry entry = { rec.timestamp_us, offset, symbols_offset };
+                m_index.push_back(entry);
+                next_us = rec.timestamp_us + MT4_JOURNAL_INDEX_INTERVAL;
+            }
+            offset = next;
+        }
+    }
+
+public:
+    MT4JournalReader() : m_end(0), m_pos(0), m_day(0) {}
+    
+    // Map a journal file (which may still be growing) and load its index
+    bool open(const char* path) {
+        close();
+        
+        if (!m_file.openRead(path) || m_file.size() < sizeof(MT4JournalFileHeader)) {
+            close();
+            return false;
+        }
+        
+        MT4JournalFileHeader h;
+        memcpy(&h, m_file.data(), sizeof(h));
+        
+        if (h.magic != MT4_JOURNAL_MAGIC || h.version != MT4_JOURNAL_VERSION) {
+            close();
+            return false;
+        }
+        
+        m_day = h.day;
+        m_end = h.data_end < m_file.size() ? h.data_end : m_file.size();
+        m_pos = sizeof(MT4JournalFileHeader);
+        
+        std::string index_path(path);
+        size_t dot = index_path.rfind('.');
+        index_path = (dot != std::string::npos ? index_path.substr(0, dot) : index_path) + ".idx";
+        
+        if (!loadIndex(index_path)) {
+            m_index.clear();
+            buildIndex();
+        }
+        return true;
+    }
+    
+    void close() {
+        m_file.close();
+        m_index.clear();
+        m_names.clear();
+        m_end = 0;
+        m_pos = 0;
+    }
+    
+    bool isOpen() const {
+        return m_file.isOpen();
+    }
+    
+    int getDay() const {
+        return m_day;
+    }
+    
+    // Timestamp of the first record, 0 if empty
+    int64_t getFirstTimestamp() const {
+        return m_index.empty() ? 0 : m_index.front().timestamp_us;
+    }
+    
+    // Next record; symbol frames update the name table before being returned
+    bool next(MT4JournalRecord& rec) {
+        uint64_t next_pos;
+        if (!parse(m_pos, rec, next_pos)) {
+            return false;
+        }
+        
+        if (rec.frame.type == MT4_WIRE_SYMBOLS) {
+            applySymbols(rec);
+        }
+        
+        m_pos = next_pos;
+        return true;
+    }
+    
+    // Position at the first record at or after timestamp_us
+    bool seek(int64_t timestamp_us) {
+        if (!isOpen()) {
+            return false;
+        }
+        
+        // Last index entry not after the target
+        size_t lo = 0, hi = m_index.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (m_index[mid].timestamp_us <= timestamp_us) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        
+        m_names.clear();
+        m_pos = sizeof(MT4JournalFileHeader);
+        
+        if (lo > 0) {
+            const MT4JournalIndexEntry& entry = m_index[lo - 1];
+            MT4JournalRecord rec;
+            uint64_t next_pos;
+            
+            if (entry.symbols_offset != 0 && parse(entry.symbols_offset, rec, next_pos) &&
+                rec.frame.type == MT4_WIRE_SYMBOLS) {
+                applySymbols(rec);
+            }
+            m_pos = entry.offset;
+        }
+        
+        // Skip forward within the indexed second
+        MT4JournalRecord rec;
+        uint64_t next_pos;
+        while (parse(m_pos, rec, next_pos) && rec.timestamp_us < timestamp_us) {
+            if (rec.frame.type == MT4_WIRE_SYMBOLS) {
+                applySymbols(rec);
+            }
+            m_pos = next_pos;
+        }
+        return true;
+    }
+    
+    // Name of a symbol id at the current position, "" if unknown
+    const char* getSymbolName(int id) const {
+        if (id < 0 || (size_t)id >= m_names.size()) {
+            return "";
+        }
+        return m_names[id].c_str();
+    }
+    
+    size_t getIndexSize() const {
+        return m_index.size();
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4JournalReplay - Feeds a journal back through pump listeners   |
+//| Quotes and trade events are delivered as the original batches,   |
+//| through the same onQuotes/onTrades calls as live pumping, on the |
+//| thread calling run(). speed 1.0 replays in real time, N replays  |
+//| N times faster and 0 replays as fast as the listeners allow.     |
+//| onPumpingStarted is not called: listeners that load their state  |
+//| from the pumping interface must be primed separately.            |
+//+------------------------------------------------------------------+
+class MT4JournalReplay {
+private:
+    MT4JournalReader& m_reader;
+    std::vector<MT4PumpListener*> m_listeners;
+    std::vector<SymbolInfo> m_quotes;
+    std::vector<MT4TradeEvent> m_trades;
+    std::atomic<bool> m_stop;
+    std::atomic<unsigned long long> m_delivered;
+    
+    MT4JournalReplay(const MT4JournalReplay&);
+    MT4JournalReplay& operator=(const MT4JournalReplay&);
+    
+    void deliverQuotes(const MT4JournalRecord& rec) {
+        m_quotes.resize(rec.frame.count);
+        
+        for (uint32_t i = 0; i < rec.frame.count; i++) {
+            MT4WireQuote w;
+            memcpy(&w, rec.records + (size_t)i * rec.frame.record_size, sizeof(w));
+            
+            SymbolInfo& info = m_quotes[i];
+            memset(&info, 0, sizeof(info));
+            strncpy(info.symbol, m_reader.getSymbolName(w.symbol_id), sizeof(info.symbol) - 1);
+            info.bid = w.bid;
+            info.ask = w.ask;
+            info.lasttime = (time_t)w.time;
+        }
+        
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            m_listeners[i]->onQuotes(m_quotes.data(), (int)m_quotes.size());
+        }
+    }
+    
+    void deliverTrades(const MT4JournalRecord& rec) {
+        m_trades.resize(rec.frame.count);
+        
+        for (uint32_t i = 0; i < rec.frame.count; i++) {
+            MT4WireTradeEvent w;
+            memcpy(&w, rec.records + (size_t)i * rec.frame.record_size, sizeof(w));
+            
+            MT4TradeEvent& event = m_trades[i];
+            memset(&event, 0, sizeof(event));
+            event.type = w.type;
+            
+            TradeRecord& t = event.trade;
+            t.order = w.trade.order;
+            t.login = w.trade.login;
+            strncpy(t.symbol, m_reader.getSymbolName(w.trade.symbol_id), sizeof(t.symbol) - 1);
+            t.cmd = w.trade.cmd;
+            t.volume = w.trade.volume;
+            t.state = w.trade.state;
+            t.digits = w.trade.digits;
+            t.open_price = w.trade.open_price;
+            t.close_price = w.trade.close_price;
+            t.sl = w.trade.sl;
+            t.tp = w.trade.tp;
+            t.profit = w.trade.profit;
+            t.commission = w.trade.commission;
+            t.storage = w.trade.storage;
+            t.open_time = (time_t)w.trade.open_time;
+            t.close_time = (time_t)w.trade.close_time;
+        }
+        
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            m_listeners[i]->onTrades(m_trades.data(), (int)m_trades.size());
+        }
+    }
+
+public:
+    explicit MT4JournalReplay(MT4JournalReader& reader) : m_reader(reader), m_stop(false), m_delivered(0) {}
+    
+    void addListener(MT4PumpListener* listener) {
+        if (listener != NULL) {
+            m_listeners.push_back(listener);
+        }
+    }
+    
+    // Replay from the reader's position until the end, until_us or stop().
+    // Returns the number of batches delivered.
+    unsigned long long run(double speed = 1.0, int64_t until_us = INT64_MAX) {
+        typedef std::chrono::steady_clock Clock;
+        
+        m_stop.store(false);
+        unsigned long long delivered = 0;
+        Clock::time_point start = Clock::now();
+        int64_t first_us = -1;
+        MT4JournalRecord rec;
+        
+        while (!m_stop.load(std::memory_order_relaxed) && m_reader.next(rec)) {
+            if (rec.timestamp_us > until_us) {
+                break;
+            }
+            
+            if (speed > 0) {
+                if (first_us < 0) {
+                    first_us = rec.timestamp_us;
+                }
+                Clock::time_point due = start + std::chrono::microseconds(
+                    (int64_t)((rec.timestamp_us - first_us) / speed));
+                if (due > Clock::now()) {
+                    std::this_thread::sleep_until(due);
+                }
+            }
+            
+            if (rec.frame.type == MT4_WIRE_QUOTES && rec.frame.record_size >= sizeof(MT4WireQuote)) {
+                deliverQuotes(rec);
+            } else if (rec.frame.type == MT4_WIRE_TRADE_EVENTS && rec.frame.record_size >= sizeof(MT4WireTradeEvent)) {
+                deliverTrades(rec);
+            } else {
+                continue;
+            }
+            
+            delivered++;
+            m_delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        return delivered;
+    }
+    
+    // Ask a running replay to return (any thread)
+    void stop() {
+        m_stop.store(true);
+    }
+    
+    // Batches delivered by all runs
+    unsigned long long getDeliveredCount() const {
+        return m_delivered.load(std::memory_order_relaxed);
+    }
+};
+
+#endif // MT4JOURNAL_H
@@ -10,9 +10,39 @@
 #include <vector>
 #include <string>
 #include <time.h>
+#include <mutex>
+#include <optional>
 #include <windows.h>
 #include <winsock2.h>
 #include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4Pumping.h"
+#include "MT4Format.h"
+#include "MT4QuoteTable.h"
+#include "MT4Dictionary.h"
+#include "MT4OrderCorrelator.h"
+#include "MT4TradeBatch.h"
+#include "MT4ManagerPool.h"
+#include "MT4RecordView.h"
+#include "MT4OnlineSet.h"
+#include "MT4TradeBook.h"
+#include "MT4MarginEngine.h"
+#include "MT4ColumnStore.h"
+#include "MT4Query.h"
+#include "MT4QuoteBus.h"
+#include "MT4Journal.h"
+#include "MT4Async.h"
+#include "MT4SignalFeed.h"
+#include "MT4RiskCheck.h"
+#include "MT4TradeCopier.h"
+#include "MT4Snapshot.h"
+#include "MT4Session.h"
+#include "MT4Dispatcher.h"
+#include "MT4Bars.h"
+#include "MT4ObjectPool.h"
+
+// How long openTrade waits for the pumped TRANS_ADD when the server
+// does not return the new ticket in TradeTransInfo.order
+#define MT4_OPEN_CORRELATE_TIMEOUT_MS 500
 
 // Forward declarations for C++ classes
 class MT4Manager;
@@ -22,8 +52,9 @@ class MT4Trade;
 
 //+------------------------------------------------------------------+
 //| MT4Account - Wrapper for user accounts                           |
+//| new/delete come from a fixed-size pool (MT4ObjectPool.h).        |
 //+------------------------------------------------------------------+
-class MT4Account {
+class MT4Account : public MT4PoolAllocated<MT4Account> {
 private:
     UserRecord user;
     friend class MT4Manager;
@@ -42,30 +73,36 @@ public:
     time_t getLastLoginDate() const { return user.lastdate; }
     int getLeverage() const { return user.leverage; }
     
+    // Write the account as a JSON object into a caller buffer
+    MT4Writer& toJson(MT4Writer& w) const { return MT4Format::accountJson(w, user); }
+    MT4Writer& toCsv(MT4Writer& w) const { return MT4Format::accountCsv(w, user); }
+    
     // Print account information
     void print() const {
-        printf("Account #%d\n", user.login);
-        printf("  Name   : %s\n", user.name);
-        printf("  Group  : %s\n", user.group);
-        printf("  Email  : %s\n", user.email);
-        printf("  Balance: %.2f\n", user.balance);
-        printf("  Credit : %.2f\n", user.credit);
-        
-        char time_buf[64];
-        time_t reg_time = user.regdate;
-        strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&reg_time));
-        printf("  Registered: %s\n", time_buf);
-        
-        time_t last_time = user.lastdate;
-        strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&last_time));
-        printf("  Last login: %s\n", time_buf);
+        MT4TimeFormatter& tf = MT4TimeFormatter::instance();
+        char buf[512];
+        MT4Writer w(buf, sizeof(buf));
+        
+        w.append("Account #").appendInt(user.login).append('\n');
+        w.append("  Name   : ").appendField(user.name, sizeof(user.name)).append('\n');
+        w.append("  Group  : ").appendField(user.group, sizeof(user.group)).append('\n');
+        w.append("  Email  : ").appendField(user.email, sizeof(user.email)).append('\n');
+        w.append("  Balance: ").appendDouble(user.balance, 2).append('\n');
+        w.append("  Credit : ").appendDouble(user.credit, 2).append('\n');
+        w.append("  Registered: ");
+        tf.append(w, user.regdate).append('\n');
+        w.append("  Last login: ");
+        tf.append(w, user.lastdate).append('\n');
+        
+        fwrite(w.data(), 1, w.size(), stdout);
     }
 };
 
 //+------------------------------------------------------------------+
 //| MT4Symbol - Wrapper for symbol information                       |
+//| new/delete come from a fixed-size pool (MT4ObjectPool.h).        |
 //+------------------------------------------------------------------+
-class MT4Symbol {
+class MT4Symbol : public MT4PoolAllocated<MT4Symbol> {
 private:
     ConSymbol symbol;
     SymbolInfo info;
@@ -98,31 +135,35 @@ public:
     
     // Print symbol information
     void print() const {
-        printf("Symbol: %s (%s)\n", symbol.symbol, symbol.description);
-        printf("  Currency    : %s\n", symbol.currency);
-        printf("  Digits      : %d\n", symbol.digits);
-        printf("  Point       : %.8f\n", symbol.point);
-        printf("  Spread      : %d\n", symbol.spread);
-        printf("  Contract Size: %.2f\n", symbol.contract_size);
-        printf("  Tick Value  : %.5f\n", symbol.tick_value);
-        printf("  Tick Size   : %.8f\n", symbol.tick_size);
+        char buf[1024];
+        MT4Writer w(buf, sizeof(buf));
+        
+        w.append("Symbol: ").appendField(symbol.symbol, sizeof(symbol.symbol));
+        w.append(" (").appendField(symbol.description, sizeof(symbol.description)).append(")\n");
+        w.append("  Currency    : ").appendField(symbol.currency, sizeof(symbol.currency)).append('\n');
+        w.append("  Digits      : ").appendInt(symbol.digits).append('\n');
+        w.append("  Point       : ").appendDouble(symbol.point, 8).append('\n');
+        w.append("  Spread      : ").appendInt(symbol.spread).append('\n');
+        w.append("  Contract Size: ").appendDouble(symbol.contract_size, 2).append('\n');
+        w.append("  Tick Value  : ").appendDouble(symbol.tick_value, 5).append('\n');
+        w.append("  Tick Size   : ").appendDouble(symbol.tick_size, 8).append('\n');
         
         if (has_info) {
-            printf("  Current Bid : %.5f\n", info.bid);
-            printf("  Current Ask : %.5f\n", info.ask);
-            
-            char time_buf[64];
-            time_t last_time = info.lasttime;
-            strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&last_time));
-            printf("  Last Update : %s\n", time_buf);
+            w.append("  Current Bid : ").appendDouble(info.bid, 5).append('\n');
+            w.append("  Current Ask : ").appendDouble(info.ask, 5).append('\n');
+            w.append("  Last Update : ");
+            MT4TimeFormatter::instance().append(w, info.lasttime).append('\n');
         }
+        
+        fwrite(w.data(), 1, w.size(), stdout);
     }
 };
 
 //+------------------------------------------------------------------+
 //| MT4Trade - Wrapper for trade records                             |
+//| new/delete come from a fixed-size pool (MT4ObjectPool.h).        |
 //+------------------------------------------------------------------+
-class MT4Trade {
+class MT4Trade : public MT4PoolAllocated<MT4Trade> {
 private:
     TradeRecord trade;
     friend class MT4Manager;
@@ -150,49 +191,49 @@ public:
     // Check if trade is open
     bool isOpen() const { return trade.close_time == 0; }
     
+    // Get trade type name (static storage, no allocation)
+    const char* getTypeName() const {
+        return MT4CmdName(trade.cmd);
+    }
+    
     // Get trade type as string
     std::string getTypeAsString() const {
-        switch (trade.cmd) {
-            case OP_BUY: return "Buy";
-            case OP_SELL: return "Sell";
-            case OP_BUY_LIMIT: return "Buy Limit";
-            case OP_SELL_LIMIT: return "Sell Limit";
-            case OP_BUY_STOP: return "Buy Stop";
-            case OP_SELL_STOP: return "Sell Stop";
-            case OP_BALANCE: return "Balance";
-            case OP_CREDIT: return "Credit";
-            default: return "Unknown";
-        }
+        return getTypeName();
     }
     
+    // Write the trade as a JSON object or CSV row into a caller buffer
+    MT4Writer& toJson(MT4Writer& w) const { return MT4Format::tradeJson(w, trade); }
+    MT4Writer& toCsv(MT4Writer& w) const { return MT4Format::tradeCsv(w, trade); }
+    
     // Print trade information
     void print() const {
-        printf("Order #%d (%s)\n", trade.order, getTypeAsString().c_str());
-        printf("  Login  : %d\n", trade.login);
-        printf("  Symbol : %s\n", trade.symbol);
-        printf("  Volume : %d\n", trade.volume);
-        printf("  Open   : %.5f\n", trade.open_price);
-        
-        char time_buf[64];
-        time_t open_time = trade.open_time;
-        strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&open_time));
-        printf("  Opened : %s\n", time_buf);
+        MT4TimeFormatter& tf = MT4TimeFormatter::instance();
+        char buf[512];
+        MT4Writer w(buf, sizeof(buf));
+        
+        w.append("Order #").appendInt(trade.order).append(" (").append(getTypeName()).append(")\n");
+        w.append("  Login  : ").appendInt(trade.login).append('\n');
+        w.append("  Symbol : ").appendField(trade.symbol, sizeof(trade.symbol)).append('\n');
+        w.append("  Volume : ").appendInt(trade.volume).append('\n');
+        w.append("  Open   : ").appendDouble(trade.open_price, 5).append('\n');
+        w.append("  Opened : ");
+        tf.append(w, trade.open_time).append('\n');
         
         if (trade.close_time > 0) {
-            printf("  Close  : %.5f\n", trade.close_price);
-            
-            time_t close_time = trade.close_time;
-            strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", localtime(&close_time));
-            printf("  Closed : %s\n", time_buf);
+            w.append("  Close  : ").appendDouble(trade.close_price, 5).append('\n');
+            w.append("  Closed : ");
+            tf.append(w, trade.close_time).append('\n');
         } else {
-            printf("  SL     : %.5f\n", trade.sl);
-            printf("  TP     : %.5f\n", trade.tp);
+            w.append("  SL     : ").appendDouble(trade.sl, 5).append('\n');
+            w.append("  TP     : ").appendDouble(trade.tp, 5).append('\n');
         }
         
-        printf("  Profit : %.2f\n", trade.profit);
-        printf("  Comm.  : %.2f\n", trade.commission);
-        printf("  Swap   : %.2f\n", trade.storage);
-        printf("  Comment: %s\n", trade.comment);
+        w.append("  Profit : ").appendDouble(trade.profit, 2).append('\n');
+        w.append("  Comm.  : ").appendDouble(trade.commission, 2).append('\n');
+        w.append("  Swap   : ").appendDouble(trade.storage, 2).append('\n');
+        w.append("  Comment: ").appendField(trade.comment, sizeof(trade.comment)).append('\n');
+        
+        fwrite(w.data(), 1, w.size(), stdout);
     }
 };
 
@@ -207,7 +248,272 @@ private:
     bool m_logged_in;
     std::string m_server;
     int m_login;
+    MT4Credential m_password;
     std::string m_last_error;
+    MT4PumpingEngine m_pumping;
+    MT4PumpQueue m_pump_queue;
+    MT4QuoteTable m_quote_table;
+    MT4Dictionary m_dictionary;
+    MT4OrderCorrelator m_correlator;
+    MT4OnlineSet m_online;
+    MT4TradeBook m_trade_book;
+    MT4MarginEngine m_margin;
+    MT4AccountStore m_account_store;
+    MT4SymbolStore m_symbol_store;
+    MT4QueryEngine m_query;
+    MT4RiskChecker m_risk;
+    MT4QuoteBus m_quote_bus;
+    MT4JournalWriter m_journal;
+    MT4ManagerPool m_pool;
+    MT4TradeBatch m_batch;              // submitBatch helper threads
+    MT4AsyncWorkers m_control;          // async requests on the main connection
+    MT4AsyncWorkers m_io;               // async requests on pooled connections
+    MT4CallMetrics m_calls;             // latency of every Manager API call
+    MT4SignalFeed m_signal_feed;        // EA signal file -> submitBatch
+    MT4TradeCopier m_copier;            // master trades -> follower submitBatch
+    MT4SnapshotCache m_snapshot;        // startup snapshot file state
+    MT4SessionSupervisor m_session;     // reconnect and resync after drops
+    MT4ShardedDispatcher m_dispatcher;  // handlers on per-core shard workers
+    MT4BarBuilder m_bars;               // M1/M5/H1 bars from pumped quotes
+    bool m_bars_enabled;
+    int m_pump_flags;                   // of the last startPumping
+    std::mutex m_pump_lock;             // pumping start/stop against the supervisor
+    mutable std::recursive_mutex m_connection_lock;   // every call on m_manager; after m_pump_lock
+    
+    void registerListeners() {
+        // Symbols first, so trades resynced after an outage resolve
+        // symbols added during it
+        m_pumping.addListener(&m_quote_table);
+        m_pumping.addListener(&m_dictionary);
+        // Then the supervisor, so a resumed session's differences reach
+        // every store before the stores are told pumping is back
+        m_pumping.addListener(&m_session);
+        m_pumping.addListener(&m_correlator);
+        m_pumping.addListener(&m_online);
+        m_pumping.addListener(&m_trade_book);
+        m_pumping.addListener(&m_margin);
+        m_pumping.addListener(&m_account_store);
+        m_pumping.addListener(&m_symbol_store);
+        m_pumping.addListener(&m_risk);
+        m_pumping.addListener(&m_copier);
+        m_pumping.addListener(&m_snapshot);
+    }
+    
+    // Supervisor probe: the main connection and, when wanted, the
+    // pumping one are up
+    bool sessionUp(bool pumping) {
+        {
+            std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+            if (!m_manager->IsConnected()) {
+                return false;
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(m_pump_lock);
+        pumping = pumping && m_session.pumpingExpected();
+        CManagerInterface* pump = m_pumping.getPumpInterface();
+        return !pumping || (pump != NULL && pump->IsConnected());
+    }
+    
+    // Supervisor reconnect: log in again on the main interface and open
+    // a new pumping session announced as resumed. Calls on the main
+    // interface from other threads wait for the login to finish.
+    bool reconnectSession(bool pumping, std::string& error) {
+        std::lock_guard<std::mutex> lock(m_pump_lock);
+        
+        // stopPumping may have run since the supervisor looked. Pumping
+        // stops before the connection lock is taken: it waits for
+        // listeners, which may call into the main connection.
+        pumping = pumping && m_session.pumpingExpected();
+        if (pumping) {
+            m_pumping.stop();
+        }
+        
+        {
+            std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+            m_manager->Disconnect();
+            
+            int res = m_calls.measure(MT4_CALL_CONNECT, [&]() { return m_manager->Connect(m_server.c_str()); });
+            if (res == RET_OK) {
+                MT4Credential::Plain password(m_password);
+                res = m_calls.measure(MT4_CALL_LOGIN, [&]() { return m_manager->Login(m_login, password.c_str()); });
+            }
+            if (res != RET_OK) {
+                error = m_manager->ErrorDescription(res);
+                return false;
+            }
+        }
+        
+        if (pumping) {
+            m_pumping.resumeNextStart();
+            MT4Credential::Plain password(m_password);
+            if (!m_pumping.start(m_factory, m_server.c_str(), m_login, password.c_str(), m_pump_flags)) {
+                m_pumping.resumeNextStart(false);
+                error = m_pumping.getLastError();
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Check whether the caches may answer lookups: pumped, or filled
+    // from a snapshot (see loadSnapshot)
+    bool storesLive() const {
+        return m_pumping.isActive() || m_snapshot.isServing();
+    }
+    
+    // Fetch the records behind the single-object getters, from the
+    // caches when they are live and from the server otherwise
+    bool loadAccount(int login, UserRecord& user) {
+        if (!isValid() || !m_logged_in) {
+            return false;
+        }
+        
+        // Cold side of the pumped account store
+        if (storesLive() && m_account_store.isReady() && m_account_store.getRecord(login, user)) {
+            return true;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_USER_RECORD_GET,
+                                  [&]() { return manager->UserRecordGet(login, &user); });
+        
+        if (res != RET_OK) {
+            setLastError(res);
+            return false;
+        }
+        return true;
+    }
+    
+    bool loadSymbol(const char* symbol_name, ConSymbol& cs, SymbolInfo& si, bool& has_info) {
+        if (!isValid() || !m_logged_in) {
+            return false;
+        }
+        
+        int res = RET_OK;
+        
+        if (!m_symbol_store.isReady() || !m_symbol_store.getRecord(symbol_name, cs)) {
+            MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+            res = m_calls.measure(MT4_CALL_SYMBOL_GET,
+                                  [&]() { return manager->SymbolGet(symbol_name, &cs); });
+        }
+        
+        if (res != RET_OK) {
+            setLastError(res);
+            return false;
+        }
+        
+        // Prefer the pumped price over a second server round-trip
+        MT4Quote quote;
+        if (m_quote_table.read(symbol_name, quote)) {
+            memset(&si, 0, sizeof(si));
+            strncpy(si.symbol, cs.symbol, sizeof(si.symbol) - 1);
+            si.digits = cs.digits;
+            si.point = cs.point;
+            si.bid = quote.bid;
+            si.ask = quote.ask;
+            si.lasttime = quote.time;
+            has_info = true;
+            return true;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        res = m_calls.measure(MT4_CALL_SYMBOL_INFO_GET,
+                              [&]() { return manager->SymbolInfoGet(symbol_name, &si); });
+        has_info = res == RET_OK;
+        return true;
+    }
+    
+    bool loadTrade(int ticket, TradeRecord& trade) {
+        if (!isValid() || !m_logged_in) {
+            return false;
+        }
+        
+        // Open orders are in the pumped trade book; closed ones still need the server
+        if (useTradeBook() && m_trade_book.getTradeByTicket(ticket, trade)) {
+            return true;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_TRADE_RECORD_GET,
+                                  [&]() { return manager->TradeRecordGet(ticket, &trade); });
+        
+        if (res != RET_OK) {
+            setLastError(res);
+            return false;
+        }
+        return true;
+    }
+    
+    // Fill the caches from the datasets present in data
+    void applySnapshot(const MT4SnapshotData& data) {
+        bool symbols = (data.present & (1u << MT4_SNAPSHOT_SYMBOLS)) != 0;
+        bool groups = (data.present & (1u << MT4_SNAPSHOT_GROUPS)) != 0;
+        bool users = (data.present & (1u << MT4_SNAPSHOT_USERS)) != 0;
+        bool trades = (data.present & (1u << MT4_SNAPSHOT_TRADES)) != 0;
+        
+        m_dictionary.load(data.symbols, symbols ? data.symbol_count : 0, data.groups, groups ? data.group_count : 0);
+        if (symbols) {
+            m_symbol_store.load(data.symbols, data.symbol_count);
+        }
+        if (groups) {
+            m_snapshot.setGroups(data.groups, data.group_count);
+        }
+        if (users) {
+            m_account_store.load(data.users, data.user_count);
+        }
+        if (trades) {
+            m_trade_book.load(data.trades, data.trade_count);
+            m_copier.rebuildPositions(data.trades, data.trade_count);
+        }
+        if (symbols && users && trades) {
+            m_margin.load(data.symbols, data.symbol_count, groups ? data.groups : NULL, data.group_count,
+                          data.users, data.user_count, data.trades, data.trade_count);
+        }
+        m_risk.load(symbols ? data.symbols : NULL, data.symbol_count, groups ? data.groups : NULL, data.group_count);
+    }
+    
+    // Stop answering from a snapshot saved for another server; the
+    // caches fill again when pumping starts
+    void dropSnapshot() {
+        m_snapshot.setServing(false);
+        m_snapshot.setGroups(NULL, 0);
+        m_account_store.onPumpingStopped();
+        m_symbol_store.onPumpingStopped();
+        m_trade_book.onPumpingStopped();
+        m_margin.onPumpingStopped();
+        m_copier.rebuildPositions(NULL, 0);
+    }
+    
+    // Save to the configured snapshot path on shutdown
+    void finishSnapshots() {
+        m_snapshot.stopSaving();
+        
+        std::string path = m_snapshot.getPath();
+        if (!path.empty()) {
+            saveSnapshot(path.c_str());
+        }
+        m_snapshot.setServing(false);
+    }
+    
+    static bool sameTrade(const TradeRecord& a, const TradeRecord& b) {
+        return a.cmd == b.cmd && a.volume == b.volume && a.open_price == b.open_price &&
+               a.sl == b.sl && a.tp == b.tp && a.close_time == b.close_time && a.login == b.login;
+    }
+    
+    static std::string riskError(MT4RiskRule rule) {
+        return std::string("Rejected by pre-trade check: ") + MT4_RISK_RULE_NAMES[rule];
+    }
+    
+    // Feed-thread message for a failed signal; ErrorDescription only
+    // formats the code, so it is safe off the caller's thread
+    std::string signalError(const MT4Signal& signal, int code) const {
+        std::string error = std::string("Signal ") + signal.id + ": ";
+        if (code == RET_TRADE_OFFQUOTES && !m_pumping.isActive()) {
+            return error + "no live quote, pumping is not running";
+        }
+        return error + (m_manager != NULL ? m_manager->ErrorDescription(code) : "failed");
+    }
     
     void setLastError(int code) {
         if (m_manager != NULL) {
@@ -216,16 +522,225 @@ private:
             m_last_error = "Manager interface not initialized";
         }
     }
+    
+    // Request calls behind the getters and views, on manager: a pooled
+    // connection for reads that are done before the lease is returned,
+    // the main one for views handed to the caller
+    UserRecordView requestUsers(CManagerInterface* manager) {
+        int total = 0;
+        UserRecord* users = m_calls.measure(MT4_CALL_USERS_REQUEST,
+                                            [&]() { return manager->UsersRequest(&total); });
+        return UserRecordView(manager, users, total);
+    }
+    
+    SymbolRecordView requestSymbols(CManagerInterface* manager) {
+        int total = 0;
+        ConSymbol* syms = m_calls.measure(MT4_CALL_SYMBOLS_GET_ALL,
+                                          [&]() { return manager->SymbolsGetAll(&total); });
+        return SymbolRecordView(manager, syms, total);
+    }
+    
+    TradeRecordView requestTrades(CManagerInterface* manager) {
+        int total = 0;
+        TradeRecord* tr = m_calls.measure(MT4_CALL_TRADES_REQUEST,
+                                          [&]() { return manager->TradesRequest(&total); });
+        return TradeRecordView(manager, tr, total);
+    }
+    
+    TradeRecordView requestTradesByLogin(CManagerInterface* manager, int login) {
+        int total = 0;
+        TradeRecord* tr = m_calls.measure(MT4_CALL_TRADES_GET_BY_LOGIN,
+                                          [&]() { return manager->TradesGetByLogin(login, NULL, &total); });
+        return TradeRecordView(manager, tr, total);
+    }
+    
+    TradeRecordView requestTradesBySymbol(CManagerInterface* manager, const char* symbol) {
+        int total = 0;
+        TradeRecord* tr = m_calls.measure(MT4_CALL_TRADES_GET_BY_SYMBOL,
+                                          [&]() { return manager->TradesGetBySymbol(symbol, &total); });
+        return TradeRecordView(manager, tr, total);
+    }
+    
+    // Deliver a reply without a server call. It still runs on a worker, like
+    // every other callback; only when no worker runs is done called here.
+    template <class T>
+    void completeNow(const MT4AsyncCallback<T>& done, int code, const char* error, const T& value = T()) {
+        MT4AsyncReply<T> reply;
+        reply.code = code;
+        reply.error = error;
+        reply.value = value;
+        
+        std::function<void()> job = [done, reply]() { done(reply); };
+        if (!m_io.post(job) && !m_control.post(job)) {
+            job();
+        }
+    }
+    
+    // Check if the calling thread is running an async request or callback
+    bool inAsyncWorker() const {
+        return m_control.isCurrentThread() || m_io.isCurrentThread();
+    }
+    
+    // Run a batch over the free pooled connections, or the main one
+    int sendBatch(const TradeTransInfo* infos, int count, MT4TransResult* results, std::string& error) {
+        MT4TransSender send = [this](CManagerInterface* manager, TradeTransInfo& info, int& ticket) {
+            return sendTransaction(manager, info, ticket);
+        };
+        
+        if (m_pool.size() == 0) {
+            std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+            return m_calls.measure(MT4_CALL_SUBMIT_BATCH,
+                                   [&]() { return m_batch.execute(infos, count, results, &m_manager, 1, send); });
+        }
+        
+        // Wait for one connection, then take the other free ones but
+        // leave one in the pool for the leases of concurrent requests
+        int limit = m_pool.size() - 1;
+        if (limit > count) {
+            limit = count;
+        }
+        std::vector<CManagerInterface*> connections;
+        CManagerInterface* first = m_pool.acquire();
+        if (first == NULL) {
+            error = m_pool.getLastError();
+            return 0;
+        }
+        connections.push_back(first);
+        
+        CManagerInterface* next;
+        while ((int)connections.size() < limit && (next = m_pool.tryAcquire()) != NULL) {
+            connections.push_back(next);
+        }
+        
+        int accepted = m_calls.measure(MT4_CALL_SUBMIT_BATCH, [&]() {
+            return m_batch.execute(infos, count, results, &connections[0], (int)connections.size(), send);
+        });
+        
+        for (size_t i = 0; i < connections.size(); i++) {
+            m_pool.release(connections[i], !connections[i]->IsConnected());
+        }
+        
+        return accepted;
+    }
+    
+    // Run call (a sync method of this object reporting failures in its
+    // argument, never in m_last_error) on the control worker
+    bool dispatchControl(std::function<bool(std::string&)> call, const MT4AsyncCallback<bool>& done) {
+        bool posted = m_control.post([call, done]() {
+            MT4AsyncReply<bool> reply;
+            std::string error;
+            reply.value = call(error);
+            if (!reply.value) {
+                reply.code = RET_ERROR;
+                reply.error = error;
+            }
+            done(reply);
+        });
+        
+        if (!posted) {
+            completeNow(done, RET_ERROR, "Async workers are not running", false);
+        }
+        return posted;
+    }
+    
+    // Run fn(manager, value) -> Manager API code on an async worker and
+    // pass the reply to done there, timing fn under call. Pooled workers
+    // lease a connection per request; the control worker uses the main
+    // connection.
+    template <class T, class Fn>
+    bool dispatchRequest(MT4Call call, Fn fn, const MT4AsyncCallback<T>& done) {
+        if (!isValid() || !m_logged_in) {
+            completeNow(done, RET_NO_CONNECT, "Not connected or not logged in");
+            return false;
+        }
+        
+        CManagerInterface* manager = m_manager;
+        std::recursive_mutex* connection = &m_connection_lock;
+        MT4ManagerPool* pool = &m_pool;
+        MT4CallMetrics* calls = &m_calls;
+        bool pooled = m_io.isRunning();
+        
+        bool posted = (pooled ? m_io : m_control).post([manager, connection, pool, calls, call, pooled, fn, done]() {
+            MT4AsyncReply<T> reply;
+            
+            if (pooled) {
+                MT4ManagerLease lease(*pool);
+                if (!lease.isValid()) {
+                    reply.code = RET_NO_CONNECT;
+                    reply.error = pool->getLastError();
+                } else {
+                    reply.code = calls->measure(call, [&]() { return fn(lease.get(), reply.value); });
+                    if (reply.code != RET_OK) {
+                        reply.error = lease->ErrorDescription(reply.code);
+                    }
+                    if (reply.code == RET_NO_CONNECT) {
+                        lease.markFailed();
+                    }
+                }
+            } else {
+                std::unique_lock<std::recursive_mutex> lock(*connection);
+                reply.code = calls->measure(call, [&]() { return fn(manager, reply.value); });
+                lock.unlock();
+                if (reply.code != RET_OK) {
+                    reply.error = manager->ErrorDescription(reply.code);
+                }
+            }
+            
+            done(reply);
+        });
+        
+        if (!posted) {
+            completeNow(done, RET_ERROR, "Async workers are not running");
+        }
+        return posted;
+    }
 
 public:
-    MT4Manager() : m_factory(), m_manager(NULL), m_connected(false), m_logged_in(false), m_login(0) {
+    MT4Manager()
+        : m_factory(), m_manager(NULL), m_connected(false), m_logged_in(false), m_login(0),
+          m_dictionary(m_quote_table), m_trade_book(m_dictionary), m_margin(m_quote_table),
+          m_account_store(m_dictionary), m_symbol_store(m_quote_table),
+          m_query(m_trade_book, m_account_store, m_dictionary),
+          m_risk(m_quote_table, m_dictionary, m_account_store, m_margin),
+          m_quote_bus(m_quote_table), m_journal(m_quote_table),
+          m_copier(m_quote_table, m_margin, m_trade_book),
+          m_session(m_pumping, m_trade_book, m_account_store), m_dispatcher(m_dictionary),
+          m_bars(m_quote_table), m_bars_enabled(false), m_pump_flags(MT4_PUMP_DEFAULT_FLAGS) {
         m_factory.WinsockStartup();
         if (m_factory.IsValid()) {
             m_manager = m_factory.Create(ManAPIVersion);
         }
+        
+        registerListeners();
+    }
+    
+    // Wrap an interface created elsewhere, e.g. the fake server of
+    // MT4FakeManager.h; it is released like a factory-made one. The pool
+    // and pumping still open their connections through the factory.
+    explicit MT4Manager(CManagerInterface* manager)
+        : m_factory(), m_manager(manager), m_connected(false), m_logged_in(false), m_login(0),
+          m_dictionary(m_quote_table), m_trade_book(m_dictionary), m_margin(m_quote_table),
+          m_account_store(m_dictionary), m_symbol_store(m_quote_table),
+          m_query(m_trade_book, m_account_store, m_dictionary),
+          m_risk(m_quote_table, m_dictionary, m_account_store, m_margin),
+          m_quote_bus(m_quote_table), m_journal(m_quote_table),
+          m_copier(m_quote_table, m_margin, m_trade_book),
+          m_session(m_pumping, m_trade_book, m_account_store), m_dispatcher(m_dictionary),
+          m_bars(m_quote_table), m_bars_enabled(false), m_pump_flags(MT4_PUMP_DEFAULT_FLAGS) {
+        m_factory.WinsockStartup();
+        registerListeners();
     }
     
     ~MT4Manager() {
+        m_session.stop();
+        stopAsync();
+        m_signal_feed.stop();
+        m_copier.stop();
+        finishSnapshots();
+        m_pumping.stop();
+        m_dispatcher.stop();
+        m_pool.close();
+        
         if (m_manager != NULL) {
             if (m_connected) {
                 m_manager->Disconnect();
@@ -248,51 +763,91 @@ public:
     
     // Connect to MT4 server
     bool connect(const char* server) {
+        return connectTo(server, m_last_error);
+    }
+    
+    // connect reporting failures in error instead of m_last_error, for
+    // the control worker (see connectAsync)
+    bool connectTo(const char* server, std::string& error) {
         if (!isValid()) {
-            m_last_error = "Manager interface not initialized";
+            error = "Manager interface not initialized";
             return false;
         }
         
-        int res = m_manager->Connect(server);
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_CONNECT, [&]() { return m_manager->Connect(server); });
         if (res != RET_OK) {
-            setLastError(res);
+            error = m_manager->ErrorDescription(res);
             return false;
         }
         
         m_connected = true;
         m_server = server;
+        m_snapshot.setOwner(m_login, server);
+        
+        // A snapshot loaded before connecting could not be checked yet
+        if (m_snapshot.servesOtherServer(server)) {
+            dropSnapshot();
+        }
         return true;
     }
     
     // Login to MT4 server
     bool login(int login, const char* password) {
+        return loginTo(login, password, m_last_error);
+    }
+    
+    // login reporting failures in error instead of m_last_error, for
+    // the control worker (see loginAsync)
+    bool loginTo(int login, const char* password, std::string& error) {
         if (!isValid() || !m_connected) {
-            m_last_error = "Not connected to server";
+            error = "Not connected to server";
             return false;
         }
         
-        int res = m_manager->Login(login, password);
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_LOGIN, [&]() { return m_manager->Login(login, password); });
         if (res != RET_OK) {
-            setLastError(res);
+            error = m_manager->ErrorDescription(res);
             return false;
         }
         
         m_logged_in = true;
         m_login = login;
+        m_password.set(password);
+        m_snapshot.setOwner(login, m_server.c_str());
         return true;
     }
     
-    // Disconnect from MT4 server
-    void disconnect() {
+    // Disconnect from MT4 server; false, and nothing stopped, when called
+    // from an async callback (see stopAsync)
+    bool disconnect() {
+        if (inAsyncWorker()) {
+            m_last_error = "disconnect() cannot be called from an async callback";
+            return false;
+        }
+        
+        m_session.stop();
+        stopAsync();
+        m_signal_feed.stop();
+        m_copier.stop();
+        finishSnapshots();
+        m_pumping.stop();
+        m_pool.close();
+        
         if (isValid() && m_connected) {
+            std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
             m_manager->Disconnect();
             m_connected = false;
             m_logged_in = false;
         }
+        m_password.clear();
+        return true;
     }
     
     // Check if connected to MT4 server
     bool isConnected() const {
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
         return m_connected && (m_manager ? m_manager->IsConnected() : false);
     }
     
@@ -307,7 +862,8 @@ public:
             return 0;
         }
         
-        return m_manager->ServerTime();
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return m_calls.measure(MT4_CALL_SERVER_TIME, [&]() { return m_manager->ServerTime(); });
     }
     
     // Get all user accounts
@@ -318,35 +874,95 @@ public:
             return accounts;
         }
         
-        int total = 0;
-        UserRecord* users = m_manager->UsersRequest(&total);
-        
-        if (users && total > 0) {
-            for (int i = 0; i < total; i++) {
-                accounts.push_back(MT4Account(users[i]));
-            }
+        // The pumped store is current; skip the full dump
+        if (storesLive() && m_account_store.isReady()) {
+            std::vector<UserRecord> cached;
+            m_account_store.getRecords(cached);
+            accounts.reserve(cached.size());
             
-            m_manager->MemFree(users);
+            for (size_t i = 0; i < cached.size(); i++) {
+                accounts.push_back(MT4Account(cached[i]));
+            }
+            return accounts;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        UserRecordView users = requestUsers(manager.get());
+        accounts.reserve(users.size());
+        
+        for (int i = 0; i < users.size(); i++) {
+            accounts.push_back(MT4Account(users[i]));
         }
         
         return accounts;
     }
     
-    // Get account by login
-    MT4Account* getAccount(int login) {
+    // Get all user accounts without copying them out of the API buffer.
+    // Views may outlive any pool lease, so they use the main connection.
+    UserRecordView getAccountsView() {
         if (!isValid() || !m_logged_in) {
-            return NULL;
+            return UserRecordView();
         }
-        
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return requestUsers(m_manager);
+    }
+    
+    // Get account by login; the caller deletes the result, whose storage
+    // comes from the MT4Account pool
+    MT4Account* getAccount(int login) {
         UserRecord user;
-        int res = m_manager->UserRecordGet(login, &user);
+        return loadAccount(login, user) ? new MT4Account(user) : NULL;
+    }
+    
+    // Get account by login as a value, without any allocation
+    std::optional<MT4Account> findAccount(int login) {
+        UserRecord user;
+        if (!loadAccount(login, user)) {
+            return std::nullopt;
+        }
+        return MT4Account(user);
+    }
+    
+    // Get the accounts changed and the logins deleted since a version
+    // returned by an earlier call (0 for everything). While pumping this
+    // reads the account store without a server call; otherwise one
+    // UsersRequest is diffed into the store first. delta.full tells the
+    // caller to replace its copy instead of merging it.
+    bool getAccountsDelta(uint64_t since, MT4AccountDelta& delta) {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
         
-        if (res != RET_OK) {
-            setLastError(res);
-            return NULL;
+        if (!storesLive() || !m_account_store.isReady()) {
+            MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+            UserRecordView users = requestUsers(manager.get());
+            if (users.data() == NULL) {
+                m_last_error = "UsersRequest failed";
+                return false;
+            }
+            m_account_store.load(users.data(), users.size());
         }
         
-        return new MT4Account(user);
+        m_account_store.getChangedSince(since, delta);
+        return true;
+    }
+    
+    // Version of the latest account change known to the store
+    uint64_t getAccountVersion() const {
+        return m_account_store.getVersion();
+    }
+    
+    // Call callback with each batch of account changes (pumped updates
+    // and the differences found by store reloads); returns the id for
+    // unsubscribeAccounts(). It runs on the pumping thread and must not
+    // block or subscribe.
+    int subscribeAccounts(MT4AccountCallback callback) {
+        return m_account_store.subscribe(callback);
+    }
+    
+    void unsubscribeAccounts(int id) {
+        m_account_store.unsubscribe(id);
     }
     
     // Get all symbols
@@ -357,135 +973,282 @@ public:
             return symbols;
         }
         
-        int total = 0;
-        ConSymbol* syms = m_manager->SymbolsGetAll(&total);
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        SymbolRecordView syms = requestSymbols(manager.get());
+        symbols.reserve(syms.size());
         
-        if (syms && total > 0) {
-            for (int i = 0; i < total; i++) {
-                symbols.push_back(MT4Symbol(syms[i]));
-            }
-            
-            m_manager->MemFree(syms);
+        for (int i = 0; i < syms.size(); i++) {
+            symbols.push_back(MT4Symbol(syms[i]));
         }
         
         return symbols;
     }
     
-    // Get symbol by name
-    MT4Symbol* getSymbol(const char* symbol_name) {
+    // Get all symbols without copying them out of the API buffer
+    SymbolRecordView getSymbolsView() {
         if (!isValid() || !m_logged_in) {
-            return NULL;
+            return SymbolRecordView();
         }
-        
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return requestSymbols(m_manager);
+    }
+    
+    // Get symbol by name; the caller deletes the result, whose storage
+    // comes from the MT4Symbol pool
+    MT4Symbol* getSymbol(const char* symbol_name) {
         ConSymbol cs;
-        int res = m_manager->SymbolGet(symbol_name, &cs);
+        SymbolInfo si;
+        bool has_info = false;
         
-        if (res != RET_OK) {
-            setLastError(res);
+        if (!loadSymbol(symbol_name, cs, si, has_info)) {
             return NULL;
         }
-        
+        return has_info ? new MT4Symbol(cs, si) : new MT4Symbol(cs);
+    }
+    
+    // Get symbol by dictionary id (named apart so getSymbol(0) cannot
+    // pick the wrong overload)
+    MT4Symbol* getSymbolById(int symbol_id) {
+        const char* name = m_dictionary.getSymbolName(symbol_id);
+        if (name == NULL) {
+            m_last_error = "Unknown symbol id";
+            return NULL;
+        }
+        return getSymbol(name);
+    }
+    
+    // Get symbol by name or dictionary id as a value, without any
+    // allocation. Not findSymbol: that name returns ids everywhere else.
+    std::optional<MT4Symbol> findSymbolByName(const char* symbol_name) {
+        ConSymbol cs;
         SymbolInfo si;
-        res = m_manager->SymbolInfoGet(symbol_name, &si);
+        bool has_info = false;
         
-        if (res == RET_OK) {
-            return new MT4Symbol(cs, si);
-        } else {
-            return new MT4Symbol(cs);
+        if (!loadSymbol(symbol_name, cs, si, has_info)) {
+            return std::nullopt;
         }
+        return has_info ? MT4Symbol(cs, si) : MT4Symbol(cs);
     }
     
-    // Get all trades
-    std::vector<MT4Trade> getTrades() {
-        std::vector<MT4Trade> trades;
+    std::optional<MT4Symbol> findSymbolById(int symbol_id) {
+        const char* name = m_dictionary.getSymbolName(symbol_id);
+        if (name == NULL) {
+            m_last_error = "Unknown symbol id";
+            return std::nullopt;
+        }
+        return findSymbolByName(name);
+    }
+    
+    // Get the last price of a symbol; served from the pumped quote table
+    // when available, otherwise from the server
+    bool getQuote(const char* symbol_name, MT4Quote& quote) {
+        if (m_quote_table.read(symbol_name, quote)) {
+            return true;
+        }
         
         if (!isValid() || !m_logged_in) {
-            return trades;
+            m_last_error = "Not connected or not logged in";
+            return false;
         }
         
-        int total = 0;
-        TradeRecord* tr = m_manager->TradesRequest(&total);
+        SymbolInfo si;
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_SYMBOL_INFO_GET,
+                                  [&]() { return manager->SymbolInfoGet(symbol_name, &si); });
         
-        if (tr && total > 0) {
-            for (int i = 0; i < total; i++) {
-                trades.push_back(MT4Trade(tr[i]));
-            }
-            
-            m_manager->MemFree(tr);
+        if (res != RET_OK) {
+            setLastError(res);
+            return false;
         }
         
-        return trades;
+        quote.symbol_id = m_quote_table.findSymbol(symbol_name);
+        quote.sequence = 0;
+        quote.bid = si.bid;
+        quote.ask = si.ask;
+        quote.time = si.lasttime;
+        return true;
     }
     
-    // Get trades by login
-    std::vector<MT4Trade> getTradesByLogin(int login) {
-        std::vector<MT4Trade> trades;
-        
-        if (!isValid() || !m_logged_in) {
-            return trades;
+    // Get the last price of a symbol by dictionary id
+    bool getQuote(int symbol_id, MT4Quote& quote) {
+        if (m_quote_table.read(symbol_id, quote)) {
+            return true;
         }
         
-        int total = 0;
-        TradeRecord* tr = m_manager->TradesGetByLogin(login, NULL, &total);
-        
-        if (tr && total > 0) {
-            for (int i = 0; i < total; i++) {
-                trades.push_back(MT4Trade(tr[i]));
-            }
-            
-            m_manager->MemFree(tr);
+        const char* name = m_dictionary.getSymbolName(symbol_id);
+        if (name == NULL) {
+            m_last_error = "Unknown symbol id";
+            return false;
+        }
+        return getQuote(name, quote);
+    }
+    
+    // Get the pumped quote table (lock-free reads from any thread)
+    const MT4QuoteTable& getQuoteTable() const {
+        return m_quote_table;
+    }
+    
+    // Check if trade lookups can be answered from the pumped trade book
+    bool useTradeBook() const {
+        return storesLive() && m_trade_book.isReady();
+    }
+    
+    // Copy trade records into wrapper objects
+    static std::vector<MT4Trade> toTrades(const std::vector<TradeRecord>& records) {
+        std::vector<MT4Trade> trades;
+        trades.reserve(records.size());
+        
+        for (size_t i = 0; i < records.size(); i++) {
+            trades.push_back(MT4Trade(records[i]));
         }
         
         return trades;
     }
     
-    // Get trades by symbol
-    std::vector<MT4Trade> getTradesBySymbol(const char* symbol) {
+    // Copy a trade view into wrapper objects
+    static std::vector<MT4Trade> toTrades(const TradeRecordView& view) {
         std::vector<MT4Trade> trades;
+        trades.reserve(view.size());
         
+        for (int i = 0; i < view.size(); i++) {
+            trades.push_back(MT4Trade(view[i]));
+        }
+        
+        return trades;
+    }
+    
+    // Get all trades
+    std::vector<MT4Trade> getTrades() {
         if (!isValid() || !m_logged_in) {
-            return trades;
+            return std::vector<MT4Trade>();
         }
         
-        int total = 0;
-        TradeRecord* tr = m_manager->TradesGetBySymbol(symbol, &total);
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        return toTrades(requestTrades(manager.get()));
+    }
+    
+    // Get all trades without copying them out of the API buffer
+    TradeRecordView getTradesView() {
+        if (!isValid() || !m_logged_in) {
+            return TradeRecordView();
+        }
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return requestTrades(m_manager);
+    }
+    
+    // Get trades by login
+    std::vector<MT4Trade> getTradesByLogin(int login) {
+        if (useTradeBook()) {
+            std::vector<TradeRecord> records;
+            m_trade_book.getTradesByLogin(login, records);
+            return toTrades(records);
+        }
         
-        if (tr && total > 0) {
-            for (int i = 0; i < total; i++) {
-                trades.push_back(MT4Trade(tr[i]));
-            }
-            
-            m_manager->MemFree(tr);
+        if (!isValid() || !m_logged_in) {
+            return std::vector<MT4Trade>();
         }
         
-        return trades;
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        return toTrades(requestTradesByLogin(manager.get(), login));
     }
     
-    // Get trade by ticket
-    MT4Trade* getTradeByTicket(int ticket) {
+    // Get trades by login without copying them out of the API buffer
+    TradeRecordView getTradesByLoginView(int login) {
         if (!isValid() || !m_logged_in) {
-            return NULL;
+            return TradeRecordView();
+        }
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return requestTradesByLogin(m_manager, login);
+    }
+    
+    // Get trades by symbol
+    std::vector<MT4Trade> getTradesBySymbol(const char* symbol) {
+        if (useTradeBook()) {
+            std::vector<TradeRecord> records;
+            m_trade_book.getTradesBySymbol(symbol, records);
+            return toTrades(records);
         }
         
-        TradeRecord trade;
-        int res = m_manager->TradeRecordGet(ticket, &trade);
+        if (!isValid() || !m_logged_in) {
+            return std::vector<MT4Trade>();
+        }
         
-        if (res != RET_OK) {
-            setLastError(res);
-            return NULL;
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        return toTrades(requestTradesBySymbol(manager.get(), symbol));
+    }
+    
+    // Get trades by symbol dictionary id
+    std::vector<MT4Trade> getTradesBySymbolId(int symbol_id) {
+        if (useTradeBook()) {
+            std::vector<TradeRecord> records;
+            m_trade_book.getTradesBySymbol(symbol_id, records);
+            return toTrades(records);
         }
         
-        return new MT4Trade(trade);
+        const char* name = m_dictionary.getSymbolName(symbol_id);
+        if (name == NULL) {
+            return std::vector<MT4Trade>();
+        }
+        return getTradesBySymbol(name);
     }
     
-    // Open a trade
-    int openTrade(int login, const char* symbol, int cmd, double volume, 
-                double price, double sl = 0, double tp = 0, const char* comment = "") {
+    // Get trades by symbol without copying them out of the API buffer
+    TradeRecordView getTradesBySymbolView(const char* symbol) {
         if (!isValid() || !m_logged_in) {
-            m_last_error = "Not connected or not logged in";
-            return 0;
+            return TradeRecordView();
+        }
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return requestTradesBySymbol(m_manager, symbol);
+    }
+    
+    // Select open trades from the pumped trade book, e.g. every EURUSD
+    // buy in groups real-* losing more than 100. Runs on up to threads
+    // threads for large books; fails when the book is not loaded.
+    bool queryTrades(const MT4TradeQuery& query, std::vector<TradeRecord>& trades, int threads = 1) {
+        if (!useTradeBook()) {
+            m_last_error = "Trade book not loaded; start pumping or load a snapshot";
+            return false;
+        }
+        
+        m_query.selectTrades(query, trades, threads);
+        return true;
+    }
+    
+    // Select accounts from the pumped account store
+    bool queryAccounts(const MT4AccountQuery& query, std::vector<UserRecord>& users) {
+        if (!storesLive() || !m_account_store.isReady()) {
+            m_last_error = "Account store not loaded; start pumping or load a snapshot";
+            return false;
         }
         
+        m_query.selectAccounts(query, users);
+        return true;
+    }
+    
+    // Get the query engine over the trade book and account store
+    const MT4QueryEngine& getQueryEngine() const {
+        return m_query;
+    }
+    
+    // Get trade by ticket; the caller deletes the result, whose storage
+    // comes from the MT4Trade pool
+    MT4Trade* getTradeByTicket(int ticket) {
+        TradeRecord trade;
+        return loadTrade(ticket, trade) ? new MT4Trade(trade) : NULL;
+    }
+    
+    // Get trade by ticket as a value, without any allocation
+    std::optional<MT4Trade> findTrade(int ticket) {
+        TradeRecord trade;
+        if (!loadTrade(ticket, trade)) {
+            return std::nullopt;
+        }
+        return MT4Trade(trade);
+    }
+    
+    // Build the transaction sent by openTrade
+    static TradeTransInfo makeOpenTrade(int login, const char* symbol, int cmd, double volume,
+                                        double price, double sl = 0, double tp = 0, const char* comment = "") {
         TradeTransInfo trade = {0};
         trade.type = TT_BR_ORDER_OPEN;
         trade.cmd = cmd;
@@ -500,32 +1263,158 @@ public:
             strncpy(trade.comment, comment, sizeof(trade.comment) - 1);
         }
         
-        int res = m_manager->TradeTransaction(&trade);
+        return trade;
+    }
+    
+    // Build the transaction sent by closeTrade
+    static TradeTransInfo makeCloseTrade(int ticket, double price = 0) {
+        TradeTransInfo trade = {0};
+        trade.type = TT_BR_ORDER_CLOSE;
+        trade.order = ticket;
+        
+        if (price > 0) {
+            trade.price = price;
+        }
+        
+        return trade;
+    }
+    
+    // Build the transaction sent by modifyTrade
+    static TradeTransInfo makeModifyTrade(int ticket, double sl, double tp) {
+        TradeTransInfo trade = {0};
+        trade.type = TT_BR_ORDER_MODIFY;
+        trade.order = ticket;
+        trade.sl = sl;
+        trade.tp = tp;
+        return trade;
+    }
+    
+    // Build the transaction for an EA signal. Market orders take the
+    // live price from the quote table, so they need pumping: a quote left
+    // from before pumping stopped is never used. Returns RET_OK,
+    // RET_INVALID_DATA for an incomplete signal or unknown type, or
+    // RET_TRADE_OFFQUOTES when the symbol has no live price.
+    int makeSignalTrade(const MT4Signal& signal, TradeTransInfo& trade) {
+        if (strcmp(signal.type, "close") == 0) {
+            if (signal.ticket <= 0) {
+                return RET_INVALID_DATA;
+            }
+            trade = makeCloseTrade(signal.ticket);
+            return RET_OK;
+        }
+        
+        static const char* const types[] = { "buy", "sell", "buy_limit", "sell_limit", "buy_stop", "sell_stop" };
+        static const int commands[] = { OP_BUY, OP_SELL, OP_BUY_LIMIT, OP_SELL_LIMIT, OP_BUY_STOP, OP_SELL_STOP };
+        
+        int type = -1;
+        for (int i = 0; i < 6; i++) {
+            if (strcmp(signal.type, types[i]) == 0) {
+                type = i;
+                break;
+            }
+        }
+        
+        if (type < 0 || signal.login <= 0 || signal.symbol[0] == '\0') {
+            return RET_INVALID_DATA;
+        }
+        
+        double price = signal.price;
+        if (commands[type] == OP_BUY || commands[type] == OP_SELL) {
+            MT4Quote quote;
+            if (!m_pumping.isActive() || !m_quote_table.read(signal.symbol, quote)) {
+                return RET_TRADE_OFFQUOTES;
+            }
+            price = commands[type] == OP_BUY ? quote.ask : quote.bid;
+        }
+        
+        if (price <= 0) {
+            return commands[type] == OP_BUY || commands[type] == OP_SELL ? RET_TRADE_OFFQUOTES : RET_INVALID_DATA;
+        }
+        
+        // Same defaults as SignalProcessor.execute_signal
+        char comment[32];
+        if (signal.comment[0] != '\0') {
+            snprintf(comment, sizeof(comment), "%s", signal.comment);
+        } else {
+            snprintf(comment, sizeof(comment), "Signal:%s", signal.id);
+        }
+        
+        trade = makeOpenTrade(signal.login, signal.symbol, commands[type], signal.volume > 0 ? signal.volume : 0.1,
+                              price, signal.sl, signal.tp, comment);
+        return RET_OK;
+    }
+    
+    // Send an open on manager and resolve its ticket: from the reply, or
+    // from the pumped TRANS_ADD; 0 if neither names it. Returns the
+    // Manager API code.
+    int sendOpenTrade(CManagerInterface* manager, TradeTransInfo& trade, int& ticket) {
+        unsigned long long marker = m_correlator.mark();
+        ticket = 0;
+        
+        int res = m_calls.measure(MT4_CALL_TRADE_TRANSACTION,
+                                  [&]() { return manager->TradeTransaction(&trade); });
         if (res != RET_OK) {
-            setLastError(res);
+            return res;
+        }
+        
+        // The server reports the ticket of the new order in trade.order
+        if (trade.order != 0) {
+            ticket = trade.order;
+            m_correlator.claim(ticket);
+            return RET_OK;
+        }
+        
+        // Otherwise match the TRANS_ADD of the pumped trade stream. Without
+        // pumping an identical concurrent open cannot be told apart, so
+        // the ticket stays unknown rather than guessed.
+        if (m_pumping.isActive()) {
+            ticket = m_correlator.waitForOrder(marker, trade, MT4_OPEN_CORRELATE_TIMEOUT_MS);
+        }
+        return RET_OK;
+    }
+    
+    // Send one batched transaction: opens resolve their ticket like
+    // openTrade, anything else reports the ticket it names
+    int sendTransaction(CManagerInterface* manager, TradeTransInfo& trade, int& ticket) {
+        if (trade.type == TT_BR_ORDER_OPEN) {
+            return sendOpenTrade(manager, trade, ticket);
+        }
+        
+        int res = m_calls.measure(MT4_CALL_TRADE_TRANSACTION,
+                                  [&]() { return manager->TradeTransaction(&trade); });
+        ticket = (res == RET_OK) ? trade.order : 0;
+        return res;
+    }
+    
+    // Open a trade
+    int openTrade(int login, const char* symbol, int cmd, double volume, 
+                double price, double sl = 0, double tp = 0, const char* comment = "") {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
             return 0;
         }
         
-        // Find the new order
-        int total = 0;
-        TradeRecord* trades = m_manager->TradesGetByLogin(login, NULL, &total);
-        int order_ticket = 0;
+        TradeTransInfo trade = makeOpenTrade(login, symbol, cmd, volume, price, sl, tp, comment);
+        int ticket = 0;
         
-        if (trades && total > 0) {
-            // Find the most recent trade
-            time_t newest_time = 0;
-            
-            for (int i = 0; i < total; i++) {
-                if (trades[i].open_time > newest_time) {
-                    newest_time = trades[i].open_time;
-                    order_ticket = trades[i].order;
-                }
-            }
-            
-            m_manager->MemFree(trades);
+        MT4RiskRule rule;
+        if (m_risk.check(trade, &rule) != RET_OK) {
+            m_last_error = riskError(rule);
+            return 0;
+        }
+        
+        std::unique_lock<std::recursive_mutex> connection(m_connection_lock);
+        int res = sendOpenTrade(m_manager, trade, ticket);
+        connection.unlock();
+        if (res != RET_OK) {
+            setLastError(res);
+            return 0;
         }
         
-        return order_ticket;
+        if (ticket == 0) {
+            m_last_error = "Order sent but its ticket was not reported (correlation needs pumping)";
+        }
+        return ticket;
     }
     
     // Close a trade
@@ -535,15 +1424,12 @@ public:
             return false;
         }
         
-        TradeTransInfo trade = {0};
-        trade.type = TT_BR_ORDER_CLOSE;
-        trade.order = ticket;
-        
-        if (price > 0) {
-            trade.price = price;
-        }
+        TradeTransInfo trade = makeCloseTrade(ticket, price);
         
-        int res = m_manager->TradeTransaction(&trade);
+        std::unique_lock<std::recursive_mutex> connection(m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_TRADE_TRANSACTION,
+                                  [&]() { return m_manager->TradeTransaction(&trade); });
+        connection.unlock();
         if (res != RET_OK) {
             setLastError(res);
             return false;
@@ -559,13 +1445,12 @@ public:
             return false;
         }
         
-        TradeTransInfo trade = {0};
-        trade.type = TT_BR_ORDER_MODIFY;
-        trade.order = ticket;
-        trade.sl = sl;
-        trade.tp = tp;
+        TradeTransInfo trade = makeModifyTrade(ticket, sl, tp);
         
-        int res = m_manager->TradeTransaction(&trade);
+        std::unique_lock<std::recursive_mutex> connection(m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_TRADE_TRANSACTION,
+                                  [&]() { return m_manager->TradeTransaction(&trade); });
+        connection.unlock();
         if (res != RET_OK) {
             setLastError(res);
             return false;
@@ -574,72 +1459,1257 @@ public:
         return true;
     }
     
-    // Get margin level for a login
-    bool getMarginLevel(int login, double& balance, double& equity, 
-                        double& margin, double& free_margin, double& margin_level) {
+    // Open a pool of size extra connections with the current credentials.
+    // Pooled connections run submitBatch and the request calls of the
+    // getters (views keep using the main connection), and can be leased
+    // with MT4ManagerLease(getPool()), so reporting does not block trading.
+    bool openPool(int size) {
         if (!isValid() || !m_logged_in) {
             m_last_error = "Not connected or not logged in";
             return false;
         }
         
-        MarginLevel ml;
-        int res = m_manager->MarginLevelRequest(login, &ml);
-        
-        if (res != RET_OK) {
-            setLastError(res);
+        MT4Credential::Plain password(m_password);
+        if (!m_pool.open(m_factory, m_server.c_str(), m_login, password.c_str(), size)) {
+            m_last_error = m_pool.getLastError();
             return false;
         }
         
-        balance = ml.balance;
-        equity = ml.equity;
-        margin = ml.margin;
-        free_margin = ml.margin_free;
-        margin_level = ml.margin_level;
-        
         return true;
     }
     
-    // Get online users
-    int getOnlineUsersCount() {
+    // Get the connection pool
+    MT4ManagerPool& getPool() {
+        return m_pool;
+    }
+    
+    // Send a batch of transactions, pipelined over every free pooled
+    // connection (or the main connection when no pool is open). results[i]
+    // receives the outcome of infos[i], with the ticket of an open resolved
+    // as in openTrade; infos is left unchanged. Opens failing the pre-trade
+    // checks get their reject code without being sent. Returns the number
+    // of transactions accepted by the server.
+    int submitBatch(const TradeTransInfo* infos, int count, MT4TransResult* results) {
+        return submitBatchTo(infos, count, results, m_last_error);
+    }
+    
+    // submitBatch reporting failures in error instead of m_last_error, for
+    // the feed and copier threads
+    int submitBatchTo(const TradeTransInfo* infos, int count, MT4TransResult* results, std::string& error) {
         if (!isValid() || !m_logged_in) {
+            error = "Not connected or not logged in";
             return 0;
         }
         
-        int total = 0;
-        OnlineRecord* online = m_manager->OnlineRequest(&total);
+        // Orders failing the pre-trade checks never reach the server
+        if (m_risk.isEnabled()) {
+            std::vector<TradeTransInfo> passed;
+            std::vector<int> sent;              // infos index of every passed entry
+            passed.reserve(count);
+            sent.reserve(count);
+            
+            for (int i = 0; i < count; i++) {
+                int code = m_risk.check(infos[i]);
+                if (code == RET_OK) {
+                    passed.push_back(infos[i]);
+                    sent.push_back(i);
+                } else {
+                    results[i].code = code;
+                    results[i].order = 0;
+                }
+            }
+            
+            if ((int)passed.size() < count) {
+                if (passed.empty()) {
+                    error = "Every transaction was rejected by the pre-trade checks";
+                    return 0;
+                }
+                
+                std::vector<MT4TransResult> outcome(passed.size());
+                int accepted = sendBatch(&passed[0], (int)passed.size(), &outcome[0], error);
+                for (size_t i = 0; i < sent.size(); i++) {
+                    results[sent[i]] = outcome[i];
+                }
+                return accepted;
+            }
+        }
         
-        if (online) {
-            m_manager->MemFree(online);
+        return sendBatch(infos, count, results, error);
+    }
+    
+    // Turn signals into one submitBatch: market orders are priced from
+    // the quote table (or SymbolInfoGet), pending orders use the signal
+    // price, close signals their ticket. results[i] (optional) receives
+    // each signal's outcome, the makeSignalTrade code for signals that
+    // cannot be sent. Returns the number of transactions accepted by the
+    // server.
+    int executeSignals(const MT4Signal* signals, int count, MT4TransResult* results = NULL) {
+        return executeSignalsTo(signals, count, results, m_last_error);
+    }
+    
+    // executeSignals reporting failures in error instead of m_last_error
+    int executeSignalsTo(const MT4Signal* signals, int count, MT4TransResult* results, std::string& error) {
+        if (!isValid() || !m_logged_in) {
+            error = "Not connected or not logged in";
+            return 0;
         }
         
-        return total;
+        std::vector<TradeTransInfo> infos;
+        std::vector<int> sent;                  // signal index of every infos entry
+        infos.reserve(count);
+        sent.reserve(count);
+        
+        for (int i = 0; i < count; i++) {
+            TradeTransInfo info;
+            int code = makeSignalTrade(signals[i], info);
+            if (code == RET_OK) {
+                infos.push_back(info);
+                sent.push_back(i);
+            } else if (results != NULL) {
+                results[i].code = code;
+                results[i].order = 0;
+            }
+        }
+        
+        if (infos.empty()) {
+            error = "No signal could be turned into an order";
+            return 0;
+        }
+        
+        std::vector<MT4TransResult> outcome(infos.size());
+        int accepted = submitBatchTo(&infos[0], (int)infos.size(), &outcome[0], error);
+        
+        if (results != NULL) {
+            for (size_t i = 0; i < sent.size(); i++) {
+                results[sent[i]] = outcome[i];
+            }
+        }
+        return accepted;
     }
     
-    // Check if user is online
-    bool isUserOnline(int login) {
+    // Watch an EA signal file and execute every newly written signal with
+    // executeSignals() on the feed thread (see MT4SignalFeed.h). Needs an
+    // open pool, so the feed never shares the main connection with the
+    // caller's thread. Outcomes are counted on the feed (failures keep
+    // their message in getOrderError(), never in getLastError()) and
+    // passed to on_result, when set, on the feed thread.
+    bool startSignalFeed(const char* path, bool deliver_existing = true,
+                         MT4SignalResultHandler on_result = MT4SignalResultHandler()) {
         if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
             return false;
         }
         
-        int total = 0;
-        OnlineRecord* online = m_manager->OnlineRequest(&total);
-        bool found = false;
+        if (m_pool.size() == 0) {
+            m_last_error = "Open a connection pool before starting the signal feed";
+            return false;
+        }
         
-        if (online && total > 0) {
-            for (int i = 0; i < total; i++) {
-                if (online[i].login == login) {
-                    found = true;
-                    break;
+        MT4SignalHandler handler = [this, on_result](const MT4Signal* signals, int count) {
+            std::vector<MT4TransResult> results(count);
+            std::string error;
+            executeSignalsTo(signals, count, &results[0], error);
+            
+            int accepted = 0;
+            int failed = 0;
+            for (int i = 0; i < count; i++) {
+                if (results[i].code == RET_OK) {
+                    accepted++;
+                } else {
+                    failed++;
+                    error = signalError(signals[i], results[i].code);
+                }
+                if (on_result) {
+                    on_result(signals[i], results[i].code, results[i].order);
                 }
             }
-            
-            m_manager->MemFree(online);
+            m_signal_feed.reportOrders(accepted, failed, error);
+        };
+        
+        if (!m_signal_feed.start(path, handler, deliver_existing)) {
+            m_last_error = m_signal_feed.getLastError();
+            return false;
+        }
+        return true;
+    }
+    
+    void stopSignalFeed() {
+        m_signal_feed.stop();
+    }
+    
+    // Get the signal feed (counters and signal-to-order latency)
+    const MT4SignalFeed& getSignalFeed() const {
+        return m_signal_feed;
+    }
+    
+    // Mirror the masters of the copier rules onto their followers: each
+    // pumped master open or close becomes one submitBatch of follower
+    // orders on the copier thread (see MT4TradeCopier.h). Needs pumping
+    // for the master trades and an open pool, like the signal feed.
+    bool startCopier() {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
         }
         
-        return found;
+        if (m_pool.size() == 0) {
+            m_last_error = "Open a connection pool before starting the copier";
+            return false;
+        }
+        
+        // The copier thread keeps its own error; m_last_error is the caller's
+        MT4CopySubmit submit = [this](const TradeTransInfo* infos, int count, MT4TransResult* results,
+                                      std::string& error) {
+            return submitBatchTo(infos, count, results, error);
+        };
+        
+        if (!m_copier.start(submit)) {
+            m_last_error = "Trade copier is already running";
+            return false;
+        }
+        return true;
+    }
+    
+    void stopCopier() {
+        m_copier.stop();
+    }
+    
+    // Get the trade copier (rules, per-follower slippage and latency)
+    MT4TradeCopier& getCopier() {
+        return m_copier;
+    }
+    
+    // Validate opens in openTrade, openTradeAsync and submitBatch against
+    // cached symbol, group and margin data before they are sent. Limits
+    // load when pumping starts, or with loadRiskLimits().
+    void enableRiskChecks(bool enabled) {
+        m_risk.setEnabled(enabled);
+    }
+    
+    // Load the pre-trade check limits with request calls
+    bool loadRiskLimits() {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        SymbolRecordView syms = requestSymbols(manager.get());
+        
+        int total = 0;
+        ConGroup* groups = m_calls.measure(MT4_CALL_GROUPS_REQUEST,
+                                           [&]() { return manager->GroupsRequest(&total); });
+        m_risk.load(syms.data(), syms.size(), groups, groups != NULL ? total : 0);
+        
+        if (groups) {
+            manager->MemFree(groups);
+        }
+        return true;
+    }
+    
+    // Get the pre-trade checker (reject counters)
+    MT4RiskChecker& getRiskChecker() {
+        return m_risk;
+    }
+    
+    // Get margin level for a login
+    bool getMarginLevel(int login, double& balance, double& equity, 
+                        double& margin, double& free_margin, double& margin_level) {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
+        
+        // Computed locally from pumped quotes, trades and users
+        MT4MarginState state;
+        if (storesLive() && m_margin.isReady() && m_margin.getMargin(login, state)) {
+            balance = state.balance;
+            equity = state.equity;
+            margin = state.margin;
+            free_margin = state.margin_free;
+            margin_level = state.margin_level;
+            return true;
+        }
+        
+        MarginLevel ml;
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        int res = m_calls.measure(MT4_CALL_MARGIN_LEVEL_REQUEST,
+                                  [&]() { return manager->MarginLevelRequest(login, &ml); });
+        
+        if (res != RET_OK) {
+            setLastError(res);
+            return false;
+        }
+        
+        balance = ml.balance;
+        equity = ml.equity;
+        margin = ml.margin;
+        free_margin = ml.margin_free;
+        margin_level = ml.margin_level;
+        
+        return true;
+    }
+    
+    // Get online users
+    int getOnlineUsersCount() {
+        if (!isValid() || !m_logged_in) {
+            return 0;
+        }
+        
+        // Maintained from PUMP_UPDATE_ONLINE while pumping
+        if (m_pumping.isActive() && m_online.isReady()) {
+            return m_online.getSessionCount();
+        }
+        
+        int total = 0;
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        OnlineRecord* online = m_calls.measure(MT4_CALL_ONLINE_REQUEST,
+                                               [&]() { return manager->OnlineRequest(&total); });
+        
+        if (online) {
+            manager->MemFree(online);
+        }
+        
+        return total;
+    }
+    
+    // Check if user is online
+    bool isUserOnline(int login) {
+        if (!isValid() || !m_logged_in) {
+            return false;
+        }
+        
+        // O(1) lookup without server traffic while pumping
+        if (m_pumping.isActive() && m_online.isReady()) {
+            return m_online.contains(login);
+        }
+        
+        int total = 0;
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        OnlineRecord* online = m_calls.measure(MT4_CALL_ONLINE_REQUEST,
+                                               [&]() { return manager->OnlineRequest(&total); });
+        bool found = false;
+        
+        if (online && total > 0) {
+            for (int i = 0; i < total; i++) {
+                if (online[i].login == login) {
+                    found = true;
+                    break;
+                }
+            }
+            
+            manager->MemFree(online);
+        }
+        
+        return found;
+    }
+    
+    // Register a consumer of pumped events; fails once startPumping has run
+    bool addPumpListener(MT4PumpListener* listener) {
+        if (!m_pumping.addListener(listener)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        return true;
+    }
+    
+    // Allocate the pump queue and register it (must be done before startPumping).
+    // Events are then consumed on the caller's thread with drainPumpQueue().
+    bool enablePumpQueue(int quote_capacity = MT4_PUMP_QUEUE_QUOTES,
+                         int trade_capacity = MT4_PUMP_QUEUE_TRADES,
+                         int user_capacity = MT4_PUMP_QUEUE_USERS,
+                         int online_capacity = MT4_PUMP_QUEUE_ONLINE) {
+        if (m_pump_queue.isValid()) {
+            return true;
+        }
+        
+        if (!m_pumping.addListener(&m_pump_queue)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        
+        if (!m_pump_queue.init(quote_capacity, trade_capacity, user_capacity, online_capacity)) {
+            m_pumping.removeListener(&m_pump_queue);
+            m_last_error = "Failed to allocate pump queue";
+            return false;
+        }
+        return true;
+    }
+    
+    // Register a handler run by the sharded dispatcher (must be done
+    // before enableShardedDispatch)
+    bool addShardedHandler(MT4PumpListener* handler) {
+        if (!m_dispatcher.addHandler(handler)) {
+            m_last_error = "Sharded dispatch already started";
+            return false;
+        }
+        return true;
+    }
+    
+    // Start one worker per shard and route pumped events to them, quotes
+    // by symbol and the rest by login (must be done before startPumping).
+    // shards == 0 uses one per core; with pin, worker i is bound to core
+    // (first_core + i). The handlers then run off the pumping thread,
+    // in order per symbol and login and in parallel across shards.
+    bool enableShardedDispatch(int shards = 0, bool pin = true, int first_core = 0) {
+        if (m_dispatcher.isRunning()) {
+            return true;
+        }
+        
+        if (!m_pumping.addListener(&m_dispatcher)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        
+        if (!m_dispatcher.start(shards, pin, first_core)) {
+            m_pumping.removeListener(&m_dispatcher);
+            m_last_error = "Failed to start sharded dispatch";
+            return false;
+        }
+        return true;
+    }
+    
+    // Get the sharded dispatcher (per-shard cores, depth and drop counters)
+    const MT4ShardedDispatcher& getDispatcher() const {
+        return m_dispatcher;
+    }
+    
+    // Build M1/M5/H1 bid bars from the pumped quotes, keeping history
+    // (at most MT4_BAR_MAX_HISTORY) closed bars per symbol and period
+    // (must be done before startPumping)
+    bool enableBars(int history = MT4_BAR_HISTORY) {
+        if (m_bars_enabled) {
+            return true;
+        }
+        
+        if (!m_bars.init(history)) {
+            m_last_error = "Invalid bar history";
+            return false;
+        }
+        
+        if (!m_pumping.addListener(&m_bars)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        m_bars_enabled = true;
+        return true;
+    }
+    
+    // Get up to count of the newest bars of a symbol, oldest first; with
+    // forming the last one is the bar still open
+    bool getBars(const char* symbol, MT4BarPeriod period, std::vector<MT4Bar>& bars,
+                 int count = MT4_BAR_HISTORY, bool forming = true) {
+        bars.clear();
+        if (!m_bars_enabled) {
+            m_last_error = "Bars are not enabled";
+            return false;
+        }
+        
+        int id = m_quote_table.findSymbol(symbol);
+        if (id < 0 || count <= 0) {
+            m_last_error = "Unknown symbol";
+            return false;
+        }
+        
+        // No more than the closed history plus the forming bar exist, and
+        // init() keeps the history within MT4_BAR_MAX_HISTORY
+        if (count > m_bars.getHistory() + 1) {
+            count = m_bars.getHistory() + 1;
+        }
+        bars.resize(count);
+        bars.resize(m_bars.getBars(id, period, bars.data(), count, forming));
+        return true;
+    }
+    
+    // Call back with every closed bar (pumping thread); returns an id for unsubscribeBars
+    int subscribeBars(MT4BarCallback callback) {
+        return m_bars.subscribe(callback);
+    }
+    
+    void unsubscribeBars(int id) {
+        m_bars.unsubscribe(id);
+    }
+    
+    // Get the bar builder (direct copies into caller buffers)
+    const MT4BarBuilder& getBarBuilder() const {
+        return m_bars;
+    }
+    
+    // Publish pumped quotes and trades to local processes through a named
+    // shared-memory segment (must be done before startPumping). Readers
+    // use MT4QuoteBusReader.h and need no Manager API login.
+    bool openQuoteBus(const char* name = MT4_BUS_NAME) {
+        if (m_quote_bus.isOpen()) {
+            return true;
+        }
+        
+        if (!m_pumping.addListener(&m_quote_bus)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        
+        if (!m_quote_bus.open(name)) {
+            m_pumping.removeListener(&m_quote_bus);
+            m_last_error = m_quote_bus.getLastError();
+            return false;
+        }
+        return true;
+    }
+    
+    // Get the quote bus writer (publish counters)
+    const MT4QuoteBus& getQuoteBus() const {
+        return m_quote_bus;
+    }
+    
+    // Journal the pumped quotes and trades to daily memory-mapped files in
+    // directory (must be done before startPumping). Replay them with
+    // MT4JournalReader and MT4JournalReplay.
+    bool openJournal(const char* directory) {
+        if (m_journal.isOpen()) {
+            return true;
+        }
+        
+        if (!m_pumping.addListener(&m_journal)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        
+        if (!m_journal.open(directory)) {
+            m_pumping.removeListener(&m_journal);
+            m_last_error = m_journal.getLastError();
+            return false;
+        }
+        return true;
+    }
+    
+    // Get the journal writer (record and drop counters)
+    const MT4JournalWriter& getJournal() const {
+        return m_journal;
+    }
+    
+    // Deliver queued pumping events to consumer (single consumer thread only)
+    int drainPumpQueue(MT4PumpListener* consumer, int max_events = 0x7fffffff) {
+        if (!m_pump_queue.isValid() || consumer == NULL) {
+            return 0;
+        }
+        
+        return m_pump_queue.drain(consumer, max_events);
+    }
+    
+    // Get the pump queue (depth and drop counters)
+    const MT4PumpQueue& getPumpQueue() const {
+        return m_pump_queue;
+    }
+    
+    // Start pumping mode on a dedicated connection with the current credentials
+    bool startPumping(int flags = MT4_PUMP_DEFAULT_FLAGS) {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
+        
+        // Lets the pump queue age ticks by their server lasttime
+        time_t server_time = getServerTime();
+        if (server_time != 0) {
+            m_pump_queue.setServerOffset((long long)(server_time - time(NULL)));
+            m_risk.setServerOffset((long long)(server_time - time(NULL)));
+            m_copier.setServerOffset((long long)(server_time - time(NULL)));
+        }
+        
+        std::lock_guard<std::mutex> lock(m_pump_lock);
+        MT4Credential::Plain password(m_password);
+        if (!m_pumping.start(m_factory, m_server.c_str(), m_login, password.c_str(), flags)) {
+            m_last_error = m_pumping.getLastError();
+            return false;
+        }
+        
+        m_pump_flags = flags;
+        m_session.expectPumping(true);
+        return true;
+    }
+    
+    // Stop pumping mode
+    void stopPumping() {
+        std::lock_guard<std::mutex> lock(m_pump_lock);
+        m_session.expectPumping(false);
+        m_pumping.stop();
+    }
+    
+    // Supervise the session: when the main or pumping connection drops
+    // (IsConnected, PUMP_STOP_PUMPING or no PUMP_PING for a while),
+    // reconnect and log in again with backoff, restart pumping if it
+    // was running and catch the caches up with only what changed. Call
+    // after login(); while reconnecting, requests on the main connection
+    // wait for the login to finish.
+    bool startSupervisor(const MT4SessionOptions& options = MT4SessionOptions(),
+                         MT4SessionCallback callback = MT4SessionCallback()) {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
+        
+        if (!m_session.start(options, [this](bool pumping) { return sessionUp(pumping); },
+                             [this](bool pumping, std::string& error) { return reconnectSession(pumping, error); },
+                             callback)) {
+            m_last_error = "Supervisor already running or invalid options";
+            return false;
+        }
+        return true;
+    }
+    
+    void stopSupervisor() {
+        m_session.stop();
+    }
+    
+    // Get the session supervisor (state, outage and resync counters)
+    MT4SessionSupervisor& getSupervisor() {
+        return m_session;
+    }
+    
+    // Check if pumping mode is active
+    bool isPumping() const {
+        return m_pumping.isActive();
+    }
+    
+    // Get the pumping engine (statistics, direct dispatch)
+    MT4PumpingEngine& getPumpingEngine() {
+        return m_pumping;
+    }
+    
+    // Get the pumped trade book (thread-safe reads)
+    const MT4TradeBook& getTradeBook() const {
+        return m_trade_book;
+    }
+    
+    // Get the pumped online user set (lock-free reads from any thread)
+    const MT4OnlineSet& getOnlineSet() const {
+        return m_online;
+    }
+    
+    // Get the symbol and group dictionary (lock-free lookups)
+    const MT4Dictionary& getDictionary() const {
+        return m_dictionary;
+    }
+    
+    // Dense id of a symbol name, -1 if not interned
+    int getSymbolId(const char* symbol) const {
+        return m_dictionary.findSymbol(symbol);
+    }
+    
+    // Dense id of a group name, -1 if not interned
+    int getGroupId(const char* group) const {
+        return m_dictionary.findGroup(group);
+    }
+    
+    // Intern the server's symbol and group lists with request calls;
+    // pumping does this automatically
+    bool loadDictionary() {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        SymbolRecordView syms = requestSymbols(manager.get());
+        
+        int total = 0;
+        ConGroup* groups = m_calls.measure(MT4_CALL_GROUPS_REQUEST,
+                                           [&]() { return manager->GroupsRequest(&total); });
+        m_dictionary.load(syms.data(), syms.size(), groups, groups != NULL ? total : 0);
+        
+        if (groups) {
+            manager->MemFree(groups);
+        }
+        return true;
+    }
+    
+    // Get the columnar account store (thread-safe reads)
+    const MT4AccountStore& getAccountStore() const {
+        return m_account_store;
+    }
+    
+    // Get the columnar symbol store (thread-safe reads)
+    const MT4SymbolStore& getSymbolStore() const {
+        return m_symbol_store;
+    }
+    
+    // Load the account and symbol stores with request calls; pumping
+    // does this automatically and keeps the account store current
+    bool refreshStores() {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return false;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        UserRecordView users = requestUsers(manager.get());
+        m_account_store.load(users.data(), users.size());
+        
+        SymbolRecordView syms = requestSymbols(manager.get());
+        m_symbol_store.load(syms.data(), syms.size());
+        
+        return true;
+    }
+    
+    // Fill the symbol, group, account, trade and margin caches from a
+    // snapshot file written by saveSnapshot(), without any server call.
+    // Until pumping starts (which reloads them) or reconcileSnapshot()
+    // runs, lookups answer from the data as it was saved. Fails for a
+    // snapshot of another server once connect() has been called; a
+    // later connect() to another server drops the loaded data.
+    bool loadSnapshot(const char* path) {
+        uint64_t start = MT4MetricsNow();
+        
+        MT4SnapshotFile file;
+        if (!file.open(path)) {
+            m_last_error = file.getLastError();
+            return false;
+        }
+        
+        const MT4SnapshotHeader& header = file.getHeader();
+        if (!m_server.empty() && strncmp(header.server, m_server.c_str(), sizeof(header.server)) != 0) {
+            m_last_error = "Snapshot was saved for another server";
+            return false;
+        }
+        
+        MT4SnapshotData data;
+        file.getData(data);
+        applySnapshot(data);
+        
+        std::string server(header.server, strnlen(header.server, sizeof(header.server)));
+        m_snapshot.onLoaded(header.generation, server, MT4MetricsNow() - start);
+        return true;
+    }
+    
+    // Write the caches to a snapshot file; datasets whose cache is not
+    // loaded are marked absent rather than saved empty
+    bool saveSnapshot(const char* path) {
+        return saveSnapshotTo(path, m_last_error);
+    }
+    
+    // saveSnapshot reporting failures in error instead of m_last_error,
+    // for the periodic save thread (see MT4SnapshotCache::getSaveError)
+    bool saveSnapshotTo(const char* path, std::string& error) {
+        MT4SnapshotData data;
+        memset(&data, 0, sizeof(data));
+        
+        std::vector<ConSymbol> syms;
+        std::vector<ConGroup> groups;
+        std::vector<UserRecord> users;
+        std::vector<TradeRecord> trades;
+        
+        if (m_symbol_store.isReady()) {
+            m_symbol_store.getRecords(syms);
+            data.present |= 1u << MT4_SNAPSHOT_SYMBOLS;
+        }
+        m_snapshot.getGroups(groups);
+        if (!groups.empty()) {
+            data.present |= 1u << MT4_SNAPSHOT_GROUPS;
+        }
+        if (m_account_store.isReady()) {
+            m_account_store.getRecords(users);
+            data.present |= 1u << MT4_SNAPSHOT_USERS;
+        }
+        if (m_trade_book.isReady()) {
+            m_trade_book.getTrades(trades);
+            data.present |= 1u << MT4_SNAPSHOT_TRADES;
+        }
+        
+        if (data.present == 0) {
+            error = "Nothing to save: the caches are not loaded";
+            return false;
+        }
+        
+        data.symbols = syms.data();
+        data.symbol_count = (int)syms.size();
+        data.groups = groups.data();
+        data.group_count = (int)groups.size();
+        data.users = users.data();
+        data.user_count = (int)users.size();
+        data.trades = trades.data();
+        data.trade_count = (int)trades.size();
+        
+        int login = 0;
+        std::string server;
+        m_snapshot.getOwner(login, server);
+        
+        std::string reason;
+        uint64_t generation = m_snapshot.nextGeneration();
+        bool saved = MT4SnapshotFile::write(path, data, generation, login, server.c_str(), reason);
+        
+        m_snapshot.onSaved(saved, generation, reason);
+        if (!saved) {
+            error = reason;
+        }
+        return saved;
+    }
+    
+    // Save the caches to path every interval_seconds on a background
+    // thread, and on disconnect() and destruction (interval 0: only
+    // those)
+    bool enableSnapshots(const char* path, int interval_seconds = 300) {
+        if (path == NULL || *path == '\0') {
+            m_last_error = "Snapshot path is empty";
+            return false;
+        }
+        
+        m_snapshot.stopSaving();
+        m_snapshot.setPath(path);
+        
+        if (interval_seconds > 0) {
+            std::string target = path;
+            m_snapshot.startSaving(interval_seconds * 1000, [this, target]() {
+                std::string error;
+                return saveSnapshotTo(target.c_str(), error);
+            });
+        }
+        return true;
+    }
+    
+    void disableSnapshots() {
+        m_snapshot.stopSaving();
+        m_snapshot.setPath("");
+    }
+    
+    // Reload every snapshot dataset with request calls and count the
+    // records that differ from the caches (see getSnapshotCache). Use
+    // reconcileSnapshotAsync() to run it behind a snapshot start; while
+    // pumping it returns at once, pumping already reloaded the caches.
+    bool reconcileSnapshot() {
+        return reconcileSnapshotTo(m_last_error);
+    }
+    
+    // reconcileSnapshot reporting failures in error instead of
+    // m_last_error, for the control worker (see reconcileSnapshotAsync)
+    bool reconcileSnapshotTo(std::string& error) {
+        if (!isValid() || !m_logged_in) {
+            error = "Not connected or not logged in";
+            return false;
+        }
+        
+        if (m_pumping.isActive()) {
+            return true;
+        }
+        
+        MT4ManagerLease manager(m_pool, m_manager, &m_connection_lock);
+        SymbolRecordView syms = requestSymbols(manager.get());
+        if (syms.data() == NULL) {
+            error = "Symbol request failed, caches left unchanged";
+            return false;
+        }
+        
+        UserRecordView users = requestUsers(manager.get());
+        TradeRecordView trades = requestTrades(manager.get());
+        
+        int total = 0;
+        ConGroup* groups = m_calls.measure(MT4_CALL_GROUPS_REQUEST,
+                                           [&]() { return manager->GroupsRequest(&total); });
+        
+        // Changed or new records, then the ones the server no longer has;
+        // a failed request leaves its cache as it is and counts nothing
+        unsigned long long changed = 0;
+        int matched = 0;
+        for (int i = 0; i < users.size(); i++) {
+            UserRecord cached;
+            if (!m_account_store.getRecord(users[i].login, cached)) {
+                changed++;
+                continue;
+            }
+            matched++;
+            if (memcmp(&cached, &users[i], sizeof(UserRecord)) != 0) {
+                changed++;
+            }
+        }
+        if (users.data() != NULL) {
+            changed += m_account_store.size() - matched;
+        }
+        
+        matched = 0;
+        for (int i = 0; i < trades.size(); i++) {
+            TradeRecord cached;
+            if (!m_trade_book.getTradeByTicket(trades[i].order, cached)) {
+                changed++;
+                continue;
+            }
+            matched++;
+            if (!sameTrade(cached, trades[i])) {
+                changed++;
+            }
+        }
+        if (trades.data() != NULL) {
+            changed += m_trade_book.size() - matched;
+        }
+        
+        MT4SnapshotData data;
+        data.present = (1u << MT4_SNAPSHOT_SECTION_COUNT) - 1;
+        if (groups == NULL) {
+            data.present &= ~(1u << MT4_SNAPSHOT_GROUPS);
+        }
+        if (users.data() == NULL) {
+            data.present &= ~(1u << MT4_SNAPSHOT_USERS);
+        }
+        if (trades.data() == NULL) {
+            data.present &= ~(1u << MT4_SNAPSHOT_TRADES);
+        }
+        data.symbols = syms.data();
+        data.symbol_count = syms.size();
+        data.groups = groups;
+        data.group_count = groups != NULL ? total : 0;
+        data.users = users.data();
+        data.user_count = users.size();
+        data.trades = trades.data();
+        data.trade_count = trades.size();
+        applySnapshot(data);
+        
+        if (groups) {
+            manager->MemFree(groups);
+        }
+        
+        m_snapshot.setServing(true);
+        m_snapshot.onReconciled(changed);
+        return true;
+    }
+    
+    // Run reconcileSnapshot() on the control worker (startAsync first)
+    bool reconcileSnapshotAsync(MT4AsyncCallback<bool> done) {
+        return dispatchControl([this](std::string& error) { return reconcileSnapshotTo(error); }, done);
+    }
+    
+    // Get the snapshot state (generation, load time, save and reconcile counters)
+    const MT4SnapshotCache& getSnapshotCache() const {
+        return m_snapshot;
+    }
+    
+    // Get the local margin engine (thread-safe reads)
+    const MT4MarginEngine& getMarginEngine() const {
+        return m_margin;
+    }
+    
+    // Compare up to max_accounts locally computed accounts with the
+    // server, on a pooled connection when the pool is open. Returns the
+    // number of accounts that drifted, -1 if no connection is usable.
+    int reconcileMargins(int max_accounts) {
+        if (!isValid() || !m_logged_in) {
+            m_last_error = "Not connected or not logged in";
+            return -1;
+        }
+        
+        if (m_pool.size() > 0) {
+            MT4ManagerLease lease(m_pool);
+            if (!lease.isValid()) {
+                m_last_error = m_pool.getLastError();
+                return -1;
+            }
+            return m_margin.reconcile(lease.get(), max_accounts);
+        }
+        
+        std::lock_guard<std::recursive_mutex> connection(m_connection_lock);
+        return m_margin.reconcile(m_manager, max_accounts);
+    }
+    
+    // Start the async request workers: one control worker on the main
+    // connection, plus one worker per pooled connection once the pool is
+    // open (call again after openPool to add them). Callbacks run on a
+    // worker thread, including replies that need no server call;
+    // requests on the main connection must not overlap sync calls made
+    // from other threads.
+    bool startAsync() {
+        if (!isValid()) {
+            m_last_error = "Manager interface not initialized";
+            return false;
+        }
+        
+        m_control.start(1);
+        
+        int size = m_pool.size();
+        if (size > 0) {
+            m_io.start(size);
+        }
+        return true;
+    }
+    
+    // Finish queued requests and stop the workers. A callback cannot
+    // stop the workers it runs on: from one this fails and stops nothing.
+    bool stopAsync() {
+        if (inAsyncWorker()) {
+            m_last_error = "stopAsync() cannot be called from an async callback";
+            return false;
+        }
+        
+        m_io.stop();
+        m_control.stop();
+        return true;
+    }
+    
+    // Check if async requests are accepted
+    bool isAsyncRunning() {
+        return m_control.isRunning();
+    }
+    
+    // Requests waiting for a worker
+    int getAsyncPending() {
+        return m_control.pending() + m_io.pending();
+    }
+    
+    // Run fn(CManagerInterface*, T&) -> Manager API code asynchronously
+    template <class T, class Fn>
+    bool requestAsync(Fn fn, MT4AsyncCallback<T> done) {
+        return dispatchRequest<T>(MT4_CALL_COUNT, fn, done);
+    }
+    
+    template <class T, class Fn>
+    std::future<MT4AsyncReply<T> > requestAsync(Fn fn) {
+        MT4AsyncPromise<T> promise;
+        dispatchRequest<T>(MT4_CALL_COUNT, fn, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Connect on the control worker; value is the result of connect()
+    bool connectAsync(const char* server, MT4AsyncCallback<bool> done) {
+        std::string address = server;
+        return dispatchControl([this, address](std::string& error) {
+            return connectTo(address.c_str(), error);
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<bool> > connectAsync(const char* server) {
+        MT4AsyncPromise<bool> promise;
+        connectAsync(server, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Log in on the control worker; value is the result of login()
+    bool loginAsync(int login_id, const char* password, MT4AsyncCallback<bool> done) {
+        std::string secret = password;
+        return dispatchControl([this, login_id, secret](std::string& error) {
+            return loginTo(login_id, secret.c_str(), error);
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<bool> > loginAsync(int login_id, const char* password) {
+        MT4AsyncPromise<bool> promise;
+        loginAsync(login_id, password, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Get an account record; completes at once from the pumped account
+    // store when it is ready
+    bool getAccountAsync(int login, MT4AsyncCallback<UserRecord> done) {
+        UserRecord user;
+        if (isValid() && m_logged_in && storesLive() && m_account_store.isReady() &&
+            m_account_store.getRecord(login, user)) {
+            completeNow(done, RET_OK, "", user);
+            return true;
+        }
+        
+        return dispatchRequest<UserRecord>(MT4_CALL_USER_RECORD_GET, [login](CManagerInterface* manager, UserRecord& record) {
+            return manager->UserRecordGet(login, &record);
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<UserRecord> > getAccountAsync(int login) {
+        MT4AsyncPromise<UserRecord> promise;
+        getAccountAsync(login, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Get the margin of a login; completes at once from the local margin
+    // engine when it is ready, so many checks can be fanned out cheaply
+    bool getMarginLevelAsync(int login, MT4AsyncCallback<MT4MarginState> done) {
+        MT4MarginState state;
+        if (isValid() && m_logged_in && storesLive() && m_margin.isReady() &&
+            m_margin.getMargin(login, state)) {
+            completeNow(done, RET_OK, "", state);
+            return true;
+        }
+        
+        return dispatchRequest<MT4MarginState>(MT4_CALL_MARGIN_LEVEL_REQUEST, [login](CManagerInterface* manager, MT4MarginState& margin) {
+            MarginLevel ml;
+            int res = manager->MarginLevelRequest(login, &ml);
+            if (res == RET_OK) {
+                margin.login = login;
+                margin.balance = ml.balance;
+                margin.credit = 0;
+                margin.profit = ml.equity - ml.balance;
+                margin.equity = ml.equity;
+                margin.margin = ml.margin;
+                margin.margin_free = ml.margin_free;
+                margin.margin_level = ml.margin_level;
+            }
+            return res;
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<MT4MarginState> > getMarginLevelAsync(int login) {
+        MT4AsyncPromise<MT4MarginState> promise;
+        getMarginLevelAsync(login, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Open a trade; value is the new ticket, 0 if it was sent but its
+    // ticket was not reported
+    bool openTradeAsync(int login, const char* symbol, int cmd, double volume, double price,
+                        double sl, double tp, const char* comment, MT4AsyncCallback<int> done) {
+        TradeTransInfo trade = makeOpenTrade(login, symbol, cmd, volume, price, sl, tp, comment);
+        
+        MT4RiskRule rule;
+        int code = m_risk.check(trade, &rule);
+        if (code != RET_OK) {
+            completeNow(done, code, riskError(rule).c_str());
+            return false;
+        }
+        
+        return dispatchRequest<int>(MT4_CALL_COUNT, [this, trade](CManagerInterface* manager, int& ticket) {
+            TradeTransInfo info = trade;
+            return sendOpenTrade(manager, info, ticket);
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<int> > openTradeAsync(int login, const char* symbol, int cmd, double volume,
+                                                    double price, double sl = 0, double tp = 0,
+                                                    const char* comment = "") {
+        MT4AsyncPromise<int> promise;
+        openTradeAsync(login, symbol, cmd, volume, price, sl, tp, comment, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Close a trade
+    bool closeTradeAsync(int ticket, double price, MT4AsyncCallback<bool> done) {
+        TradeTransInfo trade = makeCloseTrade(ticket, price);
+        
+        return dispatchRequest<bool>(MT4_CALL_TRADE_TRANSACTION, [trade](CManagerInterface* manager, bool& closed) {
+            TradeTransInfo info = trade;
+            int res = manager->TradeTransaction(&info);
+            closed = res == RET_OK;
+            return res;
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<bool> > closeTradeAsync(int ticket, double price = 0) {
+        MT4AsyncPromise<bool> promise;
+        closeTradeAsync(ticket, price, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Modify the stops of a trade
+    bool modifyTradeAsync(int ticket, double sl, double tp, MT4AsyncCallback<bool> done) {
+        TradeTransInfo trade = makeModifyTrade(ticket, sl, tp);
+        
+        return dispatchRequest<bool>(MT4_CALL_TRADE_TRANSACTION, [trade](CManagerInterface* manager, bool& modified) {
+            TradeTransInfo info = trade;
+            int res = manager->TradeTransaction(&info);
+            modified = res == RET_OK;
+            return res;
+        }, done);
+    }
+    
+    std::future<MT4AsyncReply<bool> > modifyTradeAsync(int ticket, double sl, double tp) {
+        MT4AsyncPromise<bool> promise;
+        modifyTradeAsync(ticket, sl, tp, promise.getCallback());
+        return promise.getFuture();
+    }
+    
+    // Get the latency histogram of a Manager API call
+    const MT4LatencyHistogram& getCallLatency(MT4Call call) const {
+        return m_calls.get(call);
+    }
+    
+    // Write a snapshot of every latency histogram, queue depth and drop
+    // counter as one JSON object (for health and metrics endpoints).
+    // Safe to call from any thread while the connector runs.
+    MT4Writer& metricsJson(MT4Writer& w) {
+        w.append("{\"calls\":{");
+        for (int i = 0; i < MT4_CALL_COUNT; i++) {
+            if (i > 0) {
+                w.append(',');
+            }
+            w.append('"').append(MT4_CALL_NAMES[i]).append("\":");
+            MT4Format::latencyJson(w, m_calls.get((MT4Call)i));
+        }
+        
+        w.append("},\"pumping\":{\"active\":").append(m_pumping.isActive() ? "true" : "false");
+        w.append(",\"events\":").appendInt((long long)m_pumping.getEventsReceived());
+        w.append(",\"quotes\":").appendInt((long long)m_pumping.getQuotesReceived());
+        w.append(",\"trades\":").appendInt((long long)m_pumping.getTradesReceived());
+        w.append(",\"dispatch\":");
+        MT4Format::latencyJson(w, m_pumping.getDispatchLatency());
+        
+        w.append("},\"queue\":{\"depth\":").appendInt((long long)m_pump_queue.depth());
+        w.append(",\"dropped\":").appendInt((long long)m_pump_queue.dropped());
+        w.append(",\"quotes_dropped\":").appendInt((long long)m_pump_queue.quoteRing().dropped());
+        w.append(",\"trades_dropped\":").appendInt((long long)m_pump_queue.tradeRing().dropped());
+        w.append(",\"users_dropped\":").appendInt((long long)m_pump_queue.userRing().dropped());
+        w.append(",\"online_dropped\":").appendInt((long long)m_pump_queue.onlineRing().dropped());
+        w.append(",\"tick_age\":");
+        MT4Format::latencyJson(w, m_pump_queue.getTickAge());
+        
+        w.append("},\"sharded\":{\"shards\":").appendInt(m_dispatcher.getShardCount());
+        w.append(",\"delivered\":").appendInt((long long)m_dispatcher.delivered());
+        w.append(",\"depth\":").appendInt((long long)m_dispatcher.depth());
+        w.append(",\"dropped\":").appendInt((long long)m_dispatcher.dropped());
+        
+        w.append("},\"bars\":{\"symbols\":").appendInt(m_bars.getSymbolCount());
+        w.append(",\"closed\":").appendInt((long long)m_bars.getClosedCount());
+        w.append(",\"late\":").appendInt((long long)m_bars.getLateCount());
+        
+        w.append("},\"pools\":{\"accounts\":").appendInt(MT4Account::objectPool().inUse());
+        w.append(",\"symbols\":").appendInt(MT4Symbol::objectPool().inUse());
+        w.append(",\"trades\":").appendInt(MT4Trade::objectPool().inUse());
+        w.append(",\"fallbacks\":").appendInt((long long)(MT4Account::objectPool().fallbacks() +
+                                                             MT4Symbol::objectPool().fallbacks() +
+                                                             MT4Trade::objectPool().fallbacks()));
+        
+        w.append("},\"async\":{\"pending\":").appendInt(getAsyncPending());
+        w.append(",\"completed\":").appendInt((long long)(m_control.getCompletedCount() + m_io.getCompletedCount()));
+        w.append(",\"control_wait\":");
+        MT4Format::latencyJson(w, m_control.getWaitLatency());
+        w.append(",\"io_wait\":");
+        MT4Format::latencyJson(w, m_io.getWaitLatency());
+        
+        w.append("},\"risk\":{\"checked\":").appendInt((long long)m_risk.getCheckedCount());
+        for (int i = 0; i < MT4_RISK_RULE_COUNT; i++) {
+            w.append(",\"").append(MT4_RISK_RULE_NAMES[i]).append("\":");
+            w.appendInt((long long)m_risk.getRejectCount((MT4RiskRule)i));
+        }
+        
+        w.append("},\"signals\":{\"delivered\":").appendInt((long long)m_signal_feed.getSignalCount());
+        w.append(",\"duplicates\":").appendInt((long long)m_signal_feed.getDuplicateCount());
+        w.append(",\"invalid\":").appendInt((long long)m_signal_feed.getInvalidCount());
+        w.append(",\"accepted\":").appendInt((long long)m_signal_feed.getAcceptedCount());
+        w.append(",\"failed\":").appendInt((long long)m_signal_feed.getFailedCount());
+        w.append(",\"latency\":");
+        MT4Format::latencyJson(w, m_signal_feed.getLatency());
+        
+        w.append("},\"copier\":{\"masters\":").appendInt((long long)m_copier.getMasterCount());
+        w.append(",\"orders\":").appendInt((long long)m_copier.getOrderCount());
+        w.append(",\"awaiting\":").appendInt(m_copier.getAwaitingCount());
+        w.append(",\"resync_skipped\":").appendInt((long long)m_copier.getResyncSkippedCount());
+        w.append(",\"fill\":");
+        MT4Format::latencyJson(w, m_copier.getFillLatency());
+        w.append(",\"batch\":");
+        MT4Format::latencyJson(w, m_copier.getBatchLatency());
+        
+        w.append("},\"snapshot\":{\"generation\":").appendInt((long long)m_snapshot.getGeneration());
+        w.append(",\"serving\":").append(m_snapshot.isServing() ? "true" : "false");
+        w.append(",\"load_ms\":").appendDouble(m_snapshot.getLoadMilliseconds(), 3);
+        w.append(",\"saves\":").appendInt((long long)m_snapshot.getSaveCount());
+        w.append(",\"save_failures\":").appendInt((long long)m_snapshot.getSaveFailureCount());
+        w.append(",\"reconciles\":").appendInt((long long)m_snapshot.getReconcileCount());
+        w.append(",\"changed\":").appendInt((long long)m_snapshot.getChangedCount());
+        
+        w.append("},\"session\":{\"state\":").appendInt((long long)m_session.getState());
+        w.append(",\"disconnects\":").appendInt((long long)m_session.getDisconnectCount());
+        w.append(",\"attempts\":").appendInt((long long)m_session.getAttemptCount());
+        w.append(",\"outage_ms\":").appendDouble(m_session.getLastOutageMilliseconds(), 3);
+        w.append(",\"resynced_trades\":").appendInt((long long)m_session.getResyncedTrades());
+        w.append(",\"resynced_users\":").appendInt((long long)m_session.getResyncedUsers());
+        
+        w.append("},\"journal_dropped\":").appendInt((long long)m_journal.getDroppedCount());
+        return w.append('}');
     }
     
-    // Get direct access to the manager interface (for advanced operations)
+    // Get direct access to the manager interface (for advanced operations);
+    // calls on it are not serialized with the supervisor's reconnect
     CManagerInterface* getManagerInterface() {
         return m_manager;
     }
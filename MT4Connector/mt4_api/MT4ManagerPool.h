@@ -0,0 +1,367 @@
+//+------------------------------------------------------------------+
+//|                        Pool of Manager API Connections             |
+//+------------------------------------------------------------------+
+#ifndef MT4MANAGERPOOL_H
+#define MT4MANAGERPOOL_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4Credential.h"
+
+// Default time acquire() waits for a free connection
+#define MT4_POOL_ACQUIRE_TIMEOUT_MS 30000
+
+// Default time between the health checks run when a lease is returned
+#define MT4_POOL_HEALTH_CHECK_MS 60000
+
+//+------------------------------------------------------------------+
+//| MT4ManagerPool - N logged-in interfaces from one factory         |
+//| A CManagerInterface serializes its requests, so independent      |
+//| work (reporting, order execution) leases separate connections.   |
+//| Broken connections are reconnected when they are next leased or  |
+//| by healthCheck(), which runs on the thread returning a lease     |
+//| once the health check interval has passed.                       |
+//+------------------------------------------------------------------+
+class MT4ManagerPool {
+private:
+    struct Connection {
+        CManagerInterface* manager;
+        bool leased;
+        bool failed;
+    };
+    
+    CManagerFactory* m_factory;
+    std::string m_server;
+    int m_login;
+    MT4Credential m_password;
+    std::vector<Connection> m_connections;
+    std::mutex m_lock;
+    std::condition_variable m_released;
+    std::string m_last_error;
+    std::atomic<unsigned long long> m_reconnects;
+    int m_check_ms;                             // 0 = no checks on release
+    std::chrono::steady_clock::time_point m_next_check;
+    bool m_checking;
+    
+    MT4ManagerPool(const MT4ManagerPool&);
+    MT4ManagerPool& operator=(const MT4ManagerPool&);
+    
+    // Connect and log in one interface; called without m_lock held
+    int connectOne(CManagerInterface* manager) {
+        int res = manager->Connect(m_server.c_str());
+        if (res == RET_OK) {
+            MT4Credential::Plain password(m_password);
+            res = manager->Login(m_login, password.c_str());
+        }
+        return res;
+    }
+    
+    // Re-establish a leased connection; returns false if still down
+    bool reconnect(CManagerInterface* manager) {
+        manager->Disconnect();
+        m_reconnects++;
+        
+        int res = connectOne(manager);
+        if (res != RET_OK) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_last_error = manager->ErrorDescription(res);
+            return false;
+        }
+        return true;
+    }
+    
+    // Find a free connection and mark it leased (caller holds m_lock)
+    Connection* takeFree() {
+        for (size_t i = 0; i < m_connections.size(); i++) {
+            if (!m_connections[i].leased) {
+                m_connections[i].leased = true;
+                return &m_connections[i];
+            }
+        }
+        return NULL;
+    }
+    
+    // Bring a freshly leased connection back up if it needs it; failed
+    // was read with the lease, under m_lock
+    CManagerInterface* prepare(CManagerInterface* manager, bool failed) {
+        if ((failed || !manager->IsConnected()) && !reconnect(manager)) {
+            giveBack(manager, true);
+            return NULL;
+        }
+        return manager;
+    }
+    
+    // Mark a leased connection free again
+    void giveBack(CManagerInterface* manager, bool failed) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            
+            for (size_t i = 0; i < m_connections.size(); i++) {
+                if (m_connections[i].manager == manager) {
+                    m_connections[i].leased = false;
+                    m_connections[i].failed = failed;
+                    break;
+                }
+            }
+        }
+        m_released.notify_one();
+    }
+    
+    // Claim the next scheduled health check if it is due
+    bool checkDue() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        if (m_check_ms <= 0 || m_checking || m_connections.empty() ||
+            std::chrono::steady_clock::now() < m_next_check) {
+            return false;
+        }
+        m_checking = true;
+        return true;
+    }
+
+public:
+    MT4ManagerPool()
+        : m_factory(NULL), m_login(0), m_reconnects(0), m_check_ms(MT4_POOL_HEALTH_CHECK_MS), m_checking(false) {}
+    
+    ~MT4ManagerPool() {
+        close();
+    }
+    
+    // Create and log in size connections
+    bool open(CManagerFactory& factory, const char* server, int login,
+              const char* password, int size) {
+        close();
+        
+        m_factory = &factory;
+        m_server = server;
+        m_login = login;
+        m_password.set(password);
+        
+        for (int i = 0; i < size; i++) {
+            CManagerInterface* manager = factory.Create(ManAPIVersion);
+            if (manager == NULL) {
+                m_last_error = "Failed to create pooled interface";
+                close();
+                return false;
+            }
+            
+            int res = connectOne(manager);
+            if (res != RET_OK) {
+                m_last_error = manager->ErrorDescription(res);
+                manager->Release();
+                close();
+                return false;
+            }
+            
+            Connection conn = { manager, false, false };
+            m_connections.push_back(conn);
+        }
+        
+        m_next_check = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_check_ms);
+        return true;
+    }
+    
+    // Disconnect and release every connection; no lease may be outstanding
+    void close() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        for (size_t i = 0; i < m_connections.size(); i++) {
+            m_connections[i].manager->Disconnect();
+            m_connections[i].manager->Release();
+        }
+        m_connections.clear();
+        m_password.clear();
+    }
+    
+    // Lease a connection, waiting up to timeout_ms; NULL on timeout or
+    // when a broken connection could not be re-established
+    CManagerInterface* acquire(int timeout_ms = MT4_POOL_ACQUIRE_TIMEOUT_MS) {
+        CManagerInterface* manager;
+        bool failed;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            
+            if (m_connections.empty()) {
+                m_last_error = "Connection pool is not open";
+                return NULL;
+            }
+            
+            Connection* conn = NULL;
+            m_released.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]() {
+                conn = takeFree();
+                return conn != NULL;
+            });
+            
+            if (conn == NULL) {
+                m_last_error = "Timed out waiting for a pooled connection";
+                return NULL;
+            }
+            manager = conn->manager;
+            failed = conn->failed;
+        }
+        
+        return prepare(manager, failed);
+    }
+    
+    // Lease a connection only if one is free right now
+    CManagerInterface* tryAcquire() {
+        CManagerInterface* manager;
+        bool failed;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            Connection* conn = takeFree();
+            if (conn == NULL) {
+                return NULL;
+            }
+            manager = conn->manager;
+            failed = conn->failed;
+        }
+        
+        return prepare(manager, failed);
+    }
+    
+    // Return a leased connection; failed forces a reconnect on next lease.
+    // Runs the health check here when it is due.
+    void release(CManagerInterface* manager, bool failed = false) {
+        giveBack(manager, failed);
+        
+        if (checkDue()) {
+            healthCheck();
+        }
+    }
+    
+    // Ping every idle connection and reconnect the dead ones.
+    // Returns the number of checked connections that are healthy.
+    int healthCheck() {
+        std::vector<Connection> idle;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_checking = true;
+            m_next_check = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_check_ms);
+            
+            for (size_t i = 0; i < m_connections.size(); i++) {
+                if (!m_connections[i].leased) {
+                    m_connections[i].leased = true;
+                    idle.push_back(m_connections[i]);
+                }
+            }
+        }
+        
+        int healthy = 0;
+        
+        for (size_t i = 0; i < idle.size(); i++) {
+            CManagerInterface* manager = idle[i].manager;
+            bool ok = !idle[i].failed && manager->IsConnected() && manager->Ping() == RET_OK;
+            
+            if (!ok) {
+                ok = reconnect(manager);
+            }
+            
+            giveBack(manager, !ok);
+            if (ok) {
+                healthy++;
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_checking = false;
+        return healthy;
+    }
+    
+    // Time between the health checks run on release(); 0 turns them off
+    void setHealthCheckInterval(int interval_ms) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_check_ms = interval_ms;
+        m_next_check = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval_ms);
+    }
+    
+    // Number of connections in the pool
+    int size() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return (int)m_connections.size();
+    }
+    
+    // Number of connections not currently leased
+    int available() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        int free_count = 0;
+        for (size_t i = 0; i < m_connections.size(); i++) {
+            if (!m_connections[i].leased) {
+                free_count++;
+            }
+        }
+        return free_count;
+    }
+    
+    // Number of reconnect attempts since open()
+    unsigned long long getReconnectCount() const {
+        return m_reconnects;
+    }
+    
+    // Get last error message
+    std::string getLastError() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_last_error;
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4ManagerLease - Scoped lease of one pooled connection          |
+//+------------------------------------------------------------------+
+class MT4ManagerLease {
+private:
+    MT4ManagerPool* m_pool;                 // NULL when m_manager is not pooled
+    CManagerInterface* m_manager;
+    bool m_failed;
+    std::unique_lock<std::recursive_mutex> m_fallback_lock;  // held while using the fallback
+    
+    MT4ManagerLease(const MT4ManagerLease&);
+    MT4ManagerLease& operator=(const MT4ManagerLease&);
+
+public:
+    explicit MT4ManagerLease(MT4ManagerPool& pool, int timeout_ms = MT4_POOL_ACQUIRE_TIMEOUT_MS)
+        : m_pool(&pool), m_manager(pool.acquire(timeout_ms)), m_failed(false) {}
+    
+    // Lease a pooled connection if one is free right now, otherwise use
+    // fallback (never released) instead of waiting for a busy pool.
+    // fallback_lock, when given, is held for as long as fallback is used.
+    MT4ManagerLease(MT4ManagerPool& pool, CManagerInterface* fallback,
+                    std::recursive_mutex* fallback_lock = NULL)
+        : m_pool(NULL), m_manager(NULL), m_failed(false) {
+        if (pool.size() > 0 && (m_manager = pool.tryAcquire()) != NULL) {
+            m_pool = &pool;
+        } else {
+            m_manager = fallback;
+            if (fallback_lock != NULL) {
+                m_fallback_lock = std::unique_lock<std::recursive_mutex>(*fallback_lock);
+            }
+        }
+    }
+    
+    ~MT4ManagerLease() {
+        if (m_manager != NULL && m_pool != NULL) {
+            m_pool->release(m_manager, m_failed);
+        }
+    }
+    
+    // Check if a connection was leased
+    bool isValid() const {
+        return m_manager != NULL;
+    }
+    
+    // Flag the connection as broken so it is reconnected before reuse
+    void markFailed() {
+        m_failed = true;
+    }
+    
+    CManagerInterface* get() const { return m_manager; }
+    CManagerInterface* operator->() const { return m_manager; }
+};
+
+#endif // MT4MANAGERPOOL_H
@@ -0,0 +1,209 @@
+//+------------------------------------------------------------------+
+//|                                  Memory-Mapped File (Read/Append) |
+//+------------------------------------------------------------------+
+#ifndef MT4MAPPEDFILE_H
+#define MT4MAPPEDFILE_H
+
+#include <windows.h>
+#include <stdint.h>
+
+//+------------------------------------------------------------------+
+//| MT4MappedFile - Whole-file mapping of a disk file                |
+//| Read mode maps the file as it is; write mode maps it read/write  |
+//| and can grow it with resize(). Growing remaps the view, so the   |
+//| data() pointer changes and must be re-read after every resize.   |
+//| Not thread-safe.                                                 |
+//+------------------------------------------------------------------+
+class MT4MappedFile {
+private:
+    HANDLE m_file;
+    HANDLE m_mapping;
+    char* m_data;
+    uint64_t m_size;
+    bool m_writable;
+    
+    MT4MappedFile(const MT4MappedFile&);
+    MT4MappedFile& operator=(const MT4MappedFile&);
+    
+    bool map(uint64_t size) {
+        if (size == 0) {
+            return true;                    // empty files cannot be mapped
+        }
+        
+        m_mapping = CreateFileMappingA(m_file, NULL, m_writable ? PAGE_READWRITE : PAGE_READONLY,
+                                       (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+        if (m_mapping == NULL) {
+            return false;
+        }
+        
+        m_data = (char*)MapViewOfFile(m_mapping, m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, (size_t)size);
+        if (m_data == NULL) {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+            return false;
+        }
+        
+        m_size = size;
+        return true;
+    }
+    
+    void unmap() {
+        if (m_data != NULL) {
+            UnmapViewOfFile(m_data);
+            m_data = NULL;
+        }
+        if (m_mapping != NULL) {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+        }
+        m_size = 0;
+    }
+    
+    bool setLength(uint64_t size) {
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)size;
+        return SetFilePointerEx(m_file, pos, NULL, FILE_BEGIN) && SetEndOfFile(m_file);
+    }
+
+public:
+    MT4MappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_data(NULL), m_size(0), m_writable(false) {}
+    
+    ~MT4MappedFile() {
+        close();
+    }
+    
+    // Map an existing file read-only; other processes may keep writing it
+    bool openRead(const char* path) {
+        close();
+        
+        m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        LARGE_INTEGER size;
+        m_writable = false;
+        
+        if (!GetFileSizeEx(m_file, &size) || !map((uint64_t)size.QuadPart)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+    
+    // Open or create a file for writing, at least min_size bytes long
+    bool openWrite(const char* path, uint64_t min_size) {
+        close();
+        
+        m_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                             NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        LARGE_INTEGER size;
+        m_writable = true;
+        
+        if (!GetFileSizeEx(m_file, &size)) {
+            close();
+            return false;
+        }
+        
+        uint64_t length = (uint64_t)size.QuadPart;
+        if (length < min_size) {
+            length = min_size;
+        }
+        
+        if (!setLength(length) || !map(length)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+    
+    // Grow (or shrink) a writable file and remap it; on failure the
+    // previous size is mapped again
+    bool resize(uint64_t size) {
+        if (!m_writable || m_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        uint64_t previous = m_size;
+        unmap();
+        
+        if (setLength(size) && map(size)) {
+            return true;
+        }
+        
+        setLength(previous);
+        map(previous);
+        return false;
+    }
+    
+    // Unmap, cut the file to length bytes and close it. The file is
+    // closed either way; false if it could not be cut, which Windows
+    // refuses while another process still maps it.
+    bool closeAt(uint64_t length) {
+        bool cut = true;
+        if (m_writable && m_file != INVALID_HANDLE_VALUE) {
+            unmap();
+            cut = setLength(length) != 0;
+        }
+        close();
+        return cut;
+    }
+    
+    // Cut a closed file to length bytes; false while it is mapped elsewhere
+    static bool truncate(const char* path, uint64_t length) {
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)length;
+        bool cut = SetFilePointerEx(file, pos, NULL, FILE_BEGIN) && SetEndOfFile(file);
+        CloseHandle(file);
+        return cut;
+    }
+    
+    void close() {
+        unmap();
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+        m_writable = false;
+    }
+    
+    // Write dirty pages of [offset, offset + length) back to disk
+    bool flush(uint64_t offset, uint64_t length) {
+        if (m_data == NULL || offset >= m_size) {
+            return false;
+        }
+        if (length > m_size - offset) {
+            length = m_size - offset;
+        }
+        return FlushViewOfFile(m_data + offset, (size_t)length) != 0;
+    }
+    
+    bool isOpen() const {
+        return m_file != INVALID_HANDLE_VALUE;
+    }
+    
+    char* data() {
+        return m_data;
+    }
+    
+    const char* data() const {
+        return m_data;
+    }
+    
+    uint64_t size() const {
+        return m_size;
+    }
+};
+
+#endif // MT4MAPPEDFILE_H
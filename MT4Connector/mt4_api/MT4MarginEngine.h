@@ -0,0 +1,614 @@
+//+------------------------------------------------------------------+
+//|                          Incremental Local Margin/Equity Engine   |
+//+------------------------------------------------------------------+
+#ifndef MT4MARGINENGINE_H
+#define MT4MARGINENGINE_H
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+
+// Relative equity/margin difference above which reconcile() reports drift
+#define MT4_MARGIN_DRIFT_TOLERANCE 0.001
+
+//+------------------------------------------------------------------+
+//| MT4MarginState - Locally computed margin figures of one account  |
+//+------------------------------------------------------------------+
+struct MT4MarginState {
+    int login;
+    double balance;
+    double credit;
+    double profit;              // floating profit of open positions
+    double equity;
+    double margin;
+    double margin_free;
+    double margin_level;        // percent, 0 when no margin is used
+};
+
+//+------------------------------------------------------------------+
+//| MT4MarginEngine - Equity and margin without MarginLevelRequest   |
+//| Accounts, symbol specifications and open positions come from the |
+//| pumping feed. On every tick only the positions of that symbol    |
+//| are revalued, and their accounts adjusted by the difference.     |
+//| Profit conversion uses the symbol tick value, margin is taken to |
+//| the group currency at the cross quote read when the position is  |
+//| revalued, and hedged margin is not netted, so reconcile()        |
+//| periodically compares a slice of accounts with                   |
+//| MarginLevelRequest and reports the drift.                        |
+//+------------------------------------------------------------------+
+class MT4MarginEngine : public MT4PumpListener {
+private:
+    struct SymbolParams {
+        bool valid;
+        int margin_mode;
+        double contract_size;
+        double tick_value;
+        double tick_size;
+        double margin_initial;
+        double margin_divider;
+        char margin_currency[12];
+    };
+    
+    struct Position {
+        int login;
+        int symbol_id;
+        int cmd;
+        double lots;
+        double open_price;
+        double fixed;           // commission + swaps + taxes
+        double profit;
+        double margin;
+    };
+    
+    struct Account {
+        double balance;
+        double credit;
+        int leverage;
+        char currency[12];          // deposit currency, empty when unknown
+        double profit;
+        double margin;
+        std::vector<int> tickets;   // open positions of the login
+    };
+    
+    MT4QuoteTable& m_quotes;
+    SymbolParams m_symbols[MT4_MAX_SYMBOLS];
+    std::vector<int> m_symbol_positions[MT4_MAX_SYMBOLS];   // symbol id -> tickets
+    std::unordered_map<int, Position> m_positions;           // ticket -> position
+    std::unordered_map<int, Account> m_accounts;             // login -> account
+    std::unordered_map<std::string, std::string> m_group_currency;   // group -> currency
+    mutable std::shared_mutex m_lock;
+    std::atomic<bool> m_ready;
+    
+    // Reconciliation state
+    std::vector<int> m_reconcile_logins;
+    size_t m_reconcile_cursor;
+    std::atomic<unsigned long long> m_reconciled;
+    std::atomic<unsigned long long> m_drifted;
+    double m_max_drift;
+    
+    MT4MarginEngine(const MT4MarginEngine&);
+    MT4MarginEngine& operator=(const MT4MarginEngine&);
+    
+    static bool isMarketPosition(int cmd) {
+        return cmd == OP_BUY || cmd == OP_SELL;
+    }
+    
+    void setSymbol(const ConSymbol& cs) {
+        int id = m_quotes.registerSymbol(cs.symbol);
+        if (id < 0) {
+            return;
+        }
+        
+        SymbolParams& p = m_symbols[id];
+        p.valid = true;
+        p.margin_mode = cs.margin_mode;
+        p.contract_size = cs.contract_size;
+        p.tick_value = cs.tick_value;
+        p.tick_size = cs.tick_size;
+        p.margin_initial = cs.margin_initial;
+        p.margin_divider = cs.margin_divider;
+        memcpy(p.margin_currency, cs.margin_currency, sizeof(p.margin_currency));
+        p.margin_currency[sizeof(p.margin_currency) - 1] = '\0';
+    }
+    
+    void setGroups(const ConGroup* groups, int group_total) {
+        m_group_currency.clear();
+        for (int i = 0; i < group_total; i++) {
+            m_group_currency[std::string(groups[i].group, strnlen(groups[i].group, sizeof(groups[i].group)))] =
+                std::string(groups[i].currency, strnlen(groups[i].currency, sizeof(groups[i].currency)));
+        }
+    }
+    
+    // Take the deposit currency of the user's group; true if it changed
+    bool setCurrencyLocked(Account& acc, const UserRecord& user) const {
+        char currency[sizeof(acc.currency)] = {0};
+        std::unordered_map<std::string, std::string>::const_iterator it =
+            m_group_currency.find(std::string(user.group, strnlen(user.group, sizeof(user.group))));
+        if (it != m_group_currency.end()) {
+            strncpy(currency, it->second.c_str(), sizeof(currency) - 1);
+        }
+        
+        if (strncmp(acc.currency, currency, sizeof(currency)) == 0) {
+            return false;
+        }
+        memcpy(acc.currency, currency, sizeof(currency));
+        return true;
+    }
+    
+    // Rate from the margin currency of a position's symbol to the
+    // deposit currency, through the cross quote in either direction.
+    // Buys take the dearer side. 1 when the currencies match or are
+    // unknown, or no cross has quoted yet.
+    double marginRate(const Position& pos, const Account& acc) const {
+        const SymbolParams& p = m_symbols[pos.symbol_id];
+        if (p.margin_currency[0] == '\0' || acc.currency[0] == '\0' ||
+            strncmp(p.margin_currency, acc.currency, sizeof(acc.currency)) == 0) {
+            return 1.0;
+        }
+        
+        char cross[32];
+        MT4Quote quote;
+        snprintf(cross, sizeof(cross), "%s%s", p.margin_currency, acc.currency);
+        if (m_quotes.read(cross, quote) && quote.bid > 0 && quote.ask > 0) {
+            return pos.cmd == OP_BUY ? quote.ask : quote.bid;
+        }
+        
+        snprintf(cross, sizeof(cross), "%s%s", acc.currency, p.margin_currency);
+        if (m_quotes.read(cross, quote) && quote.bid > 0 && quote.ask > 0) {
+            return 1.0 / (pos.cmd == OP_BUY ? quote.bid : quote.ask);
+        }
+        return 1.0;
+    }
+    
+    // Floating profit of a position at the given prices
+    double positionProfit(const Position& pos, double bid, double ask) const {
+        const SymbolParams& p = m_symbols[pos.symbol_id];
+        double diff = (pos.cmd == OP_BUY) ? bid - pos.open_price : pos.open_price - ask;
+        
+        if (p.tick_size > 0 && p.tick_value > 0) {
+            return diff / p.tick_size * p.tick_value * pos.lots + pos.fixed;
+        }
+        return diff * p.contract_size * pos.lots + pos.fixed;
+    }
+    
+    // Margin required by a position following the symbol margin mode,
+    // in the deposit currency of acc
+    double positionMargin(const Position& pos, const Account& acc, double price) const {
+        const SymbolParams& p = m_symbols[pos.symbol_id];
+        int leverage = acc.leverage;
+        double base = pos.lots * p.contract_size;
+        double margin;
+        
+        switch (p.margin_mode) {
+            case MARGIN_CALC_CFD:
+                margin = base * price;
+                break;
+            case MARGIN_CALC_FUTURES:
+                margin = pos.lots * p.margin_initial;
+                break;
+            case MARGIN_CALC_CFDINDEX:
+                margin = (p.tick_size > 0) ? base * price * p.tick_value / p.tick_size : base * price;
+                break;
+            case MARGIN_CALC_CFDLEVERAGE:
+                margin = (leverage > 0) ? base * price / leverage : base * price;
+                break;
+            default:                // MARGIN_CALC_FOREX
+                margin = (leverage > 0) ? base / leverage : base;
+                break;
+        }
+        
+        if (p.margin_divider > 0) {
+            margin /= p.margin_divider;
+        }
+        return margin * marginRate(pos, acc);
+    }
+    
+    // Price a position's margin is taken at: the side it would close
+    // against, or the open price until its symbol has ticked
+    static double marginPrice(const Position& pos, double bid, double ask) {
+        return pos.cmd == OP_BUY ? ask : bid;
+    }
+    
+    double marginPrice(const Position& pos) const {
+        MT4Quote quote;
+        return m_quotes.read(pos.symbol_id, quote) ? marginPrice(pos, quote.bid, quote.ask) : pos.open_price;
+    }
+    
+    // Revalue one position and push the difference into its account
+    void revalueLocked(Position& pos, Account& acc, double bid, double ask) {
+        double profit = positionProfit(pos, bid, ask);
+        double margin = positionMargin(pos, acc, marginPrice(pos, bid, ask));
+        
+        acc.profit += profit - pos.profit;
+        acc.margin += margin - pos.margin;
+        pos.profit = profit;
+        pos.margin = margin;
+    }
+    
+    void removePositionLocked(int ticket) {
+        std::unordered_map<int, Position>::iterator it = m_positions.find(ticket);
+        if (it == m_positions.end()) {
+            return;
+        }
+        
+        Position& pos = it->second;
+        std::unordered_map<int, Account>::iterator acc = m_accounts.find(pos.login);
+        if (acc != m_accounts.end()) {
+            acc->second.profit -= pos.profit;
+            acc->second.margin -= pos.margin;
+            eraseTicket(acc->second.tickets, ticket);
+        }
+        
+        eraseTicket(m_symbol_positions[pos.symbol_id], ticket);
+        m_positions.erase(it);
+    }
+    
+    // Drop an account together with its open positions
+    void removeAccountLocked(int login) {
+        std::unordered_map<int, Account>::iterator acc = m_accounts.find(login);
+        if (acc == m_accounts.end()) {
+            return;
+        }
+        
+        std::vector<int> tickets;
+        tickets.swap(acc->second.tickets);
+        for (size_t i = 0; i < tickets.size(); i++) {
+            removePositionLocked(tickets[i]);
+        }
+        m_accounts.erase(login);
+    }
+    
+    static void eraseTicket(std::vector<int>& list, int ticket) {
+        for (size_t i = 0; i < list.size(); i++) {
+            if (list[i] == ticket) {
+                list[i] = list.back();
+                list.pop_back();
+                return;
+            }
+        }
+    }
+    
+    void upsertPositionLocked(const TradeRecord& trade) {
+        removePositionLocked(trade.order);
+        
+        if (!isMarketPosition(trade.cmd) || trade.close_time != 0) {
+            return;
+        }
+        
+        int id = m_quotes.findSymbol(trade.symbol);
+        if (id < 0 || !m_symbols[id].valid) {
+            return;
+        }
+        
+        Position pos;
+        pos.login = trade.login;
+        pos.symbol_id = id;
+        pos.cmd = trade.cmd;
+        pos.lots = trade.volume / 100.0;
+        pos.open_price = trade.open_price;
+        pos.fixed = trade.commission + trade.storage + trade.taxes;
+        pos.profit = 0;
+        pos.margin = 0;
+        
+        Account& acc = m_accounts[trade.login];
+        
+        // Until the first tick the server-side profit is the best estimate
+        MT4Quote quote;
+        if (m_quotes.read(id, quote)) {
+            revalueLocked(pos, acc, quote.bid, quote.ask);
+        } else {
+            pos.profit = trade.profit + pos.fixed;
+            pos.margin = positionMargin(pos, acc, trade.open_price);
+            acc.profit += pos.profit;
+            acc.margin += pos.margin;
+        }
+        
+        m_positions[trade.order] = pos;
+        m_symbol_positions[id].push_back(trade.order);
+        acc.tickets.push_back(trade.order);
+    }
+    
+    void setAccountLocked(const UserRecord& user) {
+        Account& acc = m_accounts[user.login];
+        bool currency_changed = setCurrencyLocked(acc, user);
+        
+        if (acc.leverage != user.leverage || currency_changed) {
+            // Leverage and currency change every margin of the account; rebuild it
+            acc.leverage = user.leverage;
+            acc.margin = 0;
+            for (size_t i = 0; i < acc.tickets.size(); i++) {
+                Position& pos = m_positions[acc.tickets[i]];
+                pos.margin = positionMargin(pos, acc, marginPrice(pos));
+                acc.margin += pos.margin;
+            }
+        }
+        
+        acc.balance = user.balance;
+        acc.credit = user.credit;
+    }
+    
+    void fillState(int login, const Account& acc, MT4MarginState& state) const {
+        state.login = login;
+        state.balance = acc.balance;
+        state.credit = acc.credit;
+        state.profit = acc.profit;
+        state.equity = acc.balance + acc.credit + acc.profit;
+        state.margin = acc.margin;
+        state.margin_free = state.equity - acc.margin;
+        state.margin_level = (acc.margin > 0) ? state.equity / acc.margin * 100.0 : 0.0;
+    }
+    
+    static double relativeDiff(double local, double server) {
+        double scale = fabs(server) > 1.0 ? fabs(server) : 1.0;
+        return fabs(local - server) / scale;
+    }
+
+public:
+    explicit MT4MarginEngine(MT4QuoteTable& quotes)
+        : m_quotes(quotes), m_ready(false), m_reconcile_cursor(0),
+          m_reconciled(0), m_drifted(0), m_max_drift(0) {
+        memset(m_symbols, 0, sizeof(m_symbols));
+    }
+    
+    // Check whether the engine has been bootstrapped
+    bool isReady() const {
+        return m_ready;
+    }
+    
+    // Get locally computed margin figures; false for unknown logins
+    bool getMargin(int login, MT4MarginState& state) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        std::unordered_map<int, Account>::const_iterator it = m_accounts.find(login);
+        if (it == m_accounts.end()) {
+            return false;
+        }
+        
+        fillState(login, it->second, state);
+        return true;
+    }
+    
+    // Figures of login after opening lots of symbol_id (OP_BUY or
+    // OP_SELL) at price; false for unknown logins or symbols
+    bool projectMargin(int login, int symbol_id, int cmd, double lots, double price,
+                       MT4MarginState& state) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        if (symbol_id < 0 || symbol_id >= MT4_MAX_SYMBOLS || !m_symbols[symbol_id].valid) {
+            return false;
+        }
+        
+        std::unordered_map<int, Account>::const_iterator it = m_accounts.find(login);
+        if (it == m_accounts.end()) {
+            return false;
+        }
+        
+        Position pos = Position();
+        pos.login = login;
+        pos.symbol_id = symbol_id;
+        pos.cmd = cmd;
+        pos.lots = lots;
+        pos.open_price = price;
+        
+        fillState(login, it->second, state);
+        double margin = positionMargin(pos, it->second, price);
+        state.margin += margin;
+        state.margin_free -= margin;
+        state.margin_level = (state.margin > 0) ? state.equity / state.margin * 100.0 : 0.0;
+        return true;
+    }
+    
+    // Compare up to max_accounts accounts (round-robin) with
+    // MarginLevelRequest on manager. Returns how many drifted beyond
+    // tolerance; drifted accounts adopt the balance, credit and leverage
+    // of a fresh UserRecordGet.
+    int reconcile(CManagerInterface* manager, int max_accounts,
+                  double tolerance = MT4_MARGIN_DRIFT_TOLERANCE) {
+        std::vector<int> logins;
+        {
+            std::unique_lock<std::shared_mutex> lock(m_lock);
+            
+            // Refresh the round-robin order when accounts came or went
+            if (m_reconcile_logins.size() != m_accounts.size()) {
+                m_reconcile_logins.clear();
+                for (std::unordered_map<int, Account>::const_iterator it = m_accounts.begin(); it != m_accounts.end(); ++it) {
+                    m_reconcile_logins.push_back(it->first);
+                }
+            }
+            
+            for (int i = 0; i < max_accounts && !m_reconcile_logins.empty(); i++) {
+                if (m_reconcile_cursor >= m_reconcile_logins.size()) {
+                    m_reconcile_cursor = 0;
+                }
+                logins.push_back(m_reconcile_logins[m_reconcile_cursor++]);
+            }
+        }
+        
+        int drifted = 0;
+        
+        for (size_t i = 0; i < logins.size(); i++) {
+            MarginLevel ml;
+            if (manager->MarginLevelRequest(logins[i], &ml) != RET_OK) {
+                continue;
+            }
+            
+            MT4MarginState local;
+            if (!getMargin(logins[i], local)) {
+                continue;
+            }
+            
+            double drift = relativeDiff(local.equity, ml.equity);
+            double margin_drift = relativeDiff(local.margin, ml.margin);
+            if (margin_drift > drift) {
+                drift = margin_drift;
+            }
+            
+            m_reconciled++;
+            if (drift > tolerance) {
+                drifted++;
+                m_drifted++;
+                
+                // MarginLevel has no credit, so take the whole user record
+                UserRecord user;
+                bool loaded = manager->UserRecordGet(logins[i], &user) == RET_OK;
+                
+                std::unique_lock<std::shared_mutex> lock(m_lock);
+                if (drift > m_max_drift) {
+                    m_max_drift = drift;
+                }
+                
+                if (m_accounts.find(logins[i]) == m_accounts.end()) {
+                    continue;
+                }
+                if (loaded) {
+                    setAccountLocked(user);
+                } else {
+                    m_accounts[logins[i]].balance = ml.balance;
+                }
+            }
+        }
+        
+        return drifted;
+    }
+    
+    // Reconciliation statistics
+    unsigned long long getReconciledCount() const { return m_reconciled; }
+    unsigned long long getDriftCount() const { return m_drifted; }
+    double getMaxDrift() const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        return m_max_drift;
+    }
+    
+    // Replace symbols, accounts and positions with full lists; without
+    // groups the account currencies are unknown and margin is unconverted
+    void load(const ConSymbol* symbols, int symbol_total, const ConGroup* groups, int group_total,
+              const UserRecord* users, int user_total, const TradeRecord* trades, int trade_total) {
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        m_positions.clear();
+        m_accounts.clear();
+        m_reconcile_logins.clear();
+        for (int i = 0; i < MT4_MAX_SYMBOLS; i++) {
+            m_symbol_positions[i].clear();
+        }
+        
+        for (int i = 0; i < symbol_total; i++) {
+            setSymbol(symbols[i]);
+        }
+        setGroups(groups, groups != NULL ? group_total : 0);
+        
+        for (int i = 0; i < user_total; i++) {
+            Account& acc = m_accounts[users[i].login];
+            acc.balance = users[i].balance;
+            acc.credit = users[i].credit;
+            acc.leverage = users[i].leverage;
+            setCurrencyLocked(acc, users[i]);
+        }
+        
+        m_positions.reserve(trade_total);
+        for (int i = 0; i < trade_total; i++) {
+            upsertPositionLocked(trades[i]);
+        }
+        
+        m_ready = true;
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int symbol_total = 0;
+        int group_total = 0;
+        int user_total = 0;
+        int trade_total = 0;
+        ConSymbol* syms = pump->SymbolsGetAll(&symbol_total);
+        ConGroup* groups = pump->GroupsGet(&group_total);
+        UserRecord* users = pump->UsersGet(&user_total);
+        TradeRecord* trades = pump->TradesGet(&trade_total);
+        
+        load(syms, syms != NULL ? symbol_total : 0, groups, group_total,
+             users, users != NULL ? user_total : 0, trades, trades != NULL ? trade_total : 0);
+        
+        if (syms) {
+            pump->MemFree(syms);
+        }
+        if (groups) {
+            pump->MemFree(groups);
+        }
+        if (users) {
+            pump->MemFree(users);
+        }
+        if (trades) {
+            pump->MemFree(trades);
+        }
+    }
+    
+    // Symbol settings may have changed during the gap, and the resynced
+    // positions of symbols added in it were skipped; the pumping lists
+    // are local, so rebuild from them
+    void onPumpingResumed(CManagerInterface* pump) {
+        onPumpingStarted(pump);
+    }
+    
+    void onPumpingStopped() {
+        m_ready = false;
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        for (int i = 0; i < count; i++) {
+            int id = m_quotes.findSymbol(quotes[i].symbol);
+            if (id < 0) {
+                continue;
+            }
+            
+            std::vector<int>& tickets = m_symbol_positions[id];
+            for (size_t j = 0; j < tickets.size(); j++) {
+                std::unordered_map<int, Position>::iterator pos = m_positions.find(tickets[j]);
+                if (pos == m_positions.end()) {
+                    continue;
+                }
+                std::unordered_map<int, Account>::iterator acc = m_accounts.find(pos->second.login);
+                if (acc != m_accounts.end()) {
+                    revalueLocked(pos->second, acc->second, quotes[i].bid, quotes[i].ask);
+                }
+            }
+        }
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        for (int i = 0; i < count; i++) {
+            if (events[i].type == TRANS_DELETE) {
+                removePositionLocked(events[i].trade.order);
+            } else {
+                upsertPositionLocked(events[i].trade);
+            }
+        }
+    }
+    
+    void onUsers(const MT4UserEvent* events, int count) {
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        for (int i = 0; i < count; i++) {
+            if (events[i].type == TRANS_DELETE) {
+                removeAccountLocked(events[i].user.login);
+            } else {
+                setAccountLocked(events[i].user);
+            }
+        }
+    }
+};
+
+#endif // MT4MARGINENGINE_H
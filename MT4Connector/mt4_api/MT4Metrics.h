@@ -0,0 +1,246 @@
+//+------------------------------------------------------------------+
+//|                         Lock-free Latency Histograms and Metrics |
+//+------------------------------------------------------------------+
+#ifndef MT4METRICS_H
+#define MT4METRICS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+// Sub-buckets per power of two (2^4 = 16, about 6% relative error)
+// and the largest recorded value (2^40 ns, about 18 minutes)
+#define MT4_HIST_SUB_BITS   4
+#define MT4_HIST_MAX_BITS   40
+#define MT4_HIST_SUB_COUNT  (1 << MT4_HIST_SUB_BITS)
+#define MT4_HIST_BUCKETS    ((MT4_HIST_MAX_BITS - MT4_HIST_SUB_BITS + 1) * MT4_HIST_SUB_COUNT)
+
+// Monotonic clock in nanoseconds for latency measurement
+inline uint64_t MT4MetricsNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Index of the highest set bit; value must not be 0
+inline int MT4HighBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, (unsigned long)(value >> 32))) {
+        return (int)index + 32;
+    }
+    _BitScanReverse(&index, (unsigned long)value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+//+------------------------------------------------------------------+
+//| MT4LatencySummary - Percentiles of a histogram in microseconds   |
+//| Percentiles report the upper edge of their bucket (capped by the |
+//| recorded maximum), so they never understate a latency.           |
+//+------------------------------------------------------------------+
+struct MT4LatencySummary {
+    uint64_t count;
+    double mean_us;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+};
+
+//+------------------------------------------------------------------+
+//| MT4LatencyHistogram - HDR-style log-linear histogram of ns       |
+//| Values below 16 ns have their own bucket; above that every power |
+//| of two is split into 16 linear sub-buckets. record() is a few    |
+//| relaxed atomic adds and may be called from any number of threads |
+//| at once; summaries read the counters without stopping writers.   |
+//+------------------------------------------------------------------+
+class MT4LatencyHistogram {
+private:
+    std::atomic<uint64_t> m_buckets[MT4_HIST_BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+    
+    MT4LatencyHistogram(const MT4LatencyHistogram&);
+    MT4LatencyHistogram& operator=(const MT4LatencyHistogram&);
+    
+    // Largest value mapped to bucket index
+    static uint64_t bucketTop(int index) {
+        if (index < MT4_HIST_SUB_COUNT) {
+            return (uint64_t)index;
+        }
+        int shift = index / MT4_HIST_SUB_COUNT - 1;
+        uint64_t sub = (uint64_t)(index % MT4_HIST_SUB_COUNT);
+        return ((MT4_HIST_SUB_COUNT + sub + 1) << shift) - 1;
+    }
+
+public:
+    MT4LatencyHistogram() : m_count(0), m_sum(0), m_max(0) {
+        for (int i = 0; i < MT4_HIST_BUCKETS; i++) {
+            m_buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    
+    static int bucketOf(uint64_t value) {
+        if (value < MT4_HIST_SUB_COUNT) {
+            return (int)value;
+        }
+        
+        int high = MT4HighBit(value);
+        if (high >= MT4_HIST_MAX_BITS) {
+            return MT4_HIST_BUCKETS - 1;
+        }
+        
+        int shift = high - MT4_HIST_SUB_BITS;
+        return (shift + 1) * MT4_HIST_SUB_COUNT + (int)((value >> shift) - MT4_HIST_SUB_COUNT);
+    }
+    
+    // Record one latency in nanoseconds
+    void record(uint64_t nanos) {
+        m_buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(nanos, std::memory_order_relaxed);
+        
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (nanos > max && !m_max.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+        }
+    }
+    
+    // Record the time elapsed since start (an MT4MetricsNow() value)
+    void recordSince(uint64_t start) {
+        record(MT4MetricsNow() - start);
+    }
+    
+    uint64_t getCount() const {
+        return m_count.load(std::memory_order_relaxed);
+    }
+    
+    // Value at quantile q (0..1) in nanoseconds
+    uint64_t getPercentile(double q) const {
+        uint64_t counts[MT4_HIST_BUCKETS];
+        uint64_t total = 0;
+        
+        for (int i = 0; i < MT4_HIST_BUCKETS; i++) {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        
+        return percentileOf(counts, total, q);
+    }
+    
+    // Percentiles over a consistent copy of the buckets
+    MT4LatencySummary summarize() const {
+        uint64_t counts[MT4_HIST_BUCKETS];
+        uint64_t total = 0;
+        
+        for (int i = 0; i < MT4_HIST_BUCKETS; i++) {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        
+        MT4LatencySummary summary;
+        summary.count = total;
+        summary.mean_us = total > 0 ? (double)m_sum.load(std::memory_order_relaxed) / total / 1000.0 : 0;
+        summary.p50_us = percentileOf(counts, total, 0.50) / 1000.0;
+        summary.p90_us = percentileOf(counts, total, 0.90) / 1000.0;
+        summary.p99_us = percentileOf(counts, total, 0.99) / 1000.0;
+        summary.p999_us = percentileOf(counts, total, 0.999) / 1000.0;
+        summary.max_us = m_max.load(std::memory_order_relaxed) / 1000.0;
+        return summary;
+    }
+
+private:
+    uint64_t percentileOf(const uint64_t* counts, uint64_t total, double q) const {
+        if (total == 0) {
+            return 0;
+        }
+        
+        uint64_t rank = (uint64_t)(q * total + 0.5);
+        if (rank == 0) {
+            rank = 1;
+        }
+        
+        uint64_t seen = 0;
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        
+        // The last bucket also holds everything past its top, so only
+        // the recorded maximum bounds it
+        for (int i = 0; i < MT4_HIST_BUCKETS - 1; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t top = bucketTop(i);
+                return top < max ? top : max;
+            }
+        }
+        return max;
+    }
+};
+
+//+------------------------------------------------------------------+
+//| Manager API calls timed by MT4Manager, indexed by MT4Call        |
+//+------------------------------------------------------------------+
+enum MT4Call {
+    MT4_CALL_CONNECT,
+    MT4_CALL_LOGIN,
+    MT4_CALL_SERVER_TIME,
+    MT4_CALL_USERS_REQUEST,
+    MT4_CALL_USER_RECORD_GET,
+    MT4_CALL_SYMBOLS_GET_ALL,
+    MT4_CALL_SYMBOL_GET,
+    MT4_CALL_SYMBOL_INFO_GET,
+    MT4_CALL_GROUPS_REQUEST,
+    MT4_CALL_TRADES_REQUEST,
+    MT4_CALL_TRADES_GET_BY_LOGIN,
+    MT4_CALL_TRADES_GET_BY_SYMBOL,
+    MT4_CALL_TRADE_RECORD_GET,
+    MT4_CALL_TRADE_TRANSACTION,
+    MT4_CALL_SUBMIT_BATCH,          // one whole submitBatch, not one transaction
+    MT4_CALL_MARGIN_LEVEL_REQUEST,
+    MT4_CALL_ONLINE_REQUEST,
+    MT4_CALL_COUNT
+};
+
+constexpr const char* MT4_CALL_NAMES[] = {
+    "Connect", "Login", "ServerTime", "UsersRequest", "UserRecordGet", "SymbolsGetAll",
+    "SymbolGet", "SymbolInfoGet", "GroupsRequest", "TradesRequest", "TradesGetByLogin",
+    "TradesGetBySymbol", "TradeRecordGet", "TradeTransaction", "SubmitBatch",
+    "MarginLevelRequest", "OnlineRequest"
+};
+
+static_assert(sizeof(MT4_CALL_NAMES) / sizeof(MT4_CALL_NAMES[0]) == MT4_CALL_COUNT, "Every call needs a name");
+
+//+------------------------------------------------------------------+
+//| MT4CallMetrics - Latency histogram per Manager API call          |
+//+------------------------------------------------------------------+
+class MT4CallMetrics {
+private:
+    MT4LatencyHistogram m_calls[MT4_CALL_COUNT];
+
+public:
+    // Run fn() and record its duration under call; MT4_CALL_COUNT
+    // runs it untimed
+    template <class Fn>
+    auto measure(MT4Call call, Fn fn) -> decltype(fn()) {
+        if (call < 0 || call >= MT4_CALL_COUNT) {
+            return fn();
+        }
+        
+        uint64_t start = MT4MetricsNow();
+        auto result = fn();
+        m_calls[call].recordSince(start);
+        return result;
+    }
+    
+    const MT4LatencyHistogram& get(MT4Call call) const {
+        return m_calls[call];
+    }
+};
+
+#endif // MT4METRICS_H
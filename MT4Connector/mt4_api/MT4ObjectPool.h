@@ -0,0 +1,131 @@
+//+------------------------------------------------------------------+
+//|                      Fixed-Size Object Pools for Wrapper Lookups |
+//+------------------------------------------------------------------+
+#ifndef MT4OBJECTPOOL_H
+#define MT4OBJECTPOOL_H
+
+#include <stddef.h>
+#include <atomic>
+#include <new>
+#include "MT4RingBuffer.h"
+
+// Slots per pooled wrapper type; further objects come from the heap
+#define MT4_OBJECT_POOL_SIZE 256
+
+//+------------------------------------------------------------------+
+//| MT4ObjectPool - Preallocated slots for objects of one type       |
+//| Free slots form a lock-free stack whose head carries a tag that  |
+//| changes on every pop, so a slot freed and reused between another |
+//| thread's read and its compare-exchange cannot corrupt the list.  |
+//| When every slot is taken allocate() falls back to the heap, and  |
+//| release() tells pooled and heap pointers apart by address.       |
+//+------------------------------------------------------------------+
+template <class T, int Count>
+class MT4ObjectPool {
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+    
+    Slot m_slots[Count];
+    std::atomic<unsigned int> m_next[Count];                // free-list link, index + 1, 0 = end
+    alignas(MT4_CACHE_LINE) std::atomic<unsigned long long> m_head;   // tag << 32 | index + 1
+    std::atomic<int> m_in_use;
+    std::atomic<int> m_high_watermark;
+    std::atomic<unsigned long long> m_fallbacks;
+    
+    MT4ObjectPool(const MT4ObjectPool&);
+    MT4ObjectPool& operator=(const MT4ObjectPool&);
+    
+    void updateWatermark(int in_use) {
+        int high = m_high_watermark.load(std::memory_order_relaxed);
+        while (in_use > high && !m_high_watermark.compare_exchange_weak(high, in_use, std::memory_order_relaxed)) {
+        }
+    }
+
+public:
+    MT4ObjectPool() : m_in_use(0), m_high_watermark(0), m_fallbacks(0) {
+        for (int i = 0; i < Count; i++) {
+            m_next[i].store(i + 1 < Count ? i + 2 : 0, std::memory_order_relaxed);
+        }
+        m_head.store(Count > 0 ? 1 : 0, std::memory_order_release);
+    }
+    
+    // Storage for one T; never NULL (the heap throws when exhausted)
+    void* allocate() {
+        unsigned long long head = m_head.load(std::memory_order_acquire);
+        
+        for (;;) {
+            unsigned int index = (unsigned int)head;
+            if (index == 0) {
+                m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+                return ::operator new(sizeof(T));
+            }
+            
+            unsigned long long next = ((head >> 32) + 1) << 32 | m_next[index - 1].load(std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                updateWatermark(m_in_use.fetch_add(1, std::memory_order_relaxed) + 1);
+                return m_slots[index - 1].storage;
+            }
+        }
+    }
+    
+    // Return storage from allocate()
+    void release(void* p) {
+        if (p == NULL) {
+            return;
+        }
+        if (!owns(p)) {
+            ::operator delete(p);
+            return;
+        }
+        
+        unsigned int index = (unsigned int)((Slot*)p - m_slots) + 1;
+        unsigned long long head = m_head.load(std::memory_order_relaxed);
+        
+        do {
+            m_next[index - 1].store((unsigned int)head, std::memory_order_relaxed);
+        } while (!m_head.compare_exchange_weak(head, (head & 0xFFFFFFFF00000000ULL) | index,
+                                               std::memory_order_release, std::memory_order_relaxed));
+        m_in_use.fetch_sub(1, std::memory_order_relaxed);
+    }
+    
+    bool owns(const void* p) const {
+        const unsigned char* bytes = (const unsigned char*)p;
+        return bytes >= m_slots[0].storage && bytes < m_slots[0].storage + sizeof(m_slots);
+    }
+    
+    // Statistics
+    int capacity() const { return Count; }
+    int inUse() const { return m_in_use.load(std::memory_order_relaxed); }
+    int highWatermark() const { return m_high_watermark.load(std::memory_order_relaxed); }
+    unsigned long long fallbacks() const { return m_fallbacks.load(std::memory_order_relaxed); }
+};
+
+//+------------------------------------------------------------------+
+//| MT4PoolAllocated - Routes new/delete of T through its pool       |
+//| Derive T from MT4PoolAllocated<T> and plain new/delete use one   |
+//| process-wide pool per type. The pool is never destroyed, so an   |
+//| object may be deleted after every MT4Manager is gone. Objects of |
+//| derived classes and arrays use the heap as before.               |
+//+------------------------------------------------------------------+
+template <class T, int Count = MT4_OBJECT_POOL_SIZE>
+class MT4PoolAllocated {
+public:
+    typedef MT4ObjectPool<T, Count> Pool;
+    
+    static Pool& objectPool() {
+        static Pool* pool = new Pool();
+        return *pool;
+    }
+    
+    static void* operator new(size_t size) {
+        return size == sizeof(T) ? objectPool().allocate() : ::operator new(size);
+    }
+    
+    static void operator delete(void* p) {
+        objectPool().release(p);
+    }
+};
+
+#endif // MT4OBJECTPOOL_H
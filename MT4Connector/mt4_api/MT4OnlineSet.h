@@ -0,0 +1,196 @@
+//+------------------------------------------------------------------+
+//|                              Login-indexed Online User Set         |
+//+------------------------------------------------------------------+
+#ifndef MT4ONLINESET_H
+#define MT4ONLINESET_H
+
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include "MT4Pumping.h"
+
+// Logins per page of the online set (power of two)
+#define MT4_ONLINE_PAGE_BITS 16
+#define MT4_ONLINE_PAGE_SIZE (1 << MT4_ONLINE_PAGE_BITS)
+#define MT4_ONLINE_PAGE_COUNT (1 << (31 - MT4_ONLINE_PAGE_BITS))
+
+//+------------------------------------------------------------------+
+//| MT4OnlineSet - O(1) "is this login online" without server calls  |
+//| Logins map to a session counter in lazily allocated pages of     |
+//| MT4_ONLINE_PAGE_SIZE logins, so sparse login ranges stay cheap.  |
+//| Seeded from OnlineGet when pumping starts and maintained from    |
+//| PUMP_UPDATE_ONLINE; a login stays online while any session of it |
+//| is connected. Lookups are lock-free from any thread.             |
+//+------------------------------------------------------------------+
+class MT4OnlineSet : public MT4PumpListener {
+private:
+    std::atomic<std::atomic<unsigned char>*>* m_pages;
+    std::atomic<int> m_logins;                  // distinct logins online
+    std::atomic<int> m_sessions;                // connected sessions
+    std::atomic<bool> m_ready;
+    std::mutex m_alloc_lock;
+    
+    MT4OnlineSet(const MT4OnlineSet&);
+    MT4OnlineSet& operator=(const MT4OnlineSet&);
+    
+    // Counter of a login, NULL if its page was never allocated
+    std::atomic<unsigned char>* find(int login) const {
+        if (login <= 0) {
+            return NULL;
+        }
+        
+        std::atomic<unsigned char>* page = m_pages[login >> MT4_ONLINE_PAGE_BITS].load(std::memory_order_acquire);
+        return page != NULL ? &page[login & (MT4_ONLINE_PAGE_SIZE - 1)] : NULL;
+    }
+    
+    // Counter of a login, allocating its page on first use
+    std::atomic<unsigned char>* counter(int login) {
+        std::atomic<unsigned char>* c = find(login);
+        if (c != NULL || login <= 0) {
+            return c;
+        }
+        
+        int page_index = login >> MT4_ONLINE_PAGE_BITS;
+        std::atomic<unsigned char>* page;
+        {
+            std::lock_guard<std::mutex> lock(m_alloc_lock);
+            page = m_pages[page_index].load(std::memory_order_acquire);
+            if (page == NULL) {
+                page = new std::atomic<unsigned char>[MT4_ONLINE_PAGE_SIZE];
+                for (int i = 0; i < MT4_ONLINE_PAGE_SIZE; i++) {
+                    page[i].store(0, std::memory_order_relaxed);
+                }
+                m_pages[page_index].store(page, std::memory_order_release);
+            }
+        }
+        
+        return &page[login & (MT4_ONLINE_PAGE_SIZE - 1)];
+    }
+
+public:
+    MT4OnlineSet() : m_logins(0), m_sessions(0), m_ready(false) {
+        m_pages = new std::atomic<std::atomic<unsigned char>*>[MT4_ONLINE_PAGE_COUNT];
+        for (int i = 0; i < MT4_ONLINE_PAGE_COUNT; i++) {
+            m_pages[i].store(NULL, std::memory_order_relaxed);
+        }
+    }
+    
+    ~MT4OnlineSet() {
+        for (int i = 0; i < MT4_ONLINE_PAGE_COUNT; i++) {
+            delete[] m_pages[i].load();
+        }
+        delete[] m_pages;
+    }
+    
+    // Check whether the set has been seeded and can be trusted
+    bool isReady() const {
+        return m_ready;
+    }
+    
+    // Check if a login has at least one connected session
+    bool contains(int login) const {
+        std::atomic<unsigned char>* c = find(login);
+        return c != NULL && c->load(std::memory_order_relaxed) > 0;
+    }
+    
+    // Number of distinct logins online
+    int getLoginCount() const {
+        return m_logins;
+    }
+    
+    // Number of connected sessions (what OnlineRequest would return)
+    int getSessionCount() const {
+        return m_sessions;
+    }
+    
+    // Record one session of login connecting
+    void add(int login) {
+        std::atomic<unsigned char>* c = counter(login);
+        if (c == NULL) {
+            return;
+        }
+        
+        unsigned char sessions = c->load(std::memory_order_relaxed);
+        if (sessions == 255) {
+            return;
+        }
+        
+        c->store(sessions + 1, std::memory_order_relaxed);
+        m_sessions++;
+        if (sessions == 0) {
+            m_logins++;
+        }
+    }
+    
+    // Record one session of login disconnecting
+    void remove(int login) {
+        std::atomic<unsigned char>* c = find(login);
+        if (c == NULL) {
+            return;
+        }
+        
+        unsigned char sessions = c->load(std::memory_order_relaxed);
+        if (sessions == 0) {
+            return;
+        }
+        
+        c->store(sessions - 1, std::memory_order_relaxed);
+        m_sessions--;
+        if (sessions == 1) {
+            m_logins--;
+        }
+    }
+    
+    // Forget every login (keeps allocated pages for reuse)
+    void clear() {
+        for (int i = 0; i < MT4_ONLINE_PAGE_COUNT; i++) {
+            std::atomic<unsigned char>* page = m_pages[i].load(std::memory_order_acquire);
+            if (page != NULL) {
+                for (int j = 0; j < MT4_ONLINE_PAGE_SIZE; j++) {
+                    page[j].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+        m_logins = 0;
+        m_sessions = 0;
+    }
+    
+    // Seed from a full online list (OnlineRequest or OnlineGet)
+    void seed(const OnlineRecord* online, int total) {
+        clear();
+        for (int i = 0; i < total; i++) {
+            add(online[i].login);
+        }
+        m_ready = true;
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        OnlineRecord* online = pump->OnlineGet(&total);
+        seed(online, online != NULL ? total : 0);
+        
+        if (online) {
+            pump->MemFree(online);
+        }
+    }
+    
+    void onPumpingStopped() {
+        m_ready = false;
+    }
+    
+    void onOnline(const MT4OnlineEvent* events, int count) {
+        for (int i = 0; i < count; i++) {
+            if (events[i].type == TRANS_ADD) {
+                add(events[i].login);
+            } else if (events[i].type == TRANS_DELETE) {
+                remove(events[i].login);
+            }
+        }
+    }
+};
+
+#endif // MT4ONLINESET_H
@@ -0,0 +1,150 @@
+//+------------------------------------------------------------------+
+//|                      Pumped Order Correlation for New Trade Tickets |
+//+------------------------------------------------------------------+
+#ifndef MT4ORDERCORRELATOR_H
+#define MT4ORDERCORRELATOR_H
+
+#include <string.h>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "MT4Pumping.h"
+
+// Number of recently opened orders remembered for correlation
+#define MT4_CORRELATOR_SIZE 256
+
+//+------------------------------------------------------------------+
+//| MT4OrderCorrelator - Matches a submitted order to its ticket     |
+//| Servers normally return the new ticket in TradeTransInfo.order.  |
+//| When they do not, the ticket is taken from the TRANS_ADD event   |
+//| of the pumped trade stream with the same login, symbol, command, |
+//| volume and comment that arrived after the request was sent.      |
+//| A matched entry is taken and never handed out again, and tickets |
+//| the server did report are claimed too, so identical concurrent   |
+//| opens each resolve to their own order.                           |
+//+------------------------------------------------------------------+
+class MT4OrderCorrelator : public MT4PumpListener {
+private:
+    struct Entry {
+        unsigned long long sequence;
+        int order;
+        int login;
+        int cmd;
+        int volume;
+        char symbol[12];
+        char comment[32];
+        bool taken;
+    };
+    
+    Entry m_entries[MT4_CORRELATOR_SIZE];
+    unsigned long long m_sequence;
+    int m_claimed[MT4_CORRELATOR_SIZE];         // reported tickets not pumped yet
+    unsigned long long m_claim_count;
+    std::mutex m_lock;
+    std::condition_variable m_added;
+    
+    // Take the oldest free entry newer than marker (caller holds m_lock)
+    int take(unsigned long long marker, const TradeTransInfo& info) {
+        Entry* found = NULL;
+        
+        for (int i = 0; i < MT4_CORRELATOR_SIZE; i++) {
+            Entry& e = m_entries[i];
+            
+            if (!e.taken && e.sequence > marker && e.login == info.orderby && e.cmd == info.cmd &&
+                e.volume == info.volume &&
+                strncmp(e.symbol, info.symbol, sizeof(e.symbol)) == 0 &&
+                strncmp(e.comment, info.comment, sizeof(e.comment)) == 0 &&
+                (found == NULL || e.sequence < found->sequence)) {
+                found = &e;
+            }
+        }
+        
+        if (found == NULL) {
+            return 0;
+        }
+        found->taken = true;
+        return found->order;
+    }
+    
+    // Check and forget a claim for order (caller holds m_lock)
+    bool claimed(int order) {
+        for (int i = 0; i < MT4_CORRELATOR_SIZE; i++) {
+            if (m_claimed[i] == order) {
+                m_claimed[i] = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    MT4OrderCorrelator() : m_sequence(0), m_claim_count(0) {
+        memset(m_entries, 0, sizeof(m_entries));
+        memset(m_claimed, 0, sizeof(m_claimed));
+    }
+    
+    // Sequence marker to take before sending a transaction
+    unsigned long long mark() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_sequence;
+    }
+    
+    // Wait up to timeout_ms for the order opened by info and take it;
+    // 0 if not seen
+    int waitForOrder(unsigned long long marker, const TradeTransInfo& info, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        int order = 0;
+        
+        m_added.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]() {
+            order = take(marker, info);
+            return order != 0;
+        });
+        
+        return order;
+    }
+    
+    // Mark a ticket the server reported as taken, whether or not its
+    // TRANS_ADD has arrived yet
+    void claim(int order) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        for (int i = 0; i < MT4_CORRELATOR_SIZE; i++) {
+            if (m_entries[i].sequence != 0 && m_entries[i].order == order) {
+                m_entries[i].taken = true;
+                return;
+            }
+        }
+        m_claimed[m_claim_count++ % MT4_CORRELATOR_SIZE] = order;
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        bool added = false;
+        
+        for (int i = 0; i < count; i++) {
+            if (events[i].type != TRANS_ADD) {
+                continue;
+            }
+            
+            const TradeRecord& trade = events[i].trade;
+            Entry& e = m_entries[m_sequence % MT4_CORRELATOR_SIZE];
+            
+            e.sequence = ++m_sequence;
+            e.order = trade.order;
+            e.login = trade.login;
+            e.cmd = trade.cmd;
+            e.volume = trade.volume;
+            memcpy(e.symbol, trade.symbol, sizeof(e.symbol));
+            strncpy(e.comment, trade.comment, sizeof(e.comment) - 1);
+            e.comment[sizeof(e.comment) - 1] = 0;
+            e.taken = claimed(trade.order);
+            added = true;
+        }
+        
+        if (added) {
+            m_added.notify_all();
+        }
+    }
+};
+
+#endif // MT4ORDERCORRELATOR_H
@@ -0,0 +1,671 @@
+//+------------------------------------------------------------------+
+//|                              MT4 Manager API Native Pumping Engine |
+//+------------------------------------------------------------------+
+#ifndef MT4PUMPING_H
+#define MT4PUMPING_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4RingBuffer.h"
+#include "MT4Metrics.h"
+
+// Maximum number of quotes pulled from SymbolInfoUpdated per batch
+#define MT4_PUMP_QUOTE_BATCH 256
+
+// Default slot counts of the MT4PumpQueue rings
+#define MT4_PUMP_QUEUE_QUOTES 65536
+#define MT4_PUMP_QUEUE_TRADES 16384
+#define MT4_PUMP_QUEUE_USERS  1024
+#define MT4_PUMP_QUEUE_ONLINE 4096
+
+// Default pumping flags - the engine never consumes news or mail
+#define MT4_PUMP_DEFAULT_FLAGS (CLIENT_FLAGS_HIDENEWS | CLIENT_FLAGS_HIDEMAIL)
+
+//+------------------------------------------------------------------+
+//| Pumped event records                                             |
+//| Plain copies of the API data so they can outlive the callback    |
+//+------------------------------------------------------------------+
+struct MT4TradeEvent {
+    int type;                   // TRANS_ADD, TRANS_DELETE, TRANS_UPDATE
+    bool resync;                // replayed by the session supervisor after an outage
+    TradeRecord trade;
+};
+
+struct MT4UserEvent {
+    int type;                   // TRANS_ADD, TRANS_DELETE, TRANS_UPDATE
+    UserRecord user;
+};
+
+struct MT4OnlineEvent {
+    int type;                   // TRANS_ADD (logged in) or TRANS_DELETE (logged out)
+    int login;
+};
+
+//+------------------------------------------------------------------+
+//| MT4PumpListener - Consumer of decoded pumping events             |
+//| All methods are called on the Manager API pumping thread and     |
+//| receive contiguous batches; override only what you need.         |
+//+------------------------------------------------------------------+
+class MT4PumpListener {
+public:
+    virtual ~MT4PumpListener() {}
+    
+    // Pumping interface has synchronized its local data (PUMP_START_PUMPING)
+    virtual void onPumpingStarted(CManagerInterface* pump) {}
+    
+    // Pumping came back after a dropped session (see MT4Session.h). The
+    // changes made during the gap were delivered first as onTrades and
+    // onUsers; the default reloads everything like onPumpingStarted.
+    virtual void onPumpingResumed(CManagerInterface* pump) {
+        onPumpingStarted(pump);
+    }
+    
+    // Pumping was stopped or the connection dropped (PUMP_STOP_PUMPING,
+    // or MT4PumpingEngine::stop() on the stopping thread)
+    virtual void onPumpingStopped() {}
+    
+    // The interface passed to onPumpingStarted is about to be released.
+    // Called by MT4PumpingEngine::stop() once no notification is being
+    // dispatched, on the stopping thread; drop any saved pointer and
+    // return only when no other thread still uses it.
+    virtual void onPumpDetached() {}
+    
+    // Batch of updated quotes (PUMP_UPDATE_BIDASK)
+    virtual void onQuotes(const SymbolInfo* quotes, int count) {}
+    
+    // Batch of trade updates (PUMP_UPDATE_TRADES)
+    virtual void onTrades(const MT4TradeEvent* events, int count) {}
+    
+    // Batch of user record updates (PUMP_UPDATE_USERS)
+    virtual void onUsers(const MT4UserEvent* events, int count) {}
+    
+    // Batch of login/logout notifications (PUMP_UPDATE_ONLINE)
+    virtual void onOnline(const MT4OnlineEvent* events, int count) {}
+    
+    // Server keep-alive (PUMP_PING)
+    virtual void onPing() {}
+};
+
+//+------------------------------------------------------------------+
+//| MT4PumpQueue - Decouples the pumping thread from one consumer    |
+//| Registered as a listener it copies every event into preallocated |
+//| SPSC rings; the consumer thread calls drain() to receive the     |
+//| events as contiguous batches. A stalled consumer makes the rings |
+//| drop new events instead of blocking the Manager API thread.      |
+//| Ordering is preserved per event kind, not across kinds.          |
+//+------------------------------------------------------------------+
+class MT4PumpQueue : public MT4PumpListener {
+private:
+    MT4SpscRing<SymbolInfo> m_quotes;
+    MT4SpscRing<MT4TradeEvent> m_trades;
+    MT4SpscRing<MT4UserEvent> m_users;
+    MT4SpscRing<MT4OnlineEvent> m_online;
+    
+    // Control notifications are coalesced into flags
+    std::atomic<CManagerInterface*> m_started_pump;
+    std::atomic<int> m_pump_users;              // consumers inside onPumpingStarted
+    std::atomic<bool> m_detached;               // m_started_pump was released
+    std::atomic<int> m_started;                 // pending start: 0, 1 started, 2 resumed
+    std::atomic<bool> m_stopped;
+    std::atomic<unsigned long long> m_pings;
+    unsigned long long m_pings_delivered;
+    
+    // Age of quotes when drained, from SymbolInfo.lasttime (server time)
+    MT4LatencyHistogram m_tick_age;
+    std::atomic<long long> m_server_offset;     // server time - local time, seconds
+    std::atomic<bool> m_offset_known;
+    
+    void recordTickAge(const SymbolInfo* quotes, int count) {
+        if (!m_offset_known.load(std::memory_order_relaxed)) {
+            return;
+        }
+        
+        long long now_us = (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        long long offset = m_server_offset.load(std::memory_order_relaxed);
+        
+        for (int i = 0; i < count; i++) {
+            long long age_us = now_us - ((long long)quotes[i].lasttime - offset) * 1000000LL;
+            m_tick_age.record(age_us > 0 ? (uint64_t)age_us * 1000 : 0);
+        }
+    }
+    
+    // Hand one ring to a consumer callback, limited by budget
+    template <class T, class F>
+    int drainRing(MT4SpscRing<T>& ring, int budget, F deliver) {
+        int drained = 0;
+        const T* first = NULL;
+        int count;
+        
+        while (drained < budget && (count = ring.peek(&first)) > 0) {
+            if (count > budget - drained) {
+                count = budget - drained;
+            }
+            deliver(first, count);
+            ring.consume(count);
+            drained += count;
+        }
+        
+        return drained;
+    }
+    
+    // Queue whose onPumpingStarted is running on this thread, if any
+    static const MT4PumpQueue*& startingQueue() {
+        static thread_local const MT4PumpQueue* queue = NULL;
+        return queue;
+    }
+    
+    // Announce a pending start; the pointer is only handed out while
+    // onPumpDetached cannot complete
+    void deliverStarted(MT4PumpListener* consumer, bool resumed) {
+        m_pump_users.fetch_add(1, std::memory_order_seq_cst);
+        CManagerInterface* pump = m_started_pump.load(std::memory_order_seq_cst);
+        
+        // A pump detached before the drain belongs to a finished session
+        if (!m_detached.load(std::memory_order_seq_cst)) {
+            const MT4PumpQueue* outer = startingQueue();
+            startingQueue() = this;
+            if (resumed) {
+                consumer->onPumpingResumed(pump);
+            } else {
+                consumer->onPumpingStarted(pump);
+            }
+            startingQueue() = outer;
+        }
+        m_pump_users.fetch_sub(1, std::memory_order_release);
+    }
+
+public:
+    MT4PumpQueue()
+        : m_started_pump(NULL), m_pump_users(0), m_detached(false), m_started(0), m_stopped(false),
+          m_pings(0), m_pings_delivered(0), m_server_offset(0), m_offset_known(false) {}
+    
+    // Allocate the rings; must be called before the queue is registered
+    bool init(int quote_capacity = MT4_PUMP_QUEUE_QUOTES,
+              int trade_capacity = MT4_PUMP_QUEUE_TRADES,
+              int user_capacity = MT4_PUMP_QUEUE_USERS,
+              int online_capacity = MT4_PUMP_QUEUE_ONLINE) {
+        return m_quotes.init(quote_capacity) && m_trades.init(trade_capacity) &&
+               m_users.init(user_capacity) && m_online.init(online_capacity);
+    }
+    
+    // Check if the rings have been allocated
+    bool isValid() const {
+        return m_quotes.isValid();
+    }
+    
+    // Producer side (pumping thread)
+    void onPumpingStarted(CManagerInterface* pump) {
+        m_started_pump = pump;
+        m_detached = false;
+        m_started = 1;
+    }
+    
+    // A resume only replaces no pending start: an undelivered start
+    // still has to reload everything
+    void onPumpingResumed(CManagerInterface* pump) {
+        m_started_pump = pump;
+        m_detached = false;
+        int none = 0;
+        m_started.compare_exchange_strong(none, 2);
+    }
+    
+    void onPumpingStopped() {
+        m_stopped = true;
+    }
+    
+    // Forget the pump and wait out a consumer still announcing it
+    void onPumpDetached() {
+        m_detached.store(true, std::memory_order_seq_cst);
+        m_started_pump.store(NULL, std::memory_order_seq_cst);
+        
+        int own = startingQueue() == this ? 1 : 0;
+        while (m_pump_users.load(std::memory_order_acquire) > own) {
+            Sleep(0);
+        }
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        m_quotes.push(quotes, count);
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        m_trades.push(events, count);
+    }
+    
+    void onUsers(const MT4UserEvent* events, int count) {
+        m_users.push(events, count);
+    }
+    
+    void onOnline(const MT4OnlineEvent* events, int count) {
+        m_online.push(events, count);
+    }
+    
+    void onPing() {
+        m_pings.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Consumer side: deliver up to max_events queued events to consumer.
+    // Returns the number of data events delivered.
+    int drain(MT4PumpListener* consumer, int max_events = 0x7fffffff) {
+        int started = m_started.exchange(0);
+        if (started != 0) {
+            deliverStarted(consumer, started == 2);
+        }
+        
+        int drained = 0;
+        drained += drainRing(m_trades, max_events - drained,
+            [consumer](const MT4TradeEvent* e, int n) { consumer->onTrades(e, n); });
+        drained += drainRing(m_users, max_events - drained,
+            [consumer](const MT4UserEvent* e, int n) { consumer->onUsers(e, n); });
+        drained += drainRing(m_online, max_events - drained,
+            [consumer](const MT4OnlineEvent* e, int n) { consumer->onOnline(e, n); });
+        drained += drainRing(m_quotes, max_events - drained,
+            [this, consumer](const SymbolInfo* q, int n) { recordTickAge(q, n); consumer->onQuotes(q, n); });
+        
+        unsigned long long pings = m_pings.load(std::memory_order_relaxed);
+        if (pings != m_pings_delivered) {
+            m_pings_delivered = pings;
+            consumer->onPing();
+        }
+        
+        if (m_stopped.exchange(false)) {
+            consumer->onPumpingStopped();
+        }
+        
+        return drained;
+    }
+    
+    // Number of events waiting in all rings
+    unsigned long long depth() const {
+        return m_quotes.size() + m_trades.size() + m_users.size() + m_online.size();
+    }
+    
+    // Number of events dropped because a ring was full
+    unsigned long long dropped() const {
+        return m_quotes.dropped() + m_trades.dropped() + m_users.dropped() + m_online.dropped();
+    }
+    
+    // Set the server clock offset (ServerTime() - time(NULL)) so drained
+    // quotes can be aged; until then no tick age is recorded
+    void setServerOffset(long long seconds) {
+        m_server_offset.store(seconds, std::memory_order_relaxed);
+        m_offset_known.store(true, std::memory_order_release);
+    }
+    
+    // Quote age from SymbolInfo.lasttime to drain(). lasttime has one
+    // second resolution, so this shows stale ticks, not sub-second latency.
+    const MT4LatencyHistogram& getTickAge() const {
+        return m_tick_age;
+    }
+    
+    // Per-ring access for statistics
+    const MT4SpscRing<SymbolInfo>& quoteRing() const { return m_quotes; }
+    const MT4SpscRing<MT4TradeEvent>& tradeRing() const { return m_trades; }
+    const MT4SpscRing<MT4UserEvent>& userRing() const { return m_users; }
+    const MT4SpscRing<MT4OnlineEvent>& onlineRing() const { return m_online; }
+};
+
+//+------------------------------------------------------------------+
+//| MT4PumpingEngine - Owns a dedicated pumping interface            |
+//| The Manager API does not allow regular requests on an interface  |
+//| in pumping mode, so the engine opens its own connection.         |
+//| stop() may run while the API thread is inside dispatch(): it     |
+//| closes the gate so later notifications return at once, ends the  |
+//| session and waits for the notification in flight to leave before |
+//| the listeners detach and the interface is released.              |
+//+------------------------------------------------------------------+
+class MT4PumpingEngine {
+private:
+    CManagerInterface* m_pump;
+    CManagerInterface* m_deferred;      // released by the next stop() off the pumping thread
+    std::vector<MT4PumpListener*> m_listeners;
+    std::atomic<bool> m_active;
+    std::atomic<bool> m_resume;         // next PUMP_START_PUMPING resumes a session
+    std::atomic<bool> m_closing;        // dispatch() drops notifications
+    std::atomic<int> m_in_dispatch;     // notifications inside dispatch()
+    std::string m_last_error;
+    
+    // Scratch buffer reused for every PUMP_UPDATE_BIDASK notification
+    SymbolInfo m_quote_batch[MT4_PUMP_QUOTE_BATCH];
+    
+    // Statistics (written on the pumping thread only)
+    std::atomic<unsigned long long> m_events_received;
+    std::atomic<unsigned long long> m_quotes_received;
+    std::atomic<unsigned long long> m_trades_received;
+    MT4LatencyHistogram m_dispatch_latency;     // one notification through every listener
+    
+    // Manager API entry point; param carries the engine instance
+    static void __stdcall pumpCallback(int code, int type, void* data, void* param) {
+        MT4PumpingEngine* engine = (MT4PumpingEngine*)param;
+        if (engine != NULL) {
+            engine->dispatch(code, type, data);
+        }
+    }
+    
+    void setLastError(int code) {
+        if (m_pump != NULL) {
+            m_last_error = m_pump->ErrorDescription(code);
+        } else {
+            m_last_error = "Pumping interface not initialized";
+        }
+    }
+    
+    // Nesting of dispatch() on this thread
+    static int& dispatchDepth() {
+        static thread_local int depth = 0;
+        return depth;
+    }
+    
+    // Release the pump once no notification can still use it. From a
+    // listener callback the calling notification is still in flight,
+    // so the final Release() is left to a later stop() or start().
+    void releasePump() {
+        bool nested = dispatchDepth() > 0;
+        
+        m_closing.store(true, std::memory_order_seq_cst);
+        if (m_pump != NULL) {
+            // The Manager API leaves pumping mode only by disconnecting
+            m_pump->Disconnect();
+        }
+        while (m_in_dispatch.load(std::memory_order_seq_cst) > (nested ? 1 : 0)) {
+            Sleep(1);
+        }
+        
+        // A session ended here gets no PUMP_STOP_PUMPING of its own
+        if (m_active.exchange(false)) {
+            for (size_t i = 0; i < m_listeners.size(); i++) {
+                m_listeners[i]->onPumpingStopped();
+            }
+        }
+        
+        if (m_pump != NULL) {
+            for (size_t i = 0; i < m_listeners.size(); i++) {
+                m_listeners[i]->onPumpDetached();
+            }
+            if (nested) {
+                m_deferred = m_pump;
+            } else {
+                m_pump->Release();
+            }
+            m_pump = NULL;
+        }
+        
+        if (!nested && m_deferred != NULL) {
+            m_deferred->Release();
+            m_deferred = NULL;
+        }
+    }
+    
+    // Subscribe the pumping interface to quotes of every symbol
+    void subscribeSymbols() {
+        m_pump->SymbolsRefresh();
+        
+        int total = 0;
+        ConSymbol* syms = m_pump->SymbolsGetAll(&total);
+        
+        if (syms) {
+            for (int i = 0; i < total; i++) {
+                m_pump->SymbolAdd(syms[i].symbol);
+            }
+            
+            m_pump->MemFree(syms);
+        }
+    }
+    
+    // Announce a new or resumed pumping session
+    void dispatchStarted() {
+        bool resumed = m_resume.exchange(false);
+        
+        m_active = true;
+        if (m_pump != NULL) {
+            subscribeSymbols();
+        }
+        
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            if (resumed) {
+                m_listeners[i]->onPumpingResumed(m_pump);
+            } else {
+                m_listeners[i]->onPumpingStarted(m_pump);
+            }
+        }
+    }
+    
+    // Drain every pending quote in MT4_PUMP_QUOTE_BATCH sized chunks
+    void dispatchQuotes() {
+        int count;
+        
+        while ((count = m_pump->SymbolInfoUpdated(m_quote_batch, MT4_PUMP_QUOTE_BATCH)) > 0) {
+            m_quotes_received += count;
+            
+            for (size_t i = 0; i < m_listeners.size(); i++) {
+                m_listeners[i]->onQuotes(m_quote_batch, count);
+            }
+            
+            if (count < MT4_PUMP_QUOTE_BATCH) {
+                break;
+            }
+        }
+    }
+    
+    // Decode one notification for every listener; only through dispatch()
+    void dispatchLocked(int code, int type, void* data) {
+        uint64_t start = MT4MetricsNow();
+        m_events_received++;
+        
+        switch (code) {
+            case PUMP_START_PUMPING:
+                dispatchStarted();
+                break;
+            
+            case PUMP_STOP_PUMPING:
+                m_active = false;
+                for (size_t i = 0; i < m_listeners.size(); i++) {
+                    m_listeners[i]->onPumpingStopped();
+                }
+                break;
+            
+            case PUMP_UPDATE_BIDASK:
+                if (m_pump != NULL) {
+                    dispatchQuotes();
+                }
+                break;
+            
+            case PUMP_UPDATE_TRADES:
+                if (data != NULL) {
+                    MT4TradeEvent ev;
+                    ev.type = type;
+                    ev.resync = false;
+                    ev.trade = *(const TradeRecord*)data;
+                    deliverTrades(&ev, 1);
+                }
+                break;
+            
+            case PUMP_UPDATE_USERS:
+                if (data != NULL) {
+                    MT4UserEvent ev;
+                    ev.type = type;
+                    ev.user = *(const UserRecord*)data;
+                    deliverUsers(&ev, 1);
+                }
+                break;
+            
+            case PUMP_UPDATE_ONLINE:
+                // PumpingSwitchEx passes the login as int*, not an
+                // OnlineRecord; the session details come from OnlineGet
+                if (data != NULL) {
+                    MT4OnlineEvent ev;
+                    ev.type = type;
+                    ev.login = *(const int*)data;
+                    
+                    for (size_t i = 0; i < m_listeners.size(); i++) {
+                        m_listeners[i]->onOnline(&ev, 1);
+                    }
+                }
+                break;
+            
+            case PUMP_PING:
+                for (size_t i = 0; i < m_listeners.size(); i++) {
+                    m_listeners[i]->onPing();
+                }
+                break;
+            
+            default:
+                break;
+        }
+        
+        m_dispatch_latency.recordSince(start);
+    }
+
+public:
+    MT4PumpingEngine()
+        : m_pump(NULL), m_deferred(NULL), m_active(false), m_resume(false), m_closing(false),
+          m_in_dispatch(0), m_events_received(0), m_quotes_received(0), m_trades_received(0) {}
+    
+    ~MT4PumpingEngine() {
+        stop();
+    }
+    
+    // Register a consumer; false once start() or attach() has run, as
+    // the pumping thread walks the listeners without a lock
+    bool addListener(MT4PumpListener* listener) {
+        if (listener == NULL) {
+            return false;
+        }
+        if (m_active || m_pump != NULL) {
+            m_last_error = "Listeners must be added before pumping starts";
+            return false;
+        }
+        m_listeners.push_back(listener);
+        return true;
+    }
+    
+    // Unregister a consumer; only safe while pumping is stopped
+    void removeListener(MT4PumpListener* listener) {
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            if (m_listeners[i] == listener) {
+                m_listeners.erase(m_listeners.begin() + i);
+                return;
+            }
+        }
+    }
+    
+    // Open the pumping connection and switch it to pumping mode
+    bool start(CManagerFactory& factory, const char* server, int login,
+               const char* password, int flags = MT4_PUMP_DEFAULT_FLAGS) {
+        if (m_pump != NULL) {
+            return true;
+        }
+        if (m_deferred != NULL && dispatchDepth() == 0) {
+            m_deferred->Release();
+            m_deferred = NULL;
+        }
+        
+        m_pump = factory.Create(ManAPIVersion);
+        if (m_pump == NULL) {
+            m_last_error = "Failed to create pumping interface";
+            return false;
+        }
+        
+        int res = m_pump->Connect(server);
+        if (res == RET_OK) {
+            res = m_pump->Login(login, password);
+        }
+        if (res == RET_OK) {
+            m_closing = false;
+            res = m_pump->PumpingSwitchEx(pumpCallback, flags, this);
+        }
+        
+        if (res != RET_OK) {
+            setLastError(res);
+            releasePump();
+            return false;
+        }
+        
+        return true;
+    }
+    
+    // Take over an interface that delivers pumping notifications through
+    // dispatch() (replay tools, the fake server of MT4FakeManager.h);
+    // stop() disconnects and releases it
+    bool attach(CManagerInterface* pump) {
+        if (m_pump != NULL || pump == NULL) {
+            return false;
+        }
+        
+        m_pump = pump;
+        m_closing = false;
+        return true;
+    }
+    
+    // Deliver the next PUMP_START_PUMPING as onPumpingResumed
+    void resumeNextStart(bool resume = true) {
+        m_resume = resume;
+    }
+    
+    // Hand trade and user events to every listener as if pumped; only
+    // valid on the pumping thread, e.g. from a listener callback
+    void deliverTrades(const MT4TradeEvent* events, int count) {
+        m_trades_received += count;
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            m_listeners[i]->onTrades(events, count);
+        }
+    }
+    
+    void deliverUsers(const MT4UserEvent* events, int count) {
+        for (size_t i = 0; i < m_listeners.size(); i++) {
+            m_listeners[i]->onUsers(events, count);
+        }
+    }
+    
+    // Leave pumping mode and close the pumping connection; safe from any
+    // thread, including listener callbacks
+    void stop() {
+        releasePump();
+        m_active = false;
+    }
+    
+    // Decode one notification and hand it to every listener.
+    // Called by the Manager API thread; public so tests and replay
+    // tools can drive the engine without a server.
+    void dispatch(int code, int type, void* data) {
+        m_in_dispatch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_closing.load(std::memory_order_seq_cst)) {
+            m_in_dispatch.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        
+        dispatchDepth()++;
+        dispatchLocked(code, type, data);
+        dispatchDepth()--;
+        m_in_dispatch.fetch_sub(1, std::memory_order_release);
+    }
+    
+    // Check whether the server confirmed pumping mode
+    bool isActive() const {
+        return m_active;
+    }
+    
+    // Get last error message
+    const char* getLastError() const {
+        return m_last_error.c_str();
+    }
+    
+    // Get the pumping interface (only valid for pumping-mode calls)
+    CManagerInterface* getPumpInterface() {
+        return m_pump;
+    }
+    
+    // Statistics
+    unsigned long long getEventsReceived() const { return m_events_received; }
+    unsigned long long getQuotesReceived() const { return m_quotes_received; }
+    unsigned long long getTradesReceived() const { return m_trades_received; }
+    const MT4LatencyHistogram& getDispatchLatency() const { return m_dispatch_latency; }
+};
+
+#endif // MT4PUMPING_H
@@ -0,0 +1,772 @@
+//+------------------------------------------------------------------+
+//|                       CPython Extension Module Wrapping MT4Manager |
+//+------------------------------------------------------------------+
+// Built as mt4native.pyd by build_python_module.bat; loaded from
+// Python through src/mt4_native.py.
+//
+// Every server call releases the GIL. Record lists are returned as
+// RecordBuffer objects exporting the Manager API array through the
+// buffer protocol, so numpy.frombuffer maps them without copying; the
+// array is freed with MemFree when the last view is released. Bars are
+// copied out of the bar builder into a buffer the RecordBuffer owns.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MT4Manager.h"
+
+enum RecordKind {
+    KIND_TRADE = 0,
+    KIND_USER = 1,
+    KIND_SYMBOL = 2,
+    KIND_BAR = 3
+};
+
+//+------------------------------------------------------------------+
+//| Field descriptions for numpy dtypes, taken from the real structs |
+//+------------------------------------------------------------------+
+template <class T>
+static std::string fieldFormat(const T&) {
+    if (std::is_floating_point<T>::value) {
+        return "<f" + std::to_string(sizeof(T));
+    }
+    return std::string(std::is_signed<T>::value ? "<i" : "<u") + std::to_string(sizeof(T));
+}
+
+template <size_t N>
+static std::string fieldFormat(const char (&)[N]) {
+    return "S" + std::to_string(N);
+}
+
+static int appendField(PyObject* list, const char* name, const std::string& format, size_t offset) {
+    PyObject* item = Py_BuildValue("(ssn)", name, format.c_str(), (Py_ssize_t)offset);
+    if (item == NULL) {
+        return -1;
+    }
+    int res = PyList_Append(list, item);
+    Py_DECREF(item);
+    return res;
+}
+
+#define MT4_FIELD(list, proto, type, name) \
+    if (appendField(list, #name, fieldFormat(proto.name), offsetof(type, name)) < 0) { Py_DECREF(list); return NULL; }
+
+static PyObject* tradeFields() {
+    static TradeRecord proto;
+    PyObject* list = PyList_New(0);
+    if (list == NULL) return NULL;
+    
+    MT4_FIELD(list, proto, TradeRecord, order);
+    MT4_FIELD(list, proto, TradeRecord, login);
+    MT4_FIELD(list, proto, TradeRecord, symbol);
+    MT4_FIELD(list, proto, TradeRecord, digits);
+    MT4_FIELD(list, proto, TradeRecord, cmd);
+    MT4_FIELD(list, proto, TradeRecord, volume);
+    MT4_FIELD(list, proto, TradeRecord, open_time);
+    MT4_FIELD(list, proto, TradeRecord, state);
+    MT4_FIELD(list, proto, TradeRecord, open_price);
+    MT4_FIELD(list, proto, TradeRecord, sl);
+    MT4_FIELD(list, proto, TradeRecord, tp);
+    MT4_FIELD(list, proto, TradeRecord, close_time);
+    MT4_FIELD(list, proto, TradeRecord, commission);
+    MT4_FIELD(list, proto, TradeRecord, storage);
+    MT4_FIELD(list, proto, TradeRecord, close_price);
+    MT4_FIELD(list, proto, TradeRecord, profit);
+    MT4_FIELD(list, proto, TradeRecord, taxes);
+    MT4_FIELD(list, proto, TradeRecord, magic);
+    MT4_FIELD(list, proto, TradeRecord, comment);
+    return list;
+}
+
+static PyObject* userFields() {
+    static UserRecord proto;
+    PyObject* list = PyList_New(0);
+    if (list == NULL) return NULL;
+    
+    MT4_FIELD(list, proto, UserRecord, login);
+    MT4_FIELD(list, proto, UserRecord, group);
+    MT4_FIELD(list, proto, UserRecord, name);
+    MT4_FIELD(list, proto, UserRecord, email);
+    MT4_FIELD(list, proto, UserRecord, regdate);
+    MT4_FIELD(list, proto, UserRecord, lastdate);
+    MT4_FIELD(list, proto, UserRecord, leverage);
+    MT4_FIELD(list, proto, UserRecord, balance);
+    MT4_FIELD(list, proto, UserRecord, credit);
+    return list;
+}
+
+static PyObject* symbolFields() {
+    static ConSymbol proto;
+    PyObject* list = PyList_New(0);
+    if (list == NULL) return NULL;
+    
+    MT4_FIELD(list, proto, ConSymbol, symbol);
+    MT4_FIELD(list, proto, ConSymbol, description);
+    MT4_FIELD(list, proto, ConSymbol, currency);
+    MT4_FIELD(list, proto, ConSymbol, digits);
+    MT4_FIELD(list, proto, ConSymbol, point);
+    MT4_FIELD(list, proto, ConSymbol, spread);
+    MT4_FIELD(list, proto, ConSymbol, contract_size);
+    MT4_FIELD(list, proto, ConSymbol, tick_value);
+    MT4_FIELD(list, proto, ConSymbol, tick_size);
+    MT4_FIELD(list, proto, ConSymbol, margin_mode);
+    return list;
+}
+
+static PyObject* barFields() {
+    static MT4Bar proto;
+    PyObject* list = PyList_New(0);
+    if (list == NULL) return NULL;
+    
+    MT4_FIELD(list, proto, MT4Bar, time);
+    MT4_FIELD(list, proto, MT4Bar, symbol_id);
+    MT4_FIELD(list, proto, MT4Bar, period);
+    MT4_FIELD(list, proto, MT4Bar, ticks);
+    MT4_FIELD(list, proto, MT4Bar, open);
+    MT4_FIELD(list, proto, MT4Bar, high);
+    MT4_FIELD(list, proto, MT4Bar, low);
+    MT4_FIELD(list, proto, MT4Bar, close);
+    return list;
+}
+
+//+------------------------------------------------------------------+
+//| Manager - MT4Manager with the GIL released around server calls   |
+//+------------------------------------------------------------------+
+struct ManagerObject {
+    PyObject_HEAD
+    MT4Manager* manager;
+    std::mutex* lock;                   // serializes calls from Python threads
+};
+
+// Run fn(MT4Manager&) without the GIL, one call at a time per manager
+template <class Fn>
+static auto withoutGil(ManagerObject* self, Fn fn) -> decltype(fn(*self->manager)) {
+    struct Restore {
+        PyThreadState* state;
+        ~Restore() { PyEval_RestoreThread(state); }
+    } restore = { PyEval_SaveThread() };
+    
+    std::lock_guard<std::mutex> lock(*self->lock);
+    return fn(*self->manager);
+}
+
+//+------------------------------------------------------------------+
+//| RecordBuffer - Read-only buffer over a Manager API result array  |
+//+------------------------------------------------------------------+
+struct RecordBufferObject {
+    PyObject_HEAD
+    ManagerObject* owner;               // keeps the issuer alive; NULL when records came from malloc
+    CManagerInterface* issuer;
+    void* records;
+    Py_ssize_t count;
+    Py_ssize_t itemsize;
+    int kind;
+};
+
+static char g_empty_records[1];
+
+// Manager API records go back under the owner's lock, so MemFree never
+// races a call on the same interface from another Python thread
+static void RecordBuffer_dealloc(RecordBufferObject* self) {
+    if (self->owner != NULL) {
+        if (self->records != NULL) {
+            CManagerInterface* issuer = self->issuer;
+            void* records = self->records;
+            withoutGil(self->owner, [&](MT4Manager&) { issuer->MemFree(records); return 0; });
+        }
+        Py_DECREF((PyObject*)self->owner);
+    } else {
+        free(self->records);
+    }
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int RecordBuffer_getbuffer(RecordBufferObject* self, Py_buffer* view, int flags) {
+    void* data = self->records != NULL ? self->records : g_empty_records;
+    return PyBuffer_FillInfo(view, (PyObject*)self, data, self->count * self->itemsize, 1, flags);
+}
+
+static Py_ssize_t RecordBuffer_length(RecordBufferObject* self) {
+    return self->count;
+}
+
+static PyObject* RecordBuffer_get_count(RecordBufferObject* self, void*) {
+    return PyLong_FromSsize_t(self->count);
+}
+
+static PyObject* RecordBuffer_get_itemsize(RecordBufferObject* self, void*) {
+    return PyLong_FromSsize_t(self->itemsize);
+}
+
+static PyObject* RecordBuffer_get_kind(RecordBufferObject* self, void*) {
+    return PyLong_FromLong(self->kind);
+}
+
+static PyBufferProcs RecordBuffer_as_buffer = {
+    (getbufferproc)RecordBuffer_getbuffer,
+    NULL
+};
+
+static PySequenceMethods RecordBuffer_as_sequence = {
+    (lenfunc)RecordBuffer_length,
+};
+
+static PyGetSetDef RecordBuffer_getset[] = {
+    {"count", (getter)RecordBuffer_get_count, NULL, "Number of records", NULL},
+    {"itemsize", (getter)RecordBuffer_get_itemsize, NULL, "Size of one record in bytes", NULL},
+    {"kind", (getter)RecordBuffer_get_kind, NULL, "Record kind (KIND_TRADE, KIND_USER, KIND_SYMBOL, KIND_BAR)", NULL},
+    {NULL}
+};
+
+static PyTypeObject RecordBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mt4native.RecordBuffer",
+};
+
+// Wrap a record view; takes ownership of its array and a reference to owner
+template <class T>
+static PyObject* makeRecordBuffer(ManagerObject* owner, MT4RecordView<T>& view, int kind) {
+    RecordBufferObject* self = PyObject_New(RecordBufferObject, &RecordBufferType);
+    if (self == NULL) {
+        return NULL;
+    }
+    
+    Py_INCREF((PyObject*)owner);
+    self->owner = owner;
+    self->issuer = view.issuer();
+    self->count = view.size();
+    self->itemsize = sizeof(T);
+    self->kind = kind;
+    self->records = view.release();
+    return (PyObject*)self;
+}
+
+// Wrap a copy of bars in a buffer that owns it
+static PyObject* makeBarBuffer(const std::vector<MT4Bar>& bars) {
+    void* records = NULL;
+    if (!bars.empty()) {
+        records = malloc(bars.size() * sizeof(MT4Bar));
+        if (records == NULL) {
+            return PyErr_NoMemory();
+        }
+        memcpy(records, bars.data(), bars.size() * sizeof(MT4Bar));
+    }
+    
+    RecordBufferObject* self = PyObject_New(RecordBufferObject, &RecordBufferType);
+    if (self == NULL) {
+        free(records);
+        return NULL;
+    }
+    
+    self->owner = NULL;
+    self->issuer = NULL;
+    self->count = (Py_ssize_t)bars.size();
+    self->itemsize = sizeof(MT4Bar);
+    self->kind = KIND_BAR;
+    self->records = records;
+    return (PyObject*)self;
+}
+
+static PyObject* Manager_new(PyTypeObject* type, PyObject*, PyObject*) {
+    ManagerObject* self = (ManagerObject*)type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    
+    self->manager = new MT4Manager();
+    self->lock = new std::mutex();
+    
+    if (!self->manager->isValid()) {
+        PyErr_SetString(PyExc_RuntimeError, "Failed to load the MT4 Manager API (mtmanapi.dll)");
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject*)self;
+}
+
+static void Manager_dealloc(ManagerObject* self) {
+    if (self->manager != NULL) {
+        withoutGil(self, [](MT4Manager& m) { m.disconnect(); return 0; });
+        delete self->manager;
+    }
+    delete self->lock;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject* Manager_connect(ManagerObject* self, PyObject* args) {
+    const char* server;
+    if (!PyArg_ParseTuple(args, "s", &server)) {
+        return NULL;
+    }
+    std::string host(server);
+    return PyBool_FromLong(withoutGil(self, [&](MT4Manager& m) { return m.connect(host.c_str()); }));
+}
+
+static PyObject* Manager_login(ManagerObject* self, PyObject* args) {
+    int login;
+    const char* password;
+    if (!PyArg_ParseTuple(args, "is", &login, &password)) {
+        return NULL;
+    }
+    std::string pass(password);
+    return PyBool_FromLong(withoutGil(self, [&](MT4Manager& m) { return m.login(login, pass.c_str()); }));
+}
+
+static PyObject* Manager_disconnect(ManagerObject* self, PyObject*) {
+    withoutGil(self, [](MT4Manager& m) { m.disconnect(); return 0; });
+    Py_RETURN_NONE;
+}
+
+static PyObject* Manager_is_connected(ManagerObject* self, PyObject*) {
+    return PyBool_FromLong(withoutGil(self, [](MT4Manager& m) { return m.isConnected(); }));
+}
+
+static PyObject* Manager_is_logged_in(ManagerObject* self, PyObject*) {
+    return PyBool_FromLong(withoutGil(self, [](MT4Manager& m) { return m.isLoggedIn(); }));
+}
+
+static PyObject* Manager_last_error(ManagerObject* self, PyObject*) {
+    std::string error = withoutGil(self, [](MT4Manager& m) { return std::string(m.getLastError()); });
+    return PyUnicode_DecodeLatin1(error.c_str(), (Py_ssize_t)error.size(), "replace");
+}
+
+static PyObject* Manager_server_time(ManagerObject* self, PyObject*) {
+    return PyLong_FromLongLong((long long)withoutGil(self, [](MT4Manager& m) { return m.getServerTime(); }));
+}
+
+static PyObject* Manager_trades(ManagerObject* self, PyObject*) {
+    TradeRecordView view = withoutGil(self, [](MT4Manager& m) { return m.getTradesView(); });
+    return makeRecordBuffer(self, view, KIND_TRADE);
+}
+
+static PyObject* Manager_trades_by_login(ManagerObject* self, PyObject* args) {
+    int login;
+    if (!PyArg_ParseTuple(args, "i", &login)) {
+        return NULL;
+    }
+    TradeRecordView view = withoutGil(self, [&](MT4Manager& m) { return m.getTradesByLoginView(login); });
+    return makeRecordBuffer(self, view, KIND_TRADE);
+}
+
+static PyObject* Manager_trades_by_symbol(ManagerObject* self, PyObject* args) {
+    const char* symbol;
+    if (!PyArg_ParseTuple(args, "s", &symbol)) {
+        return NULL;
+    }
+    std::string name(symbol);
+    TradeRecordView view = withoutGil(self, [&](MT4Manager& m) { return m.getTradesBySymbolView(name.c_str()); });
+    return makeRecordBuffer(self, view, KIND_TRADE);
+}
+
+static PyObject* Manager_accounts(ManagerObject* self, PyObject*) {
+    UserRecordView view = withoutGil(self, [](MT4Manager& m) { return m.getAccountsView(); });
+    return makeRecordBuffer(self, view, KIND_USER);
+}
+
+static PyObject* Manager_symbols(ManagerObject* self, PyObject*) {
+    SymbolRecordView view = withoutGil(self, [](MT4Manager& m) { return m.getSymbolsView(); });
+    return makeRecordBuffer(self, view, KIND_SYMBOL);
+}
+
+static PyObject* Manager_margin_level(ManagerObject* self, PyObject* args) {
+    int login;
+    if (!PyArg_ParseTuple(args, "i", &login)) {
+        return NULL;
+    }
+    
+    double balance = 0, equity = 0, margin = 0, free_margin = 0, level = 0;
+    bool ok = withoutGil(self, [&](MT4Manager& m) {
+        return m.getMarginLevel(login, balance, equity, margin, free_margin, level);
+    });
+    
+    if (!ok) {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("{s:d,s:d,s:d,s:d,s:d}", "balance", balance, "equity", equity,
+                         "margin", margin, "free_margin", free_margin, "margin_level", level);
+}
+
+static PyObject* Manager_quote(ManagerObject* self, PyObject* args) {
+    const char* symbol;
+    if (!PyArg_ParseTuple(args, "s", &symbol)) {
+        return NULL;
+    }
+    
+    std::string name(symbol);
+    MT4Quote quote;
+    bool ok = withoutGil(self, [&](MT4Manager& m) { return m.getQuote(name.c_str(), quote); });
+    
+    if (!ok) {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(ddL)", quote.bid, quote.ask, (long long)quote.time);
+}
+
+static PyObject* Manager_symbol_id(ManagerObject* self, PyObject* args) {
+    const char* symbol;
+    if (!PyArg_ParseTuple(args, "s", &symbol)) {
+        return NULL;
+    }
+    
+    std::string name(symbol);
+    // The quote table assigns the ids the wire encoders use; the dictionary
+    // only mirrors them once something syncs it
+    return PyLong_FromLong(withoutGil(self, [&](MT4Manager& m) { return m.getQuoteTable().findSymbol(name.c_str()); }));
+}
+
+static PyObject* Manager_open_trade(ManagerObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"login", "symbol", "cmd", "volume", "price", "sl", "tp", "comment", NULL};
+    int login, cmd;
+    const char* symbol;
+    const char* comment = "";
+    double volume, price, sl = 0, tp = 0;
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "isidd|dds", (char**)keywords,
+                                     &login, &symbol, &cmd, &volume, &price, &sl, &tp, &comment)) {
+        return NULL;
+    }
+    
+    std::string name(symbol), note(comment);
+    int ticket = withoutGil(self, [&](MT4Manager& m) {
+        return m.openTrade(login, name.c_str(), cmd, volume, price, sl, tp, note.c_str());
+    });
+    return PyLong_FromLong(ticket);
+}
+
+static PyObject* Manager_close_trade(ManagerObject* self, PyObject* args) {
+    int ticket;
+    double price = 0;
+    if (!PyArg_ParseTuple(args, "i|d", &ticket, &price)) {
+        return NULL;
+    }
+    return PyBool_FromLong(withoutGil(self, [&](MT4Manager& m) { return m.closeTrade(ticket, price); }));
+}
+
+static PyObject* Manager_modify_trade(ManagerObject* self, PyObject* args) {
+    int ticket;
+    double sl, tp;
+    if (!PyArg_ParseTuple(args, "idd", &ticket, &sl, &tp)) {
+        return NULL;
+    }
+    return PyBool_FromLong(withoutGil(self, [&](MT4Manager& m) { return m.modifyTrade(ticket, sl, tp); }));
+}
+
+static PyObject* Manager_start_pumping(ManagerObject* self, PyObject*) {
+    return PyBool_FromLong(withoutGil(self, [](MT4Manager& m) { return m.startPumping(); }));
+}
+
+static PyObject* Manager_stop_pumping(ManagerObject* self, PyObject*) {
+    withoutGil(self, [](MT4Manager& m) { m.stopPumping(); return 0; });
+    Py_RETURN_NONE;
+}
+
+static PyObject* Manager_is_pumping(ManagerObject* self, PyObject*) {
+    return PyBool_FromLong(withoutGil(self, [](MT4Manager& m) { return m.isPumping(); }));
+}
+
+static PyObject* Manager_enable_bars(ManagerObject* self, PyObject* args) {
+    int history = MT4_BAR_HISTORY;
+    if (!PyArg_ParseTuple(args, "|i", &history)) {
+        return NULL;
+    }
+    if (history > MT4_BAR_MAX_HISTORY) {
+        PyErr_Format(PyExc_ValueError, "Bar history %d is above %d", history, MT4_BAR_MAX_HISTORY);
+        return NULL;
+    }
+    return PyBool_FromLong(withoutGil(self, [&](MT4Manager& m) { return m.enableBars(history); }));
+}
+
+static PyObject* Manager_bars(ManagerObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"symbol", "period", "count", "forming", NULL};
+    const char* symbol;
+    int period = MT4_BAR_M1, count = MT4_BAR_HISTORY, forming = 1;
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|iip", (char**)keywords, &symbol, &period, &count, &forming)) {
+        return NULL;
+    }
+    if (period < 0 || period >= MT4_BAR_PERIOD_COUNT) {
+        PyErr_Format(PyExc_ValueError, "Unknown bar period %d", period);
+        return NULL;
+    }
+    
+    std::string name(symbol);
+    std::vector<MT4Bar> bars;
+    bool ok;
+    try {
+        ok = withoutGil(self, [&](MT4Manager& m) {
+            return m.getBars(name.c_str(), (MT4BarPeriod)period, bars, count, forming != 0);
+        });
+    } catch (const std::bad_alloc&) {
+        return PyErr_NoMemory();
+    }
+    
+    if (!ok) {
+        Py_RETURN_NONE;
+    }
+    return makeBarBuffer(bars);
+}
+
+// Lock-free snapshot; does not wait for a call running on another thread
+static PyObject* Manager_metrics(ManagerObject* self, PyObject*) {
+    std::vector<char> buffer(16384);
+    
+    for (;;) {
+        MT4Writer w(&buffer[0], buffer.size());
+        self->manager->metricsJson(w);
+        if (!w.overflowed()) {
+            return PyUnicode_FromStringAndSize(w.data(), (Py_ssize_t)w.size());
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+static PyMethodDef Manager_methods[] = {
+    {"connect", (PyCFunction)Manager_connect, METH_VARARGS, "connect(server) -> bool"},
+    {"login", (PyCFunction)Manager_login, METH_VARARGS, "login(login, password) -> bool"},
+    {"disconnect", (PyCFunction)Manager_disconnect, METH_NOARGS, "Disconnect from the server"},
+    {"is_connected", (PyCFunction)Manager_is_connected, METH_NOARGS, "Check the connection state"},
+    {"is_logged_in", (PyCFunction)Manager_is_logged_in, METH_NOARGS, "Check the login state"},
+    {"last_error", (PyCFunction)Manager_last_error, METH_NOARGS, "Last error message"},
+    {"server_time", (PyCFunction)Manager_server_time, METH_NOARGS, "Server time as a Unix timestamp"},
+    {"trades", (PyCFunction)Manager_trades, METH_NOARGS, "All open trades as a RecordBuffer"},
+    {"trades_by_login", (PyCFunction)Manager_trades_by_login, METH_VARARGS, "Open trades of a login as a RecordBuffer"},
+    {"trades_by_symbol", (PyCFunction)Manager_trades_by_symbol, METH_VARARGS, "Open trades of a symbol as a RecordBuffer"},
+    {"accounts", (PyCFunction)Manager_accounts, METH_NOARGS, "All accounts as a RecordBuffer"},
+    {"symbols", (PyCFunction)Manager_symbols, METH_NOARGS, "All symbols as a RecordBuffer"},
+    {"margin_level", (PyCFunction)Manager_margin_level, METH_VARARGS, "margin_level(login) -> dict or None"},
+    {"quote", (PyCFunction)Manager_quote, METH_VARARGS, "quote(symbol) -> (bid, ask, time) or None"},
+    {"symbol_id", (PyCFunction)Manager_symbol_id, METH_VARARGS, "symbol_id(symbol) -> dense id used in wire frames, -1 if unknown"},
+    {"open_trade", (PyCFunction)(void (*)(void))Manager_open_trade, METH_VARARGS | METH_KEYWORDS,
+     "open_trade(login, symbol, cmd, volume, price, sl=0, tp=0, comment='') -> ticket or 0"},
+    {"close_trade", (PyCFunction)Manager_close_trade, METH_VARARGS, "close_trade(ticket, price=0) -> bool"},
+    {"modify_trade", (PyCFunction)Manager_modify_trade, METH_VARARGS, "modify_trade(ticket, sl, tp) -> bool"},
+    {"start_pumping", (PyCFunction)Manager_start_pumping, METH_NOARGS, "Start the native pumping engine"},
+    {"stop_pumping", (PyCFunction)Manager_stop_pumping, METH_NOARGS, "Stop the native pumping engine"},
+    {"is_pumping", (PyCFunction)Manager_is_pumping, METH_NOARGS, "Check if pumping is active"},
+    {"enable_bars", (PyCFunction)Manager_enable_bars, METH_VARARGS,
+     "enable_bars(history=1024) -> bool; build M1/M5/H1 bars from pumped quotes,"
+     " history at most BAR_MAX_HISTORY"},
+    {"bars", (PyCFunction)(void (*)(void))Manager_bars, METH_VARARGS | METH_KEYWORDS,
+     "bars(symbol, period=BAR_M1, count=1024, forming=True) -> RecordBuffer or None"},
+    {"metrics", (PyCFunction)Manager_metrics, METH_NOARGS, "Latency histograms and queue counters as a JSON string"},
+    {NULL}
+};
+
+static PyTypeObject ManagerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "mt4native.Manager",
+};
+
+//+------------------------------------------------------------------+
+//| Module                                                           |
+//+------------------------------------------------------------------+
+static PyObject* module_record_fields(PyObject*, PyObject* args) {
+    int kind;
+    if (!PyArg_ParseTuple(args, "i", &kind)) {
+        return NULL;
+    }
+    
+    PyObject* fields;
+    Py_ssize_t itemsize;
+    
+    switch (kind) {
+        case KIND_TRADE: fields = tradeFields(); itemsize = sizeof(TradeRecord); break;
+        case KIND_USER: fields = userFields(); itemsize = sizeof(UserRecord); break;
+        case KIND_SYMBOL: fields = symbolFields(); itemsize = sizeof(ConSymbol); break;
+        case KIND_BAR: fields = barFields(); itemsize = sizeof(MT4Bar); break;
+        default:
+            PyErr_Format(PyExc_ValueError, "Unknown record kind %d", kind);
+            return NULL;
+    }
+    
+    if (fields == NULL) {
+        return NULL;
+    }
+    return Py_BuildValue("(nN)", itemsize, fields);
+}
+
+// Summarize latencies in nanoseconds with the histogram used for metrics()
+static PyObject* module_latency_summary(PyObject*, PyObject* args) {
+    PyObject* samples;
+    if (!PyArg_ParseTuple(args, "O", &samples)) {
+        return NULL;
+    }
+    
+    PyObject* iterator = PyObject_GetIter(samples);
+    if (iterator == NULL) {
+        return NULL;
+    }
+    
+    MT4LatencyHistogram histogram;
+    PyObject* item;
+    while ((item = PyIter_Next(iterator)) != NULL) {
+        unsigned long long nanos = PyLong_AsUnsignedLongLong(item);
+        Py_DECREF(item);
+        if (PyErr_Occurred()) {
+            Py_DECREF(iterator);
+            return NULL;
+        }
+        histogram.record(nanos);
+    }
+    Py_DECREF(iterator);
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
+    
+    MT4LatencySummary s = histogram.summarize();
+    return Py_BuildValue("{s:K,s:d,s:d,s:d,s:d,s:d,s:d}", "count", (unsigned long long)s.count,
+                         "mean_us", s.mean_us, "p50_us", s.p50_us, "p90_us", s.p90_us,
+                         "p99_us", s.p99_us, "p999_us", s.p999_us, "max_us", s.max_us);
+}
+
+// Build bars from (symbol, bid, lasttime) ticks in pumped order, each
+// one a quote batch of its own, with a bar builder of its own
+static PyObject* module_replay_bars(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"ticks", "symbol", "period", "history", "forming", NULL};
+    PyObject* ticks;
+    const char* symbol;
+    int period = MT4_BAR_M1, history = MT4_BAR_HISTORY, forming = 1;
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Os|iip", (char**)keywords, &ticks, &symbol, &period, &history,
+                                     &forming)) {
+        return NULL;
+    }
+    if (period < 0 || period >= MT4_BAR_PERIOD_COUNT) {
+        PyErr_Format(PyExc_ValueError, "Unknown bar period %d", period);
+        return NULL;
+    }
+    if (history > MT4_BAR_MAX_HISTORY) {
+        PyErr_Format(PyExc_ValueError, "Bar history %d is above %d", history, MT4_BAR_MAX_HISTORY);
+        return NULL;
+    }
+    
+    // A failed allocation of the builder, a symbol's bars or the copy
+    // becomes MemoryError; the iterator is cleared once done with
+    PyObject* iterator = NULL;
+    try {
+        std::unique_ptr<MT4QuoteTable> quotes(new MT4QuoteTable());
+        std::unique_ptr<MT4BarBuilder> builder(new MT4BarBuilder(*quotes));
+        if (!builder->init(history)) {
+            PyErr_Format(PyExc_ValueError, "Invalid bar history %d", history);
+            return NULL;
+        }
+        
+        iterator = PyObject_GetIter(ticks);
+        if (iterator == NULL) {
+            return NULL;
+        }
+        
+        PyObject* item;
+        while ((item = PyIter_Next(iterator)) != NULL) {
+            const char* name;
+            double bid;
+            long long lasttime;
+            int ok = PyArg_ParseTuple(item, "sdL", &name, &bid, &lasttime);
+            Py_DECREF(item);
+            if (!ok) {
+                Py_DECREF(iterator);
+                return NULL;
+            }
+            if (quotes->registerSymbol(name) < 0) {
+                Py_DECREF(iterator);
+                PyErr_SetString(PyExc_ValueError, "Too many symbols");
+                return NULL;
+            }
+            
+            SymbolInfo quote;
+            memset(&quote, 0, sizeof(quote));
+            strncpy(quote.symbol, name, sizeof(quote.symbol) - 1);
+            quote.bid = bid;
+            quote.ask = bid;
+            quote.lasttime = (time_t)lasttime;
+            builder->onQuotes(&quote, 1);
+        }
+        Py_CLEAR(iterator);
+        if (PyErr_Occurred()) {
+            return NULL;
+        }
+        
+        std::vector<MT4Bar> bars(history + 1);
+        bars.resize(builder->getBars(symbol, (MT4BarPeriod)period, bars.data(), history + 1, forming != 0));
+        
+        PyObject* buffer = makeBarBuffer(bars);
+        if (buffer == NULL) {
+            return NULL;
+        }
+        return Py_BuildValue("(NK)", buffer, builder->getLateCount());
+    } catch (const std::bad_alloc&) {
+        Py_XDECREF(iterator);
+        return PyErr_NoMemory();
+    }
+}
+
+static PyMethodDef module_methods[] = {
+    {"record_fields", module_record_fields, METH_VARARGS,
+     "record_fields(kind) -> (itemsize, [(name, format, offset), ...])"},
+    {"latency_summary", module_latency_summary, METH_VARARGS,
+     "latency_summary(nanoseconds) -> dict of count, mean and percentiles in microseconds"},
+    {"replay_bars", (PyCFunction)(void (*)(void))module_replay_bars, METH_VARARGS | METH_KEYWORDS,
+     "replay_bars(ticks, symbol, period=BAR_M1, history=1024, forming=True) -> (RecordBuffer, late ticks);"
+     " history is at most BAR_MAX_HISTORY"},
+    {NULL}
+};
+
+static PyModuleDef mt4native_module = {
+    PyModuleDef_HEAD_INIT,
+    "mt4native",
+    "Native MT4 Manager API bindings",
+    -1,
+    module_methods
+};
+
+PyMODINIT_FUNC PyInit_mt4native(void) {
+    RecordBufferType.tp_basicsize = sizeof(RecordBufferObject);
+    RecordBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RecordBufferType.tp_doc = "Read-only buffer over a Manager API record array or bar copy";
+    RecordBufferType.tp_dealloc = (destructor)RecordBuffer_dealloc;
+    RecordBufferType.tp_as_buffer = &RecordBuffer_as_buffer;
+    RecordBufferType.tp_as_sequence = &RecordBuffer_as_sequence;
+    RecordBufferType.tp_getset = RecordBuffer_getset;
+    
+    ManagerType.tp_basicsize = sizeof(ManagerObject);
+    ManagerType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ManagerType.tp_doc = "MT4 Manager API connection";
+    ManagerType.tp_new = Manager_new;
+    ManagerType.tp_dealloc = (destructor)Manager_dealloc;
+    ManagerType.tp_methods = Manager_methods;
+    
+    if (PyType_Ready(&RecordBufferType) < 0 || PyType_Ready(&ManagerType) < 0) {
+        return NULL;
+    }
+    
+    PyObject* module = PyModule_Create(&mt4native_module);
+    if (module == NULL) {
+        return NULL;
+    }
+    
+    Py_INCREF(&RecordBufferType);
+    Py_INCREF(&ManagerType);
+    if (PyModule_AddObject(module, "RecordBuffer", (PyObject*)&RecordBufferType) < 0 ||
+        PyModule_AddObject(module, "Manager", (PyObject*)&ManagerType) < 0 ||
+        PyModule_AddIntConstant(module, "KIND_TRADE", KIND_TRADE) < 0 ||
+        PyModule_AddIntConstant(module, "KIND_USER", KIND_USER) < 0 ||
+        PyModule_AddIntConstant(module, "KIND_SYMBOL", KIND_SYMBOL) < 0 ||
+        PyModule_AddIntConstant(module, "KIND_BAR", KIND_BAR) < 0 ||
+        PyModule_AddIntConstant(module, "BAR_M1", MT4_BAR_M1) < 0 ||
+        PyModule_AddIntConstant(module, "BAR_M5", MT4_BAR_M5) < 0 ||
+        PyModule_AddIntConstant(module, "BAR_H1", MT4_BAR_H1) < 0 ||
+        PyModule_AddIntConstant(module, "BAR_MAX_HISTORY", MT4_BAR_MAX_HISTORY) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    
+    return module;
+}
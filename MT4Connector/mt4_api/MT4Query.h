@@ -0,0 +1,580 @@
+//+------------------------------------------------------------------+
+//|                Filtered Queries over the Trade and Account Caches |
+//+------------------------------------------------------------------+
+#ifndef MT4QUERY_H
+#define MT4QUERY_H
+
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <vector>
+#include <limits>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <string>
+#include "MT4Dictionary.h"
+#include "MT4TradeBook.h"
+#include "MT4ColumnStore.h"
+
+// Rows evaluated per mask block; sized to stay in L1
+#define MT4_QUERY_BLOCK 1024
+
+// Rows each extra thread must get before a query is split
+#define MT4_QUERY_PARALLEL_MIN 32768
+
+// Largest login span kept as a bitmap; wider spans use a hash set
+#define MT4_QUERY_BITMAP_SPAN (1 << 24)
+
+//+------------------------------------------------------------------+
+//| MT4MatchGroup - MT4 style group mask test                        |
+//| The mask is a comma list of patterns where '*' matches any run   |
+//| and '?' one character; a leading '!' excludes. A group matches   |
+//| when some plain pattern matches and no excluding one does, so    |
+//| "real-*,!real-test" selects every real group but real-test. A    |
+//| NULL or empty mask matches every group.                          |
+//+------------------------------------------------------------------+
+inline bool MT4MatchPattern(const char* name, const char* pattern, const char* end) {
+    const char* star = NULL;
+    const char* resume = NULL;
+    
+    while (*name) {
+        if (pattern < end && (*pattern == '?' || *pattern == *name)) {
+            pattern++;
+            name++;
+        } else if (pattern < end && *pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (star != NULL) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return false;
+        }
+    }
+    
+    while (pattern < end && *pattern == '*') {
+        pattern++;
+    }
+    return pattern == end;
+}
+
+inline bool MT4MatchGroup(const char* group, const char* mask) {
+    if (mask == NULL || *mask == 0) {
+        return true;
+    }
+    
+    bool matched = false;
+    while (*mask) {
+        const char* end = strchr(mask, ',');
+        if (end == NULL) {
+            end = mask + strlen(mask);
+        }
+        
+        if (*mask == '!') {
+            if (MT4MatchPattern(group, mask + 1, end)) {
+                return false;
+            }
+        } else if (!matched && MT4MatchPattern(group, mask, end)) {
+            matched = true;
+        }
+        
+        mask = *end ? end + 1 : end;
+    }
+    return matched;
+}
+
+//+------------------------------------------------------------------+
+//| MT4TradeQuery - Predicates over open trades                      |
+//| Unset fields match everything. Ranges are inclusive; profit is   |
+//| the record's as last pumped, so "loss over 100" is profit_max of |
+//| -100. Groups come from the account store, so a group predicate   |
+//| only sees logins the store knows.                                |
+//+------------------------------------------------------------------+
+struct MT4TradeQuery {
+    const char* group;          // group name or mask, NULL for any
+    const char* symbol;         // NULL for any
+    int login;                  // 0 for any
+    int cmd;                    // OP_BUY..OP_SELL_STOP, -1 for any
+    time_t open_from;           // 0 for unbounded
+    time_t open_to;             // 0 for unbounded
+    double profit_min;
+    double profit_max;
+    int volume_min;             // lots * 100
+    int volume_max;
+    
+    MT4TradeQuery() : group(NULL), symbol(NULL), login(0), cmd(-1), open_from(0), open_to(0),
+                      profit_min(-DBL_MAX), profit_max(DBL_MAX), volume_min(0), volume_max(INT_MAX) {}
+};
+
+//+------------------------------------------------------------------+
+//| MT4AccountQuery - Predicates over accounts                       |
+//+------------------------------------------------------------------+
+struct MT4AccountQuery {
+    const char* group;          // group name or mask, NULL for any
+    double balance_min;
+    double balance_max;
+    double credit_min;
+    double credit_max;
+    int leverage_min;
+    int leverage_max;
+    
+    MT4AccountQuery() : group(NULL), balance_min(-DBL_MAX), balance_max(DBL_MAX),
+                        credit_min(-DBL_MAX), credit_max(DBL_MAX), leverage_min(0), leverage_max(INT_MAX) {}
+};
+
+//+------------------------------------------------------------------+
+//| MT4QueryEngine - Column scans answering MT4TradeQuery and        |
+//| MT4AccountQuery from the trade book and account store            |
+//| Rows are taken in blocks of MT4_QUERY_BLOCK. Equality predicates |
+//| are branch-free passes ANDing into a byte mask, which the        |
+//| compiler vectorizes; the survivors become a selection vector     |
+//| that the range predicates narrow without branches, and only the  |
+//| final rows' records are copied. Group masks resolve to group ids |
+//| and, for trades, a login set that is kept until the next account |
+//| change (MT4AccountStore::getVersion()) or another mask.          |
+//| A symbol predicate reads only the book's index list of it; other |
+//| trade scans can be split over threads, each on its own row range |
+//| while the caller holds the book's read lock.                     |
+//+------------------------------------------------------------------+
+class MT4QueryEngine {
+private:
+    // Logins of the accounts in the queried groups
+    class LoginSet {
+    private:
+        int m_base;
+        std::vector<unsigned long long> m_bits;
+        std::unordered_set<int> m_hash;
+        bool m_use_bits;
+    
+    public:
+        LoginSet() : m_base(0), m_use_bits(true) {}
+        
+        void build(const std::vector<int>& logins) {
+            if (logins.empty()) {
+                return;
+            }
+            
+            int low = logins[0];
+            int high = logins[0];
+            for (size_t i = 1; i < logins.size(); i++) {
+                low = logins[i] < low ? logins[i] : low;
+                high = logins[i] > high ? logins[i] : high;
+            }
+            
+            m_base = low;
+            m_use_bits = (long long)high - low < MT4_QUERY_BITMAP_SPAN;
+            if (m_use_bits) {
+                m_bits.assign(((size_t)(high - low) >> 6) + 1, 0);
+                for (size_t i = 0; i < logins.size(); i++) {
+                    unsigned int bit = (unsigned int)(logins[i] - m_base);
+                    m_bits[bit >> 6] |= 1ULL << (bit & 63);
+                }
+            } else {
+                m_hash.insert(logins.begin(), logins.end());
+            }
+        }
+        
+        bool contains(int login) const {
+            if (!m_use_bits) {
+                return m_hash.count(login) != 0;
+            }
+            unsigned long long bit = (unsigned long long)((long long)login - m_base);
+            return bit < ((unsigned long long)m_bits.size() << 6) && ((m_bits[bit >> 6] >> (bit & 63)) & 1) != 0;
+        }
+    };
+    
+    // A trade query resolved to ids
+    struct TradeFilter {
+        int symbol_id;              // -1 for any
+        int login;
+        int cmd;
+        time_t open_from;
+        time_t open_to;
+        bool by_profit;
+        double profit_min;
+        double profit_max;
+        bool by_volume;
+        int volume_min;
+        int volume_max;
+        std::shared_ptr<const LoginSet> logins;     // NULL for any group
+    };
+    
+    const MT4TradeBook& m_book;
+    const MT4AccountStore& m_accounts;
+    const MT4Dictionary& m_dictionary;
+    
+    // Login set of the last group mask and the account version it saw
+    mutable std::mutex m_cache_lock;
+    mutable std::string m_cached_mask;
+    mutable uint64_t m_cached_version;
+    mutable std::shared_ptr<const LoginSet> m_cached_logins;
+    
+    MT4QueryEngine(const MT4QueryEngine&);
+    MT4QueryEngine& operator=(const MT4QueryEngine&);
+    
+    // Mark the dictionary group ids matching mask; false if none do
+    bool matchGroups(const char* mask, std::vector<unsigned char>& groups) const {
+        int count = m_dictionary.getGroupCount();
+        bool any = false;
+        
+        groups.assign(count, 0);
+        for (int id = 0; id < count; id++) {
+            const char* name = m_dictionary.getGroupName(id);
+            if (name != NULL && MT4MatchGroup(name, mask)) {
+                groups[id] = 1;
+                any = true;
+            }
+        }
+        return any;
+    }
+    
+    // mask[j] &= v[j] == value; the value is a copy, so the byte stores
+    // cannot alias it and the loop vectorizes
+    template <class T>
+    static void maskEqual(unsigned char* mask, const T* v, int n, T value) {
+        for (int j = 0; j < n; j++) {
+            mask[j] &= v[j] == value;
+        }
+    }
+    
+    // Keep the selected rows with lo <= v[row] <= hi, without branches;
+    // returns the new selection size
+    template <class T>
+    static int keepRange(int* sel, int k, const T* v, T lo, T hi) {
+        int kept = 0;
+        for (int i = 0; i < k; i++) {
+            int row = sel[i];
+            sel[kept] = row;
+            kept += (v[row] >= lo) & (v[row] <= hi);
+        }
+        return kept;
+    }
+    
+    // Turn a block mask into row numbers base + j. Eight mask bytes are
+    // tested at once, so sparse blocks cost little; mask must be zero
+    // from n up to the next multiple of eight.
+    static int select(const unsigned char* mask, int base, int n, int* sel) {
+        int k = 0;
+        
+        for (int j = 0; j < n; j += 8) {
+            unsigned long long word;
+            memcpy(&word, mask + j, sizeof(word));
+            if (word == 0) {
+                continue;
+            }
+            for (int b = j; b < j + 8; b++) {
+                sel[k] = base + b;
+                k += mask[b];
+            }
+        }
+        return k;
+    }
+    
+    // Append the account rows that pass; the group table is indexed
+    // by group id (empty for any group)
+    static void scanAccounts(const MT4AccountStore::Columns& cols, const MT4AccountQuery& query,
+                             const std::vector<unsigned char>& groups, std::vector<int>& rows) {
+        unsigned char mask[MT4_QUERY_BLOCK];
+        int sel[MT4_QUERY_BLOCK];
+        bool by_balance = query.balance_min > -DBL_MAX || query.balance_max < DBL_MAX;
+        bool by_credit = query.credit_min > -DBL_MAX || query.credit_max < DBL_MAX;
+        bool by_leverage = query.leverage_min > 0 || query.leverage_max < INT_MAX;
+        int group_count = (int)groups.size();
+        
+        for (int base = 0; base < cols.count; base += MT4_QUERY_BLOCK) {
+            int n = cols.count - base < MT4_QUERY_BLOCK ? cols.count - base : MT4_QUERY_BLOCK;
+            memset(mask, 1, n);
+            memset(mask + n, 0, MT4_QUERY_BLOCK - n);
+            
+            if (group_count > 0) {
+                const int* v = cols.group_id + base;
+                for (int j = 0; j < n; j++) {
+                    mask[j] = (unsigned int)v[j] < (unsigned int)group_count && groups[v[j]];
+                }
+            }
+            
+            int k = select(mask, base, n, sel);
+            if (by_balance) {
+                k = keepRange(sel, k, cols.balance, query.balance_min, query.balance_max);
+            }
+            if (by_credit) {
+                k = keepRange(sel, k, cols.credit, query.credit_min, query.credit_max);
+            }
+            if (by_leverage) {
+                k = keepRange(sel, k, cols.leverage, query.leverage_min, query.leverage_max);
+            }
+            rows.insert(rows.end(), sel, sel + k);
+        }
+    }
+    
+    // Keep the selected rows with v[row] == value
+    template <class T>
+    static int keepEqual(int* sel, int k, const T* v, T value) {
+        int kept = 0;
+        for (int i = 0; i < k; i++) {
+            int row = sel[i];
+            sel[kept] = row;
+            kept += v[row] == value;
+        }
+        return kept;
+    }
+    
+    // Narrow a selection of trade slots by the range predicates and the
+    // login set; returns the new selection size
+    static int narrowTrades(const MT4TradeBook::Columns& cols, const TradeFilter& filter, int* sel, int k) {
+        if (filter.by_volume) {
+            k = keepRange(sel, k, cols.volume, filter.volume_min, filter.volume_max);
+        }
+        if (filter.open_from != 0 || filter.open_to != 0) {
+            time_t open_to = filter.open_to != 0 ? filter.open_to : std::numeric_limits<time_t>::max();
+            k = keepRange(sel, k, cols.open_time, filter.open_from, open_to);
+        }
+        if (filter.by_profit) {
+            k = keepRange(sel, k, cols.profit, filter.profit_min, filter.profit_max);
+        }
+        if (filter.logins) {
+            int kept = 0;
+            for (int i = 0; i < k; i++) {
+                int slot = sel[i];
+                sel[kept] = slot;
+                kept += filter.logins->contains(cols.login[slot]);
+            }
+            k = kept;
+        }
+        return k;
+    }
+    
+    // Append the trade slots in [begin, end) that pass. The equality
+    // predicates run as full-block mask passes; the ranges and the login
+    // set only look at the rows those leave.
+    static void scanTrades(const MT4TradeBook::Columns& cols, const TradeFilter& filter,
+                           int begin, int end, std::vector<int>& slots) {
+        unsigned char mask[MT4_QUERY_BLOCK];
+        int sel[MT4_QUERY_BLOCK];
+        
+        for (int base = begin; base < end; base += MT4_QUERY_BLOCK) {
+            int n = end - base < MT4_QUERY_BLOCK ? end - base : MT4_QUERY_BLOCK;
+            memcpy(mask, cols.live + base, n);
+            memset(mask + n, 0, MT4_QUERY_BLOCK - n);
+            
+            if (filter.symbol_id >= 0) {
+                maskEqual(mask, cols.symbol_id + base, n, filter.symbol_id);
+            }
+            if (filter.cmd >= 0) {
+                maskEqual(mask, cols.cmd + base, n, filter.cmd);
+            }
+            if (filter.login != 0) {
+                maskEqual(mask, cols.login + base, n, filter.login);
+            }
+            
+            int k = narrowTrades(cols, filter, sel, select(mask, base, n, sel));
+            slots.insert(slots.end(), sel, sel + k);
+        }
+    }
+    
+    // Append the slots of an index list (the orders of one symbol) that
+    // pass; only those rows are read
+    static void scanIndex(const MT4TradeBook::Columns& cols, const TradeFilter& filter,
+                          const std::vector<int>& index, std::vector<int>& slots) {
+        int sel[MT4_QUERY_BLOCK];
+        int total = (int)index.size();
+        
+        for (int base = 0; base < total; base += MT4_QUERY_BLOCK) {
+            int k = total - base < MT4_QUERY_BLOCK ? total - base : MT4_QUERY_BLOCK;
+            memcpy(sel, index.data() + base, k * sizeof(int));
+            
+            if (filter.cmd >= 0) {
+                k = keepEqual(sel, k, cols.cmd, filter.cmd);
+            }
+            if (filter.login != 0) {
+                k = keepEqual(sel, k, cols.login, filter.login);
+            }
+            
+            k = narrowTrades(cols, filter, sel, k);
+            slots.insert(slots.end(), sel, sel + k);
+        }
+    }
+    
+    // Logins of the accounts in the groups of mask, NULL if none
+    std::shared_ptr<const LoginSet> groupLogins(const char* mask) const {
+        uint64_t version = m_accounts.getVersion();
+        {
+            std::lock_guard<std::mutex> lock(m_cache_lock);
+            if (m_cached_logins && m_cached_version == version && m_cached_mask == mask) {
+                return m_cached_logins;
+            }
+        }
+        
+        MT4AccountQuery accounts;
+        accounts.group = mask;
+        
+        std::vector<int> members;
+        if (!selectLogins(accounts, members) || members.empty()) {
+            return std::shared_ptr<const LoginSet>();
+        }
+        
+        std::shared_ptr<LoginSet> logins(new LoginSet());
+        logins->build(members);
+        
+        std::lock_guard<std::mutex> lock(m_cache_lock);
+        m_cached_mask = mask;
+        m_cached_version = version;
+        m_cached_logins = logins;
+        return logins;
+    }
+    
+    // Resolve a trade query; false if nothing can match
+    bool resolve(const MT4TradeQuery& query, TradeFilter& filter) const {
+        filter.symbol_id = -1;
+        if (query.symbol != NULL) {
+            filter.symbol_id = m_dictionary.findSymbol(query.symbol);
+            if (filter.symbol_id < 0) {
+                return false;
+            }
+        }
+        
+        filter.login = query.login;
+        filter.cmd = query.cmd;
+        filter.open_from = query.open_from;
+        filter.open_to = query.open_to;
+        filter.by_profit = query.profit_min > -DBL_MAX || query.profit_max < DBL_MAX;
+        filter.profit_min = query.profit_min;
+        filter.profit_max = query.profit_max;
+        filter.by_volume = query.volume_min > 0 || query.volume_max < INT_MAX;
+        filter.volume_min = query.volume_min;
+        filter.volume_max = query.volume_max;
+        filter.logins.reset();
+        
+        if (query.group != NULL && *query.group != 0) {
+            filter.logins = groupLogins(query.group);
+            if (!filter.logins) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Scan the trade book, split over up to threads threads, and pass
+    // the matching slots to fn(cols, slots)
+    template <class Fn>
+    bool runTrades(const MT4TradeQuery& query, int threads, Fn fn) const {
+        TradeFilter filter;
+        if (!resolve(query, filter)) {
+            return false;
+        }
+        
+        m_book.read([&](const MT4TradeBook::Columns& cols) {
+            // A symbol narrows the rows to its index list
+            if (filter.symbol_id >= 0 && filter.symbol_id < cols.symbol_count) {
+                std::vector<int> slots;
+                scanIndex(cols, filter, cols.by_symbol[filter.symbol_id], slots);
+                fn(cols, slots);
+                return;
+            }
+            
+            int parts = cols.count / MT4_QUERY_PARALLEL_MIN;
+            parts = parts < threads ? parts : threads;
+            
+            if (parts <= 1) {
+                std::vector<int> slots;
+                scanTrades(cols, filter, 0, cols.count, slots);
+                fn(cols, slots);
+                return;
+            }
+            
+            // Block-aligned ranges; the caller takes the first
+            std::vector<std::vector<int> > found(parts);
+            std::vector<std::thread> workers;
+            int step = (cols.count / parts + MT4_QUERY_BLOCK - 1) / MT4_QUERY_BLOCK * MT4_QUERY_BLOCK;
+            
+            for (int i = 1; i < parts; i++) {
+                int begin = i * step < cols.count ? i * step : cols.count;
+                int end = (i + 1) * step < cols.count && i + 1 < parts ? (i + 1) * step : cols.count;
+                workers.push_back(std::thread(scanTrades, std::cref(cols), std::cref(filter),
+                                              begin, end, std::ref(found[i])));
+            }
+            scanTrades(cols, filter, 0, step < cols.count ? step : cols.count, found[0]);
+            
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].join();
+            }
+            for (int i = 1; i < parts; i++) {
+                found[0].insert(found[0].end(), found[i].begin(), found[i].end());
+            }
+            fn(cols, found[0]);
+        });
+        return true;
+    }
+    
+    // Scan the account store and pass the matching rows to fn(cols, rows)
+    template <class Fn>
+    bool runAccounts(const MT4AccountQuery& query, Fn fn) const {
+        std::vector<unsigned char> groups;
+        if (query.group != NULL && *query.group != 0 && !matchGroups(query.group, groups)) {
+            return false;
+        }
+        
+        m_accounts.read([&](const MT4AccountStore::Columns& cols) {
+            std::vector<int> rows;
+            scanAccounts(cols, query, groups, rows);
+            fn(cols, rows);
+        });
+        return true;
+    }
+    
+    // Append the logins of the matching accounts; false if none can match
+    bool selectLogins(const MT4AccountQuery& query, std::vector<int>& logins) const {
+        return runAccounts(query, [&](const MT4AccountStore::Columns& cols, const std::vector<int>& rows) {
+            logins.reserve(logins.size() + rows.size());
+            for (size_t i = 0; i < rows.size(); i++) {
+                logins.push_back(cols.login[rows[i]]);
+            }
+        });
+    }
+
+public:
+    MT4QueryEngine(const MT4TradeBook& book, const MT4AccountStore& accounts, const MT4Dictionary& dictionary)
+        : m_book(book), m_accounts(accounts), m_dictionary(dictionary), m_cached_version(0) {}
+    
+    // Append the open trades matching query, in no particular order
+    void selectTrades(const MT4TradeQuery& query, std::vector<TradeRecord>& trades, int threads = 1) const {
+        runTrades(query, threads, [&](const MT4TradeBook::Columns& cols, const std::vector<int>& slots) {
+            trades.reserve(trades.size() + slots.size());
+            for (size_t i = 0; i < slots.size(); i++) {
+                trades.push_back(cols.record[slots[i]]);
+            }
+        });
+    }
+    
+    // Number of open trades matching query
+    int countTrades(const MT4TradeQuery& query, int threads = 1) const {
+        int count = 0;
+        runTrades(query, threads, [&](const MT4TradeBook::Columns&, const std::vector<int>& slots) {
+            count = (int)slots.size();
+        });
+        return count;
+    }
+    
+    // Append the accounts matching query, in store row order
+    void selectAccounts(const MT4AccountQuery& query, std::vector<UserRecord>& users) const {
+        runAccounts(query, [&](const MT4AccountStore::Columns& cols, const std::vector<int>& rows) {
+            users.reserve(users.size() + rows.size());
+            for (size_t i = 0; i < rows.size(); i++) {
+                users.push_back(cols.record[rows[i]]);
+            }
+        });
+    }
+    
+    // Number of accounts matching query
+    int countAccounts(const MT4AccountQuery& query) const {
+        int count = 0;
+        runAccounts(query, [&](const MT4AccountStore::Columns&, const std::vector<int>& rows) {
+            count = (int)rows.size();
+        });
+        return count;
+    }
+};
+
+#endif // MT4QUERY_H
@@ -0,0 +1,279 @@
+//+------------------------------------------------------------------+
+//|                        Shared-Memory Quote Bus Writer (Pumping)    |
+//+------------------------------------------------------------------+
+#ifndef MT4QUOTEBUS_H
+#define MT4QUOTEBUS_H
+
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+#include "MT4Format.h"
+#include "MT4QuoteBusReader.h"
+
+static_assert(MT4_BUS_MAX_SYMBOLS == MT4_MAX_SYMBOLS, "Bus slots must mirror the quote table ids");
+
+//+------------------------------------------------------------------+
+//| MT4QuoteBus - Publishes pumped quotes and trades to local        |
+//| processes through the segment described in MT4QuoteBusReader.h   |
+//| Symbol ids are those of the quote table, so a reader's ids match |
+//| the connector's. Registered after the quote table so every       |
+//| symbol in a batch already has an id. All writes happen on the    |
+//| pumping thread.                                                  |
+//+------------------------------------------------------------------+
+class MT4QuoteBus : public MT4PumpListener {
+private:
+    MT4QuoteTable& m_quotes;
+    HANDLE m_mapping;
+    MT4BusSegment* m_bus;
+    int m_symbols;                          // names already copied to the segment
+    std::string m_last_error;
+    
+    MT4QuoteBus(const MT4QuoteBus&);
+    MT4QuoteBus& operator=(const MT4QuoteBus&);
+    
+    // A process we cannot open (another user's) is assumed to be running
+    static bool isProcessAlive(DWORD pid) {
+        if (pid == 0) {
+            return false;
+        }
+        if (pid == GetCurrentProcessId()) {
+            return true;
+        }
+        
+        HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+        if (process == NULL) {
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        }
+        
+        bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return alive;
+    }
+    
+    // Copy names of symbols the quote table registered since the last call
+    void syncSymbols() {
+        int count = m_quotes.getSymbolCount();
+        if (count == m_symbols) {
+            return;
+        }
+        
+        for (int id = m_symbols; id < count; id++) {
+            strncpy(m_bus->quotes[id].symbol, m_quotes.getSymbolName(id), sizeof(m_bus->quotes[id].symbol) - 1);
+            m_bus->quotes[id].symbol[sizeof(m_bus->quotes[id].symbol) - 1] = 0;
+        }
+        
+        m_symbols = count;
+        m_bus->header.symbol_count.store((uint32_t)count, std::memory_order_release);
+    }
+    
+    void publishQuote(int id, double bid, double ask, time_t time) {
+        if (id < 0 || id >= m_symbols) {
+            return;
+        }
+        
+        MT4BusQuoteSlot& slot = m_bus->quotes[id];
+        uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+        
+        slot.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        slot.bid.store(bid, std::memory_order_relaxed);
+        slot.ask.store(ask, std::memory_order_relaxed);
+        slot.time.store((int64_t)time, std::memory_order_relaxed);
+        
+        slot.sequence.store(seq + 2, std::memory_order_release);
+    }
+    
+    void publishTrade(const MT4TradeEvent& event) {
+        MT4BusTrade record;
+        record.type = event.type;
+        record.reserved = 0;
+        record.trade = MT4Format::wireTrade(event.trade, m_quotes);
+        
+        uint64_t words[MT4_BUS_TRADE_WORDS];
+        memcpy(words, &record, sizeof(record));
+        
+        uint64_t pos = m_bus->header.trade_head.load(std::memory_order_relaxed);
+        MT4BusTradeSlot& slot = m_bus->trades[pos & (MT4_BUS_TRADE_SLOTS - 1)];
+        
+        slot.sequence.store(2 * pos + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        for (size_t i = 0; i < MT4_BUS_TRADE_WORDS; i++) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        
+        slot.sequence.store(2 * pos + 2, std::memory_order_release);
+        m_bus->header.trade_head.store(pos + 1, std::memory_order_release);
+    }
+    
+    void heartbeat() {
+        m_bus->header.heartbeat.store((int64_t)time(NULL), std::memory_order_relaxed);
+    }
+
+public:
+    explicit MT4QuoteBus(MT4QuoteTable& quotes) : m_quotes(quotes), m_mapping(NULL), m_bus(NULL), m_symbols(0) {}
+    
+    ~MT4QuoteBus() {
+        close();
+    }
+    
+    // Create the named segment, or take it over from a writer that has
+    // exited; fails while another live writer still owns it. Call before
+    // pumping starts.
+    bool open(const char* name = MT4_BUS_NAME) {
+        if (m_bus != NULL) {
+            return true;
+        }
+        
+        m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(MT4BusSegment), name);
+        if (m_mapping == NULL) {
+            m_last_error = std::string("Failed to create quote bus ") + name;
+            return false;
+        }
+        bool existed = GetLastError() == ERROR_ALREADY_EXISTS;
+        
+        m_bus = (MT4BusSegment*)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(MT4BusSegment));
+        if (m_bus == NULL) {
+            m_last_error = std::string("Failed to map quote bus ") + name;
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+            return false;
+        }
+        
+        if (existed && m_bus->header.magic.load(std::memory_order_acquire) == MT4_BUS_MAGIC &&
+            isProcessAlive((DWORD)m_bus->header.writer_pid.load(std::memory_order_relaxed))) {
+            m_last_error = std::string("Quote bus ") + name + " is owned by a running writer";
+            UnmapViewOfFile(m_bus);
+            m_bus = NULL;
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+            return false;
+        }
+        
+        // Readers of a previous writer keep the mapping alive; they see
+        // the generation change and resolve everything again
+        MT4BusHeader& header = m_bus->header;
+        uint32_t generation = header.generation.load(std::memory_order_relaxed) + 1;
+        
+        header.magic.store(0, std::memory_order_relaxed);
+        header.symbol_count.store(0, std::memory_order_relaxed);
+        header.pumping.store(0, std::memory_order_relaxed);
+        header.heartbeat.store((int64_t)time(NULL), std::memory_order_relaxed);
+        header.trade_head.store(0, std::memory_order_relaxed);
+        header.quote_updates.store(0, std::memory_order_relaxed);
+        
+        for (int i = 0; i < MT4_BUS_MAX_SYMBOLS; i++) {
+            m_bus->quotes[i].sequence.store(0, std::memory_order_relaxed);
+            m_bus->quotes[i].symbol[0] = 0;
+        }
+        for (int i = 0; i < MT4_BUS_TRADE_SLOTS; i++) {
+            m_bus->trades[i].sequence.store(0, std::memory_order_relaxed);
+        }
+        
+        header.version = MT4_BUS_VERSION;
+        header.max_symbols = MT4_BUS_MAX_SYMBOLS;
+        header.trade_slots = MT4_BUS_TRADE_SLOTS;
+        header.writer_pid.store((uint32_t)GetCurrentProcessId(), std::memory_order_relaxed);
+        header.generation.store(generation, std::memory_order_release);
+        header.magic.store(MT4_BUS_MAGIC, std::memory_order_release);
+        
+        m_symbols = 0;
+        return true;
+    }
+    
+    // Unmap the segment; only safe while pumping is stopped
+    void close() {
+        if (m_bus != NULL) {
+            m_bus->header.pumping.store(0, std::memory_order_release);
+            UnmapViewOfFile(m_bus);
+            m_bus = NULL;
+        }
+        if (m_mapping != NULL) {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+        }
+    }
+    
+    bool isOpen() const {
+        return m_bus != NULL;
+    }
+    
+    // Why open() failed
+    const char* getLastError() const {
+        return m_last_error.c_str();
+    }
+    
+    // Trade events published since open()
+    unsigned long long getTradeCount() const {
+        return m_bus != NULL ? m_bus->header.trade_head.load(std::memory_order_relaxed) : 0;
+    }
+    
+    // Quote updates published since open()
+    unsigned long long getQuoteCount() const {
+        return m_bus != NULL ? m_bus->header.quote_updates.load(std::memory_order_relaxed) : 0;
+    }
+    
+    // Publish names and the last known price of every symbol
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (m_bus == NULL) {
+            return;
+        }
+        
+        syncSymbols();
+        
+        MT4Quote quote;
+        for (int id = 0; id < m_symbols; id++) {
+            if (m_quotes.read(id, quote)) {
+                publishQuote(id, quote.bid, quote.ask, quote.time);
+            }
+        }
+        
+        heartbeat();
+        m_bus->header.pumping.store(1, std::memory_order_release);
+    }
+    
+    void onPumpingStopped() {
+        if (m_bus != NULL) {
+            m_bus->header.pumping.store(0, std::memory_order_release);
+        }
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        if (m_bus == NULL) {
+            return;
+        }
+        
+        syncSymbols();
+        
+        for (int i = 0; i < count; i++) {
+            publishQuote(m_quotes.findSymbol(quotes[i].symbol), quotes[i].bid, quotes[i].ask, quotes[i].lasttime);
+        }
+        
+        m_bus->header.quote_updates.fetch_add((uint64_t)count, std::memory_order_relaxed);
+        heartbeat();
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        if (m_bus == NULL) {
+            return;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            publishTrade(events[i]);
+        }
+        
+        heartbeat();
+    }
+    
+    void onPing() {
+        if (m_bus != NULL) {
+            heartbeat();
+        }
+    }
+};
+
+#endif // MT4QUOTEBUS_H
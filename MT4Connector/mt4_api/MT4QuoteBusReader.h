@@ -0,0 +1,333 @@
+//+------------------------------------------------------------------+
+//|                    Shared-Memory Quote Bus Layout and Reader       |
+//+------------------------------------------------------------------+
+#ifndef MT4QUOTEBUSREADER_H
+#define MT4QUOTEBUSREADER_H
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include "MT4WireFormat.h"
+
+//+------------------------------------------------------------------+
+//| Segment layout shared by MT4QuoteBus (writer, MT4QuoteBus.h) and |
+//| MT4QuoteBusReader. One writer process publishes the latest quote |
+//| per symbol id and an overwriting ring of trade events into a     |
+//| named file mapping; any number of local processes map it         |
+//| read-only. This header has no Manager API dependency.            |
+//+------------------------------------------------------------------+
+#define MT4_BUS_NAME        "Local\\MT4QuoteBus"
+#define MT4_BUS_MAGIC       0x4234544D          // "MT4B"
+#define MT4_BUS_VERSION     1
+#define MT4_BUS_MAX_SYMBOLS 1024
+#define MT4_BUS_TRADE_SLOTS 4096                // power of two
+#define MT4_BUS_READ_RETRIES 100000             // reads of a busy slot before the writer is presumed gone
+
+// Atomics in the mapping are shared between processes, so they must
+// not fall back to a process-local lock
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "32-bit atomics must be lock-free");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free");
+static_assert(std::atomic<double>::is_always_lock_free, "double atomics must be lock-free");
+
+// One trade event as published on the bus
+typedef MT4WireTradeEvent MT4BusTrade;
+
+static_assert(sizeof(MT4BusTrade) % 8 == 0, "MT4BusTrade must be a whole number of words");
+
+#define MT4_BUS_TRADE_WORDS (sizeof(MT4BusTrade) / 8)
+
+struct alignas(64) MT4BusHeader {
+    std::atomic<uint32_t> magic;            // stored last by the writer
+    uint32_t version;
+    uint32_t max_symbols;
+    uint32_t trade_slots;
+    std::atomic<uint32_t> generation;       // bumped whenever a writer (re)initializes
+    std::atomic<uint32_t> writer_pid;
+    std::atomic<uint32_t> symbol_count;     // names [0, count) are set
+    std::atomic<uint32_t> pumping;          // 1 while the writer receives pumping
+    std::atomic<int64_t> heartbeat;         // writer time() at the last event or ping
+    std::atomic<uint64_t> trade_head;       // trade events published so far
+    std::atomic<uint64_t> quote_updates;
+};
+
+// Seqlock per symbol; the sequence is odd while the writer updates it
+struct alignas(64) MT4BusQuoteSlot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<double> bid;
+    std::atomic<double> ask;
+    std::atomic<int64_t> time;
+    char symbol[12];                        // set once, before symbol_count covers it
+};
+
+// Seqlock per ring slot: 2 * position + 1 while writing, 2 * position + 2 once complete
+struct alignas(64) MT4BusTradeSlot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> words[MT4_BUS_TRADE_WORDS];
+};
+
+struct MT4BusSegment {
+    MT4BusHeader header;
+    MT4BusQuoteSlot quotes[MT4_BUS_MAX_SYMBOLS];
+    MT4BusTradeSlot trades[MT4_BUS_TRADE_SLOTS];
+};
+
+//+------------------------------------------------------------------+
+//| MT4QuoteBusReader - Read-only view of the bus for one consumer   |
+//| Quote reads never block the writer; a read racing an update      |
+//| retries. The trade cursor is private to the reader: if it falls  |
+//| more than MT4_BUS_TRADE_SLOTS behind, it skips to the oldest     |
+//| retained event and counts the skipped ones as dropped. A slot    |
+//| left mid-update by a writer that died is given up on after       |
+//| MT4_BUS_READ_RETRIES reads and reported through isWriterGone().  |
+//| Not thread-safe; use one reader per consuming thread.            |
+//+------------------------------------------------------------------+
+class MT4QuoteBusReader {
+private:
+    HANDLE m_mapping;
+    const MT4BusSegment* m_bus;
+    uint32_t m_generation;
+    uint64_t m_trade_cursor;
+    unsigned long long m_dropped;
+    mutable bool m_writer_gone;
+    
+    MT4QuoteBusReader(const MT4QuoteBusReader&);
+    MT4QuoteBusReader& operator=(const MT4QuoteBusReader&);
+
+public:
+    MT4QuoteBusReader() : m_mapping(NULL), m_bus(NULL), m_generation(0), m_trade_cursor(0), m_dropped(0),
+                          m_writer_gone(false) {}
+    
+    ~MT4QuoteBusReader() {
+        close();
+    }
+    
+    // Map the bus; false until a writer has created and initialized it
+    bool open(const char* name = MT4_BUS_NAME) {
+        if (m_bus != NULL) {
+            return true;
+        }
+        
+        m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+        if (m_mapping == NULL) {
+            return false;
+        }
+        
+        m_bus = (const MT4BusSegment*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, sizeof(MT4BusSegment));
+        
+        if (m_bus == NULL || m_bus->header.magic.load(std::memory_order_acquire) != MT4_BUS_MAGIC ||
+            m_bus->header.version != MT4_BUS_VERSION) {
+            close();
+            return false;
+        }
+        
+        resync();
+        return true;
+    }
+    
+    void close() {
+        if (m_bus != NULL) {
+            UnmapViewOfFile(m_bus);
+            m_bus = NULL;
+        }
+        if (m_mapping != NULL) {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+        }
+    }
+    
+    bool isOpen() const {
+        return m_bus != NULL;
+    }
+    
+    // True once if the writer restarted since the last call; symbol ids
+    // and quote sequences must then be resolved again. Trade reading
+    // resumes at the new writer's head.
+    bool checkRestart() {
+        if (m_bus == NULL || m_bus->header.generation.load(std::memory_order_acquire) == m_generation) {
+            return false;
+        }
+        
+        resync();
+        return true;
+    }
+    
+    // Start reading trades from the writer's current head
+    void resync() {
+        m_generation = m_bus->header.generation.load(std::memory_order_acquire);
+        m_trade_cursor = m_bus->header.trade_head.load(std::memory_order_acquire);
+        m_writer_gone = false;
+    }
+    
+    // True once a read gave up on a slot the writer never finished; the
+    // bus holds no reliable quotes until a new writer restarts it
+    bool isWriterGone() const {
+        return m_writer_gone;
+    }
+    
+    // True if the writer reported pumping within the last max_age seconds
+    bool isWriterAlive(int max_age = 30) const {
+        if (m_bus == NULL || m_bus->header.pumping.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        return time(NULL) - (time_t)m_bus->header.heartbeat.load(std::memory_order_relaxed) <= max_age;
+    }
+    
+    int getSymbolCount() const {
+        return m_bus != NULL ? (int)m_bus->header.symbol_count.load(std::memory_order_acquire) : 0;
+    }
+    
+    const char* getSymbolName(int id) const {
+        if (id < 0 || id >= getSymbolCount()) {
+            return NULL;
+        }
+        return m_bus->quotes[id].symbol;
+    }
+    
+    // Linear scan; resolve ids once and keep them
+    int findSymbol(const char* name) const {
+        int count = getSymbolCount();
+        
+        for (int id = 0; id < count; id++) {
+            if (strncmp(m_bus->quotes[id].symbol, name, sizeof(m_bus->quotes[id].symbol)) == 0) {
+                return id;
+            }
+        }
+        return -1;
+    }
+    
+    // Copy a consistent quote; false if the symbol never ticked or the
+    // writer left the slot mid-update (see isWriterGone())
+    bool read(int id, MT4WireQuote& quote) const {
+        if (id < 0 || id >= getSymbolCount()) {
+            return false;
+        }
+        
+        const MT4BusQuoteSlot& slot = m_bus->quotes[id];
+        uint32_t before, after;
+        double bid, ask;
+        int64_t t;
+        int retries = 0;
+        
+        do {
+            before = slot.sequence.load(std::memory_order_acquire);
+            while (before & 1) {
+                if (++retries > MT4_BUS_READ_RETRIES) {
+                    m_writer_gone = true;
+                    return false;
+                }
+                before = slot.sequence.load(std::memory_order_acquire);
+            }
+            
+            bid = slot.bid.load(std::memory_order_relaxed);
+            ask = slot.ask.load(std::memory_order_relaxed);
+            t = slot.time.load(std::memory_order_relaxed);
+            
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = slot.sequence.load(std::memory_order_relaxed);
+        } while (before != after && ++retries <= MT4_BUS_READ_RETRIES);
+        
+        if (before != after) {
+            m_writer_gone = true;
+            return false;
+        }
+        
+        quote.symbol_id = id;
+        quote.sequence = before;
+        quote.bid = bid;
+        quote.ask = ask;
+        quote.time = t;
+        return before != 0;
+    }
+    
+    // Current sequence of a slot, to detect changes without copying
+    uint32_t getSequence(int id) const {
+        if (id < 0 || id >= getSymbolCount()) {
+            return 0;
+        }
+        return m_bus->quotes[id].sequence.load(std::memory_order_acquire);
+    }
+    
+    // Conflated polling: copy every quote whose sequence differs from
+    // last_seen[id] (MT4_BUS_MAX_SYMBOLS entries owned by the caller)
+    int readChanged(uint32_t* last_seen, MT4WireQuote* quotes, int max_quotes) const {
+        int count = getSymbolCount();
+        int changed = 0;
+        
+        for (int id = 0; id < count && changed < max_quotes; id++) {
+            if (m_bus->quotes[id].sequence.load(std::memory_order_acquire) == last_seen[id]) {
+                continue;
+            }
+            
+            if (read(id, quotes[changed])) {
+                last_seen[id] = quotes[changed].sequence;
+                changed++;
+            }
+        }
+        
+        return changed;
+    }
+    
+    // Copy up to max_events trade events published since the last call
+    int readTrades(MT4BusTrade* events, int max_events) {
+        if (m_bus == NULL) {
+            return 0;
+        }
+        
+        uint64_t head = m_bus->header.trade_head.load(std::memory_order_acquire);
+        if (head < m_trade_cursor) {
+            return 0;                       // writer restarted; see checkRestart()
+        }
+        if (head - m_trade_cursor > MT4_BUS_TRADE_SLOTS) {
+            m_dropped += head - MT4_BUS_TRADE_SLOTS - m_trade_cursor;
+            m_trade_cursor = head - MT4_BUS_TRADE_SLOTS;
+        }
+        
+        int count = 0;
+        uint64_t words[MT4_BUS_TRADE_WORDS];
+        
+        while (m_trade_cursor < head && count < max_events) {
+            const MT4BusTradeSlot& slot = m_bus->trades[m_trade_cursor & (MT4_BUS_TRADE_SLOTS - 1)];
+            uint64_t expected = 2 * m_trade_cursor + 2;
+            
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before == expected) {
+                for (size_t i = 0; i < MT4_BUS_TRADE_WORDS; i++) {
+                    words[i] = slot.words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                
+                if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                    memcpy(&events[count++], words, sizeof(MT4BusTrade));
+                    m_trade_cursor++;
+                    continue;
+                }
+            }
+            
+            // Overwritten by a newer lap while we were behind
+            m_dropped++;
+            m_trade_cursor++;
+        }
+        
+        return count;
+    }
+    
+    // Trade events still to be read
+    uint64_t getTradeBacklog() const {
+        uint64_t head = m_bus != NULL ? m_bus->header.trade_head.load(std::memory_order_acquire) : 0;
+        return head > m_trade_cursor ? head - m_trade_cursor : 0;
+    }
+    
+    // Trade events skipped because this reader fell behind the ring
+    unsigned long long getDroppedTrades() const {
+        return m_dropped;
+    }
+    
+    // Total quote updates published by the writer
+    unsigned long long getQuoteUpdates() const {
+        return m_bus != NULL ? m_bus->header.quote_updates.load(std::memory_order_relaxed) : 0;
+    }
+};
+
+#endif // MT4QUOTEBUSREADER_H
@@ -0,0 +1,282 @@
+//+------------------------------------------------------------------+
+//|                          Conflated Per-Symbol Quote Snapshot Table |
+//+------------------------------------------------------------------+
+#ifndef MT4QUOTETABLE_H
+#define MT4QUOTETABLE_H
+
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include "MT4Pumping.h"
+
+// Maximum number of symbols tracked by the quote table
+#define MT4_MAX_SYMBOLS 1024
+
+// Size of the open-addressing symbol name index (power of two, > 2x MT4_MAX_SYMBOLS)
+#define MT4_SYMBOL_INDEX_SIZE 4096
+
+//+------------------------------------------------------------------+
+//| MT4Quote - Consistent copy of one symbol's last price            |
+//+------------------------------------------------------------------+
+struct MT4Quote {
+    int symbol_id;
+    unsigned int sequence;      // even, increases by 2 on every update
+    double bid;
+    double ask;
+    time_t time;
+};
+
+//+------------------------------------------------------------------+
+//| MT4QuoteSlot - One cache line per symbol, guarded by a seqlock   |
+//| The sequence is odd while the pumping thread is writing.         |
+//+------------------------------------------------------------------+
+struct alignas(MT4_CACHE_LINE) MT4QuoteSlot {
+    std::atomic<unsigned int> sequence;
+    std::atomic<bool> stale;    // pumping stopped since the last update
+    std::atomic<double> bid;
+    std::atomic<double> ask;
+    std::atomic<long long> time;
+    char symbol[12];            // set once at registration
+};
+
+//+------------------------------------------------------------------+
+//| MT4QuoteTable - Latest bid/ask per dense symbol id               |
+//| Fed by the pumping engine; any thread can read a consistent      |
+//| quote without a server round-trip. Only the newest price is      |
+//| kept, so slow readers see conflated prices, never a backlog.     |
+//| When pumping stops every quote turns stale and read() fails for  |
+//| it until the next tick, so callers fall back to the server.      |
+//+------------------------------------------------------------------+
+class MT4QuoteTable : public MT4PumpListener {
+private:
+    MT4QuoteSlot m_slots[MT4_MAX_SYMBOLS];
+    std::atomic<int> m_index[MT4_SYMBOL_INDEX_SIZE];   // symbol id + 1, 0 = empty
+    std::atomic<int> m_count;
+    std::atomic<unsigned long long> m_updates;
+    std::mutex m_register_lock;
+    
+    static unsigned int hashName(const char* name) {
+        // FNV-1a over the (at most 12 byte) symbol name
+        unsigned int hash = 2166136261u;
+        for (int i = 0; i < 12 && name[i] != 0; i++) {
+            hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+        }
+        return hash;
+    }
+    
+    MT4QuoteTable(const MT4QuoteTable&);
+    MT4QuoteTable& operator=(const MT4QuoteTable&);
+
+public:
+    MT4QuoteTable() : m_count(0), m_updates(0) {
+        for (int i = 0; i < MT4_SYMBOL_INDEX_SIZE; i++) {
+            m_index[i].store(0, std::memory_order_relaxed);
+        }
+        for (int i = 0; i < MT4_MAX_SYMBOLS; i++) {
+            m_slots[i].sequence.store(0, std::memory_order_relaxed);
+            m_slots[i].stale.store(false, std::memory_order_relaxed);
+            m_slots[i].bid.store(0.0, std::memory_order_relaxed);
+            m_slots[i].ask.store(0.0, std::memory_order_relaxed);
+            m_slots[i].time.store(0, std::memory_order_relaxed);
+            m_slots[i].symbol[0] = 0;
+        }
+    }
+    
+    // Find the dense id of a symbol, -1 if unknown (lock-free)
+    int findSymbol(const char* name) const {
+        if (name == NULL) {
+            return -1;
+        }
+        
+        unsigned int pos = hashName(name) & (MT4_SYMBOL_INDEX_SIZE - 1);
+        
+        for (;;) {
+            int entry = m_index[pos].load(std::memory_order_acquire);
+            if (entry == 0) {
+                return -1;
+            }
+            if (strncmp(m_slots[entry - 1].symbol, name, sizeof(m_slots[0].symbol)) == 0) {
+                return entry - 1;
+            }
+            pos = (pos + 1) & (MT4_SYMBOL_INDEX_SIZE - 1);
+        }
+    }
+    
+    // Get or assign the dense id of a symbol, -1 if the table is full
+    int registerSymbol(const char* name) {
+        int id = findSymbol(name);
+        if (id >= 0 || name == NULL || *name == 0) {
+            return id;
+        }
+        
+        std::lock_guard<std::mutex> lock(m_register_lock);
+        
+        id = findSymbol(name);
+        if (id >= 0) {
+            return id;
+        }
+        
+        id = m_count.load(std::memory_order_relaxed);
+        if (id >= MT4_MAX_SYMBOLS) {
+            return -1;
+        }
+        
+        strncpy(m_slots[id].symbol, name, sizeof(m_slots[id].symbol) - 1);
+        m_slots[id].symbol[sizeof(m_slots[id].symbol) - 1] = 0;
+        
+        unsigned int pos = hashName(name) & (MT4_SYMBOL_INDEX_SIZE - 1);
+        while (m_index[pos].load(std::memory_order_relaxed) != 0) {
+            pos = (pos + 1) & (MT4_SYMBOL_INDEX_SIZE - 1);
+        }
+        
+        m_count.store(id + 1, std::memory_order_release);
+        m_index[pos].store(id + 1, std::memory_order_release);
+        return id;
+    }
+    
+    // Number of registered symbols
+    int getSymbolCount() const {
+        return m_count.load(std::memory_order_acquire);
+    }
+    
+    // Name of a registered symbol
+    const char* getSymbolName(int id) const {
+        if (id < 0 || id >= getSymbolCount()) {
+            return NULL;
+        }
+        return m_slots[id].symbol;
+    }
+    
+    // Writer: publish a new price (pumping thread only)
+    void update(int id, double bid, double ask, time_t time) {
+        if (id < 0 || id >= MT4_MAX_SYMBOLS) {
+            return;
+        }
+        
+        MT4QuoteSlot& slot = m_slots[id];
+        unsigned int seq = slot.sequence.load(std::memory_order_relaxed);
+        
+        slot.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        slot.bid.store(bid, std::memory_order_relaxed);
+        slot.ask.store(ask, std::memory_order_relaxed);
+        slot.time.store((long long)time, std::memory_order_relaxed);
+        slot.stale.store(false, std::memory_order_relaxed);
+        
+        slot.sequence.store(seq + 2, std::memory_order_release);
+        m_updates.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Reader: copy a consistent quote; false if the symbol never ticked
+    // or has not ticked since pumping stopped
+    bool read(int id, MT4Quote& quote) const {
+        if (id < 0 || id >= getSymbolCount()) {
+            return false;
+        }
+        
+        const MT4QuoteSlot& slot = m_slots[id];
+        unsigned int before, after;
+        
+        do {
+            before = slot.sequence.load(std::memory_order_acquire);
+            while (before & 1) {
+                before = slot.sequence.load(std::memory_order_acquire);
+            }
+            
+            quote.bid = slot.bid.load(std::memory_order_relaxed);
+            quote.ask = slot.ask.load(std::memory_order_relaxed);
+            quote.time = (time_t)slot.time.load(std::memory_order_relaxed);
+            
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = slot.sequence.load(std::memory_order_relaxed);
+        } while (before != after);
+        
+        quote.symbol_id = id;
+        quote.sequence = before;
+        return before != 0 && !slot.stale.load(std::memory_order_acquire);
+    }
+    
+    // Check whether a symbol's quote predates the last pumping stop
+    bool isStale(int id) const {
+        if (id < 0 || id >= getSymbolCount()) {
+            return false;
+        }
+        return m_slots[id].stale.load(std::memory_order_acquire);
+    }
+    
+    // Reader: look up by name (slower; resolve ids once where possible)
+    bool read(const char* name, MT4Quote& quote) const {
+        return read(findSymbol(name), quote);
+    }
+    
+    // Current sequence of a slot, to detect changes without copying
+    unsigned int getSequence(int id) const {
+        if (id < 0 || id >= MT4_MAX_SYMBOLS) {
+            return 0;
+        }
+        return m_slots[id].sequence.load(std::memory_order_acquire);
+    }
+    
+    // Conflated polling: copy every quote whose sequence differs from
+    // last_seen[id] and remember the new sequence. last_seen must hold
+    // MT4_MAX_SYMBOLS entries owned by the calling consumer.
+    int readChanged(unsigned int* last_seen, MT4Quote* quotes, int max_quotes) const {
+        int count = getSymbolCount();
+        int changed = 0;
+        
+        for (int id = 0; id < count && changed < max_quotes; id++) {
+            unsigned int seq = m_slots[id].sequence.load(std::memory_order_acquire);
+            if (seq == last_seen[id]) {
+                continue;
+            }
+            
+            if (read(id, quotes[changed])) {
+                last_seen[id] = quotes[changed].sequence;
+                changed++;
+            }
+        }
+        
+        return changed;
+    }
+    
+    // Total number of price updates applied
+    unsigned long long getUpdateCount() const {
+        return m_updates.load(std::memory_order_relaxed);
+    }
+    
+    // Pre-register every symbol known to the pumping interface
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        ConSymbol* syms = pump->SymbolsGetAll(&total);
+        
+        if (syms) {
+            for (int i = 0; i < total; i++) {
+                registerSymbol(syms[i].symbol);
+            }
+            
+            pump->MemFree(syms);
+        }
+    }
+    
+    // Prices stop updating; stop serving them
+    void onPumpingStopped() {
+        int count = getSymbolCount();
+        for (int id = 0; id < count; id++) {
+            m_slots[id].stale.store(true, std::memory_order_release);
+        }
+    }
+    
+    void onQuotes(const SymbolInfo* quotes, int count) {
+        for (int i = 0; i < count; i++) {
+            update(registerSymbol(quotes[i].symbol), quotes[i].bid, quotes[i].ask, quotes[i].lasttime);
+        }
+    }
+};
+
+#endif // MT4QUOTETABLE_H
@@ -0,0 +1,92 @@
+//+------------------------------------------------------------------+
+//|                      Zero-copy Views over Manager API Result Arrays |
+//+------------------------------------------------------------------+
+#ifndef MT4RECORDVIEW_H
+#define MT4RECORDVIEW_H
+
+#include <stddef.h>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+
+//+------------------------------------------------------------------+
+//| MT4RecordView - Owns an array returned by the Manager API        |
+//| Iterates the records in place and calls MemFree on the issuing   |
+//| interface when destroyed. Move-only, like the buffer it owns.    |
+//+------------------------------------------------------------------+
+template <class T>
+class MT4RecordView {
+private:
+    CManagerInterface* m_manager;
+    T* m_records;
+    int m_total;
+    
+    MT4RecordView(const MT4RecordView&);
+    MT4RecordView& operator=(const MT4RecordView&);
+
+public:
+    MT4RecordView() : m_manager(NULL), m_records(NULL), m_total(0) {}
+    
+    // Take ownership of records allocated by manager
+    MT4RecordView(CManagerInterface* manager, T* records, int total)
+        : m_manager(manager), m_records(records), m_total(records != NULL ? total : 0) {}
+    
+    MT4RecordView(MT4RecordView&& other)
+        : m_manager(other.m_manager), m_records(other.m_records), m_total(other.m_total) {
+        other.m_manager = NULL;
+        other.m_records = NULL;
+        other.m_total = 0;
+    }
+    
+    MT4RecordView& operator=(MT4RecordView&& other) {
+        if (this != &other) {
+            reset();
+            m_manager = other.m_manager;
+            m_records = other.m_records;
+            m_total = other.m_total;
+            other.m_manager = NULL;
+            other.m_records = NULL;
+            other.m_total = 0;
+        }
+        return *this;
+    }
+    
+    ~MT4RecordView() {
+        reset();
+    }
+    
+    // Free the buffer now instead of at destruction
+    void reset() {
+        if (m_records != NULL && m_manager != NULL) {
+            m_manager->MemFree(m_records);
+        }
+        m_records = NULL;
+        m_total = 0;
+    }
+    
+    // Give up ownership; the caller must MemFree the returned records
+    // on issuer()
+    T* release() {
+        T* records = m_records;
+        m_records = NULL;
+        m_total = 0;
+        return records;
+    }
+    
+    // Interface that allocated the records
+    CManagerInterface* issuer() const { return m_manager; }
+    
+    // Span-like access to the original records
+    int size() const { return m_total; }
+    bool empty() const { return m_total == 0; }
+    const T* data() const { return m_records; }
+    const T* begin() const { return m_records; }
+    const T* end() const { return m_records + m_total; }
+    const T& operator[](int index) const { return m_records[index]; }
+};
+
+typedef MT4RecordView<UserRecord> UserRecordView;
+typedef MT4RecordView<TradeRecord> TradeRecordView;
+typedef MT4RecordView<ConSymbol> SymbolRecordView;
+typedef MT4RecordView<OnlineRecord> OnlineRecordView;
+
+#endif // MT4RECORDVIEW_H
@@ -0,0 +1,174 @@
+//+------------------------------------------------------------------+
+//|                         Lock-free Single Producer/Consumer Ring   |
+//+------------------------------------------------------------------+
+#ifndef MT4RINGBUFFER_H
+#define MT4RINGBUFFER_H
+
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Cache line size used to keep producer and consumer indexes apart
+#define MT4_CACHE_LINE 64
+
+//+------------------------------------------------------------------+
+//| MT4SpscRing - Fixed-capacity ring of POD slots                   |
+//| Exactly one thread may push and exactly one thread may peek and  |
+//| consume. Slots are preallocated once; a full ring drops new      |
+//| items instead of blocking the producer.                          |
+//+------------------------------------------------------------------+
+template <class T>
+class MT4SpscRing {
+private:
+    T* m_slots;
+    unsigned long long m_capacity;
+    unsigned long long m_mask;
+    
+    // Producer side
+    alignas(MT4_CACHE_LINE) std::atomic<unsigned long long> m_head;
+    unsigned long long m_cached_tail;
+    std::atomic<unsigned long long> m_pushed;
+    std::atomic<unsigned long long> m_dropped;
+    std::atomic<unsigned long long> m_high_watermark;
+    
+    // Consumer side
+    alignas(MT4_CACHE_LINE) std::atomic<unsigned long long> m_tail;
+    unsigned long long m_cached_head;
+    
+    MT4SpscRing(const MT4SpscRing&);
+    MT4SpscRing& operator=(const MT4SpscRing&);
+    
+    // Free slots as seen by the producer, refreshing the tail only when needed
+    unsigned long long freeSlots(unsigned long long head, unsigned long long wanted) {
+        unsigned long long free_slots = m_capacity - (head - m_cached_tail);
+        if (free_slots < wanted) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            free_slots = m_capacity - (head - m_cached_tail);
+        }
+        return free_slots;
+    }
+    
+    void updateWatermark(unsigned long long depth) {
+        if (depth > m_high_watermark.load(std::memory_order_relaxed)) {
+            m_high_watermark.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    MT4SpscRing()
+        : m_slots(NULL), m_capacity(0), m_mask(0),
+          m_head(0), m_cached_tail(0), m_pushed(0), m_dropped(0), m_high_watermark(0),
+          m_tail(0), m_cached_head(0) {}
+    
+    ~MT4SpscRing() {
+        delete[] m_slots;
+    }
+    
+    // Allocate the slots; capacity is rounded up to a power of two
+    bool init(unsigned long long capacity) {
+        if (m_slots != NULL || capacity == 0) {
+            return false;
+        }
+        
+        unsigned long long size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        
+        m_slots = new T[size];
+        m_capacity = size;
+        m_mask = size - 1;
+        return true;
+    }
+    
+    // Check if the ring has been allocated
+    bool isValid() const {
+        return m_slots != NULL;
+    }
+    
+    // Producer: copy one item in; returns false (and counts a drop) when full
+    bool push(const T& item) {
+        unsigned long long head = m_head.load(std::memory_order_relaxed);
+        
+        if (freeSlots(head, 1) == 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        
+        m_slots[head & m_mask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        m_pushed.fetch_add(1, std::memory_order_relaxed);
+        updateWatermark(head + 1 - m_cached_tail);
+        return true;
+    }
+    
+    // Producer: copy up to count items in; returns how many were accepted
+    int push(const T* items, int count) {
+        unsigned long long head = m_head.load(std::memory_order_relaxed);
+        unsigned long long free_slots = freeSlots(head, (unsigned long long)count);
+        int accepted = (unsigned long long)count < free_slots ? count : (int)free_slots;
+        
+        // Copy in at most two contiguous runs
+        unsigned long long start = head & m_mask;
+        unsigned long long first_run = m_capacity - start;
+        if (first_run > (unsigned long long)accepted) {
+            first_run = accepted;
+        }
+        
+        memcpy(&m_slots[start], items, (size_t)first_run * sizeof(T));
+        if ((unsigned long long)accepted > first_run) {
+            memcpy(&m_slots[0], items + first_run, (size_t)(accepted - first_run) * sizeof(T));
+        }
+        
+        m_head.store(head + accepted, std::memory_order_release);
+        m_pushed.fetch_add(accepted, std::memory_order_relaxed);
+        if (accepted < count) {
+            m_dropped.fetch_add(count - accepted, std::memory_order_relaxed);
+        }
+        updateWatermark(head + accepted - m_cached_tail);
+        return accepted;
+    }
+    
+    // Consumer: get the longest contiguous run of readable slots
+    int peek(const T** first) {
+        unsigned long long tail = m_tail.load(std::memory_order_relaxed);
+        
+        if (m_cached_head == tail) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (m_cached_head == tail) {
+                *first = NULL;
+                return 0;
+            }
+        }
+        
+        unsigned long long start = tail & m_mask;
+        unsigned long long available = m_cached_head - tail;
+        unsigned long long run = m_capacity - start;
+        
+        *first = &m_slots[start];
+        return (int)(available < run ? available : run);
+    }
+    
+    // Consumer: release slots returned by peek()
+    void consume(int count) {
+        unsigned long long tail = m_tail.load(std::memory_order_relaxed);
+        m_tail.store(tail + count, std::memory_order_release);
+    }
+    
+    // Items pushed and not yet consumed. Exact on the consumer thread;
+    // elsewhere the consumer may take items between the two loads, so
+    // the result can overstate the backlog; it is capped at capacity.
+    unsigned long long size() const {
+        unsigned long long tail = m_tail.load(std::memory_order_acquire);
+        unsigned long long head = m_head.load(std::memory_order_acquire);
+        return head - tail < m_capacity ? head - tail : m_capacity;
+    }
+    
+    // Statistics
+    unsigned long long capacity() const { return m_capacity; }
+    unsigned long long pushed() const { return m_pushed.load(std::memory_order_relaxed); }
+    unsigned long long dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    unsigned long long highWatermark() const { return m_high_watermark.load(std::memory_order_relaxed); }
+};
+
+#endif // MT4RINGBUFFER_H
@@ -0,0 +1,368 @@
+//+------------------------------------------------------------------+
+//|                                 In-process Pre-trade Risk Checks |
+//+------------------------------------------------------------------+
+#ifndef MT4RISKCHECK_H
+#define MT4RISKCHECK_H
+
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+#include "MT4Dictionary.h"
+#include "MT4ColumnStore.h"
+#include "MT4MarginEngine.h"
+
+// Security groups per ConGroup (ConGroup::secgroups)
+#define MT4_RISK_SECURITY_GROUPS 32
+
+//+------------------------------------------------------------------+
+//| Rules evaluated by MT4RiskChecker, each with a reject counter.   |
+//| A rejected transaction gets the code the server would return.    |
+//+------------------------------------------------------------------+
+enum MT4RiskRule {
+    MT4_RISK_SYMBOL,            // unknown symbol or trading disabled (RET_TRADE_DISABLE, RET_TRADE_LONG_ONLY)
+    MT4_RISK_GROUP,             // group may not trade the symbol (RET_TRADE_DISABLE)
+    MT4_RISK_VOLUME,            // outside the group lot min/max/step (RET_TRADE_BAD_VOLUME)
+    MT4_RISK_STOPS,             // sl, tp or pending price inside the stops level (RET_TRADE_BAD_STOPS)
+    MT4_RISK_SESSION,           // outside the symbol trade sessions (RET_TRADE_MARKET_CLOSED)
+    MT4_RISK_MARGIN,            // projected free margin below zero (RET_TRADE_NO_MONEY)
+    MT4_RISK_RULE_COUNT
+};
+
+constexpr const char* MT4_RISK_RULE_NAMES[] = {
+    "symbol", "group", "volume", "stops", "session", "margin"
+};
+
+static_assert(sizeof(MT4_RISK_RULE_NAMES) / sizeof(MT4_RISK_RULE_NAMES[0]) == MT4_RISK_RULE_COUNT,
+              "Every risk rule needs a name");
+
+//+------------------------------------------------------------------+
+//| MT4RiskChecker - Validates opens before TradeTransaction         |
+//| Symbol and group limits are cached from ConSymbol and ConGroup   |
+//| when pumping starts (or with load()); accounts and margin come   |
+//| from the account store and margin engine. A rule whose data is   |
+//| not available passes, so the server stays the authority and the  |
+//| checker only saves round trips for orders it would reject: a     |
+//| symbol without loaded limits skips the symbol, stops and session |
+//| rules, and only a symbol the server never listed is unknown.     |
+//| check() takes one shared lock and a few array lookups.           |
+//+------------------------------------------------------------------+
+class MT4RiskChecker : public MT4PumpListener {
+private:
+    struct SymbolLimits {
+        bool valid;
+        int type;               // security group index
+        int trade;              // TRADE_NO, TRADE_CLOSE or TRADE_FULL
+        int long_only;
+        double point;
+        int stops_level;        // points
+        bool scheduled;         // any trade session configured
+        unsigned char open[7][24 * 60 / 8];     // bit per minute of each weekday
+    };
+    
+    struct GroupLimits {
+        bool valid;
+        struct Security {
+            int show;
+            int trade;
+            int lot_min;        // 1/100 lots, as TradeTransInfo::volume
+            int lot_max;
+            int lot_step;
+        } sec[MT4_RISK_SECURITY_GROUPS];
+    };
+    
+    MT4QuoteTable& m_quotes;
+    MT4Dictionary& m_dictionary;
+    const MT4AccountStore& m_accounts;
+    const MT4MarginEngine& m_margin;
+    std::vector<SymbolLimits> m_symbols;        // quote table symbol id -> limits
+    std::vector<GroupLimits> m_groups;          // dictionary group id -> limits
+    bool m_symbols_loaded;                      // m_symbols holds a server symbol list
+    mutable std::shared_mutex m_lock;
+    std::atomic<bool> m_enabled;
+    std::atomic<long long> m_server_offset;     // server time - local time, seconds
+    std::atomic<unsigned long long> m_checked;
+    std::atomic<unsigned long long> m_rejects[MT4_RISK_RULE_COUNT];
+    
+    MT4RiskChecker(const MT4RiskChecker&);
+    MT4RiskChecker& operator=(const MT4RiskChecker&);
+    
+    // Mark the minutes [open, close) of one day as tradeable
+    static void openMinutes(unsigned char* day, int open, int close) {
+        if (close > 24 * 60) {
+            close = 24 * 60;
+        }
+        for (int m = open < 0 ? 0 : open; m < close; m++) {
+            day[m >> 3] |= (unsigned char)(1 << (m & 7));
+        }
+    }
+    
+    // id from m_quotes.registerSymbol, taken before the lock
+    void setSymbolLocked(int id, const ConSymbol& cs) {
+        if (id < 0) {
+            return;
+        }
+        
+        SymbolLimits& s = m_symbols[id];
+        memset(&s, 0, sizeof(s));
+        s.valid = true;
+        s.type = cs.type;
+        s.trade = cs.trade;
+        s.long_only = cs.long_only;
+        s.point = cs.point;
+        s.stops_level = cs.stops_level;
+        
+        for (int day = 0; day < 7; day++) {
+            for (int i = 0; i < 3; i++) {
+                const ConSession& session = cs.sessions[day].trade[i];
+                int open = session.open_hour * 60 + session.open_min;
+                int close = session.close_hour * 60 + session.close_min;
+                if (close > open) {
+                    openMinutes(s.open[day], open, close);
+                    s.scheduled = true;
+                }
+            }
+        }
+    }
+    
+    // id from m_dictionary.addGroup, taken before the lock
+    void setGroupLocked(int id, const ConGroup& group) {
+        if (id < 0) {
+            return;
+        }
+        if ((size_t)id >= m_groups.size()) {
+            m_groups.resize(id + 1);
+        }
+        
+        GroupLimits& g = m_groups[id];
+        g.valid = true;
+        for (int i = 0; i < MT4_RISK_SECURITY_GROUPS; i++) {
+            g.sec[i].show = group.secgroups[i].show;
+            g.sec[i].trade = group.secgroups[i].trade;
+            g.sec[i].lot_min = group.secgroups[i].lot_min;
+            g.sec[i].lot_max = group.secgroups[i].lot_max;
+            g.sec[i].lot_step = group.secgroups[i].lot_step;
+        }
+    }
+    
+    int reject(MT4RiskRule rule, MT4RiskRule* failed, int code) {
+        m_rejects[rule]++;
+        if (failed != NULL) {
+            *failed = rule;
+        }
+        return code;
+    }
+    
+    // Check that a stop level price lies at least distance beyond base
+    // in direction (+1 above, -1 below); 0 prices are not set
+    static bool beyond(double price, double base, int direction, double distance) {
+        if (price <= 0) {
+            return true;
+        }
+        double eps = distance * 1e-6 + 1e-10;
+        return direction > 0 ? price >= base + distance - eps : price <= base - distance + eps;
+    }
+    
+    static bool stopsValid(const TradeTransInfo& trade, const MT4Quote* quote, double distance) {
+        bool buy = (trade.cmd == OP_BUY || trade.cmd == OP_BUY_LIMIT || trade.cmd == OP_BUY_STOP);
+        double base;
+        
+        if (trade.cmd == OP_BUY || trade.cmd == OP_SELL) {
+            if (quote == NULL) {
+                return true;
+            }
+            base = buy ? quote->bid : quote->ask;           // positions close at the opposite price
+        } else {
+            base = trade.price;
+            if (quote != NULL) {
+                double market = buy ? quote->ask : quote->bid;
+                bool limit = (trade.cmd == OP_BUY_LIMIT || trade.cmd == OP_SELL_LIMIT);
+                int side = (buy == limit) ? -1 : 1;          // buy limit / sell stop sit below the market
+                if (!beyond(trade.price, market, side, distance)) {
+                    return false;
+                }
+            }
+        }
+        
+        return beyond(trade.sl, base, buy ? -1 : 1, distance) && beyond(trade.tp, base, buy ? 1 : -1, distance);
+    }
+
+public:
+    MT4RiskChecker(MT4QuoteTable& quotes, MT4Dictionary& dictionary,
+                   const MT4AccountStore& accounts, const MT4MarginEngine& margin)
+        : m_quotes(quotes), m_dictionary(dictionary), m_accounts(accounts), m_margin(margin),
+          m_symbols(MT4_MAX_SYMBOLS), m_symbols_loaded(false), m_enabled(false), m_server_offset(0), m_checked(0) {
+        for (int i = 0; i < MT4_RISK_RULE_COUNT; i++) {
+            m_rejects[i] = 0;
+        }
+    }
+    
+    // Replace the cached symbol and group limits. Ids are resolved in
+    // the quote table and dictionary first, so their locks are never
+    // taken inside m_lock.
+    void load(const ConSymbol* symbols, int symbol_total, const ConGroup* groups, int group_total) {
+        std::vector<int> symbol_ids;
+        std::vector<int> group_ids;
+        
+        if (symbols != NULL) {
+            symbol_ids.resize(symbol_total);
+            for (int i = 0; i < symbol_total; i++) {
+                symbol_ids[i] = m_quotes.registerSymbol(symbols[i].symbol);
+            }
+        }
+        if (groups != NULL) {
+            group_ids.resize(group_total);
+            for (int i = 0; i < group_total; i++) {
+                group_ids[i] = m_dictionary.addGroup(groups[i].group);
+            }
+        }
+        
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        if (symbols != NULL) {
+            m_symbols.assign(MT4_MAX_SYMBOLS, SymbolLimits());
+            for (int i = 0; i < symbol_total; i++) {
+                setSymbolLocked(symbol_ids[i], symbols[i]);
+            }
+            m_symbols_loaded = true;
+        }
+        
+        if (groups != NULL) {
+            m_groups.clear();
+            for (int i = 0; i < group_total; i++) {
+                setGroupLocked(group_ids[i], groups[i]);
+            }
+        }
+    }
+    
+    // Turn checking on or off (off by default); check() passes everything when off
+    void setEnabled(bool enabled) {
+        m_enabled = enabled;
+    }
+    
+    bool isEnabled() const {
+        return m_enabled;
+    }
+    
+    // Server time minus local time, for the session rule
+    void setServerOffset(long long seconds) {
+        m_server_offset = seconds;
+    }
+    
+    // Validate an open (TT_BR_ORDER_OPEN); other transactions pass.
+    // Returns RET_OK or the server code the order would be rejected
+    // with, and the failing rule in failed.
+    int check(const TradeTransInfo& trade, MT4RiskRule* failed = NULL) {
+        if (!m_enabled || trade.type != TT_BR_ORDER_OPEN) {
+            return RET_OK;
+        }
+        m_checked++;
+        
+        int symbol_id = m_quotes.findSymbol(trade.symbol);
+        
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        // Unknown only against a loaded list; a symbol added since then
+        // or before any load has no limits and skips the symbol rules
+        if (symbol_id < 0 && m_symbols_loaded) {
+            return reject(MT4_RISK_SYMBOL, failed, RET_TRADE_DISABLE);
+        }
+        
+        static const SymbolLimits no_limits = SymbolLimits();
+        const SymbolLimits& s = symbol_id >= 0 ? m_symbols[symbol_id] : no_limits;
+        bool sell = (trade.cmd == OP_SELL || trade.cmd == OP_SELL_LIMIT || trade.cmd == OP_SELL_STOP);
+        
+        if (s.valid && s.trade != TRADE_FULL) {
+            return reject(MT4_RISK_SYMBOL, failed, RET_TRADE_DISABLE);
+        }
+        if (s.valid && s.long_only && sell) {
+            return reject(MT4_RISK_SYMBOL, failed, RET_TRADE_LONG_ONLY);
+        }
+        
+        // Group limits of the account's security group
+        UserRecord user;
+        if (s.valid && m_accounts.isReady() && m_accounts.getRecord(trade.orderby, user)) {
+            int group_id = m_dictionary.findGroup(user.group);
+            if (group_id >= 0 && (size_t)group_id < m_groups.size() && m_groups[group_id].valid &&
+                s.type >= 0 && s.type < MT4_RISK_SECURITY_GROUPS) {
+                const GroupLimits::Security& sec = m_groups[group_id].sec[s.type];
+                
+                if (!sec.show || !sec.trade) {
+                    return reject(MT4_RISK_GROUP, failed, RET_TRADE_DISABLE);
+                }
+                if (trade.volume < sec.lot_min || (sec.lot_max > 0 && trade.volume > sec.lot_max) ||
+                    (sec.lot_step > 0 && (trade.volume - sec.lot_min) % sec.lot_step != 0)) {
+                    return reject(MT4_RISK_VOLUME, failed, RET_TRADE_BAD_VOLUME);
+                }
+            }
+        }
+        if (trade.volume <= 0) {
+            return reject(MT4_RISK_VOLUME, failed, RET_TRADE_BAD_VOLUME);
+        }
+        
+        MT4Quote quote;
+        bool quoted = symbol_id >= 0 && m_quotes.read(symbol_id, quote) && quote.bid > 0;
+        
+        if (s.stops_level > 0 && s.point > 0 &&
+            !stopsValid(trade, quoted ? &quote : NULL, s.stops_level * s.point)) {
+            return reject(MT4_RISK_STOPS, failed, RET_TRADE_BAD_STOPS);
+        }
+        
+        if (s.scheduled) {
+            long long now = (long long)time(NULL) + m_server_offset;
+            int day = (int)((now / 86400 + 4) % 7);              // 1 Jan 1970 was a Thursday
+            int minute = (int)(now % 86400 / 60);
+            if (!(s.open[day][minute >> 3] & (1 << (minute & 7)))) {
+                return reject(MT4_RISK_SESSION, failed, RET_TRADE_MARKET_CLOSED);
+            }
+        }
+        
+        // Pending orders take margin only when they fill
+        if ((trade.cmd == OP_BUY || trade.cmd == OP_SELL) && symbol_id >= 0 && m_margin.isReady()) {
+            double price = trade.price > 0 ? trade.price : (quoted ? (sell ? quote.bid : quote.ask) : 0);
+            MT4MarginState state;
+            if (price > 0 && m_margin.projectMargin(trade.orderby, symbol_id, trade.cmd, trade.volume / 100.0,
+                                                    price, state) && state.margin_free < 0) {
+                return reject(MT4_RISK_MARGIN, failed, RET_TRADE_NO_MONEY);
+            }
+        }
+        
+        return RET_OK;
+    }
+    
+    // Transactions checked while enabled
+    unsigned long long getCheckedCount() const {
+        return m_checked;
+    }
+    
+    // Transactions rejected by rule
+    unsigned long long getRejectCount(MT4RiskRule rule) const {
+        return (rule >= 0 && rule < MT4_RISK_RULE_COUNT) ? m_rejects[rule].load() : 0;
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int symbol_total = 0;
+        int group_total = 0;
+        ConSymbol* symbols = pump->SymbolsGetAll(&symbol_total);
+        ConGroup* groups = pump->GroupsGet(&group_total);
+        
+        load(symbols, symbol_total, groups, group_total);
+        
+        if (symbols) {
+            pump->MemFree(symbols);
+        }
+        if (groups) {
+            pump->MemFree(groups);
+        }
+    }
+};
+
+#endif // MT4RISKCHECK_H
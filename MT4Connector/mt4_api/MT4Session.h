@@ -0,0 +1,372 @@
+//+------------------------------------------------------------------+
+//|                      Supervised Session with Reconnect and Resync |
+//+------------------------------------------------------------------+
+#ifndef MT4SESSION_H
+#define MT4SESSION_H
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include "MT4Pumping.h"
+#include "MT4TradeBook.h"
+#include "MT4ColumnStore.h"
+#include "MT4Metrics.h"
+
+enum MT4SessionState {
+    MT4_SESSION_IDLE,           // not supervised
+    MT4_SESSION_CONNECTED,
+    MT4_SESSION_RECONNECTING
+};
+
+struct MT4SessionOptions {
+    int check_ms;               // health check period
+    int ping_timeout_ms;        // pumping silence taken as a drop, 0 to ignore pings
+    int backoff_min_ms;         // shortest retry delay
+    int backoff_max_ms;         // cap of the doubling retry delay
+    
+    MT4SessionOptions() : check_ms(500), ping_timeout_ms(30000), backoff_min_ms(250), backoff_max_ms(30000) {}
+};
+
+// true while the connections (and the pumping one when pumping is
+// wanted) are up; called on the supervisor thread
+typedef std::function<bool(bool pumping)> MT4SessionProbe;
+
+// Reconnect, log in and restart pumping if wanted; fill error on failure
+typedef std::function<bool(bool pumping, std::string& error)> MT4SessionReconnect;
+
+// State changes, called on the supervisor thread
+typedef std::function<void(MT4SessionState state)> MT4SessionCallback;
+
+//+------------------------------------------------------------------+
+//| MT4SessionSupervisor - Keeps the Manager session up              |
+//| A thread probes the connections every check_ms and also treats   |
+//| PUMP_STOP_PUMPING and a ping silence as a drop. It then retries  |
+//| the reconnect with exponential backoff and full jitter, so many  |
+//| connectors losing the same server do not return in lockstep.     |
+//| A restarted pumping session is announced as resumed: the         |
+//| supervisor, registered ahead of the trade book and account store,|
+//| diffs the pumping interface's trades and users against them      |
+//| (still as they were before the drop) and delivers only the       |
+//| differences as onTrades/onUsers, so the stores and event-driven  |
+//| consumers catch up without rebuilding from the full lists. The   |
+//| trade events are flagged resync: they happened during the gap.   |
+//+------------------------------------------------------------------+
+class MT4SessionSupervisor : public MT4PumpListener {
+private:
+    MT4PumpingEngine& m_engine;
+    const MT4TradeBook& m_book;
+    const MT4AccountStore& m_accounts;
+    
+    MT4SessionOptions m_options;
+    MT4SessionProbe m_probe;
+    MT4SessionReconnect m_reconnect;
+    MT4SessionCallback m_callback;
+    std::thread m_thread;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    bool m_running;
+    std::string m_last_error;               // guarded by m_lock
+    std::minstd_rand m_random;
+    
+    std::atomic<int> m_state;
+    std::atomic<bool> m_pumping;            // a pumping session should be up
+    std::atomic<bool> m_dropped;            // PUMP_STOP_PUMPING while wanted
+    std::atomic<uint64_t> m_last_ping;      // MT4MetricsNow(), 0 before the first
+    std::atomic<unsigned long long> m_disconnects;
+    std::atomic<unsigned long long> m_attempts;
+    std::atomic<unsigned long long> m_resync_trades;
+    std::atomic<unsigned long long> m_resync_users;
+    std::atomic<uint64_t> m_outage_ns;      // of the last completed outage
+    
+    MT4SessionSupervisor(const MT4SessionSupervisor&);
+    MT4SessionSupervisor& operator=(const MT4SessionSupervisor&);
+    
+    bool healthy() {
+        if (m_pumping && m_dropped) {
+            return false;
+        }
+        
+        uint64_t ping = m_last_ping;
+        if (m_pumping && ping != 0 && m_options.ping_timeout_ms > 0 &&
+            MT4MetricsNow() - ping > (uint64_t)m_options.ping_timeout_ms * 1000000) {
+            return false;
+        }
+        return m_probe(m_pumping);
+    }
+    
+    void setState(MT4SessionState state) {
+        m_state = state;
+        if (m_callback) {
+            m_callback(state);
+        }
+    }
+    
+    // Random delay in [backoff_min_ms, min(backoff_max_ms, backoff_min_ms << attempt)]
+    int backoff(int attempt) {
+        long long ceiling = (long long)m_options.backoff_min_ms << (attempt < 20 ? attempt : 20);
+        if (ceiling > m_options.backoff_max_ms) {
+            ceiling = m_options.backoff_max_ms;
+        }
+        
+        long long span = ceiling - m_options.backoff_min_ms;
+        return m_options.backoff_min_ms + (span > 0 ? (int)(m_random() % (span + 1)) : 0);
+    }
+    
+    void run() {
+        std::unique_lock<std::mutex> lock(m_lock);
+        uint64_t outage_start = 0;
+        int attempt = 0;
+        
+        while (m_running) {
+            int wait_ms = m_options.check_ms;
+            
+            if (m_state == MT4_SESSION_CONNECTED) {
+                lock.unlock();
+                bool up = healthy();
+                lock.lock();
+                
+                if (!up && m_running) {
+                    m_disconnects++;
+                    outage_start = MT4MetricsNow();
+                    attempt = 0;
+                    lock.unlock();
+                    setState(MT4_SESSION_RECONNECTING);
+                    lock.lock();
+                    continue;
+                }
+            } else {
+                std::string error;
+                bool pumping = m_pumping;
+                lock.unlock();
+                m_attempts++;
+                bool done = m_reconnect(pumping, error);
+                lock.lock();
+                
+                if (done) {
+                    m_dropped = false;
+                    m_last_ping = 0;
+                    m_outage_ns = MT4MetricsNow() - outage_start;
+                    m_last_error.clear();
+                    lock.unlock();
+                    setState(MT4_SESSION_CONNECTED);
+                    lock.lock();
+                } else {
+                    m_last_error = error;
+                    wait_ms = backoff(attempt++);
+                }
+            }
+            
+            if (m_running) {
+                m_wake.wait_for(lock, std::chrono::milliseconds(wait_ms));
+            }
+        }
+    }
+    
+    // Deliver the differences between the pumping interface's lists and
+    // the stores as they were before the drop
+    void resync(CManagerInterface* pump) {
+        std::vector<MT4TradeEvent> trade_events;
+        std::vector<MT4UserEvent> user_events;
+        
+        int total = 0;
+        TradeRecord* trades = pump->TradesGet(&total);
+        {
+            std::vector<TradeRecord> held;
+            m_book.getTrades(held);
+            
+            std::unordered_map<int, const TradeRecord*> before;
+            before.reserve(held.size());
+            for (size_t i = 0; i < held.size(); i++) {
+                before[held[i].order] = &held[i];
+            }
+            
+            MT4TradeEvent ev;
+            ev.resync = true;
+            for (int i = 0; trades != NULL && i < total; i++) {
+                if (MT4TradeBook::isFinished(trades[i])) {
+                    continue;
+                }
+                
+                std::unordered_map<int, const TradeRecord*>::iterator it = before.find(trades[i].order);
+                if (it == before.end()) {
+                    ev.type = TRANS_ADD;
+                } else {
+                    bool same = memcmp(it->second, &trades[i], sizeof(TradeRecord)) == 0;
+                    before.erase(it);
+                    if (same) {
+                        continue;
+                    }
+                    ev.type = TRANS_UPDATE;
+                }
+                ev.trade = trades[i];
+                trade_events.push_back(ev);
+            }
+            
+            // Closed or deleted while disconnected
+            for (std::unordered_map<int, const TradeRecord*>::iterator it = before.begin(); it != before.end(); ++it) {
+                ev.type = TRANS_DELETE;
+                ev.trade = *it->second;
+                trade_events.push_back(ev);
+            }
+        }
+        if (trades) {
+            pump->MemFree(trades);
+        }
+        
+        total = 0;
+        UserRecord* users = pump->UsersGet(&total);
+        {
+            std::vector<UserRecord> held;
+            m_accounts.getRecords(held);
+            
+            std::unordered_map<int, const UserRecord*> before;
+            before.reserve(held.size());
+            for (size_t i = 0; i < held.size(); i++) {
+                before[held[i].login] = &held[i];
+            }
+            
+            MT4UserEvent ev;
+            for (int i = 0; users != NULL && i < total; i++) {
+                std::unordered_map<int, const UserRecord*>::iterator it = before.find(users[i].login);
+                if (it == before.end()) {
+                    ev.type = TRANS_ADD;
+                } else {
+                    bool same = memcmp(it->second, &users[i], sizeof(UserRecord)) == 0;
+                    before.erase(it);
+                    if (same) {
+                        continue;
+                    }
+                    ev.type = TRANS_UPDATE;
+                }
+                ev.user = users[i];
+                user_events.push_back(ev);
+            }
+            
+            for (std::unordered_map<int, const UserRecord*>::iterator it = before.begin(); it != before.end(); ++it) {
+                ev.type = TRANS_DELETE;
+                ev.user = *it->second;
+                user_events.push_back(ev);
+            }
+        }
+        if (users) {
+            pump->MemFree(users);
+        }
+        
+        // Users first, so the account side is current when trades land
+        if (!user_events.empty()) {
+            m_engine.deliverUsers(user_events.data(), (int)user_events.size());
+        }
+        if (!trade_events.empty()) {
+            m_engine.deliverTrades(trade_events.data(), (int)trade_events.size());
+        }
+        m_resync_users += user_events.size();
+        m_resync_trades += trade_events.size();
+    }
+
+public:
+    MT4SessionSupervisor(MT4PumpingEngine& engine, const MT4TradeBook& book, const MT4AccountStore& accounts)
+        : m_engine(engine), m_book(book), m_accounts(accounts), m_running(false),
+          m_random((unsigned int)MT4MetricsNow()), m_state(MT4_SESSION_IDLE), m_pumping(false),
+          m_dropped(false), m_last_ping(0), m_disconnects(0), m_attempts(0), m_resync_trades(0),
+          m_resync_users(0), m_outage_ns(0) {}
+    
+    ~MT4SessionSupervisor() {
+        stop();
+    }
+    
+    // Start supervising a session that is connected now
+    bool start(const MT4SessionOptions& options, MT4SessionProbe probe,
+               MT4SessionReconnect reconnect, MT4SessionCallback callback = MT4SessionCallback()) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        if (m_running || !probe || !reconnect || options.check_ms <= 0 || options.backoff_min_ms <= 0) {
+            return false;
+        }
+        
+        m_options = options;
+        m_probe = probe;
+        m_reconnect = reconnect;
+        m_callback = callback;
+        m_dropped = false;
+        m_state = MT4_SESSION_CONNECTED;
+        m_running = true;
+        m_thread = std::thread(&MT4SessionSupervisor::run, this);
+        return true;
+    }
+    
+    // Stop supervising; a reconnect attempt in progress finishes first
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_running = false;
+        }
+        m_wake.notify_all();
+        
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        m_state = MT4_SESSION_IDLE;
+    }
+    
+    bool isRunning() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_running;
+    }
+    
+    // Whether reconnects restart pumping; set by startPumping/stopPumping
+    void expectPumping(bool pumping) {
+        m_pumping = pumping;
+        if (!pumping) {
+            m_dropped = false;
+        }
+    }
+    
+    bool pumpingExpected() const {
+        return m_pumping;
+    }
+    
+    std::string getLastError() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_last_error;
+    }
+    
+    MT4SessionState getState() const { return (MT4SessionState)m_state.load(); }
+    unsigned long long getDisconnectCount() const { return m_disconnects; }
+    unsigned long long getAttemptCount() const { return m_attempts; }
+    unsigned long long getResyncedTrades() const { return m_resync_trades; }
+    unsigned long long getResyncedUsers() const { return m_resync_users; }
+    double getLastOutageMilliseconds() const { return m_outage_ns.load() / 1e6; }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        m_pumping = true;
+        m_dropped = false;
+    }
+    
+    void onPumpingResumed(CManagerInterface* pump) {
+        m_dropped = false;
+        if (pump != NULL) {
+            resync(pump);
+        }
+    }
+    
+    void onPumpingStopped() {
+        if (m_pumping) {
+            m_dropped = true;
+            m_wake.notify_all();
+        }
+    }
+    
+    void onPing() {
+        m_last_ping = MT4MetricsNow();
+    }
+};
+
+#endif // MT4SESSION_H
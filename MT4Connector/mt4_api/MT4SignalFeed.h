@@ -0,0 +1,654 @@
+//+------------------------------------------------------------------+
+//|                    EA Signal File Watcher and Incremental Parser |
+//+------------------------------------------------------------------+
+#ifndef MT4SIGNALFEED_H
+#define MT4SIGNALFEED_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <windows.h>
+#include "MT4Metrics.h"
+
+#define MT4_SIGNAL_NOTIFY_BUFFER  8192      // ReadDirectoryChangesW buffer bytes
+#define MT4_SIGNAL_RESCAN_MS      1000      // size check when no notification arrives
+#define MT4_SIGNAL_RECENT_IDS     1024      // ids remembered to drop re-sent signals
+#define MT4_SIGNAL_FINGERPRINT    64        // bytes before the offset checked for a rewrite
+
+//+------------------------------------------------------------------+
+//| MT4Signal - One EA signal object from the signal file            |
+//| Fields missing from the JSON are empty / 0. "id" and "signal_id" |
+//| are both accepted; login may be a number or a numeric string.    |
+//+------------------------------------------------------------------+
+struct MT4Signal {
+    char id[64];
+    char type[16];              // buy, sell, buy_limit, sell_limit, buy_stop, sell_stop, close
+    char symbol[12];
+    char comment[32];
+    int login;
+    int ticket;                 // close signals
+    double volume;              // lots
+    double price;               // pending orders
+    double sl;
+    double tp;
+};
+
+//+------------------------------------------------------------------+
+//| MT4SignalParser - Single-pass scanner for flat signal objects    |
+//| Finds complete {...} objects anywhere in a byte range, so the    |
+//| file may be a JSON array that grows in place, concatenated       |
+//| objects or one object per line. Strings are skipped with memchr; |
+//| nested values are skipped, unknown keys ignored.                 |
+//+------------------------------------------------------------------+
+class MT4SignalParser {
+private:
+    // p points after an opening quote; returns the closing quote or NULL
+    static const char* stringEnd(const char* p, const char* end) {
+        while (p < end) {
+            const char* quote = (const char*)memchr(p, '"', end - p);
+            if (quote == NULL) {
+                return NULL;
+            }
+            
+            // Escaped when preceded by an odd number of backslashes
+            const char* back = quote;
+            while (back > p && back[-1] == '\\') {
+                back--;
+            }
+            if (((quote - back) & 1) == 0) {
+                return quote;
+            }
+            p = quote + 1;
+        }
+        return NULL;
+    }
+    
+    // p points at '{' or '['; returns the matching close or NULL
+    static const char* containerEnd(const char* p, const char* end) {
+        int depth = 0;
+        
+        for (; p < end; p++) {
+            char c = *p;
+            if (c == '"') {
+                p = stringEnd(p + 1, end);
+                if (p == NULL) {
+                    return NULL;
+                }
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return p;
+                }
+            }
+        }
+        return NULL;
+    }
+    
+    static const char* skipSpace(const char* p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',')) {
+            p++;
+        }
+        return p;
+    }
+    
+    // Copy the JSON string [begin, end) to out with escapes resolved
+    // (\uXXXX becomes '?'); truncated to size - 1 characters
+    static void copyString(const char* begin, const char* end, char* out, size_t size) {
+        size_t n = 0;
+        
+        for (const char* p = begin; p < end && n + 1 < size; p++) {
+            char c = *p;
+            if (c == '\\' && p + 1 < end) {
+                c = *++p;
+                if (c == 'n') c = '\n';
+                else if (c == 't') c = '\t';
+                else if (c == 'r') c = '\r';
+                else if (c == 'b') c = '\b';
+                else if (c == 'f') c = '\f';
+                else if (c == 'u') {
+                    c = '?';
+                    p += (end - p > 4) ? 4 : end - p - 1;
+                }
+            }
+            out[n++] = c;
+        }
+        out[n] = '\0';
+    }
+    
+    static bool keyIs(const char* key, size_t length, const char* name) {
+        return strlen(name) == length && memcmp(key, name, length) == 0;
+    }
+    
+    // Store a string value under key
+    static void setString(MT4Signal& signal, const char* key, size_t length, const char* begin, const char* end) {
+        if (keyIs(key, length, "id") || keyIs(key, length, "signal_id")) {
+            copyString(begin, end, signal.id, sizeof(signal.id));
+        } else if (keyIs(key, length, "type")) {
+            copyString(begin, end, signal.type, sizeof(signal.type));
+            for (char* c = signal.type; *c; c++) {
+                if (*c >= 'A' && *c <= 'Z') {
+                    *c = (char)(*c - 'A' + 'a');
+                }
+            }
+        } else if (keyIs(key, length, "symbol")) {
+            copyString(begin, end, signal.symbol, sizeof(signal.symbol));
+        } else if (keyIs(key, length, "comment")) {
+            copyString(begin, end, signal.comment, sizeof(signal.comment));
+        } else {
+            // Numbers sent as strings ("login": "12345")
+            char number[32];
+            copyString(begin, end, number, sizeof(number));
+            setNumber(signal, key, length, strtod(number, NULL));
+        }
+    }
+    
+    // Store a numeric value under key
+    static void setNumber(MT4Signal& signal, const char* key, size_t length, double value) {
+        if (keyIs(key, length, "login")) {
+            signal.login = (int)value;
+        } else if (keyIs(key, length, "ticket")) {
+            signal.ticket = (int)value;
+        } else if (keyIs(key, length, "volume")) {
+            signal.volume = value;
+        } else if (keyIs(key, length, "price")) {
+            signal.price = value;
+        } else if (keyIs(key, length, "sl")) {
+            signal.sl = value;
+        } else if (keyIs(key, length, "tp")) {
+            signal.tp = value;
+        } else if (keyIs(key, length, "id") || keyIs(key, length, "signal_id")) {
+            snprintf(signal.id, sizeof(signal.id), "%.0f", value);
+        }
+    }
+
+public:
+    // Find the next complete top-level object at or after p. Returns its
+    // '{' and sets object_end just past its '}', or returns NULL when no
+    // complete object follows (the rest may still be being written).
+    static const char* nextObject(const char* p, const char* end, const char*& object_end) {
+        const char* open = (const char*)memchr(p, '{', end - p);
+        if (open == NULL) {
+            return NULL;
+        }
+        
+        const char* close = containerEnd(open, end);
+        if (close == NULL) {
+            return NULL;
+        }
+        
+        object_end = close + 1;
+        return open;
+    }
+    
+    // Parse the object [begin, end) returned by nextObject
+    static bool parse(const char* begin, const char* end, MT4Signal& signal) {
+        memset(&signal, 0, sizeof(signal));
+        const char* p = begin + 1;
+        const char* last = end - 1;            // the closing '}'
+        
+        while ((p = skipSpace(p, last)) < last) {
+            if (*p != '"') {
+                return false;
+            }
+            
+            const char* key = p + 1;
+            const char* key_end = stringEnd(key, last);
+            if (key_end == NULL) {
+                return false;
+            }
+            
+            p = skipSpace(key_end + 1, last);
+            if (p >= last || *p != ':') {
+                return false;
+            }
+            p = skipSpace(p + 1, last);
+            if (p >= last) {
+                return false;
+            }
+            
+            size_t length = key_end - key;
+            
+            if (*p == '"') {
+                const char* value_end = stringEnd(p + 1, last);
+                if (value_end == NULL) {
+                    return false;
+                }
+                setString(signal, key, length, p + 1, value_end);
+                p = value_end + 1;
+            } else if (*p == '{' || *p == '[') {
+                const char* value_end = containerEnd(p, last);
+                if (value_end == NULL) {
+                    return false;
+                }
+                p = value_end + 1;
+            } else {
+                // Number, true, false or null; the closing '}' stops strtod
+                char* number_end;
+                double value = strtod(p, &number_end);
+                if (number_end != p) {
+                    setNumber(signal, key, length, value);
+                    p = number_end;
+                } else {
+                    while (p < last && *p != ',' && *p != ' ' && *p != '\r' && *p != '\n') {
+                        p++;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+typedef std::function<void(const MT4Signal* signals, int count)> MT4SignalHandler;
+
+// Outcome of one executed signal: RET_OK and its ticket, or the code
+// it failed with
+typedef std::function<void(const MT4Signal& signal, int code, int order)> MT4SignalResultHandler;
+
+//+------------------------------------------------------------------+
+//| MT4SignalFeed - Delivers signals appended to an EA signal file   |
+//| A background thread waits on ReadDirectoryChangesW for the       |
+//| file's directory and reads only the bytes after the last         |
+//| complete object it has seen, through a handle that lets the EA   |
+//| truncate or replace the file meanwhile. If the                   |
+//| MT4_SIGNAL_FINGERPRINT bytes before that offset change (the EA   |
+//| rewrote the file) the whole file is parsed again; a rewrite that |
+//| keeps them is not noticed. Recently seen ids are dropped, so     |
+//| re-sent signals are not delivered twice. Signals without an id   |
+//| are skipped, matching the Python SignalProcessor. The handler    |
+//| runs on the feed thread.                                         |
+//+------------------------------------------------------------------+
+class MT4SignalFeed {
+private:
+    std::string m_path;
+    std::string m_name;
+    MT4SignalHandler m_handler;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    HANDLE m_stop;
+    HANDLE m_watch;
+    std::string m_last_error;
+    
+    // Feed thread state
+    uint64_t m_offset;                          // end of the last complete object
+    uint64_t m_fingerprint;                     // hash of the bytes just before m_offset
+    uint64_t m_scanned_size;
+    std::vector<char> m_buffer;                 // file bytes from the fingerprint on
+    std::unordered_set<std::string> m_seen;
+    std::deque<std::string> m_seen_order;
+    std::vector<MT4Signal> m_batch;
+    
+    std::atomic<unsigned long long> m_signals;
+    std::atomic<unsigned long long> m_duplicates;
+    std::atomic<unsigned long long> m_invalid;
+    std::atomic<unsigned long long> m_rewrites;
+    MT4LatencyHistogram m_latency;              // change noticed to handler returned
+    
+    // Order outcomes, reported by the handler through reportOrders()
+    std::atomic<unsigned long long> m_accepted;
+    std::atomic<unsigned long long> m_failed;
+    mutable std::mutex m_error_lock;
+    std::string m_order_error;
+    
+    MT4SignalFeed(const MT4SignalFeed&);
+    MT4SignalFeed& operator=(const MT4SignalFeed&);
+    
+    // FNV-1a of the last MT4_SIGNAL_FINGERPRINT of length bytes at data
+    static uint64_t fingerprint(const char* data, uint64_t length) {
+        uint64_t hash = 14695981039346656037ULL;
+        uint64_t begin = length > MT4_SIGNAL_FINGERPRINT ? length - MT4_SIGNAL_FINGERPRINT : 0;
+        
+        for (uint64_t i = begin; i < length; i++) {
+            hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+    
+    // Read file from begin up to size into m_buffer; size drops to the
+    // end actually read when the file shrank meanwhile
+    bool readFrom(HANDLE file, uint64_t begin, uint64_t& size) {
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)begin;
+        if (!SetFilePointerEx(file, position, NULL, FILE_BEGIN)) {
+            return false;
+        }
+        
+        m_buffer.resize((size_t)(size - begin));
+        size_t total = 0;
+        while (total < m_buffer.size()) {
+            size_t left = m_buffer.size() - total;
+            DWORD chunk = left > 0x40000000 ? 0x40000000 : (DWORD)left;
+            DWORD read = 0;
+            if (!ReadFile(file, m_buffer.data() + total, chunk, &read, NULL)) {
+                return false;
+            }
+            if (read == 0) {
+                break;
+            }
+            total += read;
+        }
+        
+        m_buffer.resize(total);
+        size = begin + total;
+        return true;
+    }
+    
+    // Remember id; false if it was seen recently
+    bool remember(const char* id) {
+        if (!m_seen.insert(id).second) {
+            return false;
+        }
+        
+        m_seen_order.push_back(id);
+        if (m_seen_order.size() > MT4_SIGNAL_RECENT_IDS) {
+            m_seen.erase(m_seen_order.front());
+            m_seen_order.pop_front();
+        }
+        return true;
+    }
+    
+    // Case-insensitive match of a notification file name against m_name
+    bool namesFile(const FILE_NOTIFY_INFORMATION* info) const {
+        size_t length = info->FileNameLength / sizeof(wchar_t);
+        if (length != m_name.size()) {
+            return false;
+        }
+        
+        for (size_t i = 0; i < length; i++) {
+            wchar_t a = info->FileName[i];
+            wchar_t b = (wchar_t)(unsigned char)m_name[i];
+            if (a >= L'A' && a <= L'Z') a = a - L'A' + L'a';
+            if (b >= L'A' && b <= L'Z') b = b - L'A' + L'a';
+            if (a != b) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Check whether a completed notification buffer mentions the file
+    bool touchesFile(const char* buffer, DWORD bytes) const {
+        if (bytes == 0) {
+            return true;                        // buffer overflowed, changes were lost
+        }
+        
+        const char* p = buffer;
+        for (;;) {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)p;
+            if (namesFile(info)) {
+                return true;
+            }
+            if (info->NextEntryOffset == 0) {
+                return false;
+            }
+            p += info->NextEntryOffset;
+        }
+    }
+    
+    // Parse what was appended since the last scan and hand it to the
+    // handler (when deliver is set). Without a notification only a size
+    // change triggers parsing.
+    void scan(uint64_t noticed, bool notified, bool deliver) {
+        // A mapping or a handle without FILE_SHARE_WRITE and
+        // FILE_SHARE_DELETE would make the EA's truncate or rewrite fail
+        HANDLE file = CreateFileA(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;                             // missing or being replaced
+        }
+        
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file, &length) || (!notified && (uint64_t)length.QuadPart == m_scanned_size)) {
+            CloseHandle(file);
+            return;
+        }
+        
+        // Only the fingerprinted bytes before the offset are read again
+        uint64_t size = (uint64_t)length.QuadPart;
+        uint64_t begin = 0;
+        if (m_offset <= size && m_offset > MT4_SIGNAL_FINGERPRINT) {
+            begin = m_offset - MT4_SIGNAL_FINGERPRINT;
+        }
+        bool read = readFrom(file, begin, size);
+        
+        if (read && (m_offset > size || fingerprint(m_buffer.data(), m_offset - begin) != m_fingerprint)) {
+            m_offset = 0;
+            m_rewrites++;
+            if (begin > 0) {
+                size = (uint64_t)length.QuadPart;
+                begin = 0;
+                read = readFrom(file, begin, size);
+            }
+        }
+        CloseHandle(file);
+        if (!read) {
+            return;
+        }
+        
+        m_batch.clear();
+        const char* data = m_buffer.data();
+        const char* p = data + (m_offset - begin);
+        const char* end = data + m_buffer.size();
+        const char* object;
+        const char* object_end;
+        
+        while (p < end && (object = MT4SignalParser::nextObject(p, end, object_end)) != NULL) {
+            MT4Signal signal;
+            
+            if (!MT4SignalParser::parse(object, object_end, signal) || signal.id[0] == '\0') {
+                m_invalid++;
+            } else if (!remember(signal.id)) {
+                m_duplicates++;
+            } else {
+                m_batch.push_back(signal);
+            }
+            p = object_end;
+        }
+        
+        m_offset = begin + (uint64_t)(p - data);
+        m_fingerprint = fingerprint(data, m_offset - begin);
+        m_scanned_size = size;
+        
+        if (deliver && !m_batch.empty()) {
+            m_handler(&m_batch[0], (int)m_batch.size());
+            m_signals += m_batch.size();
+            m_latency.recordSince(noticed);
+        }
+    }
+    
+    void run(bool deliver_existing) {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+        
+        // DWORD-aligned as ReadDirectoryChangesW requires
+        DWORD buffer[MT4_SIGNAL_NOTIFY_BUFFER / sizeof(DWORD)];
+        const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_FILE_NAME;
+        bool armed = false;
+        
+        scan(MT4MetricsNow(), true, deliver_existing);
+        
+        while (m_running) {
+            // Fall back to size polling if the directory cannot be watched
+            if (!armed && m_watch != INVALID_HANDLE_VALUE && overlapped.hEvent != NULL) {
+                ResetEvent(overlapped.hEvent);
+                armed = ReadDirectoryChangesW(m_watch, buffer, sizeof(buffer), FALSE, filter,
+                                              NULL, &overlapped, NULL) != 0;
+            }
+            
+            HANDLE waits[2] = { m_stop, overlapped.hEvent };
+            DWORD wait = WaitForMultipleObjects(armed ? 2 : 1, waits, FALSE, MT4_SIGNAL_RESCAN_MS);
+            uint64_t noticed = MT4MetricsNow();
+            
+            if (wait == WAIT_OBJECT_0) {
+                break;
+            }
+            
+            if (wait == WAIT_OBJECT_0 + 1) {
+                DWORD bytes = 0;
+                armed = false;
+                if (GetOverlappedResult(m_watch, &overlapped, &bytes, FALSE) &&
+                    touchesFile((const char*)buffer, bytes)) {
+                    scan(noticed, true, true);
+                }
+            } else {
+                scan(noticed, false, true);
+            }
+        }
+        
+        if (armed) {
+            DWORD bytes;
+            CancelIoEx(m_watch, &overlapped);
+            GetOverlappedResult(m_watch, &overlapped, &bytes, TRUE);
+        }
+        if (overlapped.hEvent != NULL) {
+            CloseHandle(overlapped.hEvent);
+        }
+    }
+
+public:
+    MT4SignalFeed()
+        : m_running(false), m_stop(NULL), m_watch(INVALID_HANDLE_VALUE), m_offset(0), m_fingerprint(0),
+          m_scanned_size(0), m_signals(0), m_duplicates(0), m_invalid(0), m_rewrites(0),
+          m_accepted(0), m_failed(0) {}
+    
+    ~MT4SignalFeed() {
+        stop();
+    }
+    
+    // Start watching path and pass newly written signals to handler. With
+    // deliver_existing the signals already in the file are delivered first
+    // (as SignalProcessor does at startup); otherwise they are only marked seen.
+    bool start(const char* path, MT4SignalHandler handler, bool deliver_existing = true) {
+        if (m_running) {
+            m_last_error = "Signal feed already running";
+            return false;
+        }
+        if (path == NULL || *path == '\0' || !handler) {
+            m_last_error = "Signal file path and handler are required";
+            return false;
+        }
+        
+        m_path = path;
+        size_t slash = m_path.find_last_of("\\/");
+        std::string directory = slash == std::string::npos ? "." : m_path.substr(0, slash);
+        m_name = slash == std::string::npos ? m_path : m_path.substr(slash + 1);
+        m_handler = handler;
+        
+        m_offset = 0;
+        m_fingerprint = fingerprint(NULL, 0);
+        m_scanned_size = 0;
+        m_seen.clear();
+        m_seen_order.clear();
+        
+        m_stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+        if (m_stop == NULL) {
+            m_last_error = "Failed to create signal feed stop event";
+            return false;
+        }
+        
+        m_watch = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                              FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+        
+        m_running = true;
+        m_thread = std::thread(&MT4SignalFeed::run, this, deliver_existing);
+        return true;
+    }
+    
+    void stop() {
+        if (!m_running) {
+            return;
+        }
+        
+        m_running = false;
+        SetEvent(m_stop);
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        
+        if (m_watch != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_watch);
+            m_watch = INVALID_HANDLE_VALUE;
+        }
+        CloseHandle(m_stop);
+        m_stop = NULL;
+    }
+    
+    bool isRunning() const {
+        return m_running;
+    }
+    
+    // Check if changes are notified rather than found by size polling
+    bool isWatching() const {
+        return m_watch != INVALID_HANDLE_VALUE;
+    }
+    
+    const char* getLastError() const {
+        return m_last_error.c_str();
+    }
+    
+    // Signals passed to the handler
+    unsigned long long getSignalCount() const {
+        return m_signals;
+    }
+    
+    // Signals dropped because their id was delivered recently
+    unsigned long long getDuplicateCount() const {
+        return m_duplicates;
+    }
+    
+    // Objects that were not valid signal JSON or had no id
+    unsigned long long getInvalidCount() const {
+        return m_invalid;
+    }
+    
+    // Times the file was rewritten rather than appended to
+    unsigned long long getRewriteCount() const {
+        return m_rewrites;
+    }
+    
+    // Time from noticing a change to the handler returning
+    const MT4LatencyHistogram& getLatency() const {
+        return m_latency;
+    }
+    
+    // Count the orders the handler sent for one batch; error describes
+    // the last failure and is kept when failed is 0
+    void reportOrders(int accepted, int failed, const std::string& error) {
+        m_accepted += accepted;
+        m_failed += failed;
+        if (failed > 0) {
+            std::lock_guard<std::mutex> lock(m_error_lock);
+            m_order_error = error;
+        }
+    }
+    
+    // Signals the server accepted as orders
+    unsigned long long getAcceptedCount() const {
+        return m_accepted;
+    }
+    
+    // Signals that could not be built or were rejected
+    unsigned long long getFailedCount() const {
+        return m_failed;
+    }
+    
+    // Last order failure reported by the handler (any thread)
+    std::string getOrderError() const {
+        std::lock_guard<std::mutex> lock(m_error_lock);
+        return m_order_error;
+    }
+};
+
+#endif // MT4SIGNALFEED_H
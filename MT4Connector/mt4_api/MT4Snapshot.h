@@ -0,0 +1,478 @@
+//+------------------------------------------------------------------+
+//|                   Versioned Snapshot File of the Startup Datasets |
+//+------------------------------------------------------------------+
+#ifndef MT4SNAPSHOT_H
+#define MT4SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4Pumping.h"
+#include "MT4MappedFile.h"
+
+#define MT4_SNAPSHOT_MAGIC    0x50414E53    // "SNAP"
+#define MT4_SNAPSHOT_VERSION  1             // bump on any layout change
+#define MT4_SNAPSHOT_SERVER   64            // server name bytes kept in the header
+
+// Datasets of a snapshot, in file order
+enum MT4SnapshotSection {
+    MT4_SNAPSHOT_SYMBOLS = 0,
+    MT4_SNAPSHOT_GROUPS,
+    MT4_SNAPSHOT_USERS,
+    MT4_SNAPSHOT_TRADES,
+    MT4_SNAPSHOT_SECTION_COUNT
+};
+
+struct MT4SnapshotSectionInfo {
+    uint64_t offset;            // from the start of the file, 8-byte aligned
+    uint32_t count;
+    uint32_t record_size;       // sizeof the API structure that wrote it
+};
+
+//+------------------------------------------------------------------+
+//| MT4SnapshotHeader - First bytes of a snapshot file               |
+//| A file is only accepted with the same magic, version and record  |
+//| sizes, so a snapshot written against another API header is       |
+//| rejected instead of misread. A dataset whose cache was not       |
+//| loaded at save time is stored empty with its present bit clear,  |
+//| so it is not mistaken for an empty server. The checksum covers   |
+//| every byte after the header.                                     |
+//+------------------------------------------------------------------+
+struct MT4SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;        // increases with every save
+    int64_t saved_time;         // time() of the save
+    uint64_t payload_size;
+    uint64_t checksum;
+    int32_t login;              // manager login that saved it
+    uint32_t present;           // bit (1 << MT4SnapshotSection) per dataset that was known
+    char server[MT4_SNAPSHOT_SERVER];
+    MT4SnapshotSectionInfo sections[MT4_SNAPSHOT_SECTION_COUNT];
+};
+
+//+------------------------------------------------------------------+
+//| MT4SnapshotData - The datasets of one snapshot                   |
+//| Filled by MT4SnapshotFile::getData() the arrays point into the   |
+//| mapped file and are valid while it stays open. TradeRecord::next |
+//| is meaningless after a reload.                                   |
+//+------------------------------------------------------------------+
+struct MT4SnapshotData {
+    unsigned int present;       // MT4SnapshotHeader::present
+    const ConSymbol* symbols;
+    int symbol_count;
+    const ConGroup* groups;
+    int group_count;
+    const UserRecord* users;
+    int user_count;
+    const TradeRecord* trades;
+    int trade_count;
+};
+
+//+------------------------------------------------------------------+
+//| MT4SnapshotFile - Reads and writes snapshot files                |
+//| open() maps the file read-only and validates it, so loading is   |
+//| one pass over the pages rather than a parse. write() fills a     |
+//| ".tmp" file next to the target and moves it over the old one, so |
+//| a crash mid-save leaves the previous snapshot intact.            |
+//+------------------------------------------------------------------+
+class MT4SnapshotFile {
+private:
+    MT4MappedFile m_file;
+    const MT4SnapshotHeader* m_header;
+    std::string m_last_error;
+    
+    MT4SnapshotFile(const MT4SnapshotFile&);
+    MT4SnapshotFile& operator=(const MT4SnapshotFile&);
+    
+    static const uint32_t* recordSizes() {
+        static const uint32_t sizes[MT4_SNAPSHOT_SECTION_COUNT] = {
+            sizeof(ConSymbol), sizeof(ConGroup), sizeof(UserRecord), sizeof(TradeRecord)
+        };
+        return sizes;
+    }
+    
+    static uint64_t align(uint64_t offset) {
+        return (offset + 7) & ~(uint64_t)7;
+    }
+    
+    // FNV-1a over 8-byte words; sections are 8-byte aligned
+    static uint64_t checksum(const char* data, uint64_t size) {
+        uint64_t h = 14695981039346656037ull;
+        uint64_t i = 0;
+        
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            h ^= word;
+            h *= 1099511628211ull;
+        }
+        for (; i < size; i++) {
+            h ^= (unsigned char)data[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+    
+    bool fail(const char* error) {
+        m_last_error = error;
+        close();
+        return false;
+    }
+
+public:
+    MT4SnapshotFile() : m_header(NULL) {}
+    
+    // Map and validate a snapshot file
+    bool open(const char* path) {
+        close();
+        
+        if (!m_file.openRead(path)) {
+            m_last_error = std::string("Cannot open snapshot file ") + path;
+            return false;
+        }
+        if (m_file.size() < sizeof(MT4SnapshotHeader)) {
+            return fail("Snapshot file is truncated");
+        }
+        
+        const MT4SnapshotHeader* header = (const MT4SnapshotHeader*)m_file.data();
+        if (header->magic != MT4_SNAPSHOT_MAGIC) {
+            return fail("Not a snapshot file");
+        }
+        if (header->version != MT4_SNAPSHOT_VERSION) {
+            return fail("Snapshot file version is not supported");
+        }
+        if (header->payload_size != m_file.size() - sizeof(MT4SnapshotHeader)) {
+            return fail("Snapshot file is truncated");
+        }
+        
+        for (int i = 0; i < MT4_SNAPSHOT_SECTION_COUNT; i++) {
+            const MT4SnapshotSectionInfo& section = header->sections[i];
+            if (section.record_size != recordSizes()[i]) {
+                return fail("Snapshot was written with different API record layouts");
+            }
+            if (section.offset < sizeof(MT4SnapshotHeader) || section.offset > m_file.size() ||
+                (uint64_t)section.count * section.record_size > m_file.size() - section.offset) {
+                return fail("Snapshot section lies outside the file");
+            }
+        }
+        
+        if (checksum(m_file.data() + sizeof(MT4SnapshotHeader), header->payload_size) != header->checksum) {
+            return fail("Snapshot checksum mismatch");
+        }
+        
+        m_header = header;
+        return true;
+    }
+    
+    void close() {
+        m_header = NULL;
+        m_file.close();
+    }
+    
+    bool isOpen() const {
+        return m_header != NULL;
+    }
+    
+    // Header of the open file; only valid while isOpen()
+    const MT4SnapshotHeader& getHeader() const {
+        return *m_header;
+    }
+    
+    // Point data at the datasets of the open file
+    void getData(MT4SnapshotData& data) const {
+        const char* base = m_file.data();
+        const MT4SnapshotSectionInfo* s = m_header->sections;
+        
+        data.present = m_header->present;
+        data.symbols = (const ConSymbol*)(base + s[MT4_SNAPSHOT_SYMBOLS].offset);
+        data.symbol_count = (int)s[MT4_SNAPSHOT_SYMBOLS].count;
+        data.groups = (const ConGroup*)(base + s[MT4_SNAPSHOT_GROUPS].offset);
+        data.group_count = (int)s[MT4_SNAPSHOT_GROUPS].count;
+        data.users = (const UserRecord*)(base + s[MT4_SNAPSHOT_USERS].offset);
+        data.user_count = (int)s[MT4_SNAPSHOT_USERS].count;
+        data.trades = (const TradeRecord*)(base + s[MT4_SNAPSHOT_TRADES].offset);
+        data.trade_count = (int)s[MT4_SNAPSHOT_TRADES].count;
+    }
+    
+    const char* getLastError() const {
+        return m_last_error.c_str();
+    }
+    
+    // Write data to path as the given generation; false with error set
+    static bool write(const char* path, const MT4SnapshotData& data, uint64_t generation,
+                      int login, const char* server, std::string& error) {
+        const void* arrays[MT4_SNAPSHOT_SECTION_COUNT] = { data.symbols, data.groups, data.users, data.trades };
+        int counts[MT4_SNAPSHOT_SECTION_COUNT] = { data.symbol_count, data.group_count, data.user_count, data.trade_count };
+        
+        MT4SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = MT4_SNAPSHOT_MAGIC;
+        header.version = MT4_SNAPSHOT_VERSION;
+        header.generation = generation;
+        header.saved_time = (int64_t)time(NULL);
+        header.login = login;
+        header.present = data.present;
+        if (server != NULL) {
+            strncpy(header.server, server, sizeof(header.server) - 1);
+        }
+        
+        uint64_t offset = sizeof(MT4SnapshotHeader);
+        for (int i = 0; i < MT4_SNAPSHOT_SECTION_COUNT; i++) {
+            offset = align(offset);
+            header.sections[i].offset = offset;
+            header.sections[i].count = counts[i] > 0 ? (uint32_t)counts[i] : 0;
+            header.sections[i].record_size = recordSizes()[i];
+            offset += (uint64_t)header.sections[i].count * header.sections[i].record_size;
+        }
+        header.payload_size = offset - sizeof(MT4SnapshotHeader);
+        
+        std::string temp = std::string(path) + ".tmp";
+        MT4MappedFile file;
+        if (!file.openWrite(temp.c_str(), offset) || (file.size() != offset && !file.resize(offset))) {
+            error = std::string("Cannot write snapshot file ") + temp;
+            file.close();
+            DeleteFileA(temp.c_str());
+            return false;
+        }
+        
+        char* out = file.data();
+        uint64_t end = sizeof(MT4SnapshotHeader);
+        for (int i = 0; i < MT4_SNAPSHOT_SECTION_COUNT; i++) {
+            const MT4SnapshotSectionInfo& section = header.sections[i];
+            size_t bytes = (size_t)section.count * section.record_size;
+            
+            memset(out + end, 0, (size_t)(section.offset - end));     // alignment padding
+            if (bytes > 0) {
+                memcpy(out + section.offset, arrays[i], bytes);
+            }
+            end = section.offset + bytes;
+        }
+        header.checksum = checksum(out + sizeof(MT4SnapshotHeader), header.payload_size);
+        memcpy(out, &header, sizeof(header));
+        
+        bool flushed = file.flush(0, offset);
+        file.closeAt(offset);
+        
+        if (!flushed || !MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            error = std::string("Cannot replace snapshot file ") + path;
+            DeleteFileA(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+//+------------------------------------------------------------------+
+//| MT4SnapshotCache - Snapshot state kept by MT4Manager             |
+//| Holds the group list (no other cache keeps whole ConGroups), the |
+//| generation and load/save counters, and runs the periodic save    |
+//| thread. The datasets themselves live in the stores; MT4Manager   |
+//| collects and applies them. Serving ends when pumping stops: the  |
+//| loaded data is then only as fresh as the next pump or reconcile. |
+//| The login and server a save is tagged with, and the error of the |
+//| last failed save, are kept here for the save thread.             |
+//+------------------------------------------------------------------+
+class MT4SnapshotCache : public MT4PumpListener {
+private:
+    std::vector<ConGroup> m_groups;
+    mutable std::mutex m_groups_lock;
+    
+    std::string m_path;                     // periodic and shutdown saves, guarded by m_lock
+    std::string m_server;                   // saves are tagged with, guarded by m_lock
+    int m_login;
+    std::string m_loaded_server;            // of the last file loaded, guarded by m_lock
+    std::string m_save_error;               // of the last failed save, guarded by m_lock
+    std::function<bool()> m_save;
+    std::thread m_thread;
+    mutable std::mutex m_lock;
+    std::condition_variable m_wake;
+    bool m_running;
+    
+    std::atomic<uint64_t> m_generation;     // of the last file loaded or saved
+    std::atomic<bool> m_serving;            // stores were filled from a snapshot
+    std::atomic<unsigned long long> m_saves;
+    std::atomic<unsigned long long> m_save_failures;
+    std::atomic<unsigned long long> m_reconciles;
+    std::atomic<unsigned long long> m_changed;   // records that differed at the last reconcile
+    std::atomic<uint64_t> m_load_ns;
+    
+    MT4SnapshotCache(const MT4SnapshotCache&);
+    MT4SnapshotCache& operator=(const MT4SnapshotCache&);
+    
+    void run(int interval_ms) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        
+        while (m_running) {
+            m_wake.wait_for(lock, std::chrono::milliseconds(interval_ms));
+            if (!m_running) {
+                break;
+            }
+            
+            std::function<bool()> save = m_save;
+            lock.unlock();
+            save();
+            lock.lock();
+        }
+    }
+
+public:
+    MT4SnapshotCache()
+        : m_login(0), m_running(false), m_generation(0), m_serving(false), m_saves(0), m_save_failures(0),
+          m_reconciles(0), m_changed(0), m_load_ns(0) {}
+    
+    ~MT4SnapshotCache() {
+        stopSaving();
+    }
+    
+    // Set the path used by the periodic and shutdown saves ("" for none)
+    void setPath(const char* path) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_path = path != NULL ? path : "";
+    }
+    
+    std::string getPath() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_path;
+    }
+    
+    // Set the login and server that saves are written for
+    void setOwner(int login, const char* server) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_login = login;
+        m_server = server != NULL ? server : "";
+    }
+    
+    void getOwner(int& login, std::string& server) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        login = m_login;
+        server = m_server;
+    }
+    
+    // Call save every interval_ms on a background thread
+    bool startSaving(int interval_ms, std::function<bool()> save) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        
+        if (m_running || interval_ms <= 0 || !save) {
+            return false;
+        }
+        
+        m_save = save;
+        m_running = true;
+        m_thread = std::thread(&MT4SnapshotCache::run, this, interval_ms);
+        return true;
+    }
+    
+    // Stop the periodic saves; a save in progress finishes first
+    void stopSaving() {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_running = false;
+        }
+        m_wake.notify_all();
+        
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+    
+    void setGroups(const ConGroup* groups, int total) {
+        std::lock_guard<std::mutex> lock(m_groups_lock);
+        m_groups.assign(groups, groups + (total > 0 ? total : 0));
+    }
+    
+    void getGroups(std::vector<ConGroup>& groups) const {
+        std::lock_guard<std::mutex> lock(m_groups_lock);
+        groups = m_groups;
+    }
+    
+    // Record a load of file generation, saved for server, that took nanos
+    void onLoaded(uint64_t generation, const std::string& server, uint64_t nanos) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_loaded_server = server;
+        }
+        m_generation = generation;
+        m_load_ns = nanos;
+        m_serving = true;
+    }
+    
+    // Check whether the data being served was saved for another server
+    bool servesOtherServer(const char* server) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_serving && m_loaded_server != server;
+    }
+    
+    // Generation for the next save
+    uint64_t nextGeneration() const {
+        return m_generation.load() + 1;
+    }
+    
+    void onSaved(bool saved, uint64_t generation, const std::string& error) {
+        if (saved) {
+            m_generation = generation;
+            m_saves++;
+        } else {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_save_error = error;
+            m_save_failures++;
+        }
+    }
+    
+    // Why the last failed save failed, "" if none did
+    std::string getSaveError() const {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_save_error;
+    }
+    
+    void onReconciled(unsigned long long changed) {
+        m_changed = changed;
+        m_reconciles++;
+    }
+    
+    void setServing(bool serving) {
+        m_serving = serving;
+    }
+    
+    // Check whether lookups may answer from snapshot-loaded stores
+    bool isServing() const {
+        return m_serving;
+    }
+    
+    uint64_t getGeneration() const { return m_generation; }
+    double getLoadMilliseconds() const { return m_load_ns.load() / 1e6; }
+    unsigned long long getSaveCount() const { return m_saves; }
+    unsigned long long getSaveFailureCount() const { return m_save_failures; }
+    unsigned long long getReconcileCount() const { return m_reconciles; }
+    unsigned long long getChangedCount() const { return m_changed; }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        ConGroup* groups = pump->GroupsGet(&total);
+        if (groups) {
+            setGroups(groups, total);
+            pump->MemFree(groups);
+        }
+    }
+    
+    void onPumpingStopped() {
+        m_serving = false;
+    }
+};
+
+#endif // MT4SNAPSHOT_H
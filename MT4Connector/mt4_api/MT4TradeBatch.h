@@ -0,0 +1,198 @@
+//+------------------------------------------------------------------+
+//|                           Pipelined Trade Transaction Batches      |
+//+------------------------------------------------------------------+
+#ifndef MT4TRADEBATCH_H
+#define MT4TRADEBATCH_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <windows.h>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+
+//+------------------------------------------------------------------+
+//| MT4TransResult - Outcome of one transaction in a batch           |
+//+------------------------------------------------------------------+
+struct MT4TransResult {
+    int code;                   // RET_OK or the TradeTransaction error code
+    int order;                  // ticket of the transaction, 0 if not known
+};
+
+// Sends one transaction on a connection and resolves its ticket;
+// returns the Manager API code
+typedef std::function<int(CManagerInterface*, TradeTransInfo&, int&)> MT4TransSender;
+
+//+------------------------------------------------------------------+
+//| MT4TradeBatch - Runs batches of transactions over N connections  |
+//| Every connection keeps pulling the next unsent transaction, so a |
+//| batch takes roughly count/N round trips instead of count. The    |
+//| caller drives the first connection; the others run on helper     |
+//| threads that are kept between batches and only added when more   |
+//| connections are busy at once. A single Manager API interface     |
+//| must not be used by two threads at once, so each connection runs |
+//| on exactly one thread. The caller's transactions are not changed.|
+//+------------------------------------------------------------------+
+class MT4TradeBatch {
+private:
+    struct Job {
+        const TradeTransInfo* infos;
+        MT4TransResult* results;
+        int count;
+        const MT4TransSender* send;
+        std::atomic<int> next;
+        std::atomic<int> succeeded;
+        int helpers;                // tasks queued or running, under m_lock
+    };
+    
+    struct Task {
+        Job* job;
+        CManagerInterface* manager;
+    };
+    
+    std::vector<std::thread> m_threads;
+    std::deque<Task> m_tasks;
+    std::mutex m_lock;
+    std::condition_variable m_ready;
+    std::condition_variable m_done;
+    int m_idle;                     // helper threads not running a task
+    bool m_running;
+    
+    MT4TradeBatch(const MT4TradeBatch&);
+    MT4TradeBatch& operator=(const MT4TradeBatch&);
+    
+    // Send transactions of job over one connection until none are left
+    static void run(Job& job, CManagerInterface* manager) {
+        int index;
+        
+        while ((index = job.next.fetch_add(1)) < job.count) {
+            // The server fills in prices and the ticket; keep that off the caller's array
+            TradeTransInfo info = job.infos[index];
+            int ticket = 0;
+            int res = (*job.send)(manager, info, ticket);
+            
+            job.results[index].code = res;
+            job.results[index].order = (res == RET_OK) ? ticket : 0;
+            
+            if (res == RET_OK) {
+                job.succeeded++;
+            }
+        }
+    }
+    
+    // Helper thread loop
+    void work() {
+        std::unique_lock<std::mutex> lock(m_lock);
+        
+        for (;;) {
+            m_ready.wait(lock, [this]() { return !m_tasks.empty() || !m_running; });
+            
+            if (m_tasks.empty()) {
+                return;
+            }
+            
+            Task task = m_tasks.front();
+            m_tasks.pop_front();
+            m_idle--;
+            
+            lock.unlock();
+            run(*task.job, task.manager);
+            lock.lock();
+            
+            m_idle++;
+            if (--task.job->helpers == 0) {
+                m_done.notify_all();
+            }
+        }
+    }
+
+public:
+    MT4TradeBatch() : m_idle(0), m_running(true) {}
+    
+    ~MT4TradeBatch() {
+        stop();
+    }
+    
+    // Join the helper threads; must not be called while a batch runs
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_running = false;
+        }
+        m_ready.notify_all();
+        
+        for (size_t i = 0; i < m_threads.size(); i++) {
+            m_threads[i].join();
+        }
+        m_threads.clear();
+    }
+    
+    // Send count transactions with send, results[i] receiving the outcome
+    // of infos[i]; blocks until every transaction has a result. Several
+    // batches may run at once on different connections. Returns the
+    // number of transactions accepted by the server.
+    int execute(const TradeTransInfo* infos, int count, MT4TransResult* results,
+                CManagerInterface** connections, int connection_count, const MT4TransSender& send) {
+        if (connection_count <= 0 || count <= 0) {
+            return 0;
+        }
+        
+        Job job;
+        job.infos = infos;
+        job.results = results;
+        job.count = count;
+        job.send = &send;
+        job.next = 0;
+        job.succeeded = 0;
+        job.helpers = 0;
+        
+        int workers = connection_count < count ? connection_count : count;
+        if (workers > 1) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            
+            if (m_running) {
+                for (int i = 1; i < workers; i++) {
+                    Task task = { &job, connections[i] };
+                    m_tasks.push_back(task);
+                }
+                job.helpers = workers - 1;
+                
+                // Tasks are bounded by the connections, and so are the threads
+                while (m_idle < (int)m_tasks.size()) {
+                    m_threads.push_back(std::thread(&MT4TradeBatch::work, this));
+                    m_idle++;
+                }
+            }
+        }
+        m_ready.notify_all();
+        
+        // The calling thread drives the first connection
+        run(job, connections[0]);
+        
+        std::unique_lock<std::mutex> lock(m_lock);
+        
+        // Tasks no helper picked up have nothing left to send
+        for (std::deque<Task>::iterator it = m_tasks.begin(); it != m_tasks.end();) {
+            if (it->job == &job) {
+                it = m_tasks.erase(it);
+                job.helpers--;
+            } else {
+                ++it;
+            }
+        }
+        m_done.wait(lock, [&job]() { return job.helpers == 0; });
+        
+        return job.succeeded;
+    }
+    
+    // Helper threads started so far
+    int threads() {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return (int)m_threads.size();
+    }
+};
+
+#endif // MT4TRADEBATCH_H
@@ -0,0 +1,377 @@
+//+------------------------------------------------------------------+
+//|                    Incremental In-memory Trade Book from Pumping  |
+//+------------------------------------------------------------------+
+#ifndef MT4TRADEBOOK_H
+#define MT4TRADEBOOK_H
+
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include "MT4Pumping.h"
+#include "MT4Dictionary.h"
+
+//+------------------------------------------------------------------+
+//| MT4TradeBook - Open orders keyed by ticket                       |
+//| Bootstrapped with the full trade list when pumping starts (or    |
+//| from TradesRequest) and kept current from PUMP_UPDATE_TRADES.    |
+//| Secondary indexes by login and by symbol id make per-account and |
+//| per-symbol lookups independent of the book size. Updates come    |
+//| from the pumping thread; reads may come from any thread.         |
+//| The filterable fields are mirrored per slot in dense columns so  |
+//| queries (see MT4Query.h) scan them without touching the records. |
+//+------------------------------------------------------------------+
+class MT4TradeBook : public MT4PumpListener {
+public:
+    // Read-only view of the slot columns, valid inside read(); free
+    // slots have live[slot] == 0
+    struct Columns {
+        int count;
+        const unsigned char* live;
+        const int* login;
+        const int* symbol_id;
+        const int* cmd;
+        const int* volume;
+        const time_t* open_time;
+        const double* profit;
+        const TradeRecord* record;
+        const std::vector<int>* by_symbol;      // symbol id -> slots
+        int symbol_count;
+    };
+
+private:
+    typedef std::vector<int> SlotList;
+    
+    std::vector<TradeRecord> m_records;                 // slot storage
+    std::vector<unsigned char> m_live;
+    std::vector<int> m_login;
+    std::vector<int> m_symbol_id;
+    std::vector<int> m_cmd;
+    std::vector<int> m_volume;
+    std::vector<time_t> m_open_time;
+    std::vector<double> m_profit;
+    std::vector<int> m_free_slots;
+    std::unordered_map<int, int> m_by_ticket;           // ticket -> slot
+    std::unordered_map<int, SlotList> m_by_login;       // login -> slots
+    std::vector<SlotList> m_by_symbol;                  // symbol id -> slots
+    MT4Dictionary& m_dictionary;
+    mutable std::shared_mutex m_lock;
+    std::atomic<bool> m_ready;
+    std::atomic<unsigned long long> m_updates;
+    
+    MT4TradeBook(const MT4TradeBook&);
+    MT4TradeBook& operator=(const MT4TradeBook&);
+    
+    // Slot list of a symbol, NULL if it could not be interned. Symbols
+    // are interned before the lock is taken, see internSymbol().
+    SlotList* symbolSlots(const char* symbol) {
+        int id = m_dictionary.findSymbol(symbol);
+        return id >= 0 ? &m_by_symbol[id] : NULL;
+    }
+    
+    // A new name takes the dictionary and quote table locks, so it is
+    // never interned under m_lock
+    void internSymbol(const char* symbol) {
+        m_dictionary.addSymbol(symbol);
+    }
+    
+    // Mirror a record into the slot columns
+    void setColumnsLocked(int slot, const TradeRecord& trade) {
+        if (slot == (int)m_live.size()) {
+            m_live.push_back(0);
+            m_login.push_back(0);
+            m_symbol_id.push_back(-1);
+            m_cmd.push_back(0);
+            m_volume.push_back(0);
+            m_open_time.push_back(0);
+            m_profit.push_back(0);
+        }
+        
+        m_live[slot] = 1;
+        m_login[slot] = trade.login;
+        m_symbol_id[slot] = m_dictionary.findSymbol(trade.symbol);
+        m_cmd[slot] = trade.cmd;
+        m_volume[slot] = trade.volume;
+        m_open_time[slot] = trade.open_time;
+        m_profit[slot] = trade.profit;
+    }
+    
+    static void unlink(SlotList& list, int slot) {
+        for (size_t i = 0; i < list.size(); i++) {
+            if (list[i] == slot) {
+                list[i] = list.back();
+                list.pop_back();
+                return;
+            }
+        }
+    }
+    
+    // Drop slot from the login's list, and the list once it is empty
+    void unlinkLogin(int login, int slot) {
+        std::unordered_map<int, SlotList>::iterator it = m_by_login.find(login);
+        if (it == m_by_login.end()) {
+            return;
+        }
+        
+        unlink(it->second, slot);
+        if (it->second.empty()) {
+            m_by_login.erase(it);
+        }
+    }
+    
+    // Insert or replace (caller holds the exclusive lock)
+    void upsertLocked(const TradeRecord& trade) {
+        std::unordered_map<int, int>::iterator it = m_by_ticket.find(trade.order);
+        
+        if (it != m_by_ticket.end()) {
+            TradeRecord& current = m_records[it->second];
+            
+            // Re-index only when the keys changed (rare)
+            if (current.login != trade.login) {
+                unlinkLogin(current.login, it->second);
+                m_by_login[trade.login].push_back(it->second);
+            }
+            if (strncmp(current.symbol, trade.symbol, sizeof(current.symbol)) != 0) {
+                SlotList* from = symbolSlots(current.symbol);
+                SlotList* to = symbolSlots(trade.symbol);
+                if (from) unlink(*from, it->second);
+                if (to) to->push_back(it->second);
+            }
+            
+            current = trade;
+            setColumnsLocked(it->second, trade);
+            return;
+        }
+        
+        int slot;
+        if (!m_free_slots.empty()) {
+            slot = m_free_slots.back();
+            m_free_slots.pop_back();
+            m_records[slot] = trade;
+        } else {
+            slot = (int)m_records.size();
+            m_records.push_back(trade);
+        }
+        
+        m_by_ticket[trade.order] = slot;
+        m_by_login[trade.login].push_back(slot);
+        
+        SlotList* symbol_slots = symbolSlots(trade.symbol);
+        if (symbol_slots) {
+            symbol_slots->push_back(slot);
+        }
+        setColumnsLocked(slot, trade);
+    }
+    
+    // Remove by ticket (caller holds the exclusive lock)
+    void removeLocked(int ticket) {
+        std::unordered_map<int, int>::iterator it = m_by_ticket.find(ticket);
+        if (it == m_by_ticket.end()) {
+            return;
+        }
+        
+        int slot = it->second;
+        const TradeRecord& trade = m_records[slot];
+        
+        unlinkLogin(trade.login, slot);
+        
+        SlotList* symbol_slots = symbolSlots(trade.symbol);
+        if (symbol_slots) {
+            unlink(*symbol_slots, slot);
+        }
+        m_by_ticket.erase(it);
+        m_free_slots.push_back(slot);
+        m_live[slot] = 0;
+    }
+    
+    void copySlots(const SlotList& slots, std::vector<TradeRecord>& trades) const {
+        trades.reserve(trades.size() + slots.size());
+        for (size_t i = 0; i < slots.size(); i++) {
+            trades.push_back(m_records[slots[i]]);
+        }
+    }
+
+public:
+    // Check if a record represents a closed or deleted order
+    static bool isFinished(const TradeRecord& trade) {
+        return trade.state == TS_CLOSED_NORMAL || trade.state == TS_CLOSED_PART ||
+               trade.state == TS_CLOSED_BY || trade.state == TS_DELETED ||
+               trade.close_time != 0;
+    }
+    
+    explicit MT4TradeBook(MT4Dictionary& dictionary)
+        : m_by_symbol(MT4_MAX_SYMBOLS), m_dictionary(dictionary), m_ready(false), m_updates(0) {}
+    
+    // Replace the book contents with a full trade list
+    void load(const TradeRecord* trades, int total) {
+        for (int i = 0; i < total; i++) {
+            internSymbol(trades[i].symbol);
+        }
+        
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        m_records.clear();
+        m_live.clear();
+        m_login.clear();
+        m_symbol_id.clear();
+        m_cmd.clear();
+        m_volume.clear();
+        m_open_time.clear();
+        m_profit.clear();
+        m_free_slots.clear();
+        m_by_ticket.clear();
+        m_by_login.clear();
+        for (size_t i = 0; i < m_by_symbol.size(); i++) {
+            m_by_symbol[i].clear();
+        }
+        
+        m_records.reserve(total);
+        m_live.reserve(total);
+        m_login.reserve(total);
+        m_symbol_id.reserve(total);
+        m_cmd.reserve(total);
+        m_volume.reserve(total);
+        m_open_time.reserve(total);
+        m_profit.reserve(total);
+        m_by_ticket.reserve(total);
+        
+        for (int i = 0; i < total; i++) {
+            if (!isFinished(trades[i])) {
+                upsertLocked(trades[i]);
+            }
+        }
+        
+        m_ready = true;
+    }
+    
+    // Apply one pumped trade transaction
+    void apply(int type, const TradeRecord& trade) {
+        internSymbol(trade.symbol);
+        
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+        
+        if (type == TRANS_DELETE || isFinished(trade)) {
+            removeLocked(trade.order);
+        } else {
+            upsertLocked(trade);
+        }
+        
+        m_updates++;
+    }
+    
+    // Check whether the book has been loaded and can be trusted
+    bool isReady() const {
+        return m_ready;
+    }
+    
+    // Number of open orders in the book
+    int size() const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        return (int)m_by_ticket.size();
+    }
+    
+    // Number of updates applied since the last load
+    unsigned long long getUpdateCount() const {
+        return m_updates;
+    }
+    
+    // Copy one order; false if the ticket is not open
+    bool getTradeByTicket(int ticket, TradeRecord& trade) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        std::unordered_map<int, int>::const_iterator it = m_by_ticket.find(ticket);
+        if (it == m_by_ticket.end()) {
+            return false;
+        }
+        
+        trade = m_records[it->second];
+        return true;
+    }
+    
+    // Append the open orders of a login to trades
+    void getTradesByLogin(int login, std::vector<TradeRecord>& trades) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        std::unordered_map<int, SlotList>::const_iterator it = m_by_login.find(login);
+        if (it != m_by_login.end()) {
+            copySlots(it->second, trades);
+        }
+    }
+    
+    // Append the open orders of a symbol id to trades
+    void getTradesBySymbol(int symbol_id, std::vector<TradeRecord>& trades) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        if (symbol_id >= 0 && symbol_id < (int)m_by_symbol.size()) {
+            copySlots(m_by_symbol[symbol_id], trades);
+        }
+    }
+    
+    // Append the open orders of a symbol to trades
+    void getTradesBySymbol(const char* symbol, std::vector<TradeRecord>& trades) const {
+        getTradesBySymbol(m_dictionary.findSymbol(symbol), trades);
+    }
+    
+    // Run fn(const Columns&) with the slot columns under the read lock
+    template <class Fn>
+    void read(Fn fn) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        Columns cols;
+        cols.count = (int)m_live.size();
+        cols.live = m_live.data();
+        cols.login = m_login.data();
+        cols.symbol_id = m_symbol_id.data();
+        cols.cmd = m_cmd.data();
+        cols.volume = m_volume.data();
+        cols.open_time = m_open_time.data();
+        cols.profit = m_profit.data();
+        cols.record = m_records.data();
+        cols.by_symbol = m_by_symbol.data();
+        cols.symbol_count = (int)m_by_symbol.size();
+        fn(cols);
+    }
+    
+    // Append every open order to trades
+    void getTrades(std::vector<TradeRecord>& trades) const {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+        
+        trades.reserve(trades.size() + m_by_ticket.size());
+        for (std::unordered_map<int, int>::const_iterator it = m_by_ticket.begin(); it != m_by_ticket.end(); ++it) {
+            trades.push_back(m_records[it->second]);
+        }
+    }
+    
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        TradeRecord* trades = pump->TradesGet(&total);
+        load(trades, trades != NULL ? total : 0);
+        
+        if (trades) {
+            pump->MemFree(trades);
+        }
+    }
+    
+    // The session supervisor delivered the gap's changes as onTrades
+    void onPumpingResumed(CManagerInterface* pump) {
+        m_ready = true;
+    }
+    
+    void onPumpingStopped() {
+        m_ready = false;
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        for (int i = 0; i < count; i++) {
+            apply(events[i].type, events[i].trade);
+        }
+    }
+};
+
+#endif // MT4TRADEBOOK_H
@@ -0,0 +1,744 @@
+//+------------------------------------------------------------------+
+//|                         Trade Copier: Master Trades to Followers |
+//+------------------------------------------------------------------+
+#ifndef MT4TRADECOPIER_H
+#define MT4TRADECOPIER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "../MT4ManagerAPI/MT4ManagerAPI.h"
+#include "MT4Pumping.h"
+#include "MT4QuoteTable.h"
+#include "MT4MarginEngine.h"
+#include "MT4TradeBook.h"
+#include "MT4TradeBatch.h"
+#include "MT4Metrics.h"
+#include "MT4Async.h"
+
+#define MT4_COPY_COMMENT      "copy #"      // follower comment prefix, then the master ticket
+#define MT4_COPY_MAX_EARLY    4096          // fills pumped before their batch returned
+
+// How a follower's volume is derived from the master trade
+enum MT4CopyMode {
+    MT4_COPY_FIXED_LOT = 0,     // value lots on every trade
+    MT4_COPY_BALANCE_RATIO,     // master lots * value * follower / master balance
+    MT4_COPY_EQUITY_RATIO       // master lots * value * follower / master equity
+};
+
+//+------------------------------------------------------------------+
+//| MT4CopyRule - One follower of one master                         |
+//+------------------------------------------------------------------+
+struct MT4CopyRule {
+    int master;
+    int follower;
+    int mode;                   // MT4CopyMode
+    double value;               // lots for FIXED_LOT, multiplier for the ratios
+    double max_lots;            // cap per trade, 0 for none
+};
+
+//+------------------------------------------------------------------+
+//| MT4FollowerStats - Copy outcome of one follower login            |
+//| Slippage is the follower fill against the master open price in   |
+//| points, positive when the follower got the worse price. Latency  |
+//| runs from the pumped master trade to the pumped follower fill.   |
+//+------------------------------------------------------------------+
+struct MT4FollowerStats {
+    int login;
+    unsigned long long copied;      // orders accepted by the server
+    unsigned long long rejected;    // refused by the server or the pre-trade checks
+    unsigned long long skipped;     // below 0.01 lot, or no balance/equity known yet
+    unsigned long long fills;       // fills matched for slippage and latency
+    double last_slippage;
+    double avg_slippage;
+    double max_slippage;
+    double last_latency_us;
+    double avg_latency_us;
+    double max_latency_us;
+};
+
+// Sends one batch of follower transactions; see MT4Manager::submitBatchTo().
+// error receives the reason when the batch could not be sent at all.
+typedef std::function<int(const TradeTransInfo*, int, MT4TransResult*, std::string& error)> MT4CopySubmit;
+
+//+------------------------------------------------------------------+
+//| MT4TradeCopier - Fans master trades out to follower accounts     |
+//| Rules are edited with addRule()/removeMaster() and only take     |
+//| effect on compile(), which publishes a flat per-master follower  |
+//| table. The pumping thread only looks the master up and queues    |
+//| the trade; a single worker sizes every follower from the margin  |
+//| engine, prices it from the quote table and sends the whole fan-  |
+//| out as one submit call, so opens and closes of a master run in   |
+//| pumped order. Follower fills come back tagged "copy #<master     |
+//| ticket>" and are matched by ticket, or by login and tag when the |
+//| open returned no ticket. The tag also rebuilds the copied        |
+//| positions from the follower trades whenever pumping (re)starts   |
+//| or a snapshot is loaded, so closes still follow a restart. Opens |
+//| the session supervisor resyncs after an outage are copied only   |
+//| while younger than setResyncMaxAge() (by default never); their   |
+//| closes are always copied, as a close or delete of the follower   |
+//| order as the live record in the trade book has it now.           |
+//+------------------------------------------------------------------+
+class MT4TradeCopier : public MT4PumpListener {
+private:
+    struct Row {                    // one compiled follower of a master
+        int login;
+        int mode;
+        double value;
+        int max_volume;             // 1/100 lots, 0 for none
+    };
+    
+    typedef std::unordered_map<int, std::vector<Row> > Table;     // master -> followers
+    
+    struct Position {               // one follower position of a master ticket
+        int login;
+        int ticket;
+        int cmd;
+        int volume;
+    };
+    
+    struct Awaiting {               // accepted follower order waiting for its fill
+        int login;
+        int master;                 // master ticket
+        int cmd;
+        int volume;
+        double master_price;
+        double point;
+        uint64_t noticed;           // MT4MetricsNow() when the master trade was pumped
+    };
+    
+    struct Fill {
+        int login;
+        int master;                 // master ticket from the "copy #" comment
+        double price;
+        uint64_t time;
+    };
+    
+    struct Slot {                   // running totals behind MT4FollowerStats
+        MT4FollowerStats stats;
+        double slippage_sum;
+        double latency_sum;
+    };
+    
+    MT4QuoteTable& m_quotes;
+    const MT4MarginEngine& m_margin;
+    const MT4TradeBook& m_trades;
+    MT4CopySubmit m_submit;
+    MT4AsyncWorkers m_worker;
+    
+    std::vector<MT4CopyRule> m_rules;               // edited rules, guarded by m_rules_lock
+    std::mutex m_rules_lock;
+    std::shared_ptr<const Table> m_table;           // compiled rules, guarded by m_table_lock
+    std::shared_ptr<const std::unordered_set<int> > m_followers;
+    mutable std::mutex m_table_lock;
+    
+    std::unordered_map<int, std::vector<Position> > m_positions;  // master ticket -> followers
+    std::mutex m_positions_lock;                    // never held with m_fill_lock
+    
+    std::unordered_map<int, Awaiting> m_awaiting;   // follower ticket -> order, guarded by m_fill_lock
+    std::unordered_map<long long, Awaiting> m_unticketed;   // copyKey -> order whose ticket is unknown
+    std::unordered_map<int, Fill> m_early;          // follower ticket -> fill pumped before the batch returned
+    std::unordered_map<int, Slot> m_stats;          // follower login -> totals
+    std::string m_last_error;                       // last batch that could not be sent
+    mutable std::mutex m_fill_lock;
+    
+    std::atomic<unsigned long long> m_masters;      // master trades fanned out
+    std::atomic<unsigned long long> m_orders;       // follower transactions sent
+    std::atomic<unsigned long long> m_resync_skipped;   // resynced master opens not copied
+    std::atomic<int> m_resync_max_age;              // seconds
+    std::atomic<long long> m_server_offset;         // server time - local time, seconds
+    MT4LatencyHistogram m_fill_latency;             // master pumped -> follower fill pumped
+    MT4LatencyHistogram m_batch_latency;            // master pumped -> submit call returned
+    
+    MT4TradeCopier(const MT4TradeCopier&);
+    MT4TradeCopier& operator=(const MT4TradeCopier&);
+    
+    std::shared_ptr<const Table> table() const {
+        std::lock_guard<std::mutex> lock(m_table_lock);
+        return m_table;
+    }
+    
+    static bool isBuy(int cmd) {
+        return cmd == OP_BUY || cmd == OP_BUY_LIMIT || cmd == OP_BUY_STOP;
+    }
+    
+    static double pointOf(int digits) {
+        return digits > 0 ? pow(10.0, -digits) : 1.0;
+    }
+    
+    // Check whether a resynced master open may still be copied
+    bool youngEnough(const TradeRecord& trade) const {
+        int max_age = m_resync_max_age;
+        long long now = (long long)time(NULL) + m_server_offset;
+        return max_age > 0 && now - (long long)trade.open_time <= max_age;
+    }
+    
+    // Master ticket of a "copy #<ticket>" comment, 0 for other comments
+    static int masterOf(const char* comment) {
+        if (strncmp(comment, MT4_COPY_COMMENT, sizeof(MT4_COPY_COMMENT) - 1) != 0) {
+            return 0;
+        }
+        return atoi(comment + sizeof(MT4_COPY_COMMENT) - 1);
+    }
+    
+    // Key of a follower order by login and master ticket
+    static long long copyKey(int login, int master) {
+        return (long long)login << 32 | (unsigned int)master;
+    }
+    
+    static Position positionOf(int login, int ticket, int cmd, int volume) {
+        Position position;
+        position.login = login;
+        position.ticket = ticket;
+        position.cmd = cmd;
+        position.volume = volume;
+        return position;
+    }
+    
+    void addPositions(const std::vector<std::pair<int, Position> >& added) {
+        if (added.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_positions_lock);
+        for (size_t i = 0; i < added.size(); i++) {
+            m_positions[added[i].first].push_back(added[i].second);
+        }
+    }
+    
+    // Send one batch, keeping the reason when none of it could be sent
+    void submit(const std::vector<TradeTransInfo>& infos, std::vector<MT4TransResult>& results) {
+        std::string error;
+        m_submit(&infos[0], (int)infos.size(), &results[0], error);
+        if (!error.empty()) {
+            std::lock_guard<std::mutex> lock(m_fill_lock);
+            m_last_error = error;
+        }
+    }
+    
+    // Follower volume in 1/100 lots; 0 to skip the follower
+    int volumeOf(const Row& row, const TradeRecord& master, const MT4MarginState* master_state) const {
+        double volume;
+        
+        if (row.mode == MT4_COPY_FIXED_LOT) {
+            volume = row.value * 100.0;
+        } else {
+            MT4MarginState state;
+            if (master_state == NULL || !m_margin.getMargin(row.login, state)) {
+                return 0;
+            }
+            
+            double own = row.mode == MT4_COPY_EQUITY_RATIO ? state.equity : state.balance;
+            double base = row.mode == MT4_COPY_EQUITY_RATIO ? master_state->equity : master_state->balance;
+            if (base <= 0 || own <= 0) {
+                return 0;
+            }
+            volume = master.volume * row.value * own / base;
+        }
+        
+        // Round down: a copier must never trade more than allocated
+        int units = (int)floor(volume + 1e-6);
+        if (row.max_volume > 0 && units > row.max_volume) {
+            units = row.max_volume;
+        }
+        return units > 0 ? units : 0;
+    }
+    
+    Slot& slotLocked(int login) {
+        Slot& slot = m_stats[login];
+        slot.stats.login = login;
+        return slot;
+    }
+    
+    void recordFillLocked(const Awaiting& order, double price, uint64_t time) {
+        double slippage = (isBuy(order.cmd) ? price - order.master_price : order.master_price - price) / order.point;
+        uint64_t nanos = time > order.noticed ? time - order.noticed : 0;
+        double latency = nanos / 1000.0;
+        
+        Slot& slot = slotLocked(order.login);
+        MT4FollowerStats& s = slot.stats;
+        if (s.fills == 0 || slippage > s.max_slippage) {
+            s.max_slippage = slippage;
+        }
+        if (latency > s.max_latency_us) {
+            s.max_latency_us = latency;
+        }
+        s.fills++;
+        slot.slippage_sum += slippage;
+        slot.latency_sum += latency;
+        s.last_slippage = slippage;
+        s.last_latency_us = latency;
+        s.avg_slippage = slot.slippage_sum / s.fills;
+        s.avg_latency_us = slot.latency_sum / s.fills;
+        
+        m_fill_latency.record(nanos);
+    }
+    
+    void copyOpen(const TradeRecord& master, uint64_t noticed) {
+        std::shared_ptr<const Table> current = table();
+        Table::const_iterator it = current->find(master.login);
+        if (it == current->end()) {
+            return;
+        }
+        const std::vector<Row>& rows = it->second;
+        
+        MT4MarginState master_state;
+        bool have_master = m_margin.getMargin(master.login, master_state);
+        
+        // Followers open at the current market; pending orders and symbols
+        // without a quote yet at the master price
+        double price = master.open_price;
+        MT4Quote quote;
+        if ((master.cmd == OP_BUY || master.cmd == OP_SELL) && m_quotes.read(master.symbol, quote)) {
+            price = master.cmd == OP_BUY ? quote.ask : quote.bid;
+        }
+        
+        std::vector<TradeTransInfo> infos;
+        std::vector<const Row*> sent;
+        infos.reserve(rows.size());
+        sent.reserve(rows.size());
+        
+        for (size_t i = 0; i < rows.size(); i++) {
+            int volume = volumeOf(rows[i], master, have_master ? &master_state : NULL);
+            if (volume == 0) {
+                std::lock_guard<std::mutex> lock(m_fill_lock);
+                slotLocked(rows[i].login).stats.skipped++;
+                continue;
+            }
+            
+            TradeTransInfo info;
+            memset(&info, 0, sizeof(info));
+            info.type = TT_BR_ORDER_OPEN;
+            info.cmd = (short)master.cmd;
+            info.orderby = rows[i].login;
+            memcpy(info.symbol, master.symbol, sizeof(info.symbol));
+            info.volume = volume;
+            info.price = price;
+            info.sl = master.sl;
+            info.tp = master.tp;
+            info.expiration = master.expiration;
+            snprintf(info.comment, sizeof(info.comment), MT4_COPY_COMMENT "%d", master.order);
+            
+            infos.push_back(info);
+            sent.push_back(&rows[i]);
+        }
+        
+        m_masters.fetch_add(1, std::memory_order_relaxed);
+        if (infos.empty()) {
+            return;
+        }
+        
+        std::vector<MT4TransResult> results(infos.size());
+        submit(infos, results);
+        m_batch_latency.recordSince(noticed);
+        m_orders.fetch_add(infos.size(), std::memory_order_relaxed);
+        
+        std::vector<std::pair<int, Position> > added;
+        {
+            std::lock_guard<std::mutex> lock(m_fill_lock);
+            
+            for (size_t i = 0; i < infos.size(); i++) {
+                Slot& slot = slotLocked(sent[i]->login);
+                if (results[i].code != RET_OK) {
+                    slot.stats.rejected++;
+                    continue;
+                }
+                slot.stats.copied++;
+                
+                Awaiting order;
+                order.login = sent[i]->login;
+                order.master = master.order;
+                order.cmd = master.cmd;
+                order.volume = infos[i].volume;
+                order.master_price = master.open_price;
+                order.point = pointOf(master.digits);
+                order.noticed = noticed;
+                
+                int ticket = results[i].order;
+                if (ticket == 0) {
+                    // Neither reported nor correlated: the pumped fill names
+                    // the ticket, found by login and "copy #" tag
+                    ticket = takeEarlyLocked(order);
+                    if (ticket == 0) {
+                        m_unticketed[copyKey(order.login, order.master)] = order;
+                        continue;
+                    }
+                } else {
+                    std::unordered_map<int, Fill>::iterator early = m_early.find(ticket);
+                    if (early != m_early.end()) {
+                        recordFillLocked(order, early->second.price, early->second.time);
+                        m_early.erase(early);
+                    } else {
+                        m_awaiting[ticket] = order;
+                    }
+                }
+                
+                added.push_back(std::make_pair(master.order, positionOf(order.login, ticket, order.cmd, order.volume)));
+            }
+        }
+        addPositions(added);
+    }
+    
+    // Match an unticketed order against the fills pumped before its
+    // batch returned; returns the fill's ticket or 0
+    int takeEarlyLocked(const Awaiting& order) {
+        for (std::unordered_map<int, Fill>::iterator it = m_early.begin(); it != m_early.end(); ++it) {
+            if (it->second.login == order.login && it->second.master == order.master) {
+                int ticket = it->first;
+                recordFillLocked(order, it->second.price, it->second.time);
+                m_early.erase(it);
+                return ticket;
+            }
+        }
+        return 0;
+    }
+    
+    void copyClose(const TradeRecord& master) {
+        std::vector<Position> positions;
+        {
+            std::lock_guard<std::mutex> lock(m_positions_lock);
+            std::unordered_map<int, std::vector<Position> >::iterator it = m_positions.find(master.order);
+            if (it == m_positions.end()) {
+                return;
+            }
+            positions.swap(it->second);
+            m_positions.erase(it);
+        }
+        
+        double bid = master.close_price;
+        double ask = master.close_price;
+        MT4Quote quote;
+        if (m_quotes.read(master.symbol, quote)) {
+            bid = quote.bid;
+            ask = quote.ask;
+        }
+        
+        std::vector<TradeTransInfo> infos;
+        infos.reserve(positions.size());
+        for (size_t i = 0; i < positions.size(); i++) {
+            // A pending copy may have filled, or the follower closed part
+            // of it, since it was copied; act on the live record
+            int cmd = positions[i].cmd;
+            int volume = positions[i].volume;
+            TradeRecord live;
+            if (m_trades.isReady()) {
+                if (!m_trades.getTradeByTicket(positions[i].ticket, live)) {
+                    continue;           // already closed or deleted by the follower
+                }
+                cmd = live.cmd;
+                volume = live.volume;
+            }
+            
+            TradeTransInfo info;
+            memset(&info, 0, sizeof(info));
+            info.type = cmd == OP_BUY || cmd == OP_SELL ? TT_BR_ORDER_CLOSE : TT_BR_ORDER_DELETE;
+            info.order = positions[i].ticket;
+            info.orderby = positions[i].login;
+            memcpy(info.symbol, master.symbol, sizeof(info.symbol));
+            info.volume = volume;
+            info.price = isBuy(cmd) ? bid : ask;
+            infos.push_back(info);
+        }
+        
+        std::vector<MT4TransResult> results(infos.size());
+        if (!infos.empty()) {
+            submit(infos, results);
+            m_orders.fetch_add(infos.size(), std::memory_order_relaxed);
+        }
+        
+        std::lock_guard<std::mutex> lock(m_fill_lock);
+        for (size_t i = 0; i < positions.size(); i++) {
+            m_awaiting.erase(positions[i].ticket);
+            m_unticketed.erase(copyKey(positions[i].login, master.order));
+        }
+        for (size_t i = 0; i < infos.size(); i++) {
+            if (results[i].code != RET_OK) {
+                slotLocked(infos[i].orderby).stats.rejected++;
+            }
+        }
+    }
+
+public:
+    MT4TradeCopier(MT4QuoteTable& quotes, const MT4MarginEngine& margin, const MT4TradeBook& trades)
+        : m_quotes(quotes), m_margin(margin), m_trades(trades), m_table(new Table()),
+          m_followers(new std::unordered_set<int>()), m_masters(0), m_orders(0),
+          m_resync_skipped(0), m_resync_max_age(0), m_server_offset(0) {}
+    
+    ~MT4TradeCopier() {
+        stop();
+    }
+    
+    // Add or replace the rule of one master/follower pair (takes effect on compile())
+    void addRule(const MT4CopyRule& rule) {
+        std::lock_guard<std::mutex> lock(m_rules_lock);
+        
+        for (size_t i = 0; i < m_rules.size(); i++) {
+            if (m_rules[i].master == rule.master && m_rules[i].follower == rule.follower) {
+                m_rules[i] = rule;
+                return;
+            }
+        }
+        m_rules.push_back(rule);
+    }
+    
+    // Drop every rule of a master (takes effect on compile())
+    void removeMaster(int master) {
+        std::lock_guard<std::mutex> lock(m_rules_lock);
+        
+        size_t kept = 0;
+        for (size_t i = 0; i < m_rules.size(); i++) {
+            if (m_rules[i].master != master) {
+                m_rules[kept++] = m_rules[i];
+            }
+        }
+        m_rules.resize(kept);
+    }
+    
+    // Publish the edited rules. Rules with a zero or negative value,
+    // an unknown mode, or a follower that is itself a master (a copy
+    // loop) are dropped; returns the number of rules compiled.
+    int compile() {
+        std::shared_ptr<Table> compiled(new Table());
+        std::shared_ptr<std::unordered_set<int> > followers(new std::unordered_set<int>());
+        int total = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_rules_lock);
+            
+            std::unordered_set<int> masters;
+            for (size_t i = 0; i < m_rules.size(); i++) {
+                masters.insert(m_rules[i].master);
+            }
+            
+            for (size_t i = 0; i < m_rules.size(); i++) {
+                const MT4CopyRule& rule = m_rules[i];
+                if (rule.value <= 0 || rule.mode < MT4_COPY_FIXED_LOT || rule.mode > MT4_COPY_EQUITY_RATIO ||
+                    rule.follower == rule.master || masters.count(rule.follower) != 0) {
+                    continue;
+                }
+                
+                Row row;
+                row.login = rule.follower;
+                row.mode = rule.mode;
+                row.value = rule.value;
+                row.max_volume = rule.max_lots > 0 ? (int)floor(rule.max_lots * 100.0 + 1e-6) : 0;
+                (*compiled)[rule.master].push_back(row);
+                followers->insert(rule.follower);
+                total++;
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(m_table_lock);
+        m_table = compiled;
+        m_followers = followers;
+        return total;
+    }
+    
+    // Start the fan-out worker; submit sends each batch of follower orders
+    bool start(MT4CopySubmit submit) {
+        if (!submit || m_worker.isRunning()) {
+            return false;
+        }
+        m_submit = submit;
+        return m_worker.start(1);
+    }
+    
+    // Finish queued fan-outs and stop; positions already copied are kept
+    void stop() {
+        m_worker.stop();
+    }
+    
+    bool isRunning() {
+        return m_worker.isRunning();
+    }
+    
+    // Copy the stats of a follower login; false if it never had a trade
+    bool getFollowerStats(int login, MT4FollowerStats& stats) const {
+        std::lock_guard<std::mutex> lock(m_fill_lock);
+        
+        std::unordered_map<int, Slot>::const_iterator it = m_stats.find(login);
+        if (it == m_stats.end()) {
+            return false;
+        }
+        stats = it->second.stats;
+        return true;
+    }
+    
+    // Append the stats of every follower that had a trade
+    void getAllFollowerStats(std::vector<MT4FollowerStats>& stats) const {
+        std::lock_guard<std::mutex> lock(m_fill_lock);
+        
+        stats.reserve(stats.size() + m_stats.size());
+        for (std::unordered_map<int, Slot>::const_iterator it = m_stats.begin(); it != m_stats.end(); ++it) {
+            stats.push_back(it->second.stats);
+        }
+    }
+    
+    // Accepted follower orders whose fill has not been pumped yet
+    int getAwaitingCount() const {
+        std::lock_guard<std::mutex> lock(m_fill_lock);
+        return (int)(m_awaiting.size() + m_unticketed.size());
+    }
+    
+    // Replace the copied positions with the open follower trades tagged
+    // "copy #<master ticket>", e.g. after a restart. Only logins that
+    // follow a compiled rule count, so compile() first.
+    void rebuildPositions(const TradeRecord* trades, int count) {
+        std::shared_ptr<const std::unordered_set<int> > followers;
+        {
+            std::lock_guard<std::mutex> lock(m_table_lock);
+            followers = m_followers;
+        }
+        
+        std::unordered_map<int, std::vector<Position> > positions;
+        for (int i = 0; i < count; i++) {
+            const TradeRecord& t = trades[i];
+            int master = masterOf(t.comment);
+            if (master > 0 && t.close_time == 0 && t.cmd <= OP_SELL_STOP && followers->count(t.login) != 0) {
+                positions[master].push_back(positionOf(t.login, t.order, t.cmd, t.volume));
+            }
+        }
+        
+        std::lock_guard<std::mutex> lock(m_positions_lock);
+        m_positions.swap(positions);
+    }
+    
+    // Copied follower positions currently tracked
+    int getPositionCount() {
+        std::lock_guard<std::mutex> lock(m_positions_lock);
+        int total = 0;
+        for (std::unordered_map<int, std::vector<Position> >::const_iterator it = m_positions.begin();
+             it != m_positions.end(); ++it) {
+            total += (int)it->second.size();
+        }
+        return total;
+    }
+    
+    // Reason the last follower batch could not be sent (any thread)
+    std::string getLastError() const {
+        std::lock_guard<std::mutex> lock(m_fill_lock);
+        return m_last_error;
+    }
+    
+    unsigned long long getMasterCount() const { return m_masters.load(std::memory_order_relaxed); }
+    unsigned long long getOrderCount() const { return m_orders.load(std::memory_order_relaxed); }
+    unsigned long long getResyncSkippedCount() const { return m_resync_skipped.load(std::memory_order_relaxed); }
+    
+    // Copy master opens resynced after an outage while at most seconds
+    // old by the server clock; 0 skips them all. Prices have moved since,
+    // so a late copy is rarely what a follower wants.
+    void setResyncMaxAge(int seconds) {
+        m_resync_max_age = seconds > 0 ? seconds : 0;
+    }
+    
+    int getResyncMaxAge() const {
+        return m_resync_max_age;
+    }
+    
+    // Set the server clock offset (ServerTime() - time(NULL)) resynced
+    // opens are aged by
+    void setServerOffset(long long seconds) {
+        m_server_offset = seconds;
+    }
+    int getPendingCount() { return m_worker.pending(); }
+    const MT4LatencyHistogram& getFillLatency() const { return m_fill_latency; }
+    const MT4LatencyHistogram& getBatchLatency() const { return m_batch_latency; }
+    
+    // The follower trades the server holds now
+    void onPumpingStarted(CManagerInterface* pump) {
+        if (pump == NULL) {
+            return;
+        }
+        
+        int total = 0;
+        TradeRecord* trades = pump->TradesGet(&total);
+        rebuildPositions(trades, trades != NULL ? total : 0);
+        if (trades) {
+            pump->MemFree(trades);
+        }
+    }
+    
+    void onPumpingStopped() {
+        // Fills missed while disconnected would never be matched
+        std::lock_guard<std::mutex> lock(m_fill_lock);
+        m_awaiting.clear();
+        m_unticketed.clear();
+        m_early.clear();
+    }
+    
+    void onTrades(const MT4TradeEvent* events, int count) {
+        std::shared_ptr<const Table> current;
+        std::shared_ptr<const std::unordered_set<int> > followers;
+        {
+            std::lock_guard<std::mutex> lock(m_table_lock);
+            current = m_table;
+            followers = m_followers;
+        }
+        if (current->empty()) {
+            return;
+        }
+        
+        uint64_t now = MT4MetricsNow();
+        std::vector<std::pair<int, Position> > added;
+        
+        for (int i = 0; i < count; i++) {
+            const TradeRecord& trade = events[i].trade;
+            
+            if (current->find(trade.login) != current->end()) {
+                if (events[i].type == TRANS_ADD && trade.close_time == 0 && trade.cmd <= OP_SELL_STOP) {
+                    if (events[i].resync && !youngEnough(trade)) {
+                        m_resync_skipped.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    m_worker.post([this, trade, now]() { copyOpen(trade, now); });
+                } else if (events[i].type == TRANS_DELETE ||
+                           (events[i].type == TRANS_UPDATE && trade.close_time != 0)) {
+                    m_worker.post([this, trade]() { copyClose(trade); });
+                }
+                continue;
+            }
+            
+            // Fill of a copied order
+            if (events[i].type != TRANS_ADD || followers->count(trade.login) == 0 ||
+                strncmp(trade.comment, MT4_COPY_COMMENT, sizeof(MT4_COPY_COMMENT) - 1) != 0) {
+                continue;
+            }
+            
+            std::lock_guard<std::mutex> lock(m_fill_lock);
+            std::unordered_map<int, Awaiting>::iterator it = m_awaiting.find(trade.order);
+            if (it != m_awaiting.end()) {
+                recordFillLocked(it->second, trade.open_price, now);
+                m_awaiting.erase(it);
+                continue;
+            }
+            
+            int master = masterOf(trade.comment);
+            std::unordered_map<long long, Awaiting>::iterator un = m_unticketed.find(copyKey(trade.login, master));
+            if (un != m_unticketed.end()) {
+                const Awaiting& order = un->second;
+                recordFillLocked(order, trade.open_price, now);
+                added.push_back(std::make_pair(master, positionOf(order.login, trade.order, order.cmd, order.volume)));
+                m_unticketed.erase(un);
+            } else {
+                if (m_early.size() >= MT4_COPY_MAX_EARLY) {
+                    m_early.clear();
+                }
+                Fill fill = { trade.login, master, trade.open_price, now };
+                m_early[trade.order] = fill;
+            }
+        }
+        
+        addPositions(added);
+    }
+};
+
+#endif // MT4TRADECOPIER_H
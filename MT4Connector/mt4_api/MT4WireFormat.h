@@ -0,0 +1,90 @@
+//+------------------------------------------------------------------+
+//|                         Versioned Binary Wire Format for Streaming |
+//+------------------------------------------------------------------+
+#ifndef MT4WIREFORMAT_H
+#define MT4WIREFORMAT_H
+
+#include <stdint.h>
+
+//+------------------------------------------------------------------+
+//| Fixed little-endian layouts shared with src/mt4_wire.py          |
+//| A frame is one MT4WireHeader followed by count records of one    |
+//| type. The header carries the record size, so readers can skip    |
+//| fields appended by later versions. Symbols travel as dictionary  |
+//| ids; MT4_WIRE_SYMBOLS frames map the ids to names. This header   |
+//| has no Manager API dependency so out-of-process readers can use  |
+//| it on its own.                                                   |
+//+------------------------------------------------------------------+
+#define MT4_WIRE_MAGIC   0x5734544D          // "MT4W"
+#define MT4_WIRE_VERSION 1
+
+enum MT4WireType {
+    MT4_WIRE_QUOTES = 1,
+    MT4_WIRE_TRADES = 2,
+    MT4_WIRE_SYMBOLS = 3,
+    MT4_WIRE_TRADE_EVENTS = 4
+};
+
+#pragma pack(push, 1)
+
+struct MT4WireHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;                  // MT4WireType
+    uint32_t count;                 // records following the header
+    uint32_t record_size;
+};
+
+struct MT4WireQuote {
+    int32_t symbol_id;
+    uint32_t sequence;
+    double bid;
+    double ask;
+    int64_t time;
+};
+
+struct MT4WireTrade {
+    int32_t order;
+    int32_t login;
+    int32_t symbol_id;
+    int32_t cmd;
+    int32_t volume;                 // lots * 100
+    int32_t state;
+    int32_t digits;
+    int32_t reserved;
+    double open_price;
+    double close_price;
+    double sl;
+    double tp;
+    double profit;
+    double commission;
+    double storage;
+    int64_t open_time;
+    int64_t close_time;
+};
+
+// Trade with its pumping transaction, for streams that replay changes
+struct MT4WireTradeEvent {
+    int32_t type;                   // TRANS_ADD, TRANS_DELETE, TRANS_UPDATE
+    int32_t reserved;
+    MT4WireTrade trade;
+};
+
+struct MT4WireSymbol {
+    int32_t symbol_id;
+    int32_t digits;
+    double point;
+    double contract_size;
+    char name[12];
+    int32_t reserved;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(MT4WireHeader) == 16, "MT4WireHeader layout changed");
+static_assert(sizeof(MT4WireQuote) == 32, "MT4WireQuote layout changed");
+static_assert(sizeof(MT4WireTrade) == 104, "MT4WireTrade layout changed");
+static_assert(sizeof(MT4WireTradeEvent) == 112, "MT4WireTradeEvent layout changed");
+static_assert(sizeof(MT4WireSymbol) == 40, "MT4WireSymbol layout changed");
+
+#endif // MT4WIREFORMAT_H
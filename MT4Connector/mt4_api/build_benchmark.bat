@@ -0,0 +1,14 @@
+@echo off
+echo ===== Building MT4Benchmark =====
+
+:: Run from a Visual Studio Developer Command Prompt
+cd /d %~dp0
+
+cl /nologo /O2 /EHsc /std:c++17 MT4Benchmark.cpp /Fe:MT4Benchmark.exe
+if ERRORLEVEL 1 (
+    echo Build failed.
+    exit /b 1
+)
+
+del MT4Benchmark.obj 2> nul
+echo Built MT4Benchmark.exe
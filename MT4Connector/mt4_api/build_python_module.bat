@@ -0,0 +1,19 @@
+@echo off
+echo ===== Building mt4native Python module =====
+
+:: Run from a Visual Studio Developer Command Prompt matching the Python bitness
+cd /d %~dp0
+
+:: Locate the Python headers and import library
+for /f "delims=" %%i in ('python -c "import sysconfig; print(sysconfig.get_paths()['include'])"') do set PY_INCLUDE=%%i
+for /f "delims=" %%i in ('python -c "import sys, os; print(os.path.join(sys.base_prefix, 'libs'))"') do set PY_LIBS=%%i
+for /f "delims=" %%i in ('python -c "import sysconfig; print(sysconfig.get_config_var('EXT_SUFFIX'))"') do set PY_EXT=%%i
+
+cl /nologo /O2 /EHsc /std:c++17 /LD /I"%PY_INCLUDE%" MT4PythonModule.cpp /link /LIBPATH:"%PY_LIBS%" /OUT:..\src\mt4native%PY_EXT%
+if ERRORLEVEL 1 (
+    echo Build failed.
+    exit /b 1
+)
+
+del MT4PythonModule.obj 2> nul
+echo Built ..\src\mt4native%PY_EXT%
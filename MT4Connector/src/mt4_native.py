@@ -0,0 +1,147 @@
+"""
+MT4 Native Bindings
+Loads the mt4native extension built from mt4_api/MT4PythonModule.cpp and maps
+its record buffers into numpy structured arrays without copying
+"""
+
+import json
+import logging
+from typing import Dict, List, Optional, Tuple, Any
+
+logger = logging.getLogger(__name__)
+
+try:
+    import mt4native
+    NATIVE_AVAILABLE = True
+except ImportError:
+    mt4native = None
+    NATIVE_AVAILABLE = False
+
+# Record kinds, identical to the RecordKind enum in MT4PythonModule.cpp
+KIND_TRADE = 0
+KIND_USER = 1
+KIND_SYMBOL = 2
+KIND_BAR = 3
+
+# Bar periods, identical to MT4BarPeriod in MT4Bars.h
+BAR_PERIODS = {'M1': 0, 'M5': 1, 'H1': 2}
+
+# dtypes per record kind, built on first use
+_dtype_cache: Dict[int, Any] = {}
+
+
+def build_dtype(itemsize: int, fields: List[Tuple[str, str, int]]):
+    """numpy dtype from (itemsize, [(name, format, offset), ...])"""
+    import numpy as np
+
+    return np.dtype({'names': [f[0] for f in fields],
+                     'formats': [f[1] for f in fields],
+                     'offsets': [f[2] for f in fields],
+                     'itemsize': itemsize})
+
+
+def record_dtype(kind: int):
+    """numpy dtype of a native record kind, laid out from the C++ structs"""
+    if not NATIVE_AVAILABLE:
+        raise RuntimeError("mt4native extension is not available")
+
+    dtype = _dtype_cache.get(kind)
+    if dtype is None:
+        itemsize, fields = mt4native.record_fields(kind)
+        dtype = build_dtype(itemsize, fields)
+        _dtype_cache[kind] = dtype
+    return dtype
+
+
+def as_array(buffer, dtype):
+    """Map a record buffer into a structured array (no copy, read-only)"""
+    import numpy as np
+
+    return np.frombuffer(buffer, dtype=dtype)
+
+
+def to_dataframe(array):
+    """pandas DataFrame from a structured array, decoding byte-string fields"""
+    import pandas as pd
+
+    frame = pd.DataFrame(array)
+    for name in array.dtype.names:
+        if array.dtype[name].kind == 'S':
+            frame[name] = frame[name].str.decode('ascii', 'replace')
+    return frame
+
+
+class NativeManager:
+    """Thin wrapper over mt4native.Manager returning numpy arrays for bulk calls"""
+
+    def __init__(self):
+        if not NATIVE_AVAILABLE:
+            raise RuntimeError("mt4native extension is not available")
+        self.manager = mt4native.Manager()
+
+    def __getattr__(self, name):
+        # Scalar calls (connect, login, open_trade, ...) pass straight through
+        return getattr(self.manager, name)
+
+    def get_trades(self, login: Optional[int] = None, symbol: Optional[str] = None):
+        """Open trades as a structured array"""
+        if login is not None:
+            buffer = self.manager.trades_by_login(login)
+        elif symbol is not None:
+            buffer = self.manager.trades_by_symbol(symbol)
+        else:
+            buffer = self.manager.trades()
+        return as_array(buffer, record_dtype(KIND_TRADE))
+
+    def get_accounts(self):
+        """All accounts as a structured array"""
+        return as_array(self.manager.accounts(), record_dtype(KIND_USER))
+
+    def get_symbols(self):
+        """All symbols as a structured array"""
+        return as_array(self.manager.symbols(), record_dtype(KIND_SYMBOL))
+
+    def symbol_registry(self):
+        """SymbolRegistry using native symbol ids, loaded with the symbol specifications"""
+        from mt4_wire import SymbolRegistry
+
+        registry = SymbolRegistry(self.manager.symbol_id)
+        registry.load(self.get_symbols())
+        return registry
+
+    def get_trades_frame(self, login: Optional[int] = None, symbol: Optional[str] = None):
+        """Open trades as a pandas DataFrame"""
+        return to_dataframe(self.get_trades(login, symbol))
+
+    def get_accounts_frame(self):
+        """All accounts as a pandas DataFrame"""
+        return to_dataframe(self.get_accounts())
+
+    def get_bars(self, symbol: str, period: str = 'M1', count: int = 1024, forming: bool = True):
+        """Newest M1/M5/H1 bars of a symbol as a structured array, oldest first.
+
+        Needs enable_bars() before start_pumping(); with forming the last
+        row is the still open bar. None if bars are off or the symbol is unknown.
+        """
+        if period not in BAR_PERIODS:
+            raise ValueError(f"Unknown bar period {period!r}, expected one of {sorted(BAR_PERIODS)}")
+
+        buffer = self.manager.bars(symbol, BAR_PERIODS[period], count, forming)
+        if buffer is None:
+            return None
+        return as_array(buffer, record_dtype(KIND_BAR))
+
+    def get_bars_frame(self, symbol: str, period: str = 'M1', count: int = 1024, forming: bool = True):
+        """Bars as a pandas DataFrame with a datetime index"""
+        import pandas as pd
+
+        bars = self.get_bars(symbol, period, count, forming)
+        if bars is None:
+            return None
+        frame = to_dataframe(bars)
+        frame.index = pd.to_datetime(frame['time'], unit='s')
+        return frame
+
+    def get_metrics(self) -> Dict[str, Any]:
+        """Latency percentiles per server call and pumping stage, queue depth and drops"""
+        return json.loads(self.manager.metrics())
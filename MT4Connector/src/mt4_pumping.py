@@ -66,6 +66,8 @@ class QuoteData:
     spread: float
     time: int
     server_time: datetime
+    digits: int = 5
+    point: float = 0.0
     
 @dataclass
 class TradeData:
@@ -81,6 +83,11 @@ class TradeData:
     tp: float
     profit: float
     state: str
+    digits: int = 0
+    commission: float = 0.0
+    storage: float = 0.0
+    open_time: int = 0
+    close_time: int = 0
     
 class MT4PumpingMode:
     """Handles MT4 Manager API pumping mode for real-time data"""
@@ -159,7 +166,9 @@ class MT4PumpingMode:
                     spread=round((symbol_info.ask - symbol_info.bid) * 
                                (10 ** symbol_info.digits), 1),
                     time=symbol_info.time,
-                    server_time=datetime.fromtimestamp(symbol_info.time)
+                    server_time=datetime.fromtimestamp(symbol_info.time),
+                    digits=symbol_info.digits,
+                    point=symbol_info.point
                 )
                 
             elif code == PumpingCode.UPDATE_TRADES:
@@ -188,7 +197,12 @@ class MT4PumpingMode:
                     sl=trade.sl,
                     tp=trade.tp,
                     profit=trade.profit,
-                    state=state_map.get(trade.state, "unknown")
+                    state=state_map.get(trade.state, "unknown"),
+                    digits=trade.digits,
+                    commission=trade.commission,
+                    storage=trade.storage,
+                    open_time=trade.open_time,
+                    close_time=trade.close_time
                 )
                 
             elif code == PumpingCode.UPDATE_USERS:
@@ -16,6 +16,8 @@ import jwt
 from functools import wraps
 
 from mt4_pumping import QuoteData, TradeData
+from mt4_wire import (SymbolRegistry, WireQuote, WireTrade, encode_quotes,
+                      encode_trades, TRADE_STATES)
 from config import Config
 
 logger = logging.getLogger(__name__)
@@ -29,20 +31,27 @@ class ClientInfo:
     authenticated: bool = False
     user_login: Optional[int] = None
     subscriptions: Set[str] = None
+    binary: bool = False  # receive quotes/trades as wire frames
+    known_symbols: Set[int] = None  # symbol ids already defined to the client
     
     def __post_init__(self):
         if self.subscriptions is None:
             self.subscriptions = set()
+        if self.known_symbols is None:
+            self.known_symbols = set()
 
 class MT4WebSocketServer:
     """WebSocket server for real-time MT4 data distribution"""
     
-    def __init__(self, host: str = 'localhost', port: int = 8765):
+    def __init__(self, host: str = 'localhost', port: int = 8765,
+                 symbol_registry: Optional[SymbolRegistry] = None):
         self.host = host
         self.port = port
         self.clients: Dict[str, ClientInfo] = {}
         self.symbol_subscribers: Dict[str, Set[str]] = {}  # symbol -> client_ids
         self.authenticated_clients: Set[str] = set()
+        # Pass NativeManager.symbol_registry() so ids match native frames
+        self.symbol_registry = symbol_registry or SymbolRegistry()
         self.server = None
         
         # Statistics
@@ -140,6 +149,8 @@ class MT4WebSocketServer:
                 await self.handle_unsubscribe(client_id, data)
             elif action == 'get_quotes':
                 await self.handle_get_quotes(client_id, data)
+            elif action == 'set_format':
+                await self.handle_set_format(client_id, data)
             elif action == 'ping':
                 await self.send_to_client(client_id, {'type': 'pong'})
             else:
@@ -265,6 +276,38 @@ class MT4WebSocketServer:
             'all_subscriptions': list(client.subscriptions)
         })
     
+    async def handle_set_format(self, client_id: str, data: Dict):
+        """Switch a client between JSON and binary wire frames"""
+        fmt = data.get('format', 'json')
+        
+        if fmt not in ('json', 'binary'):
+            await self.send_to_client(client_id, {
+                'type': 'error',
+                'message': f'Unknown format: {fmt}'
+            })
+            return
+        
+        client = self.clients[client_id]
+        client.binary = fmt == 'binary'
+        client.known_symbols.clear()
+        
+        await self.send_to_client(client_id, {
+            'type': 'format_update',
+            'format': fmt
+        })
+    
+    async def send_binary(self, client: ClientInfo, symbol: str, frame: bytes):
+        """Send a wire frame, preceded by the symbol definition the first time"""
+        symbol_id = self.symbol_registry.get_id(symbol)
+        
+        if symbol_id not in client.known_symbols:
+            await client.websocket.send(self.symbol_registry.definition(symbol))
+            client.known_symbols.add(symbol_id)
+            self.stats['messages_sent'] += 1
+        
+        await client.websocket.send(frame)
+        self.stats['messages_sent'] += 1
+    
     async def handle_get_quotes(self, client_id: str, data: Dict):
         """Handle request for current quotes"""
         symbols = data.get('symbols', [])
@@ -321,18 +364,9 @@ class MT4WebSocketServer:
         if symbol not in self.symbol_subscribers:
             return
         
-        # Prepare message
-        message = json.dumps({
-            'type': 'quote',
-            'data': {
-                'symbol': quote.symbol,
-                'bid': quote.bid,
-                'ask': quote.ask,
-                'spread': quote.spread,
-                'time': quote.time,
-                'server_time': quote.server_time.isoformat()
-            }
-        })
+        # Messages are encoded once, and only in the formats in use
+        message = None
+        frame = None
         
         # Send to all subscribed clients
         disconnected_clients = []
@@ -341,6 +375,31 @@ class MT4WebSocketServer:
             if client_id in self.clients:
                 client = self.clients[client_id]
                 try:
+                    if client.binary:
+                        if frame is None:
+                            self.symbol_registry.update(symbol, quote.digits, quote.point)
+                            frame = encode_quotes([WireQuote(
+                                symbol_id=self.symbol_registry.get_id(symbol),
+                                sequence=0,
+                                bid=quote.bid,
+                                ask=quote.ask,
+                                time=quote.time
+                            )])
+                        await self.send_binary(client, symbol, frame)
+                        continue
+                    
+                    if message is None:
+                        message = json.dumps({
+                            'type': 'quote',
+                            'data': {
+                                'symbol': quote.symbol,
+                                'bid': quote.bid,
+                                'ask': quote.ask,
+                                'spread': quote.spread,
+                                'time': quote.time,
+                                'server_time': quote.server_time.isoformat()
+                            }
+                        })
                     await client.websocket.send(message)
                     self.stats['messages_sent'] += 1
                 except Exception as e:
@@ -353,28 +412,54 @@ class MT4WebSocketServer:
     
     async def broadcast_trade(self, trade: TradeData, user_login: int):
         """Broadcast trade update to relevant clients"""
-        # Prepare message
-        message = json.dumps({
-            'type': 'trade',
-            'data': {
-                'order': trade.order,
-                'login': trade.login,
-                'symbol': trade.symbol,
-                'cmd': trade.cmd,
-                'volume': trade.volume,
-                'open_price': trade.open_price,
-                'close_price': trade.close_price,
-                'sl': trade.sl,
-                'tp': trade.tp,
-                'profit': trade.profit,
-                'state': trade.state
-            }
-        })
+        # Messages are encoded once, and only in the formats in use
+        message = None
+        frame = None
         
         # Send to clients authenticated with this login
         for client_id, client in self.clients.items():
             if client.authenticated and client.user_login == user_login:
                 try:
+                    if client.binary:
+                        if frame is None:
+                            frame = encode_trades([WireTrade(
+                                order=trade.order,
+                                login=trade.login,
+                                symbol_id=self.symbol_registry.get_id(trade.symbol),
+                                cmd=trade.cmd,
+                                volume=int(round(trade.volume * 100)),
+                                state=TRADE_STATES.get(trade.state, -1),
+                                digits=trade.digits,
+                                open_price=trade.open_price,
+                                close_price=trade.close_price,
+                                sl=trade.sl,
+                                tp=trade.tp,
+                                profit=trade.profit,
+                                commission=trade.commission,
+                                storage=trade.storage,
+                                open_time=trade.open_time,
+                                close_time=trade.close_time
+                            )])
+                        await self.send_binary(client, trade.symbol, frame)
+                        continue
+                    
+                    if message is None:
+                        message = json.dumps({
+                            'type': 'trade',
+                            'data': {
+                                'order': trade.order,
+                                'login': trade.login,
+                                'symbol': trade.symbol,
+                                'cmd': trade.cmd,
+                                'volume': trade.volume,
+                                'open_price': trade.open_price,
+                                'close_price': trade.close_price,
+                                'sl': trade.sl,
+                                'tp': trade.tp,
+                                'profit': trade.profit,
+                                'state': trade.state
+                            }
+                        })
                     await client.websocket.send(message)
                     self.stats['messages_sent'] += 1
                 except Exception as e:
@@ -0,0 +1,277 @@
+"""
+MT4 Binary Wire Format
+Encodes and decodes the fixed-layout frames defined in mt4_api/MT4WireFormat.h
+"""
+
+import struct
+import logging
+from typing import Callable, Dict, List, Optional, Tuple, Any
+from dataclasses import dataclass
+
+logger = logging.getLogger(__name__)
+
+WIRE_MAGIC = 0x5734544D  # "MT4W"
+WIRE_VERSION = 1
+
+# Frame types
+WIRE_QUOTES = 1
+WIRE_TRADES = 2
+WIRE_SYMBOLS = 3
+WIRE_TRADE_EVENTS = 4
+
+# Little-endian layouts, identical to the packed C++ structs
+HEADER = struct.Struct('<IHHII')
+QUOTE = struct.Struct('<iIddq')
+TRADE = struct.Struct('<8i7d2q')
+SYMBOL = struct.Struct('<iidd12si')
+TRADE_EVENT = struct.Struct('<2i8i7d2q')
+
+RECORD_STRUCTS = {
+    WIRE_QUOTES: QUOTE,
+    WIRE_TRADES: TRADE,
+    WIRE_SYMBOLS: SYMBOL,
+    WIRE_TRADE_EVENTS: TRADE_EVENT,
+}
+
+# Trade states as carried on the wire (TradeRecord::state)
+TRADE_STATES = {
+    'open': 0,
+    'open_remand': 1,
+    'open_restored': 2,
+    'closed': 3,
+    'partial_close': 4,
+    'closed_by': 5,
+    'deleted': 6,
+}
+TRADE_STATE_NAMES = {value: name for name, value in TRADE_STATES.items()}
+
+# numpy dtypes matching the record layouts, for zero-copy decoding
+NUMPY_FIELDS = {
+    WIRE_QUOTES: [('symbol_id', '<i4'), ('sequence', '<u4'), ('bid', '<f8'),
+                  ('ask', '<f8'), ('time', '<i8')],
+    WIRE_TRADES: [('order', '<i4'), ('login', '<i4'), ('symbol_id', '<i4'),
+                  ('cmd', '<i4'), ('volume', '<i4'), ('state', '<i4'),
+                  ('digits', '<i4'), ('reserved', '<i4'), ('open_price', '<f8'),
+                  ('close_price', '<f8'), ('sl', '<f8'), ('tp', '<f8'),
+                  ('profit', '<f8'), ('commission', '<f8'), ('storage', '<f8'),
+                  ('open_time', '<i8'), ('close_time', '<i8')],
+    WIRE_SYMBOLS: [('symbol_id', '<i4'), ('digits', '<i4'), ('point', '<f8'),
+                   ('contract_size', '<f8'), ('name', 'S12'), ('reserved', '<i4')],
+}
+NUMPY_FIELDS[WIRE_TRADE_EVENTS] = [('type', '<i4'), ('event_reserved', '<i4')] + NUMPY_FIELDS[WIRE_TRADES]
+
+
+class WireFormatError(ValueError):
+    """Raised when a buffer is not a valid wire frame"""
+
+
+@dataclass
+class WireQuote:
+    """Quote record"""
+    symbol_id: int
+    sequence: int
+    bid: float
+    ask: float
+    time: int
+
+
+@dataclass
+class WireTrade:
+    """Trade record"""
+    order: int
+    login: int
+    symbol_id: int
+    cmd: int
+    volume: int  # lots * 100
+    state: int
+    digits: int
+    open_price: float
+    close_price: float
+    sl: float
+    tp: float
+    profit: float
+    commission: float
+    storage: float
+    open_time: int
+    close_time: int
+
+
+@dataclass
+class WireTradeEvent:
+    """Trade record with its pumping transaction (TRANS_ADD/DELETE/UPDATE)"""
+    type: int
+    trade: WireTrade
+
+
+@dataclass
+class WireSymbol:
+    """Symbol definition record mapping an id to a name"""
+    symbol_id: int
+    digits: int
+    point: float
+    contract_size: float
+    name: str
+
+
+def read_header(buf) -> Tuple[int, int, int]:
+    """Validate a frame header; returns (type, count, record_size)"""
+    view = memoryview(buf)
+    if len(view) < HEADER.size:
+        raise WireFormatError(f"Frame too short: {len(view)} bytes")
+
+    magic, version, frame_type, count, record_size = HEADER.unpack_from(view, 0)
+    if magic != WIRE_MAGIC:
+        raise WireFormatError(f"Bad magic 0x{magic:08x}")
+    if version > WIRE_VERSION:
+        raise WireFormatError(f"Unsupported wire version {version}")
+
+    layout = RECORD_STRUCTS.get(frame_type)
+    if layout is None:
+        raise WireFormatError(f"Unknown frame type {frame_type}")
+    if record_size < layout.size:
+        raise WireFormatError(f"Record size {record_size} smaller than {layout.size}")
+    if len(view) < HEADER.size + count * record_size:
+        raise WireFormatError(f"Frame truncated: {count} records of {record_size} bytes")
+
+    return frame_type, count, record_size
+
+
+def decode_frame(buf) -> Tuple[int, List[Any]]:
+    """Decode a frame into (type, list of WireQuote/WireTrade/WireSymbol)"""
+    frame_type, count, record_size = read_header(buf)
+    layout = RECORD_STRUCTS[frame_type]
+    view = memoryview(buf)
+    records = []
+
+    for i in range(count):
+        fields = layout.unpack_from(view, HEADER.size + i * record_size)
+        if frame_type == WIRE_QUOTES:
+            records.append(WireQuote(*fields))
+        elif frame_type == WIRE_TRADES:
+            # Drop the reserved field
+            records.append(WireTrade(*fields[:7], *fields[8:]))
+        elif frame_type == WIRE_TRADE_EVENTS:
+            records.append(WireTradeEvent(fields[0], WireTrade(*fields[2:9], *fields[10:])))
+        else:
+            symbol_id, digits, point, contract_size, name, _ = fields
+            records.append(WireSymbol(symbol_id, digits, point, contract_size,
+                                      name.split(b'\x00', 1)[0].decode('ascii', 'replace')))
+
+    return frame_type, records
+
+
+def as_numpy(buf):
+    """Map the records of a frame into a numpy structured array (no copy)"""
+    import numpy as np
+
+    frame_type, count, record_size = read_header(buf)
+    fields = NUMPY_FIELDS[frame_type]
+    dtype = np.dtype({'names': [f[0] for f in fields],
+                      'formats': [f[1] for f in fields],
+                      'itemsize': record_size})
+    return np.frombuffer(buf, dtype=dtype, count=count, offset=HEADER.size)
+
+
+def _frame(frame_type: int, records: List[bytes]) -> bytes:
+    layout = RECORD_STRUCTS[frame_type]
+    return HEADER.pack(WIRE_MAGIC, WIRE_VERSION, frame_type, len(records), layout.size) + b''.join(records)
+
+
+def encode_quotes(quotes: List[WireQuote]) -> bytes:
+    """Encode quote records into one frame"""
+    return _frame(WIRE_QUOTES, [QUOTE.pack(q.symbol_id, q.sequence, q.bid, q.ask, q.time)
+                                for q in quotes])
+
+
+def encode_trades(trades: List[WireTrade]) -> bytes:
+    """Encode trade records into one frame"""
+    return _frame(WIRE_TRADES, [TRADE.pack(t.order, t.login, t.symbol_id, t.cmd, t.volume,
+                                           t.state, t.digits, 0, t.open_price, t.close_price,
+                                           t.sl, t.tp, t.profit, t.commission, t.storage,
+                                           t.open_time, t.close_time)
+                                for t in trades])
+
+
+def encode_trade_events(events: List[WireTradeEvent]) -> bytes:
+    """Encode trade event records into one frame"""
+    return _frame(WIRE_TRADE_EVENTS, [TRADE_EVENT.pack(e.type, 0, e.trade.order, e.trade.login,
+                                                       e.trade.symbol_id, e.trade.cmd, e.trade.volume,
+                                                       e.trade.state, e.trade.digits, 0,
+                                                       e.trade.open_price, e.trade.close_price,
+                                                       e.trade.sl, e.trade.tp, e.trade.profit,
+                                                       e.trade.commission, e.trade.storage,
+                                                       e.trade.open_time, e.trade.close_time)
+                                      for e in events])
+
+
+def encode_symbols(symbols: List[WireSymbol]) -> bytes:
+    """Encode symbol definition records into one frame"""
+    return _frame(WIRE_SYMBOLS, [SYMBOL.pack(s.symbol_id, s.digits, s.point, s.contract_size,
+                                             s.name.encode('ascii')[:11], 0)
+                                 for s in symbols])
+
+
+class SymbolRegistry:
+    """Maps symbol names to the ids and specifications carried on the wire.
+
+    With resolve_id (e.g. mt4native.Manager.symbol_id) ids are the native
+    dictionary ids, so frames built here and by the C++ encoders agree.
+    Names the resolver does not know get ids from LOCAL_ID_BASE up, clear
+    of the dense native range, and are resolved again on later use so
+    they switch to the native id once the connector has seen the symbol.
+    Without a resolver ids are dense from 0.
+    """
+
+    LOCAL_ID_BASE = 0x40000000
+
+    def __init__(self, resolve_id: Optional[Callable[[str], int]] = None):
+        self.resolve_id = resolve_id
+        self.ids: Dict[str, int] = {}
+        self.names: Dict[int, str] = {}
+        self.specs: Dict[str, Tuple[int, float, float]] = {}
+        self.next_local = self.LOCAL_ID_BASE if resolve_id is not None else 0
+
+    def get_id(self, symbol: str) -> int:
+        """Id of a symbol, resolved or assigned on first use"""
+        symbol_id = self.ids.get(symbol)
+        if symbol_id is not None and (self.resolve_id is None or symbol_id < self.LOCAL_ID_BASE):
+            return symbol_id
+
+        native_id = self.resolve_id(symbol) if self.resolve_id is not None else -1
+        if native_id >= 0:
+            symbol_id = native_id
+        elif symbol_id is None:
+            symbol_id = self.next_local
+            self.next_local += 1
+        self.ids[symbol] = symbol_id
+        self.names[symbol_id] = symbol
+        return symbol_id
+
+    def get_name(self, symbol_id: int) -> Optional[str]:
+        """Name of a symbol id, None if unknown"""
+        return self.names.get(symbol_id)
+
+    def update(self, symbol: str, digits: Optional[int] = None, point: Optional[float] = None,
+               contract_size: Optional[float] = None):
+        """Record a symbol's specification; None keeps the known value"""
+        known_digits, known_point, known_size = self.specs.get(symbol, (5, 0.0, 0.0))
+        self.specs[symbol] = (known_digits if digits is None else int(digits),
+                              known_point if point is None else float(point),
+                              known_size if contract_size is None else float(contract_size))
+
+    def load(self, symbols):
+        """Record specifications from ConSymbol records (native symbols() rows or dicts)"""
+        for record in symbols:
+            name = record['symbol']
+            if isinstance(name, bytes):
+                name = name.split(b'\x00', 1)[0].decode('ascii', 'replace')
+            self.update(name, record['digits'], record['point'], record['contract_size'])
+
+    def definition(self, symbol: str, digits: Optional[int] = None, point: Optional[float] = None,
+                   contract_size: Optional[float] = None) -> bytes:
+        """Symbol definition frame for one symbol, from its recorded specification"""
+        if digits is not None or point is not None or contract_size is not None:
+            self.update(symbol, digits, point, contract_size)
+        digits, point, contract_size = self.specs.get(symbol, (5, 0.0, 0.0))
+        return encode_symbols([WireSymbol(self.get_id(symbol), digits, point,
+                                          contract_size, symbol)])
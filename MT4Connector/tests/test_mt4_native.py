@@ -0,0 +1,281 @@
+"""
+Test MT4 Native Bindings
+"""
+
+import pytest
+import struct
+
+# Add parent directory to path
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
+
+import mt4_native
+from mt4_native import build_dtype, as_array, NATIVE_AVAILABLE, KIND_TRADE, KIND_USER, KIND_SYMBOL, KIND_BAR
+
+# Layout of a small record with padding, as record_fields() reports it
+SAMPLE_FIELDS = [('order', '<i4', 0), ('symbol', 'S12', 4), ('price', '<f8', 24)]
+SAMPLE_ITEMSIZE = 40
+
+
+def pack_sample(order, symbol, price):
+    record = bytearray(SAMPLE_ITEMSIZE)
+    struct.pack_into('<i12s', record, 0, order, symbol)
+    struct.pack_into('<d', record, 24, price)
+    return bytes(record)
+
+
+class TestDtype:
+    """Structured dtypes built from native field lists"""
+
+    def test_offsets_and_itemsize(self):
+        pytest.importorskip('numpy')
+        dtype = build_dtype(SAMPLE_ITEMSIZE, SAMPLE_FIELDS)
+
+        assert dtype.itemsize == SAMPLE_ITEMSIZE
+        assert dtype.fields['price'][1] == 24
+        assert dtype.names == ('order', 'symbol', 'price')
+
+    def test_frombuffer(self):
+        np = pytest.importorskip('numpy')
+        dtype = build_dtype(SAMPLE_ITEMSIZE, SAMPLE_FIELDS)
+        buffer = pack_sample(1, b'EURUSD', 1.085) + pack_sample(2, b'GBPUSD', 1.27)
+
+        array = as_array(buffer, dtype)
+        assert len(array) == 2
+        assert array['order'].tolist() == [1, 2]
+        assert array['symbol'][1] == b'GBPUSD'
+        assert np.allclose(array['price'], [1.085, 1.27])
+
+    def test_dataframe_decodes_strings(self):
+        pytest.importorskip('numpy')
+        pytest.importorskip('pandas')
+        dtype = build_dtype(SAMPLE_ITEMSIZE, SAMPLE_FIELDS)
+
+        frame = mt4_native.to_dataframe(as_array(pack_sample(7, b'XAUUSD', 2000.5), dtype))
+        assert frame['symbol'][0] == 'XAUUSD'
+        assert frame['order'][0] == 7
+
+
+class TestUnavailable:
+    """Behaviour without the compiled extension"""
+
+    def test_manager_requires_extension(self):
+        if NATIVE_AVAILABLE:
+            pytest.skip("mt4native is installed")
+        with pytest.raises(RuntimeError):
+            mt4_native.NativeManager()
+
+    def test_record_dtype_requires_extension(self):
+        if NATIVE_AVAILABLE:
+            pytest.skip("mt4native is installed")
+        with pytest.raises(RuntimeError):
+            mt4_native.record_dtype(KIND_TRADE)
+
+
+@pytest.mark.skipif(not NATIVE_AVAILABLE, reason="mt4native extension not built")
+class TestLatencyHistogram:
+    """Bucket math of MT4LatencyHistogram, through mt4native.latency_summary"""
+
+    def summary(self, samples):
+        import mt4native
+
+        return mt4native.latency_summary(samples)
+
+    def test_empty(self):
+        summary = self.summary([])
+        assert summary['count'] == 0
+        assert summary['p50_us'] == 0.0
+        assert summary['max_us'] == 0.0
+
+    def test_small_values_are_exact(self):
+        # Below 16 ns every value has its own bucket
+        summary = self.summary([7] * 100)
+        assert summary['p50_us'] == pytest.approx(0.007)
+        assert summary['p999_us'] == pytest.approx(0.007)
+
+    def test_percentile_is_bucket_upper_edge(self):
+        # 1000 ns falls in [992, 1023]; 5000 ns in [4864, 5119], capped by the max
+        summary = self.summary([1000] * 99 + [5000])
+        assert summary['count'] == 100
+        assert summary['p50_us'] == pytest.approx(1.023)
+        assert summary['p99_us'] == pytest.approx(1.023)
+        assert summary['p999_us'] == pytest.approx(5.0)
+        assert summary['max_us'] == pytest.approx(5.0)
+        assert summary['mean_us'] == pytest.approx(1.04)
+
+    def test_relative_error_bound(self):
+        # 16 sub-buckets per power of two: never under, at most 1/16 over
+        for nanos in (17, 100, 1234, 65537, 999999, 123456789):
+            p50 = self.summary([nanos, nanos * 100])['p50_us'] * 1000
+            assert nanos <= p50 + 1e-6
+            assert p50 < nanos * (1 + 1 / 16) + 1
+
+    def test_overflow_reports_maximum(self):
+        # Values past 2^40 ns share the last bucket, which must not understate them
+        summary = self.summary([1 << 41, 1 << 42])
+        assert summary['p50_us'] * 1000 == pytest.approx(1 << 42)
+        assert summary['max_us'] * 1000 == pytest.approx(1 << 42)
+
+
+class TestBars:
+    """Bar buffers mapped through the bar layout"""
+
+    BAR_FIELDS = [('time', '<i4', 0), ('symbol_id', '<i4', 4), ('period', '<i4', 8), ('ticks', '<i4', 12),
+                  ('open', '<f8', 16), ('high', '<f8', 24), ('low', '<f8', 32), ('close', '<f8', 40)]
+
+    class FakeManager:
+        def __init__(self, bars):
+            self.bars_data = bars
+            self.calls = []
+
+        def bars(self, symbol, period, count, forming):
+            self.calls.append((symbol, period, count, forming))
+            if symbol != 'EURUSD':
+                return None
+            return b''.join(struct.pack('<4i4d', *bar) for bar in self.bars_data)
+
+    def make_wrapper(self, bars):
+        wrapper = mt4_native.NativeManager.__new__(mt4_native.NativeManager)
+        wrapper.manager = self.FakeManager(bars)
+        return wrapper
+
+    def teardown_method(self):
+        mt4_native._dtype_cache.pop(KIND_BAR, None)
+
+    def test_get_bars_maps_records(self, monkeypatch):
+        np = pytest.importorskip('numpy')
+        monkeypatch.setattr(mt4_native, 'NATIVE_AVAILABLE', True)
+        mt4_native._dtype_cache[KIND_BAR] = build_dtype(48, self.BAR_FIELDS)
+        wrapper = self.make_wrapper([(1700000040, 0, 0, 3, 1.1, 1.2, 1.0, 1.15),
+                                     (1700000100, 0, 0, 1, 1.15, 1.15, 1.15, 1.15)])
+
+        bars = wrapper.get_bars('EURUSD', 'M5', 10, False)
+        assert wrapper.manager.calls == [('EURUSD', 1, 10, False)]
+        assert bars['time'].tolist() == [1700000040, 1700000100]
+        assert np.allclose(bars['high'], [1.2, 1.15])
+        assert bars['ticks'][0] == 3
+
+    def test_unknown_symbol_returns_none(self):
+        wrapper = self.make_wrapper([])
+        assert wrapper.get_bars('XAUUSD') is None
+
+    def test_unknown_period(self):
+        wrapper = self.make_wrapper([])
+        with pytest.raises(ValueError):
+            wrapper.get_bars('EURUSD', 'D1')
+        assert wrapper.manager.calls == []
+
+    def test_bar_layout_matches_struct(self):
+        pytest.importorskip('numpy')
+        dtype = build_dtype(48, self.BAR_FIELDS)
+        record = struct.pack('<4i4d', 60, 2, 0, 5, 1.0, 2.0, 0.5, 1.5)
+
+        bar = as_array(record, dtype)[0]
+        assert bar['symbol_id'] == 2
+        assert bar['low'] == 0.5
+        assert bar['close'] == 1.5
+
+
+@pytest.mark.skipif(not NATIVE_AVAILABLE, reason="mt4native extension not built")
+class TestBarBuilder:
+    """Bar logic of MT4BarBuilder, through mt4native.replay_bars"""
+
+    # Opens an M1 bar; the M5 bar it falls in ends a minute later
+    T = 1700000040
+
+    def replay(self, ticks, symbol='EURUSD', **kwargs):
+        import mt4native
+
+        buffer, late = mt4native.replay_bars(ticks, symbol, **kwargs)
+        bars = [bar for bar in struct.iter_unpack('<4i4d', bytes(memoryview(buffer)))]
+        return bars, late
+
+    def test_bar_closes_on_later_tick(self):
+        ticks = [('EURUSD', 1.1, self.T + 1), ('EURUSD', 1.3, self.T + 30), ('EURUSD', 1.0, self.T + 59)]
+
+        bars, _ = self.replay(ticks, forming=False)
+        assert bars == []
+
+        bars, _ = self.replay(ticks + [('EURUSD', 1.2, self.T + 61)], forming=False)
+        assert len(bars) == 1
+        time, symbol_id, period, count, open_, high, low, close = bars[0]
+        assert (time, period, count) == (self.T, 0, 3)
+        assert (open_, high, low, close) == pytest.approx((1.1, 1.3, 1.0, 1.0))
+
+        bars, _ = self.replay(ticks + [('EURUSD', 1.2, self.T + 61)])
+        assert [bar[0] for bar in bars] == [self.T, self.T + 60]
+        assert bars[1][3] == 1
+
+    def test_quiet_symbol_closes_on_server_clock(self):
+        ticks = [('EURUSD', 1.1, self.T + 5)]
+        assert self.replay(ticks, forming=False)[0] == []
+
+        # Another symbol's later tick moves the server clock past the bar
+        bars, _ = self.replay(ticks + [('GBPUSD', 1.3, self.T + 65)], forming=False)
+        assert len(bars) == 1
+        assert bars[0][0] == self.T
+        assert bars[0][7] == pytest.approx(1.1)
+
+    def test_late_tick_is_dropped(self):
+        ticks = [('EURUSD', 1.1, self.T + 5), ('EURUSD', 1.2, self.T + 65), ('EURUSD', 1.5, self.T + 10)]
+
+        bars, late = self.replay(ticks, forming=False)
+        assert len(bars) == 1
+        assert bars[0][5] == pytest.approx(1.1)
+        # Late for the closed M1 and M5 bars; the H1 bar is still forming
+        assert late == 2
+
+        bars, _ = self.replay(ticks, period=2)
+        assert len(bars) == 1
+        assert bars[0][3] == 3
+        assert bars[0][5] == pytest.approx(1.5)
+
+    def test_history_caps_closed_bars(self):
+        ticks = [('EURUSD', 1.0 + i / 10, self.T + 60 * i) for i in range(5)]
+
+        bars, _ = self.replay(ticks, history=2)
+        assert [bar[0] for bar in bars] == [self.T + 120, self.T + 180, self.T + 240]
+
+    def test_unknown_period(self):
+        import mt4native
+
+        with pytest.raises(ValueError):
+            mt4native.replay_bars([], 'EURUSD', 7)
+
+    def test_history_above_cap(self):
+        import mt4native
+
+        with pytest.raises(ValueError):
+            mt4native.replay_bars([], 'EURUSD', history=mt4native.BAR_MAX_HISTORY + 1)
+        bars, _ = self.replay([('EURUSD', 1.1, self.T)], history=mt4native.BAR_MAX_HISTORY)
+        assert len(bars) == 1
+
+
+@pytest.mark.skipif(not NATIVE_AVAILABLE, reason="mt4native extension not built")
+class TestNativeModule:
+    """Native record layouts"""
+
+    def test_record_fields(self):
+        import mt4native
+
+        for kind in (KIND_TRADE, KIND_USER, KIND_SYMBOL, KIND_BAR):
+            itemsize, fields = mt4native.record_fields(kind)
+            assert itemsize > 0
+            for name, fmt, offset in fields:
+                assert 0 <= offset < itemsize
+
+    def test_trade_record_layout(self):
+        import mt4native
+
+        itemsize, fields = mt4native.record_fields(KIND_TRADE)
+        layout = {name: (fmt, offset) for name, fmt, offset in fields}
+        assert itemsize == 256
+        assert layout['order'] == ('<i4', 0)
+        assert layout['symbol'][0] == 'S12'
+
+    def test_unknown_kind(self):
+        import mt4native
+
+        with pytest.raises(ValueError):
+            mt4native.record_fields(99)
@@ -0,0 +1,269 @@
+"""
+Test MT4 Binary Wire Format
+"""
+
+import pytest
+import asyncio
+import struct
+from unittest.mock import Mock, MagicMock
+from datetime import datetime
+
+# Add parent directory to path
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
+
+from mt4_wire import (HEADER, QUOTE, TRADE, SYMBOL, TRADE_EVENT, WIRE_MAGIC, WIRE_VERSION,
+                      WIRE_QUOTES, WIRE_TRADES, WIRE_SYMBOLS, WIRE_TRADE_EVENTS,
+                      WireFormatError, WireQuote, WireTrade, WireTradeEvent, WireSymbol,
+                      SymbolRegistry, decode_frame, read_header, encode_quotes,
+                      encode_trades, encode_trade_events, encode_symbols)
+from mt4_pumping import QuoteData, TradeData
+from mt4_websocket import MT4WebSocketServer, ClientInfo
+
+
+def make_trade(**overrides):
+    fields = dict(order=1001, login=5001, symbol_id=3, cmd=0, volume=150,
+                  state=0, digits=5, open_price=1.08501, close_price=0.0,
+                  sl=1.08, tp=1.09, profit=12.5, commission=-1.0,
+                  storage=-0.25, open_time=1700000000, close_time=0)
+    fields.update(overrides)
+    return WireTrade(**fields)
+
+
+class TestWireLayout:
+    """Record sizes must match the packed structs in MT4WireFormat.h"""
+
+    def test_record_sizes(self):
+        assert HEADER.size == 16
+        assert QUOTE.size == 32
+        assert TRADE.size == 104
+        assert SYMBOL.size == 40
+        assert TRADE_EVENT.size == 112
+
+    def test_header_fields(self):
+        frame = encode_quotes([WireQuote(7, 1, 1.1, 1.2, 100)])
+        magic, version, frame_type, count, record_size = HEADER.unpack_from(frame, 0)
+
+        assert magic == WIRE_MAGIC
+        assert frame[:4] == b'MT4W'
+        assert version == WIRE_VERSION
+        assert frame_type == WIRE_QUOTES
+        assert count == 1
+        assert record_size == QUOTE.size
+
+
+class TestWireRoundTrip:
+    """Encode/decode round trips"""
+
+    def test_quotes(self):
+        quotes = [WireQuote(0, 10, 1.08500, 1.08520, 1700000000),
+                  WireQuote(1, 11, 150.123, 150.140, 1700000001)]
+        frame = encode_quotes(quotes)
+
+        assert len(frame) == HEADER.size + 2 * QUOTE.size
+        frame_type, records = decode_frame(frame)
+        assert frame_type == WIRE_QUOTES
+        assert records == quotes
+
+    def test_trades(self):
+        trades = [make_trade(), make_trade(order=1002, cmd=1, state=3, close_time=1700000100)]
+        frame_type, records = decode_frame(encode_trades(trades))
+
+        assert frame_type == WIRE_TRADES
+        assert records == trades
+
+    def test_trade_events(self):
+        events = [WireTradeEvent(0, make_trade()), WireTradeEvent(2, make_trade(order=1003, state=3))]
+        frame_type, records = decode_frame(encode_trade_events(events))
+
+        assert frame_type == WIRE_TRADE_EVENTS
+        assert records == events
+
+    def test_symbols(self):
+        symbols = [WireSymbol(0, 5, 0.00001, 100000.0, 'EURUSD'),
+                   WireSymbol(1, 2, 0.01, 100.0, 'XAUUSD')]
+        frame_type, records = decode_frame(encode_symbols(symbols))
+
+        assert frame_type == WIRE_SYMBOLS
+        assert records == symbols
+
+    def test_empty_frame(self):
+        frame_type, records = decode_frame(encode_quotes([]))
+        assert frame_type == WIRE_QUOTES
+        assert records == []
+
+    def test_larger_records_are_skipped_forward(self):
+        """Readers honour record_size so later versions can append fields"""
+        record = QUOTE.pack(4, 2, 1.5, 1.6, 99) + b'\xff' * 8
+        frame = HEADER.pack(WIRE_MAGIC, WIRE_VERSION, WIRE_QUOTES, 2, QUOTE.size + 8) + record * 2
+
+        _, records = decode_frame(frame)
+        assert records == [WireQuote(4, 2, 1.5, 1.6, 99)] * 2
+
+    def test_numpy_view(self):
+        np = pytest.importorskip('numpy')
+        from mt4_wire import as_numpy
+
+        frame = encode_quotes([WireQuote(i, i, 1.0 + i, 2.0 + i, i) for i in range(5)])
+        array = as_numpy(frame)
+
+        assert len(array) == 5
+        assert array['symbol_id'].tolist() == [0, 1, 2, 3, 4]
+        assert np.allclose(array['ask'], [2.0, 3.0, 4.0, 5.0, 6.0])
+
+
+class TestWireValidation:
+    """Malformed frames are rejected"""
+
+    def test_short_buffer(self):
+        with pytest.raises(WireFormatError):
+            read_header(b'MT4W')
+
+    def test_bad_magic(self):
+        frame = bytearray(encode_quotes([WireQuote(0, 0, 1.0, 1.0, 0)]))
+        frame[0] = 0
+        with pytest.raises(WireFormatError):
+            decode_frame(bytes(frame))
+
+    def test_newer_version(self):
+        frame = HEADER.pack(WIRE_MAGIC, WIRE_VERSION + 1, WIRE_QUOTES, 0, QUOTE.size)
+        with pytest.raises(WireFormatError):
+            read_header(frame)
+
+    def test_truncated(self):
+        frame = encode_quotes([WireQuote(0, 0, 1.0, 1.0, 0)] * 3)
+        with pytest.raises(WireFormatError):
+            decode_frame(frame[:-1])
+
+    def test_unknown_type(self):
+        frame = HEADER.pack(WIRE_MAGIC, WIRE_VERSION, 99, 0, 8)
+        with pytest.raises(WireFormatError):
+            read_header(frame)
+
+
+class TestSymbolRegistry:
+    """Python-side symbol id assignment"""
+
+    def test_dense_ids(self):
+        registry = SymbolRegistry()
+        assert registry.get_id('EURUSD') == 0
+        assert registry.get_id('GBPUSD') == 1
+        assert registry.get_id('EURUSD') == 0
+        assert registry.get_name(1) == 'GBPUSD'
+        assert registry.get_name(5) is None
+
+    def test_definition_frame(self):
+        registry = SymbolRegistry()
+        frame_type, records = decode_frame(registry.definition('USDJPY', digits=3))
+
+        assert frame_type == WIRE_SYMBOLS
+        assert records[0].name == 'USDJPY'
+        assert records[0].symbol_id == 0
+        assert records[0].digits == 3
+
+    def test_native_ids(self):
+        native = {'EURUSD': 4, 'GBPUSD': 9}
+        registry = SymbolRegistry(lambda symbol: native.get(symbol, -1))
+
+        assert registry.get_id('GBPUSD') == 9
+        assert registry.get_id('EURUSD') == 4
+        assert registry.get_name(9) == 'GBPUSD'
+
+        # Names the native side has not interned stay clear of its ids
+        assert registry.get_id('XAUUSD') == SymbolRegistry.LOCAL_ID_BASE
+        assert registry.get_id('XAUUSD') == SymbolRegistry.LOCAL_ID_BASE
+
+        # ...until the connector sees them
+        native['XAUUSD'] = 12
+        assert registry.get_id('XAUUSD') == 12
+        assert registry.get_name(12) == 'XAUUSD'
+
+    def test_loaded_specifications(self):
+        registry = SymbolRegistry()
+        registry.load([{'symbol': b'USDJPY\x00\x00', 'digits': 3, 'point': 0.001,
+                        'contract_size': 100000.0}])
+        _, records = decode_frame(registry.definition('USDJPY'))
+
+        assert records[0].digits == 3
+        assert records[0].point == 0.001
+        assert records[0].contract_size == 100000.0
+
+
+class TestWebSocketBinary:
+    """Binary streaming through the WebSocket server"""
+
+    @pytest.fixture
+    def ws_server(self):
+        return MT4WebSocketServer('localhost', 8765)
+
+    def add_client(self, ws_server, client_id, binary, login=None):
+        mock_ws = Mock()
+        mock_ws.send = MagicMock(side_effect=lambda message: asyncio.sleep(0))
+        ws_server.clients[client_id] = ClientInfo(
+            websocket=mock_ws,
+            client_id=client_id,
+            connected_at=datetime.now(),
+            authenticated=True,
+            user_login=login,
+            subscriptions={'EURUSD'},
+            binary=binary
+        )
+        ws_server.symbol_subscribers.setdefault('EURUSD', set()).add(client_id)
+        return mock_ws
+
+    @pytest.mark.asyncio
+    async def test_set_format(self, ws_server):
+        mock_ws = self.add_client(ws_server, 'c1', binary=False)
+
+        await ws_server.process_message('c1', '{"action": "set_format", "format": "binary"}')
+
+        assert ws_server.clients['c1'].binary is True
+        assert '"format_update"' in mock_ws.send.call_args[0][0]
+
+    @pytest.mark.asyncio
+    async def test_binary_quote_with_symbol_definition(self, ws_server):
+        binary_ws = self.add_client(ws_server, 'bin', binary=True)
+        json_ws = self.add_client(ws_server, 'json', binary=False)
+
+        quote = QuoteData(symbol='EURUSD', bid=1.0850, ask=1.0852, spread=2.0,
+                          time=1700000000, server_time=datetime.now(), digits=5, point=0.00001)
+        await ws_server.broadcast_quote(quote)
+        await ws_server.broadcast_quote(quote)
+
+        # Symbol definition is sent once, before the first quote
+        sent = [call[0][0] for call in binary_ws.send.call_args_list]
+        assert len(sent) == 3
+        definition = decode_frame(sent[0])[1][0]
+        assert definition.name == 'EURUSD'
+        assert definition.digits == 5
+        assert definition.point == 0.00001
+        frame_type, quotes = decode_frame(sent[1])
+        assert frame_type == WIRE_QUOTES
+        assert quotes[0].bid == 1.0850
+        assert quotes[0].symbol_id == ws_server.symbol_registry.get_id('EURUSD')
+
+        # JSON clients are unaffected
+        assert json_ws.send.call_count == 2
+        assert isinstance(json_ws.send.call_args[0][0], str)
+
+    @pytest.mark.asyncio
+    async def test_binary_trade(self, ws_server):
+        binary_ws = self.add_client(ws_server, 'bin', binary=True, login=5001)
+
+        trade = TradeData(order=77, login=5001, symbol='EURUSD', cmd=1, volume=0.5,
+                          open_price=1.085, close_price=0.0, sl=0.0, tp=0.0,
+                          profit=-3.0, state='open', digits=5, commission=-1.5,
+                          storage=-0.25, open_time=1700000000)
+        await ws_server.broadcast_trade(trade, 5001)
+
+        frame_type, trades = decode_frame(binary_ws.send.call_args[0][0])
+        assert frame_type == WIRE_TRADES
+        assert trades[0].order == 77
+        assert trades[0].volume == 50
+        assert trades[0].state == 0
+        assert trades[0].digits == 5
+        assert trades[0].commission == -1.5
+        assert trades[0].storage == -0.25
+        assert trades[0].open_time == 1700000000
+        assert trades[0].close_time == 0